@@ -6,9 +6,15 @@
 
 #include <addrman.h>
 
+#include <crypto/siphash.h>
+#include <dbwrapper.h>
 #include <hash.h>
 #include <serialize.h>
 
+static const std::string DB_ADDRMAN_KEY = "am_key";
+static const std::string DB_ADDRMAN_ENTRY = "am_a";
+static const std::string DB_ADDRMAN_NEW_BUCKET = "am_n";
+
 int CAddrInfo::GetTriedBucket(const uint256& nKey) const
 {
     uint64_t hash1 = (CHashWriter(SER_GETHASH, 0) << nKey << GetKey()).GetCheapHash();
@@ -65,29 +71,284 @@ double CAddrInfo::GetChance(int64_t nNow) const
     return fChance;
 }
 
+CNetAddrHasher::CNetAddrHasher() :
+    k0(GetRand(std::numeric_limits<uint64_t>::max())),
+    k1(GetRand(std::numeric_limits<uint64_t>::max()))
+{
+}
+
+size_t CNetAddrHasher::operator()(const CNetAddr& addr) const
+{
+    // CNetAddr equality only considers the 16 address bytes, so must the hash
+    unsigned char vch[16];
+    for (int i = 0; i < 16; i++) {
+        vch[i] = addr.GetByte(15 - i);
+    }
+    return CSipHasher(k0, k1).Write(vch, sizeof(vch)).Finalize();
+}
+
+CAddrMan::CAddrMan()
+{
+    Clear();
+    fWipeDB = false;
+}
+
+CAddrMan::~CAddrMan()
+{
+    nKey.SetNull();
+}
+
+bool CAddrMan::InitDB(bool fWipe)
+{
+    LOCK2(cs_db, cs);
+
+    Clear();
+    fWipeDB = false;
+    fTrackChanges = true;
+    // LevelDB only allows one handle per database, so the previous one has to be closed first
+    db.reset();
+    try {
+        db = MakeUnique<CDBWrapper>(GetDataDir() / "peers", 1 << 20, false, fWipe);
+    } catch (const std::exception& e) {
+        return error("CAddrMan::%s -- failed to open database: %s", __func__, e.what());
+    }
+
+    if (!db->Read(DB_ADDRMAN_KEY, nKey)) {
+        // fresh database, the next flush writes our new key
+        fWipeDB = true;
+        return true;
+    }
+
+    // Entries are loaded the same way as in Unserialize: tried entries go to the positions their key dictates,
+    // positions in the new table are then restored from the stored bucket contents.
+    int nLost = 0;
+    {
+        std::unique_ptr<CDBIterator> pcursor(db->NewIterator());
+        auto start = std::make_tuple(DB_ADDRMAN_ENTRY, CService());
+        pcursor->Seek(start);
+        while (pcursor->Valid()) {
+            decltype(start) k;
+            if (!pcursor->GetKey(k) || std::get<0>(k) != DB_ADDRMAN_ENTRY) {
+                break;
+            }
+            std::pair<CAddrInfo, bool> entry;
+            if (!pcursor->GetValue(entry)) {
+                return error("CAddrMan::%s -- failed to read entry for %s", __func__, std::get<1>(k).ToString());
+            }
+            CAddrInfo& info = entry.first;
+            pcursor->Next();
+
+            if (mapAddr.count(info)) {
+                vErased.emplace_back(std::get<1>(k));
+                continue;
+            }
+            if (entry.second) {
+                int nKBucket = info.GetTriedBucket(nKey);
+                int nKBucketPos = info.GetBucketPosition(nKey, false, nKBucket);
+                if (vvTried[nKBucket][nKBucketPos] != -1) {
+                    vErased.emplace_back(info);
+                    nLost++;
+                    continue;
+                }
+                vvTried[nKBucket][nKBucketPos] = vInfo.size();
+                info.fInTried = true;
+                nTried++;
+            } else {
+                nNew++;
+            }
+            int nId = vInfo.size();
+            info.nRandomPos = vRandom.size();
+            info.fDirty = false;
+            vRandom.push_back(nId);
+            mapAddr[info] = nId;
+            vInfo.push_back(info);
+        }
+    }
+    {
+        std::unique_ptr<CDBIterator> pcursor(db->NewIterator());
+        auto start = std::make_tuple(DB_ADDRMAN_NEW_BUCKET, 0);
+        pcursor->Seek(start);
+        while (pcursor->Valid()) {
+            decltype(start) k;
+            if (!pcursor->GetKey(k) || std::get<0>(k) != DB_ADDRMAN_NEW_BUCKET) {
+                break;
+            }
+            int bucket = std::get<1>(k);
+            std::vector<CService> vBucket;
+            if (!pcursor->GetValue(vBucket)) {
+                return error("CAddrMan::%s -- failed to read new bucket %d", __func__, bucket);
+            }
+            pcursor->Next();
+
+            if (bucket < 0 || bucket >= ADDRMAN_NEW_BUCKET_COUNT) {
+                continue;
+            }
+            for (const CService& addr : vBucket) {
+                int nId;
+                CAddrInfo* pinfo = Find(addr, &nId);
+                // a mismatch means the bucket's row is outdated and gets rewritten at the next flush
+                if (!pinfo || pinfo->fInTried || (CService)*pinfo != addr) {
+                    vNewBucketsDirty.set(bucket);
+                    continue;
+                }
+                int nUBucketPos = pinfo->GetBucketPosition(nKey, true, bucket);
+                if (vvNew[bucket][nUBucketPos] == -1 && pinfo->nRefCount < ADDRMAN_NEW_BUCKETS_PER_ADDRESS) {
+                    vvNew[bucket][nUBucketPos] = nId;
+                    pinfo->nRefCount++;
+                } else {
+                    vNewBucketsDirty.set(bucket);
+                }
+            }
+        }
+    }
+
+    // Prune new entries which ended up without a position
+    int nLostUnk = 0;
+    for (size_t nId = 0; nId < vInfo.size(); nId++) {
+        const CAddrInfo& info = vInfo[nId];
+        if (info.nRandomPos != -1 && !info.fInTried && info.nRefCount == 0) {
+            Delete(nId);
+            nLostUnk++;
+        }
+    }
+    if (nLost + nLostUnk > 0) {
+        LogPrint(BCLog::ADDRMAN, "addrman lost %i new and %i tried addresses due to collisions\n", nLostUnk, nLost);
+    }
+    nSize = vRandom.size();
+
+    Check();
+    return true;
+}
+
+void CAddrMan::Flush()
+{
+    LOCK(cs_db);
+    if (!db) {
+        return;
+    }
+
+    int64_t nStart = GetTimeMillis();
+
+    // only hold cs while collecting, serialization and writing happen outside of it
+    bool fWipe;
+    uint256 nKeyCopy;
+    std::vector<std::pair<CAddrInfo, bool>> vEntries;
+    std::vector<std::pair<int, std::vector<CService>>> vBuckets;
+    std::vector<CService> vErasedCopy;
+    {
+        LOCK(cs);
+        fWipe = fWipeDB;
+        fWipeDB = false;
+        nKeyCopy = nKey;
+        for (CAddrInfo& info : vInfo) {
+            if (info.nRandomPos != -1 && (fWipe || info.fDirty)) {
+                vEntries.emplace_back(info, info.fInTried);
+                info.fDirty = false;
+            }
+        }
+        for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
+            if (!fWipe && !vNewBucketsDirty.test(bucket)) {
+                continue;
+            }
+            std::vector<CService> vBucket;
+            for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
+                if (vvNew[bucket][i] != -1) {
+                    vBucket.emplace_back(vInfo[vvNew[bucket][i]]);
+                }
+            }
+            vBuckets.emplace_back(bucket, std::move(vBucket));
+        }
+        vNewBucketsDirty.reset();
+        vErasedCopy.swap(vErased);
+    }
+
+    CDBBatch batch(*db);
+    if (fWipe) {
+        // the key changed, so all existing entries and buckets are invalid
+        std::unique_ptr<CDBIterator> pcursor(db->NewIterator());
+        auto startEntry = std::make_tuple(DB_ADDRMAN_ENTRY, CService());
+        for (pcursor->Seek(startEntry); pcursor->Valid(); pcursor->Next()) {
+            decltype(startEntry) k;
+            if (!pcursor->GetKey(k) || std::get<0>(k) != DB_ADDRMAN_ENTRY) {
+                break;
+            }
+            batch.Erase(k);
+        }
+        auto startBucket = std::make_tuple(DB_ADDRMAN_NEW_BUCKET, 0);
+        for (pcursor->Seek(startBucket); pcursor->Valid(); pcursor->Next()) {
+            decltype(startBucket) k;
+            if (!pcursor->GetKey(k) || std::get<0>(k) != DB_ADDRMAN_NEW_BUCKET) {
+                break;
+            }
+            batch.Erase(k);
+        }
+    }
+    // erasures come first, an address might have been deleted and re-added since the last flush
+    for (const CService& addr : vErasedCopy) {
+        batch.Erase(std::make_tuple(DB_ADDRMAN_ENTRY, addr));
+    }
+    for (const auto& entry : vEntries) {
+        batch.Write(std::make_tuple(DB_ADDRMAN_ENTRY, (CService)entry.first), entry);
+    }
+    for (const auto& p : vBuckets) {
+        if (p.second.empty()) {
+            batch.Erase(std::make_tuple(DB_ADDRMAN_NEW_BUCKET, p.first));
+        } else {
+            batch.Write(std::make_tuple(DB_ADDRMAN_NEW_BUCKET, p.first), p.second);
+        }
+    }
+    batch.Write(DB_ADDRMAN_KEY, nKeyCopy);
+    db->WriteBatch(batch);
+
+    LogPrint(BCLog::ADDRMAN, "CAddrMan::%s -- wrote %d changed entries and %d new buckets, erased %d entries, %dms\n",
+        __func__, vEntries.size(), vBuckets.size(), vErasedCopy.size(), GetTimeMillis() - nStart);
+}
+
+std::pair<int, int> CAddrMan::CalcNewPosition(const CAddress& addr, const CNetAddr& source, const uint256& nKeyIn)
+{
+    CAddrInfo info(addr, source);
+    int nUBucket = info.GetNewBucket(nKeyIn, source);
+    return std::make_pair(nUBucket, info.GetBucketPosition(nKeyIn, true, nUBucket));
+}
+
+std::vector<int> CAddrMan::CalcNewBucketPositions(const CService& addr, const uint256& nKeyIn)
+{
+    CAddrInfo info(CAddress(addr, NODE_NONE), CNetAddr());
+    std::vector<int> vPositions(ADDRMAN_NEW_BUCKET_COUNT);
+    for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
+        vPositions[bucket] = info.GetBucketPosition(nKeyIn, true, bucket);
+    }
+    return vPositions;
+}
+
 CAddrInfo* CAddrMan::Find(const CNetAddr& addr, int* pnId)
 {
-    std::map<CNetAddr, int>::iterator it = mapAddr.find(addr);
+    auto it = mapAddr.find(addr);
     if (it == mapAddr.end())
         return nullptr;
     if (pnId)
         *pnId = (*it).second;
-    std::map<int, CAddrInfo>::iterator it2 = mapInfo.find((*it).second);
-    if (it2 != mapInfo.end())
-        return &(*it2).second;
-    return nullptr;
+    return &vInfo[(*it).second];
 }
 
 CAddrInfo* CAddrMan::Create(const CAddress& addr, const CNetAddr& addrSource, int* pnId)
 {
-    int nId = nIdCount++;
-    mapInfo[nId] = CAddrInfo(addr, addrSource);
+    int nId;
+    if (!vFreeIds.empty()) {
+        nId = vFreeIds.back();
+        vFreeIds.pop_back();
+        vInfo[nId] = CAddrInfo(addr, addrSource);
+    } else {
+        nId = vInfo.size();
+        vInfo.emplace_back(addr, addrSource);
+    }
     mapAddr[addr] = nId;
-    mapInfo[nId].nRandomPos = vRandom.size();
+    vInfo[nId].nRandomPos = vRandom.size();
     vRandom.push_back(nId);
+    nSize = vRandom.size();
     if (pnId)
         *pnId = nId;
-    return &mapInfo[nId];
+    return &vInfo[nId];
 }
 
 void CAddrMan::SwapRandom(unsigned int nRndPos1, unsigned int nRndPos2)
@@ -100,11 +361,11 @@ void CAddrMan::SwapRandom(unsigned int nRndPos1, unsigned int nRndPos2)
     int nId1 = vRandom[nRndPos1];
     int nId2 = vRandom[nRndPos2];
 
-    assert(mapInfo.count(nId1) == 1);
-    assert(mapInfo.count(nId2) == 1);
+    assert(IsUsed(nId1));
+    assert(IsUsed(nId2));
 
-    mapInfo[nId1].nRandomPos = nRndPos2;
-    mapInfo[nId2].nRandomPos = nRndPos1;
+    vInfo[nId1].nRandomPos = nRndPos2;
+    vInfo[nId2].nRandomPos = nRndPos1;
 
     vRandom[nRndPos1] = nId2;
     vRandom[nRndPos2] = nId1;
@@ -112,15 +373,22 @@ void CAddrMan::SwapRandom(unsigned int nRndPos1, unsigned int nRndPos2)
 
 void CAddrMan::Delete(int nId)
 {
-    assert(mapInfo.count(nId) != 0);
-    CAddrInfo& info = mapInfo[nId];
+    assert(IsUsed(nId));
+    CAddrInfo& info = vInfo[nId];
     assert(!info.fInTried);
     assert(info.nRefCount == 0);
 
     SwapRandom(info.nRandomPos, vRandom.size() - 1);
     vRandom.pop_back();
+    nSize = vRandom.size();
     mapAddr.erase(info);
-    mapInfo.erase(nId);
+    if (fTrackChanges) {
+        vErased.emplace_back(info);
+    }
+    // the slot gets reused, so it must not be referenced as a collision anymore
+    m_tried_collisions.erase(nId);
+    info = CAddrInfo();
+    vFreeIds.push_back(nId);
     nNew--;
 }
 
@@ -129,23 +397,25 @@ void CAddrMan::ClearNew(int nUBucket, int nUBucketPos)
     // if there is an entry in the specified bucket, delete it.
     if (vvNew[nUBucket][nUBucketPos] != -1) {
         int nIdDelete = vvNew[nUBucket][nUBucketPos];
-        CAddrInfo& infoDelete = mapInfo[nIdDelete];
+        CAddrInfo& infoDelete = vInfo[nIdDelete];
         assert(infoDelete.nRefCount > 0);
         infoDelete.nRefCount--;
         vvNew[nUBucket][nUBucketPos] = -1;
+        vNewBucketsDirty.set(nUBucket);
         if (infoDelete.nRefCount == 0) {
             Delete(nIdDelete);
         }
     }
 }
 
-void CAddrMan::MakeTried(CAddrInfo& info, int nId)
+void CAddrMan::MakeTried(CAddrInfo& info, int nId, const std::vector<int>* pNewPositions)
 {
     // remove the entry from all new buckets
     for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
-        int pos = info.GetBucketPosition(nKey, true, bucket);
+        int pos = pNewPositions ? (*pNewPositions)[bucket] : info.GetBucketPosition(nKey, true, bucket);
         if (vvNew[bucket][pos] == nId) {
             vvNew[bucket][pos] = -1;
+            vNewBucketsDirty.set(bucket);
             info.nRefCount--;
         }
     }
@@ -161,11 +431,12 @@ void CAddrMan::MakeTried(CAddrInfo& info, int nId)
     if (vvTried[nKBucket][nKBucketPos] != -1) {
         // find an item to evict
         int nIdEvict = vvTried[nKBucket][nKBucketPos];
-        assert(mapInfo.count(nIdEvict) == 1);
-        CAddrInfo& infoOld = mapInfo[nIdEvict];
+        assert(IsUsed(nIdEvict));
+        CAddrInfo& infoOld = vInfo[nIdEvict];
 
         // Remove the to-be-evicted item from the tried set.
         infoOld.fInTried = false;
+        infoOld.fDirty = true;
         vvTried[nKBucket][nKBucketPos] = -1;
         nTried--;
 
@@ -178,6 +449,7 @@ void CAddrMan::MakeTried(CAddrInfo& info, int nId)
         // Enter it into the new set again.
         infoOld.nRefCount = 1;
         vvNew[nUBucket][nUBucketPos] = nIdEvict;
+        vNewBucketsDirty.set(nUBucket);
         nNew++;
     }
     assert(vvTried[nKBucket][nKBucketPos] == -1);
@@ -185,9 +457,10 @@ void CAddrMan::MakeTried(CAddrInfo& info, int nId)
     vvTried[nKBucket][nKBucketPos] = nId;
     nTried++;
     info.fInTried = true;
+    info.fDirty = true;
 }
 
-void CAddrMan::Good_(const CService& addr, bool test_before_evict, int64_t nTime)
+void CAddrMan::Good_(const CService& addr, bool test_before_evict, int64_t nTime, const std::vector<int>* pNewPositions)
 {
     int nId;
 
@@ -209,6 +482,7 @@ void CAddrMan::Good_(const CService& addr, bool test_before_evict, int64_t nTime
     info.nLastSuccess = nTime;
     info.nLastTry = nTime;
     info.nAttempts = 0;
+    info.fDirty = true;
     // nTime is not updated here, to avoid leaking information about
     // currently-connected peers.
 
@@ -221,7 +495,7 @@ void CAddrMan::Good_(const CService& addr, bool test_before_evict, int64_t nTime
     int nUBucket = -1;
     for (unsigned int n = 0; n < ADDRMAN_NEW_BUCKET_COUNT; n++) {
         int nB = (n + nRnd) % ADDRMAN_NEW_BUCKET_COUNT;
-        int nBpos = info.GetBucketPosition(nKey, true, nB);
+        int nBpos = pNewPositions ? (*pNewPositions)[nB] : info.GetBucketPosition(nKey, true, nB);
         if (vvNew[nB][nBpos] == nId) {
             nUBucket = nB;
             break;
@@ -240,8 +514,8 @@ void CAddrMan::Good_(const CService& addr, bool test_before_evict, int64_t nTime
     // Will moving this address into tried evict another entry?
     if (test_before_evict && (vvTried[tried_bucket][tried_bucket_pos] != -1)) {
         // Output the entry we'd be colliding with, for debugging purposes
-        auto colliding_entry = mapInfo.find(vvTried[tried_bucket][tried_bucket_pos]);
-        LogPrint(BCLog::ADDRMAN, "Collision inserting element into tried table (%s), moving %s to m_tried_collisions=%d\n", colliding_entry != mapInfo.end() ? colliding_entry->second.ToString() : "", addr.ToString(), m_tried_collisions.size());
+        int nIdColliding = vvTried[tried_bucket][tried_bucket_pos];
+        LogPrint(BCLog::ADDRMAN, "Collision inserting element into tried table (%s), moving %s to m_tried_collisions=%d\n", IsUsed(nIdColliding) ? vInfo[nIdColliding].ToString() : "", addr.ToString(), m_tried_collisions.size());
         if (m_tried_collisions.size() < ADDRMAN_SET_TRIED_COLLISION_SIZE) {
             m_tried_collisions.insert(nId);
         }
@@ -249,11 +523,11 @@ void CAddrMan::Good_(const CService& addr, bool test_before_evict, int64_t nTime
         LogPrint(BCLog::ADDRMAN, "Moving %s to tried\n", addr.ToString());
 
         // move nId to the tried tables
-        MakeTried(info, nId);
+        MakeTried(info, nId, pNewPositions);
     }
 }
 
-bool CAddrMan::Add_(const CAddress& addr, const CNetAddr& source, int64_t nTimePenalty)
+bool CAddrMan::Add_(const CAddress& addr, const CNetAddr& source, int64_t nTimePenalty, const std::pair<int, int>* pNewPosition)
 {
     if (!addr.IsRoutable())
         return false;
@@ -271,11 +545,16 @@ bool CAddrMan::Add_(const CAddress& addr, const CNetAddr& source, int64_t nTimeP
         // periodically update nTime
         bool fCurrentlyOnline = (GetAdjustedTime() - addr.nTime < 24 * 60 * 60);
         int64_t nUpdateInterval = (fCurrentlyOnline ? 60 * 60 : 24 * 60 * 60);
-        if (addr.nTime && (!pinfo->nTime || pinfo->nTime < addr.nTime - nUpdateInterval - nTimePenalty))
+        if (addr.nTime && (!pinfo->nTime || pinfo->nTime < addr.nTime - nUpdateInterval - nTimePenalty)) {
             pinfo->nTime = std::max((int64_t)0, addr.nTime - nTimePenalty);
+            pinfo->fDirty = true;
+        }
 
         // add services
-        pinfo->nServices = ServiceFlags(pinfo->nServices | addr.nServices);
+        if ((pinfo->nServices | addr.nServices) != pinfo->nServices) {
+            pinfo->nServices = ServiceFlags(pinfo->nServices | addr.nServices);
+            pinfo->fDirty = true;
+        }
 
         // do not update if no new information is present
         if (!addr.nTime || (pinfo->nTime && addr.nTime <= pinfo->nTime))
@@ -302,12 +581,19 @@ bool CAddrMan::Add_(const CAddress& addr, const CNetAddr& source, int64_t nTimeP
         fNew = true;
     }
 
-    int nUBucket = pinfo->GetNewBucket(nKey, source);
-    int nUBucketPos = pinfo->GetBucketPosition(nKey, true, nUBucket);
+    // the precalculated position is only valid if the entry has the same port as addr
+    int nUBucket, nUBucketPos;
+    if (pNewPosition && (fNew || (CService)*pinfo == (CService)addr)) {
+        nUBucket = pNewPosition->first;
+        nUBucketPos = pNewPosition->second;
+    } else {
+        nUBucket = pinfo->GetNewBucket(nKey, source);
+        nUBucketPos = pinfo->GetBucketPosition(nKey, true, nUBucket);
+    }
     if (vvNew[nUBucket][nUBucketPos] != nId) {
         bool fInsert = vvNew[nUBucket][nUBucketPos] == -1;
         if (!fInsert) {
-            CAddrInfo& infoExisting = mapInfo[vvNew[nUBucket][nUBucketPos]];
+            CAddrInfo& infoExisting = vInfo[vvNew[nUBucket][nUBucketPos]];
             if (infoExisting.IsTerrible() || (infoExisting.nRefCount > 1 && pinfo->nRefCount == 0)) {
                 // Overwrite the existing new table entry.
                 fInsert = true;
@@ -317,6 +603,7 @@ bool CAddrMan::Add_(const CAddress& addr, const CNetAddr& source, int64_t nTimeP
             ClearNew(nUBucket, nUBucketPos);
             pinfo->nRefCount++;
             vvNew[nUBucket][nUBucketPos] = nId;
+            vNewBucketsDirty.set(nUBucket);
         } else {
             if (pinfo->nRefCount == 0) {
                 Delete(nId);
@@ -342,6 +629,7 @@ void CAddrMan::Attempt_(const CService& addr, bool fCountFailure, int64_t nTime)
 
     // update info
     info.nLastTry = nTime;
+    info.fDirty = true;
     if (fCountFailure && info.nLastCountAttempt < nLastGood) {
         info.nLastCountAttempt = nTime;
         info.nAttempts++;
@@ -350,7 +638,7 @@ void CAddrMan::Attempt_(const CService& addr, bool fCountFailure, int64_t nTime)
 
 CAddrInfo CAddrMan::Select_(bool newOnly)
 {
-    if (size() == 0)
+    if (vRandom.empty())
         return CAddrInfo();
 
     if (newOnly && nNew == 0)
@@ -369,8 +657,8 @@ CAddrInfo CAddrMan::Select_(bool newOnly)
                 nKBucketPos = (nKBucketPos + insecure_rand.randbits(ADDRMAN_BUCKET_SIZE_LOG2)) % ADDRMAN_BUCKET_SIZE;
             }
             int nId = vvTried[nKBucket][nKBucketPos];
-            assert(mapInfo.count(nId) == 1);
-            CAddrInfo& info = mapInfo[nId];
+            assert(IsUsed(nId));
+            CAddrInfo& info = vInfo[nId];
             if (insecure_rand.randbits(30) < fChanceFactor * info.GetChance() * (1 << 30))
                 return info;
             fChanceFactor *= 1.2;
@@ -386,8 +674,8 @@ CAddrInfo CAddrMan::Select_(bool newOnly)
                 nUBucketPos = (nUBucketPos + insecure_rand.randbits(ADDRMAN_BUCKET_SIZE_LOG2)) % ADDRMAN_BUCKET_SIZE;
             }
             int nId = vvNew[nUBucket][nUBucketPos];
-            assert(mapInfo.count(nId) == 1);
-            CAddrInfo& info = mapInfo[nId];
+            assert(IsUsed(nId));
+            CAddrInfo& info = vInfo[nId];
             if (insecure_rand.randbits(30) < fChanceFactor * info.GetChance() * (1 << 30))
                 return info;
             fChanceFactor *= 1.2;
@@ -404,9 +692,11 @@ int CAddrMan::Check_()
     if (vRandom.size() != (size_t)(nTried + nNew))
         return -7;
 
-    for (const auto& entry : mapInfo) {
-        int n = entry.first;
-        const CAddrInfo& info = entry.second;
+    for (size_t n = 0; n < vInfo.size(); n++) {
+        const CAddrInfo& info = vInfo[n];
+        if (info.nRandomPos == -1) {
+            continue;
+        }
         if (info.fInTried) {
             if (!info.nLastSuccess)
                 return -1;
@@ -420,9 +710,9 @@ int CAddrMan::Check_()
                 return -4;
             mapNew[n] = info.nRefCount;
         }
-        if (mapAddr[info] != n)
+        if (mapAddr[info] != (int)n)
             return -5;
-        if (info.nRandomPos < 0 || (size_t)info.nRandomPos >= vRandom.size() || vRandom[info.nRandomPos] != n)
+        if ((size_t)info.nRandomPos >= vRandom.size() || vRandom[info.nRandomPos] != (int)n)
             return -14;
         if (info.nLastTry < 0)
             return -6;
@@ -440,9 +730,9 @@ int CAddrMan::Check_()
              if (vvTried[n][i] != -1) {
                  if (!setTried.count(vvTried[n][i]))
                      return -11;
-                 if (mapInfo[vvTried[n][i]].GetTriedBucket(nKey) != n)
+                 if (vInfo[vvTried[n][i]].GetTriedBucket(nKey) != n)
                      return -17;
-                 if (mapInfo[vvTried[n][i]].GetBucketPosition(nKey, false, n) != i)
+                 if (vInfo[vvTried[n][i]].GetBucketPosition(nKey, false, n) != i)
                      return -18;
                  setTried.erase(vvTried[n][i]);
              }
@@ -454,7 +744,7 @@ int CAddrMan::Check_()
             if (vvNew[n][i] != -1) {
                 if (!mapNew.count(vvNew[n][i]))
                     return -12;
-                if (mapInfo[vvNew[n][i]].GetBucketPosition(nKey, true, n) != i)
+                if (vInfo[vvNew[n][i]].GetBucketPosition(nKey, true, n) != i)
                     return -19;
                 if (--mapNew[vvNew[n][i]] == 0)
                     mapNew.erase(vvNew[n][i]);
@@ -486,9 +776,9 @@ void CAddrMan::GetAddr_(std::vector<CAddress>& vAddr)
 
         int nRndPos = insecure_rand.randrange(vRandom.size() - n) + n;
         SwapRandom(n, nRndPos);
-        assert(mapInfo.count(vRandom[n]) == 1);
+        assert(IsUsed(vRandom[n]));
 
-        const CAddrInfo& ai = mapInfo[vRandom[n]];
+        const CAddrInfo& ai = vInfo[vRandom[n]];
         if (!ai.IsTerrible())
             vAddr.push_back(ai);
     }
@@ -510,8 +800,10 @@ void CAddrMan::Connected_(const CService& addr, int64_t nTime)
 
     // update info
     int64_t nUpdateInterval = 20 * 60;
-    if (nTime - info.nTime > nUpdateInterval)
+    if (nTime - info.nTime > nUpdateInterval) {
         info.nTime = nTime;
+        info.fDirty = true;
+    }
 }
 
 void CAddrMan::SetServices_(const CService& addr, ServiceFlags nServices)
@@ -530,6 +822,7 @@ void CAddrMan::SetServices_(const CService& addr, ServiceFlags nServices)
 
     // update info
     info.nServices = nServices;
+    info.fDirty = true;
 }
 
 void CAddrMan::ResolveCollisions_()
@@ -539,11 +832,11 @@ void CAddrMan::ResolveCollisions_()
 
         bool erase_collision = false;
 
-        // If id_new not found in mapInfo remove it from m_tried_collisions
-        if (mapInfo.count(id_new) != 1) {
+        // If id_new not found in vInfo remove it from m_tried_collisions
+        if (!IsUsed(id_new)) {
             erase_collision = true;
         } else {
-            CAddrInfo& info_new = mapInfo[id_new];
+            CAddrInfo& info_new = vInfo[id_new];
 
             // Which tried bucket to move the entry to.
             int tried_bucket = info_new.GetTriedBucket(nKey);
@@ -554,7 +847,7 @@ void CAddrMan::ResolveCollisions_()
 
                 // Get the to-be-evicted address that is being tested
                 int id_old = vvTried[tried_bucket][tried_bucket_pos];
-                CAddrInfo& info_old = mapInfo[id_old];
+                CAddrInfo& info_old = vInfo[id_old];
 
                 // Has successfully connected in last X hours
                 if (GetAdjustedTime() - info_old.nLastSuccess < ADDRMAN_REPLACEMENT_HOURS*(60*60)) {
@@ -601,21 +894,24 @@ CAddrInfo CAddrMan::SelectTriedCollision_()
     std::advance(it, insecure_rand.randrange(m_tried_collisions.size()));
     int id_new = *it;
 
-    // If id_new not found in mapInfo remove it from m_tried_collisions
-    if (mapInfo.count(id_new) != 1) {
+    // If id_new not found in vInfo remove it from m_tried_collisions
+    if (!IsUsed(id_new)) {
         m_tried_collisions.erase(it);
         return CAddrInfo();
     }
 
-    CAddrInfo& newInfo = mapInfo[id_new];
+    CAddrInfo& newInfo = vInfo[id_new];
 
     // which tried bucket to move the entry to
     int tried_bucket = newInfo.GetTriedBucket(nKey);
     int tried_bucket_pos = newInfo.GetBucketPosition(nKey, false, tried_bucket);
 
     int id_old = vvTried[tried_bucket][tried_bucket_pos];
+    if (!IsUsed(id_old)) {
+        return CAddrInfo();
+    }
 
-    return mapInfo[id_old];
+    return vInfo[id_old];
 }
 
 CAddrInfo CAddrMan::GetAddressInfo_(const CService& addr)
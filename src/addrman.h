@@ -13,11 +13,17 @@
 #include <timedata.h>
 #include <util/system.h>
 
+#include <atomic>
+#include <bitset>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdint.h>
+#include <unordered_map>
 #include <vector>
 
+class CDBWrapper;
+
 /**
  * Extended statistics about a CAddress
  */
@@ -46,9 +52,12 @@ private:
     //! in tried set? (memory only)
     bool fInTried{false};
 
-    //! position in vRandom
+    //! position in vRandom, -1 for unused slots of the table (memory only)
     int nRandomPos{-1};
 
+    //! changed since it was last written to the peers database? (memory only)
+    bool fDirty{true};
+
     friend class CAddrMan;
 
 public:
@@ -96,7 +105,7 @@ public:
 /** Stochastic address manager
  *
  * Design goals:
- *  * Keep the address tables in-memory, and asynchronously dump the entire table to peers.dat.
+ *  * Keep the address tables in-memory, and asynchronously write the entries that changed to the peers database.
  *  * Make sure no (localized) attacker can fill the entire table with his nodes/addresses.
  *
  * To that end:
@@ -117,6 +126,10 @@ public:
  *      be observable by adversaries.
  *    * Several indexes are kept for high performance. Defining DEBUG_ADDRMAN will introduce frequent (and expensive)
  *      consistency checks for the entire data structure.
+ *    * Entries live in a flat table of slots which are reused after deletion, so the table never grows beyond the
+ *      capacity of the buckets.
+ *    * All bucket hashing needed by Add and Good is done before taking the lock, so that the critical sections
+ *      of Add, Good and Select only consist of table lookups and updates.
  */
 
 //! total number of buckets for tried addresses
@@ -169,6 +182,17 @@ public:
 //! the maximum time we'll spend trying to resolve a tried table collision, in seconds
 static const int64_t ADDRMAN_TEST_WINDOW = 40*60; // 40 minutes
 
+/** Salted hasher for the address index, so that peers can't pick addresses which collide in it */
+class CNetAddrHasher
+{
+private:
+    const uint64_t k0, k1;
+
+public:
+    CNetAddrHasher();
+    size_t operator()(const CNetAddr& addr) const;
+};
+
 /**
  * Stochastical (IP) address manager
  */
@@ -179,14 +203,14 @@ protected:
     mutable CCriticalSection cs;
 
 private:
-    //! last used nId
-    int nIdCount GUARDED_BY(cs);
+    //! table with information about all nIds, indexed by nId
+    std::vector<CAddrInfo> vInfo GUARDED_BY(cs);
 
-    //! table with information about all nIds
-    std::map<int, CAddrInfo> mapInfo GUARDED_BY(cs);
+    //! unused slots of vInfo, which are reused before the table grows
+    std::vector<int> vFreeIds GUARDED_BY(cs);
 
     //! find an nId based on its network address
-    std::map<CNetAddr, int> mapAddr GUARDED_BY(cs);
+    std::unordered_map<CNetAddr, int, CNetAddrHasher> mapAddr GUARDED_BY(cs);
 
     //! randomly-ordered vector of all nIds
     std::vector<int> vRandom GUARDED_BY(cs);
@@ -209,6 +233,25 @@ private:
     //! Holds addrs inserted into tried table that collide with existing entries. Test-before-evict discipline used to resolve these collisions.
     std::set<int> m_tried_collisions;
 
+    //! number of (unique) addresses in all tables, readable without taking cs
+    std::atomic<size_t> nSize{0};
+
+    //! new buckets which changed since the last flush of the peers database
+    std::bitset<ADDRMAN_NEW_BUCKET_COUNT> vNewBucketsDirty GUARDED_BY(cs);
+
+    //! deleted addresses which still have to be erased from the peers database
+    std::vector<CService> vErased GUARDED_BY(cs);
+
+    //! whether changes are tracked for the peers database, set once it is opened
+    bool fTrackChanges GUARDED_BY(cs){false};
+
+    //! set when the tables were cleared, the next flush then rewrites the peers database from scratch
+    bool fWipeDB GUARDED_BY(cs){false};
+
+    //! protects db
+    CCriticalSection cs_db;
+    std::unique_ptr<CDBWrapper> db GUARDED_BY(cs_db);
+
 protected:
     //! secret key to randomize bucket select with
     uint256 nKey;
@@ -216,6 +259,19 @@ protected:
     //! Source of random numbers for randomization in inner loops
     FastRandomContext insecure_rand;
 
+    //! Whether nId refers to a used slot of the table.
+    bool IsUsed(int nId) const EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        return nId >= 0 && (size_t)nId < vInfo.size() && vInfo[nId].nRandomPos != -1;
+    }
+
+    //! Get the key used for bucket placement, to calculate positions before taking cs.
+    uint256 GetBucketKey() const
+    {
+        LOCK(cs);
+        return nKey;
+    }
+
     //! Find an entry.
     CAddrInfo* Find(const CNetAddr& addr, int *pnId = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
@@ -226,8 +282,9 @@ protected:
     //! Swap two elements in vRandom.
     void SwapRandom(unsigned int nRandomPos1, unsigned int nRandomPos2) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
-    //! Move an entry from the "new" table(s) to the "tried" table
-    void MakeTried(CAddrInfo& info, int nId) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    //! Move an entry from the "new" table(s) to the "tried" table. pNewPositions are the entry's positions in all
+    //! new buckets, if already calculated.
+    void MakeTried(CAddrInfo& info, int nId, const std::vector<int>* pNewPositions = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     //! Delete an entry. It must not be in tried, and have refcount 0.
     void Delete(int nId) EXCLUSIVE_LOCKS_REQUIRED(cs);
@@ -235,11 +292,19 @@ protected:
     //! Clear a position in a "new" table. This is the only place where entries are actually deleted.
     void ClearNew(int nUBucket, int nUBucketPos) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
-    //! Mark an entry "good", possibly moving it from "new" to "tried".
-    void Good_(const CService &addr, bool test_before_evict, int64_t time) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    //! Mark an entry "good", possibly moving it from "new" to "tried". pNewPositions are the address' positions in
+    //! all new buckets, if already calculated.
+    void Good_(const CService &addr, bool test_before_evict, int64_t time, const std::vector<int>* pNewPositions = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    //! Add an entry to the "new" table. pNewPosition is the (bucket, position) the address from source belongs to,
+    //! if already calculated.
+    bool Add_(const CAddress &addr, const CNetAddr& source, int64_t nTimePenalty, const std::pair<int, int>* pNewPosition = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    //! Calculate the new table (bucket, position) of an address from a certain source.
+    static std::pair<int, int> CalcNewPosition(const CAddress& addr, const CNetAddr& source, const uint256& nKeyIn);
 
-    //! Add an entry to the "new" table.
-    bool Add_(const CAddress &addr, const CNetAddr& source, int64_t nTimePenalty) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    //! Calculate the positions of an address in all new buckets.
+    static std::vector<int> CalcNewBucketPositions(const CService& addr, const uint256& nKeyIn);
 
     //! Mark an entry as attempted to connect.
     void Attempt_(const CService &addr, bool fCountFailure, int64_t nTime) EXCLUSIVE_LOCKS_REQUIRED(cs);
@@ -314,11 +379,14 @@ public:
 
         int nUBuckets = ADDRMAN_NEW_BUCKET_COUNT ^ (1 << 30);
         s << nUBuckets;
-        std::map<int, int> mapUnkIds;
+        std::vector<int> vUnkIds(vInfo.size(), -1);
         int nIds = 0;
-        for (const auto& entry : mapInfo) {
-            mapUnkIds[entry.first] = nIds;
-            const CAddrInfo &info = entry.second;
+        for (size_t nId = 0; nId < vInfo.size(); nId++) {
+            const CAddrInfo &info = vInfo[nId];
+            if (info.nRandomPos == -1) {
+                continue;
+            }
+            vUnkIds[nId] = nIds;
             if (info.nRefCount) {
                 assert(nIds != nNew); // this means nNew was wrong, oh ow
                 s << info;
@@ -326,24 +394,23 @@ public:
             }
         }
         nIds = 0;
-        for (const auto& entry : mapInfo) {
-            const CAddrInfo &info = entry.second;
-            if (info.fInTried) {
+        for (const CAddrInfo& info : vInfo) {
+            if (info.nRandomPos != -1 && info.fInTried) {
                 assert(nIds != nTried); // this means nTried was wrong, oh ow
                 s << info;
                 nIds++;
             }
         }
         for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
-            int nSize = 0;
+            int nEntries = 0;
             for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
                 if (vvNew[bucket][i] != -1)
-                    nSize++;
+                    nEntries++;
             }
-            s << nSize;
+            s << nEntries;
             for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
                 if (vvNew[bucket][i] != -1) {
-                    int nIndex = mapUnkIds[vvNew[bucket][i]];
+                    int nIndex = vUnkIds[vvNew[bucket][i]];
                     s << nIndex;
                 }
             }
@@ -380,8 +447,9 @@ public:
         }
 
         // Deserialize entries from the new table.
+        vInfo.resize(nNew);
         for (int n = 0; n < nNew; n++) {
-            CAddrInfo &info = mapInfo[n];
+            CAddrInfo &info = vInfo[n];
             s >> info;
             mapAddr[info] = n;
             info.nRandomPos = vRandom.size();
@@ -397,7 +465,6 @@ public:
                 }
             }
         }
-        nIdCount = nNew;
 
         // Deserialize entries from the tried table.
         int nLost = 0;
@@ -407,13 +474,13 @@ public:
             int nKBucket = info.GetTriedBucket(nKey);
             int nKBucketPos = info.GetBucketPosition(nKey, false, nKBucket);
             if (vvTried[nKBucket][nKBucketPos] == -1) {
+                int nId = vInfo.size();
                 info.nRandomPos = vRandom.size();
                 info.fInTried = true;
-                vRandom.push_back(nIdCount);
-                mapInfo[nIdCount] = info;
-                mapAddr[info] = nIdCount;
-                vvTried[nKBucket][nKBucketPos] = nIdCount;
-                nIdCount++;
+                vRandom.push_back(nId);
+                mapAddr[info] = nId;
+                vvTried[nKBucket][nKBucketPos] = nId;
+                vInfo.push_back(info);
             } else {
                 nLost++;
             }
@@ -422,13 +489,13 @@ public:
 
         // Deserialize positions in the new table (if possible).
         for (int bucket = 0; bucket < nUBuckets; bucket++) {
-            int nSize = 0;
-            s >> nSize;
-            for (int n = 0; n < nSize; n++) {
+            int nEntries = 0;
+            s >> nEntries;
+            for (int n = 0; n < nEntries; n++) {
                 int nIndex = 0;
                 s >> nIndex;
                 if (nIndex >= 0 && nIndex < nNew) {
-                    CAddrInfo &info = mapInfo[nIndex];
+                    CAddrInfo &info = vInfo[nIndex];
                     int nUBucketPos = info.GetBucketPosition(nKey, true, bucket);
                     if (nVersion == 1 && nUBuckets == ADDRMAN_NEW_BUCKET_COUNT && vvNew[bucket][nUBucketPos] == -1 && info.nRefCount < ADDRMAN_NEW_BUCKETS_PER_ADDRESS) {
                         info.nRefCount++;
@@ -440,18 +507,17 @@ public:
 
         // Prune new entries with refcount 0 (as a result of collisions).
         int nLostUnk = 0;
-        for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); ) {
-            if (it->second.fInTried == false && it->second.nRefCount == 0) {
-                std::map<int, CAddrInfo>::const_iterator itCopy = it++;
-                Delete(itCopy->first);
+        for (size_t nId = 0; nId < vInfo.size(); nId++) {
+            const CAddrInfo& info = vInfo[nId];
+            if (info.nRandomPos != -1 && info.fInTried == false && info.nRefCount == 0) {
+                Delete(nId);
                 nLostUnk++;
-            } else {
-                it++;
             }
         }
         if (nLost + nLostUnk > 0) {
             LogPrint(BCLog::ADDRMAN, "addrman lost %i new and %i tried addresses due to collisions\n", nLostUnk, nLost);
         }
+        nSize = vRandom.size();
 
         Check();
     }
@@ -472,29 +538,34 @@ public:
             }
         }
 
-        nIdCount = 0;
         nTried = 0;
         nNew = 0;
         nLastGood = 1; //Initially at 1 so that "never" is strictly worse.
-        mapInfo.clear();
+        vInfo.clear();
+        vFreeIds.clear();
         mapAddr.clear();
-    }
+        m_tried_collisions.clear();
+        nSize = 0;
 
-    CAddrMan()
-    {
-        Clear();
+        // the key changed, so nothing on disk is usable anymore
+        vNewBucketsDirty.reset();
+        vErased.clear();
+        fWipeDB = true;
     }
 
-    ~CAddrMan()
-    {
-        nKey.SetNull();
-    }
+    CAddrMan();
+    ~CAddrMan();
+
+    //! Open the peers database at <datadir>/peers and load all entries from it, replacing the current tables.
+    bool InitDB(bool fWipe);
+
+    //! Write all entries and new buckets which changed since the last flush to the peers database.
+    void Flush();
 
     //! Return the number of (unique) addresses in all tables.
     size_t size() const
     {
-        LOCK(cs); // TODO: Cache this in an atomic to avoid this overhead
-        return vRandom.size();
+        return nSize;
     }
 
     //! Consistency check
@@ -513,10 +584,13 @@ public:
     //! Add a single address.
     bool Add(const CAddress &addr, const CNetAddr& source, int64_t nTimePenalty = 0)
     {
+        const uint256 nKeyUsed = GetBucketKey();
+        const auto newPosition = CalcNewPosition(addr, source, nKeyUsed);
+
         LOCK(cs);
         bool fRet = false;
         Check();
-        fRet |= Add_(addr, source, nTimePenalty);
+        fRet |= Add_(addr, source, nTimePenalty, nKeyUsed == nKey ? &newPosition : nullptr);
         Check();
         if (fRet) {
             LogPrint(BCLog::ADDRMAN, "Added %s from %s: %i tried, %i new\n", addr.ToStringIPPort(), source.ToString(), nTried, nNew);
@@ -527,11 +601,20 @@ public:
     //! Add multiple addresses.
     bool Add(const std::vector<CAddress> &vAddr, const CNetAddr& source, int64_t nTimePenalty = 0)
     {
+        const uint256 nKeyUsed = GetBucketKey();
+        std::vector<std::pair<int, int>> vNewPositions;
+        vNewPositions.reserve(vAddr.size());
+        for (const CAddress& addr : vAddr) {
+            vNewPositions.emplace_back(CalcNewPosition(addr, source, nKeyUsed));
+        }
+
         LOCK(cs);
         int nAdd = 0;
         Check();
-        for (std::vector<CAddress>::const_iterator it = vAddr.begin(); it != vAddr.end(); it++)
-            nAdd += Add_(*it, source, nTimePenalty) ? 1 : 0;
+        // the positions are useless if the key changed in the meantime
+        const bool fKeyUnchanged = nKeyUsed == nKey;
+        for (size_t i = 0; i < vAddr.size(); i++)
+            nAdd += Add_(vAddr[i], source, nTimePenalty, fKeyUnchanged ? &vNewPositions[i] : nullptr) ? 1 : 0;
         Check();
         if (nAdd) {
             LogPrint(BCLog::ADDRMAN, "Added %i addresses from %s: %i tried, %i new\n", nAdd, source.ToString(), nTried, nNew);
@@ -542,9 +625,12 @@ public:
     //! Mark an entry as accessible.
     void Good(const CService &addr, bool test_before_evict = true, int64_t nTime = GetAdjustedTime())
     {
+        const uint256 nKeyUsed = GetBucketKey();
+        const std::vector<int> vNewPositions = CalcNewBucketPositions(addr, nKeyUsed);
+
         LOCK(cs);
         Check();
-        Good_(addr, test_before_evict, nTime);
+        Good_(addr, test_before_evict, nTime, nKeyUsed == nKey ? &vNewPositions : nullptr);
         Check();
     }
 
@@ -19,13 +19,20 @@
 
 CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID) :
         nonce(GetRand(std::numeric_limits<uint64_t>::max())),
-        shorttxids(block.vtx.size() - 1), prefilledtxn(1), header(block), vchBlockSig(block.vchBlockSig) {
+        header(block), vchBlockSig(block.vchBlockSig) {
     FillShortTxIDSelector();
-    //TODO: Use our mempool prior to block acceptance to predictively fill more than just the coinbase
-    prefilledtxn[0] = {0, block.vtx[0]};
-    for (size_t i = 1; i < block.vtx.size(); i++) {
+    // The coinbase, the coinstake of PoS blocks and quorum commitments never go through the mempool, so peers can't
+    // have them yet and we always prefill them. Prefilled indexes are encoded as offsets since the last prefilled tx.
+    shorttxids.reserve(block.vtx.size() - 1);
+    int nLastPrefilled = -1;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
         const CTransaction& tx = *block.vtx[i];
-        shorttxids[i - 1] = GetShortID(fUseWTXID ? tx.GetWitnessHash() : tx.GetHash());
+        if (i == 0 || tx.IsCoinStake() || tx.nType == TRANSACTION_QUORUM_COMMITMENT) {
+            prefilledtxn.push_back({(uint16_t)(i - nLastPrefilled - 1), block.vtx[i]});
+            nLastPrefilled = i;
+        } else {
+            shorttxids.push_back(GetShortID(fUseWTXID ? tx.GetWitnessHash() : tx.GetHash()));
+        }
     }
 }
 
@@ -10,12 +10,16 @@
 #include <consensus/params.h>
 #include <flatfile.h>
 #include <primitives/block.h>
+#include <sync.h>
 #include <tinyformat.h>
 #include <uint256.h>
 #include <util/moneystr.h>
 
+#include <memory>
 #include <vector>
 
+extern CCriticalSection cs_main;
+
 /**
  * Maximum amount of time that a block timestamp is allowed to exceed the
  * current network-adjusted time before the block will be accepted.
@@ -134,10 +138,52 @@ enum BlockStatus: uint32_t {
     BLOCK_CONFLICT_CHAINLOCK =   256, //!< conflicts with chainlock system
 };
 
+/**
+ * Proof-of-stake fields of a block index entry which are only needed by RPC, the stake modifier selection and
+ * when connecting the next block. They are not kept in memory for the whole block index, but loaded from the
+ * block tree database on first access, see CBlockIndex::GetPoSData.
+ */
+struct CBlockIndexPoSData
+{
+    // money supply related block index fields
+    int64_t nMint{0};
+    int64_t nMoneySupply{0};
+
+    // proof-of-stake related block index fields, only set for proof-of-stake blocks
+    COutPoint prevoutStake;
+    unsigned int nStakeTime{0};
+    uint256 hashProofOfStake;
+};
+
+/** Owning pointer to the cold proof-of-stake fields of a CBlockIndex, copies get their own copy of the data */
+class CBlockIndexPoSDataPtr
+{
+private:
+    std::unique_ptr<CBlockIndexPoSData> ptr;
+
+public:
+    CBlockIndexPoSDataPtr() {}
+    CBlockIndexPoSDataPtr(const CBlockIndexPoSDataPtr& other) { *this = other; }
+    CBlockIndexPoSDataPtr& operator=(const CBlockIndexPoSDataPtr& other)
+    {
+        if (this != &other) {
+            ptr.reset(other.ptr ? new CBlockIndexPoSData(*other.ptr) : nullptr);
+        }
+        return *this;
+    }
+
+    CBlockIndexPoSData* get() const { return ptr.get(); }
+    void reset(CBlockIndexPoSData* p = nullptr) { ptr.reset(p); }
+};
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
  * to it, but at most one of them can be part of the currently active branch.
+ *
+ * Only the fields which are needed to walk and validate the chain are kept in
+ * every entry, see CBlockIndexPoSData for the others. Entries are allocated in
+ * chunks by BlockManager and live as long as the block index.
  */
 class CBlockIndex
 {
@@ -192,11 +238,6 @@ public:
     unsigned int nTimeMax;
 
 // proof-of-stake
-    // money supply related block index fields
-    int64_t nMint;
-    int64_t nMoneySupply;
-
-    // proof-of-stake related block index fields
     unsigned int nFlags;  // block index flags
     enum
     {
@@ -204,11 +245,44 @@ public:
         BLOCK_STAKE_ENTROPY  = (1 << 1), // entropy bit for stake modifier
         BLOCK_STAKE_MODIFIER = (1 << 2), // regenerated stake modifier
     };
-    uint64_t nStakeModifier; // hash modifier for proof-of-stake
     unsigned int nStakeModifierChecksum; // checksum of index; in-memory only
-    COutPoint prevoutStake;
-    unsigned int nStakeTime;
-    uint256 hashProofOfStake;
+    uint64_t nStakeModifier; // hash modifier for proof-of-stake
+
+protected:
+    //! (lazily loaded) cold proof-of-stake fields, nullptr until they are accessed or set for the first time.
+    //! They are loaded and released while holding cs_main, so they must only be accessed while holding it.
+    mutable CBlockIndexPoSDataPtr posData;
+
+    //! Reads the cold proof-of-stake fields from the block tree database
+    CBlockIndexPoSData& LoadPoSData() const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+public:
+    const CBlockIndexPoSData& GetPoSData() const
+    {
+        AssertLockHeld(cs_main);
+        return posData.get() ? *posData.get() : LoadPoSData();
+    }
+
+    //! Returns the cold proof-of-stake fields for modification, these are written with the entry on the next flush
+    CBlockIndexPoSData& GetMutablePoSData()
+    {
+        AssertLockHeld(cs_main);
+        return posData.get() ? *posData.get() : LoadPoSData();
+    }
+
+    //! Sets the cold proof-of-stake fields without looking at the database, used for fields which are known already
+    void SetPoSData(const CBlockIndexPoSData& data)
+    {
+        posData.reset(new CBlockIndexPoSData(data));
+    }
+
+    //! Frees the cold proof-of-stake fields once they are on disk, they are read again on the next access
+    void ReleasePoSData() const EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        posData.reset();
+    }
+
+    bool HasPoSData() const { return posData.get() != nullptr; }
 
     bool IsProofOfWork() const
     {
@@ -274,14 +348,10 @@ public:
         nNonce         = 0;
 
         // proof-of-stake
-        nMint = 0;
-        nMoneySupply = 0;
         nFlags = 0;
         nStakeModifier = 0;
         nStakeModifierChecksum = 0;
-        hashProofOfStake = uint256();
-        prevoutStake.SetNull();
-        nStakeTime = 0;
+        posData.reset();
     }
 
     CBlockIndex()
@@ -375,16 +445,18 @@ public:
 
     std::string ToString() const
     {
+        // don't load the cold fields just for logging
+        CBlockIndexPoSData data = posData.get() ? *posData.get() : CBlockIndexPoSData();
         return strprintf("CBlockIndex(pprev=%p, nHeight=%d, nMint=%s nMoneySupply=%s nFlags=(%s)(%d)(%s) nStakeModifier=%016llx, nStakeModifierChecksum=%08x, hashProofOfStake=%s, prevoutStake=(%s), nStakeTime=%d merkle=%s, hashBlock=%s)",
             pprev, nHeight,
-            FormatMoney(nMint),
-            FormatMoney(nMoneySupply),
+            FormatMoney(data.nMint),
+            FormatMoney(data.nMoneySupply),
             GeneratedStakeModifier() ? "MOD" : "-", GetStakeEntropyBit(), IsProofOfStake()? "PoS" : "PoW", // nFlags
             nStakeModifier,
             nStakeModifierChecksum,
-            hashProofOfStake.ToString(),
-            prevoutStake.ToString(),
-            nStakeTime,
+            data.hashProofOfStake.ToString(),
+            data.prevoutStake.ToString(),
+            data.nStakeTime,
             hashMerkleRoot.ToString(),
             GetBlockHash().ToString());
     }
@@ -433,15 +505,18 @@ class CDiskBlockIndex : public CBlockIndex
 public:
     uint256 hash;
     uint256 hashPrev;
+    // the cold fields are stored with the entry, but the CBlockIndex they are read into doesn't hold them
+    CBlockIndexPoSData diskPoSData;
 
     CDiskBlockIndex() {
         hash = uint256();
         hashPrev = uint256();
     }
 
-    explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
+    explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex), diskPoSData(pindex->GetPoSData()) {
         hash = (hash == uint256() ? pindex->GetBlockHash() : hash);
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
+        posData.reset();
     }
 
     ADD_SERIALIZE_METHODS;
@@ -463,21 +538,21 @@ public:
             READWRITE(VARINT(nUndoPos));
 
         // proof-of-stake
-        READWRITE(nMint);
-        READWRITE(nMoneySupply);
+        READWRITE(diskPoSData.nMint);
+        READWRITE(diskPoSData.nMoneySupply);
         READWRITE(nFlags);
         READWRITE(nStakeModifier);
         if (IsProofOfStake())
         {
-            READWRITE(prevoutStake);
-            READWRITE(nStakeTime);
-            READWRITE(hashProofOfStake);
+            READWRITE(diskPoSData.prevoutStake);
+            READWRITE(diskPoSData.nStakeTime);
+            READWRITE(diskPoSData.hashProofOfStake);
         }
         else
         {
-            const_cast<CDiskBlockIndex*>(this)->prevoutStake.SetNull();
-            const_cast<CDiskBlockIndex*>(this)->nStakeTime = 0;
-            const_cast<CDiskBlockIndex*>(this)->hashProofOfStake = uint256();
+            const_cast<CDiskBlockIndex*>(this)->diskPoSData.prevoutStake.SetNull();
+            const_cast<CDiskBlockIndex*>(this)->diskPoSData.nStakeTime = 0;
+            const_cast<CDiskBlockIndex*>(this)->diskPoSData.hashProofOfStake = uint256();
         }
         // proof-of-stake
 
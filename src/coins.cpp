@@ -8,6 +8,7 @@
 #include <consensus/consensus.h>
 #include <logging.h>
 #include <random.h>
+#include <util/memory.h>
 #include <version.h>
 
 bool CCoinsView::GetCoin(const COutPoint &outpoint, Coin &coin) const { return false; }
@@ -210,6 +211,45 @@ bool CCoinsViewCache::Flush() {
     return fOk;
 }
 
+std::unique_ptr<CCoinsMap> CCoinsViewCache::DetachDirty(bool erase, size_t& usage)
+{
+    std::unique_ptr<CCoinsMap> dirty = MakeUnique<CCoinsMap>();
+    if (erase) {
+        // Hand over the whole map, the entries which are not dirty are skipped when writing
+        usage = DynamicMemoryUsage();
+        dirty->swap(cacheCoins);
+        cachedCoinsUsage = 0;
+        return dirty;
+    }
+
+    usage = 0;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end();) {
+        if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
+            ++it;
+            continue;
+        }
+        if (it->second.coin.IsSpent()) {
+            // The base has no use for a spent coin it does not have
+            cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+            if (!(it->second.flags & CCoinsCacheEntry::FRESH)) {
+                CCoinsCacheEntry& entry = (*dirty)[it->first];
+                entry.coin = std::move(it->second.coin);
+                entry.flags = CCoinsCacheEntry::DIRTY;
+            }
+            it = cacheCoins.erase(it);
+            continue;
+        }
+        CCoinsCacheEntry& entry = (*dirty)[it->first];
+        entry.coin = it->second.coin;
+        entry.flags = CCoinsCacheEntry::DIRTY;
+        usage += entry.coin.DynamicMemoryUsage();
+        it->second.flags = 0;
+        ++it;
+    }
+    usage += memusage::DynamicUsage(*dirty);
+    return dirty;
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
@@ -11,6 +11,7 @@
 #include <core_memusage.h>
 #include <crypto/siphash.h>
 #include <memusage.h>
+#include <pooledmap.h>
 #include <serialize.h>
 #include <uint256.h>
 
@@ -102,8 +103,8 @@ public:
 class SaltedOutpointHasher
 {
 private:
-    /** Salt */
-    const uint64_t k0, k1;
+    /** Salt, not const so that coins maps can be swapped */
+    uint64_t k0, k1;
 
 public:
     SaltedOutpointHasher();
@@ -137,7 +138,7 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+typedef pooledmap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -286,6 +287,14 @@ public:
      */
     bool Flush();
 
+    /**
+     * Move the modifications applied to this cache into a new map, for the caller
+     * to write to the base, and leave this cache as if it had been flushed. Unless
+     * erase is set, unspent coins stay cached. The memory used by the returned map
+     * is stored in usage.
+     */
+    std::unique_ptr<CCoinsMap> DetachDirty(bool erase, size_t& usage);
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
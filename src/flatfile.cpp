@@ -4,6 +4,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include <config/emrals-config.h>
+#endif
+
 #include <stdexcept>
 
 #include <flatfile.h>
@@ -11,6 +15,13 @@
 #include <tinyformat.h>
 #include <util/system.h>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 FlatFileSeq::FlatFileSeq(fs::path dir, const char* prefix, size_t chunk_size) :
     m_dir(std::move(dir)),
     m_prefix(prefix),
@@ -97,3 +108,83 @@ bool FlatFileSeq::Flush(const FlatFilePos& pos, bool finalize)
     fclose(file);
     return true;
 }
+
+FlatFileMapCache::Mapping::~Mapping()
+{
+#ifndef WIN32
+    munmap(m_addr, m_size);
+#endif
+}
+
+#ifndef WIN32
+/** Map a whole file read-only, returns nullptr on failure */
+static std::shared_ptr<const FlatFileMapCache::Mapping> MapFile(const fs::path& path)
+{
+    // Large block files would exhaust the address space of 32-bit systems.
+    if (sizeof(void*) < 8) {
+        return nullptr;
+    }
+
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps a reference to the file, the descriptor is not needed anymore.
+    close(fd);
+    if (addr == MAP_FAILED) {
+        LogPrintf("%s: mmap of %s failed: %s\n", __func__, path.string(), strerror(errno));
+        return nullptr;
+    }
+    return std::make_shared<const FlatFileMapCache::Mapping>(addr, st.st_size);
+}
+#endif
+
+std::shared_ptr<const FlatFileMapCache::Mapping> FlatFileMapCache::Get(const fs::path& path, size_t min_size)
+{
+#ifndef WIN32
+    // Pages of a mapping beyond the end of the file raise SIGBUS when accessed, so the file itself
+    // has to be large enough, not only the mapping.
+    struct stat st;
+    if (stat(path.string().c_str(), &st) != 0 || st.st_size < 0 || (uint64_t)st.st_size < min_size) {
+        return nullptr;
+    }
+    const size_t file_size = st.st_size;
+
+    LOCK(m_mutex);
+    for (auto it = m_files.begin(); it != m_files.end(); ++it) {
+        if (it->first != path) continue;
+        const size_t mapped_size = it->second->GetData().size();
+        if (mapped_size >= min_size && mapped_size <= file_size) {
+            m_files.splice(m_files.begin(), m_files, it);
+            return it->second;
+        }
+        // The file has grown or was truncated since it was mapped.
+        m_files.erase(it);
+        break;
+    }
+
+    std::shared_ptr<const Mapping> mapping = MapFile(path);
+    if (!mapping || (size_t)mapping->GetData().size() < min_size) {
+        return nullptr;
+    }
+    m_files.emplace_front(path, mapping);
+    if (m_files.size() > m_max_files) {
+        m_files.pop_back();
+    }
+    return mapping;
+#else
+    return nullptr;
+#endif
+}
+
+void FlatFileMapCache::Invalidate(const fs::path& path)
+{
+    LOCK(m_mutex);
+    m_files.remove_if([&](const std::pair<fs::path, std::shared_ptr<const Mapping>>& file) { return file.first == path; });
+}
@@ -6,10 +6,14 @@
 #ifndef EMRALS_FLATFILE_H
 #define EMRALS_FLATFILE_H
 
+#include <list>
+#include <memory>
 #include <string>
 
 #include <fs.h>
 #include <serialize.h>
+#include <span.h>
+#include <sync.h>
 
 struct FlatFilePos
 {
@@ -93,4 +97,53 @@ public:
     bool Flush(const FlatFilePos& pos, bool finalize = false);
 };
 
+/**
+ * Read-only memory mappings of flat files, of which the most recently used ones are kept mapped.
+ * Reading through a mapping avoids opening, seeking and copying through a stdio buffer on every
+ * access. Mappings are only supported on 64-bit POSIX systems, elsewhere Get always fails and
+ * callers fall back to reading the file.
+ */
+class FlatFileMapCache
+{
+public:
+    /** A mapped file. The mapping stays valid as long as a reference to it is held, even after it
+     *  was evicted from the cache. */
+    class Mapping
+    {
+    private:
+        void* m_addr;
+        size_t m_size;
+
+    public:
+        Mapping(void* addr, size_t size) : m_addr(addr), m_size(size) {}
+        ~Mapping();
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+
+        Span<const unsigned char> GetData() const { return Span<const unsigned char>(static_cast<const unsigned char*>(m_addr), m_size); }
+    };
+
+private:
+    const size_t m_max_files;
+
+    Mutex m_mutex;
+    //! Mappings by file, most recently used first
+    std::list<std::pair<fs::path, std::shared_ptr<const Mapping>>> m_files GUARDED_BY(m_mutex);
+
+public:
+    /** @param max_files The number of files which are kept mapped. */
+    explicit FlatFileMapCache(size_t max_files) : m_max_files(max_files) {}
+
+    /**
+     * Get a mapping of a file which contains at least its first min_size bytes. A file which has
+     * grown or was truncated since it was mapped is mapped again.
+     *
+     * @return nullptr if the file could not be mapped or is currently smaller than min_size.
+     */
+    std::shared_ptr<const Mapping> Get(const fs::path& path, size_t min_size);
+
+    /** Drop the mapping of a file, eg. because it is deleted or truncated. */
+    void Invalidate(const fs::path& path);
+};
+
 #endif // EMRALS_FLATFILE_H
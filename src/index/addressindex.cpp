@@ -0,0 +1,323 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+
+#include <chainparams.h>
+#include <crypto/sha256.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+/* The index database stores a delta entry for every output paying to a script and for every input
+ * spending from it, and an unspent entry for every output which is not spent in the chain the index
+ * is synced to.
+ *
+ * Keys for deltas have the type [DB_ADDRESS_DELTA, uint256, uint32 (BE), uint256, uint32 (BE), bool]
+ * holding the script hash, height, txid, input or output index and whether it is a spend. The value
+ * is the amount, negative for spends. The height is represented as big-endian so that the deltas of
+ * a script are ordered by height and a height range can be read sequentially.
+ * Keys for unspent outputs have the type [DB_ADDRESS_UNSPENT, uint256, uint256, uint32 (BE)] holding
+ * the script hash and the outpoint. The value is the amount and the height.
+ */
+constexpr char DB_ADDRESS_DELTA = 'd';
+constexpr char DB_ADDRESS_UNSPENT = 'u';
+
+std::unique_ptr<AddressIndex> g_addressindex;
+
+uint256 GetAddressIndexScriptHash(const CScript& script)
+{
+    uint256 hash;
+    CSHA256().Write(script.data(), script.size()).Finalize(hash.begin());
+    return hash;
+}
+
+namespace {
+
+struct DBDeltaKey {
+    uint256 script_hash;
+    int height;
+    uint256 txid;
+    uint32_t index;
+    bool spending;
+
+    DBDeltaKey() : height(0), index(0), spending(false) {}
+    DBDeltaKey(const uint256& script_hash_in, int height_in, const uint256& txid_in, uint32_t index_in, bool spending_in) :
+        script_hash(script_hash_in), height(height_in), txid(txid_in), index(index_in), spending(spending_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDRESS_DELTA);
+        s << script_hash;
+        ser_writedata32be(s, height);
+        s << txid;
+        ser_writedata32be(s, index);
+        ser_writedata8(s, spending);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_ADDRESS_DELTA) {
+            throw std::ios_base::failure("Invalid format for address index DB delta key");
+        }
+        s >> script_hash;
+        height = ser_readdata32be(s);
+        s >> txid;
+        index = ser_readdata32be(s);
+        spending = ser_readdata8(s) != 0;
+    }
+};
+
+struct DBUnspentKey {
+    uint256 script_hash;
+    uint256 txid;
+    uint32_t index;
+
+    DBUnspentKey() : index(0) {}
+    DBUnspentKey(const uint256& script_hash_in, const uint256& txid_in, uint32_t index_in) :
+        script_hash(script_hash_in), txid(txid_in), index(index_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDRESS_UNSPENT);
+        s << script_hash;
+        s << txid;
+        ser_writedata32be(s, index);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_ADDRESS_UNSPENT) {
+            throw std::ios_base::failure("Invalid format for address index DB unspent key");
+        }
+        s >> script_hash;
+        s >> txid;
+        index = ser_readdata32be(s);
+    }
+};
+
+struct DBUnspentVal {
+    CAmount amount;
+    int height;
+
+    DBUnspentVal() : amount(0), height(0) {}
+    DBUnspentVal(CAmount amount_in, int height_in) : amount(amount_in), height(height_in) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(amount);
+        READWRITE(height);
+    }
+};
+
+/** The undo data of a block, read ahead during the initial sync */
+struct UndoPreparation : public BaseIndex::BlockPreparation
+{
+    CBlockUndo blockundo;
+};
+
+}; // namespace
+
+/** Access to the address index database (indexes/addressindex/) */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+AddressIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "addressindex", n_cache_size, f_memory, f_wipe)
+{}
+
+AddressIndex::AddressIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<AddressIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AddressIndex::~AddressIndex() {}
+
+bool AddressIndex::ReadUndo(const CBlock& block, const CBlockIndex* pindex, CBlockUndo& blockundo)
+{
+    if (!UndoReadFromDisk(blockundo, pindex)) {
+        return error("%s: Failed to read undo data of block %s from disk", __func__, pindex->GetBlockHash().ToString());
+    }
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: Undo data of block %s does not match the block", __func__, pindex->GetBlockHash().ToString());
+    }
+    return true;
+}
+
+bool AddressIndex::ReadBlockAndUndo(const CBlockIndex* pindex, CBlock& block, CBlockUndo& blockundo)
+{
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+        return error("%s: Failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+    }
+    return ReadUndo(block, pindex, blockundo);
+}
+
+bool AddressIndex::WriteBlockEntries(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    // Transactions are processed in block order, so an output created and spent within this block
+    // is first written and then erased from the unspent set within the same batch.
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txid = tx.GetHash();
+
+        if (!tx.IsCoinBase()) {
+            const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+            if (txundo.vprevout.size() != tx.vin.size()) {
+                return error("%s: Undo data of tx %s does not match its inputs", __func__, txid.ToString());
+            }
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const Coin& coin = txundo.vprevout[j];
+                if (coin.out.scriptPubKey.empty()) continue;
+                const uint256 script_hash = GetAddressIndexScriptHash(coin.out.scriptPubKey);
+                batch.Write(DBDeltaKey(script_hash, pindex->nHeight, txid, j, true), -coin.out.nValue);
+                batch.Erase(DBUnspentKey(script_hash, tx.vin[j].prevout.hash, tx.vin[j].prevout.n));
+            }
+        }
+
+        for (size_t j = 0; j < tx.vout.size(); j++) {
+            const CTxOut& out = tx.vout[j];
+            if (out.scriptPubKey.empty() || out.scriptPubKey.IsUnspendable()) continue;
+            const uint256 script_hash = GetAddressIndexScriptHash(out.scriptPubKey);
+            batch.Write(DBDeltaKey(script_hash, pindex->nHeight, txid, j, false), out.nValue);
+            batch.Write(DBUnspentKey(script_hash, txid, j), DBUnspentVal(out.nValue, pindex->nHeight));
+        }
+    }
+    return true;
+}
+
+bool AddressIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight == 0) return true;
+
+    CBlockUndo blockundo;
+    if (!ReadUndo(block, pindex, blockundo)) {
+        return false;
+    }
+
+    CDBBatch batch(*m_db);
+    if (!WriteBlockEntries(batch, block, blockundo, pindex)) {
+        return false;
+    }
+    return m_db->WriteBatch(batch);
+}
+
+std::unique_ptr<BaseIndex::BlockPreparation> AddressIndex::PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const
+{
+    if (pindex->nHeight == 0) return nullptr;
+
+    auto prep = MakeUnique<UndoPreparation>();
+    if (!ReadUndo(block, pindex, prep->blockundo)) {
+        return nullptr;
+    }
+    return prep;
+}
+
+bool AddressIndex::WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex,
+                                      BlockPreparation* prep, CDBBatch& batch)
+{
+    if (pindex->nHeight == 0) return true;
+
+    // A missing preparation means reading the undo data failed on the read-ahead thread.
+    if (!prep) {
+        return false;
+    }
+    return WriteBlockEntries(batch, block, static_cast<UndoPreparation*>(prep)->blockundo, pindex);
+}
+
+bool AddressIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // Undo the disconnected blocks in reverse order, restoring the outputs they spent from the undo data.
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        if (pindex->nHeight == 0) continue;
+
+        CBlock block;
+        CBlockUndo blockundo;
+        if (!ReadBlockAndUndo(pindex, block, blockundo)) {
+            return false;
+        }
+
+        for (size_t i = block.vtx.size(); i-- > 0;) {
+            const CTransaction& tx = *block.vtx[i];
+            const uint256& txid = tx.GetHash();
+
+            for (size_t j = 0; j < tx.vout.size(); j++) {
+                const CTxOut& out = tx.vout[j];
+                if (out.scriptPubKey.empty() || out.scriptPubKey.IsUnspendable()) continue;
+                const uint256 script_hash = GetAddressIndexScriptHash(out.scriptPubKey);
+                batch.Erase(DBDeltaKey(script_hash, pindex->nHeight, txid, j, false));
+                batch.Erase(DBUnspentKey(script_hash, txid, j));
+            }
+
+            if (tx.IsCoinBase()) continue;
+            const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+            if (txundo.vprevout.size() != tx.vin.size()) {
+                return error("%s: Undo data of tx %s does not match its inputs", __func__, txid.ToString());
+            }
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const Coin& coin = txundo.vprevout[j];
+                if (coin.out.scriptPubKey.empty()) continue;
+                const uint256 script_hash = GetAddressIndexScriptHash(coin.out.scriptPubKey);
+                batch.Erase(DBDeltaKey(script_hash, pindex->nHeight, txid, j, true));
+                batch.Write(DBUnspentKey(script_hash, tx.vin[j].prevout.hash, tx.vin[j].prevout.n),
+                            DBUnspentVal(coin.out.nValue, coin.nHeight));
+            }
+        }
+    }
+    if (!m_db->WriteBatch(batch)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+bool AddressIndex::FindDeltas(const uint256& script_hash, int start_height, int end_height, std::vector<CAddressIndexDelta>& deltas) const
+{
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    db_it->Seek(DBDeltaKey(script_hash, std::max(start_height, 0), uint256(), 0, false));
+    for (; db_it->Valid(); db_it->Next()) {
+        DBDeltaKey key;
+        if (!db_it->GetKey(key) || key.script_hash != script_hash) break;
+        if (end_height >= 0 && key.height > end_height) break;
+
+        CAmount amount;
+        if (!db_it->GetValue(amount)) {
+            return error("%s: unable to read value in %s at key (%c, %s, %d)",
+                         __func__, GetName(), DB_ADDRESS_DELTA, script_hash.ToString(), key.height);
+        }
+        deltas.push_back({key.txid, key.index, key.height, key.spending, amount});
+    }
+    return true;
+}
+
+bool AddressIndex::FindUnspent(const uint256& script_hash, std::vector<CAddressUnspent>& unspent) const
+{
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    db_it->Seek(DBUnspentKey(script_hash, uint256(), 0));
+    for (; db_it->Valid(); db_it->Next()) {
+        DBUnspentKey key;
+        if (!db_it->GetKey(key) || key.script_hash != script_hash) break;
+
+        DBUnspentVal value;
+        if (!db_it->GetValue(value)) {
+            return error("%s: unable to read value in %s at key (%c, %s)",
+                         __func__, GetName(), DB_ADDRESS_UNSPENT, script_hash.ToString());
+        }
+        unspent.push_back({COutPoint(key.txid, key.index), value.amount, value.height});
+    }
+    return true;
+}
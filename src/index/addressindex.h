@@ -0,0 +1,97 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef EMRALS_INDEX_ADDRESSINDEX_H
+#define EMRALS_INDEX_ADDRESSINDEX_H
+
+#include <amount.h>
+#include <index/base.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+
+class CBlockUndo;
+
+/** Returns the key a script is indexed under in the address index, the SHA256 of the scriptPubKey. */
+uint256 GetAddressIndexScriptHash(const CScript& script);
+
+/** A single change to the balance of a script, caused by an output paying to it or an input spending from it. */
+struct CAddressIndexDelta
+{
+    uint256 txid;
+    uint32_t index; //!< output index if !fSpending, input index otherwise
+    int nHeight;
+    bool fSpending;
+    CAmount nAmount;
+};
+
+/** An output paying to a script that is not spent in the active chain. */
+struct CAddressUnspent
+{
+    COutPoint outpoint;
+    CAmount nAmount;
+    int nHeight;
+};
+
+/**
+ * AddressIndex records all outputs paying to and all inputs spending from each
+ * script in the active chain, together with the set of outputs which are still
+ * unspent. Scripts are identified by GetAddressIndexScriptHash. The amounts and
+ * scripts of the spent outputs are taken from the block undo data.
+ */
+class AddressIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    /// Read the block and its undo data from disk
+    static bool ReadBlockAndUndo(const CBlockIndex* pindex, CBlock& block, CBlockUndo& blockundo);
+
+    /// Read the undo data of a block from disk and check it matches the block
+    static bool ReadUndo(const CBlock& block, const CBlockIndex* pindex, CBlockUndo& blockundo);
+
+    /// Add the entries of a block to a batch
+    static bool WriteBlockEntries(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex);
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    /// Reads the undo data of the block.
+    std::unique_ptr<BlockPreparation> PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const override;
+
+    bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex,
+                            BlockPreparation* prep, CDBBatch& batch) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    /// Look up all balance changes of a script in the given height range, ordered by height.
+    ///
+    /// @param[in]   script_hash  The hash of the script, see GetAddressIndexScriptHash.
+    /// @param[in]   start_height  First height to return deltas for.
+    /// @param[in]   end_height  Last height to return deltas for, -1 for no limit.
+    /// @param[out]  deltas  The deltas are appended to this vector.
+    /// @return  false if the database could not be read
+    bool FindDeltas(const uint256& script_hash, int start_height, int end_height, std::vector<CAddressIndexDelta>& deltas) const;
+
+    /// Look up all unspent outputs paying to a script, ordered by outpoint.
+    bool FindUnspent(const uint256& script_hash, std::vector<CAddressUnspent>& unspent) const;
+};
+
+/// The global address index, used by the address RPCs. May be null.
+extern std::unique_ptr<AddressIndex> g_addressindex;
+
+#endif // EMRALS_INDEX_ADDRESSINDEX_H
@@ -4,18 +4,27 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <ctpl.h>
 #include <index/base.h>
 #include <shutdown.h>
 #include <tinyformat.h>
 #include <ui_interface.h>
 #include <util/system.h>
+#include <util/threadnames.h>
 #include <validation.h>
 #include <warnings.h>
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+
 constexpr char DB_BEST_BLOCK = 'B';
 
 constexpr int64_t SYNC_LOG_INTERVAL = 30; // seconds
 constexpr int64_t SYNC_LOCATOR_WRITE_INTERVAL = 30; // seconds
+constexpr size_t SYNC_BATCH_SIZE = 16 << 20; // 16 MiB
+constexpr int MAX_SYNC_READ_AHEAD_THREADS = 8;
+constexpr size_t SYNC_READ_AHEAD_BLOCKS_PER_THREAD = 8;
 
 template<typename... Args>
 static void FatalError(const char* fmt, const Args&... args)
@@ -86,17 +95,168 @@ static const CBlockIndex* NextSyncBlock(const CBlockIndex* pindex_prev) EXCLUSIV
     return ::ChainActive().Next(::ChainActive().FindFork(pindex_prev));
 }
 
+//! Read-ahead workers shared by all indexes which are syncing at the same time. The pool lives as long as
+//! one of them is syncing.
+static Mutex g_read_ahead_pool_mutex;
+static std::weak_ptr<ctpl::thread_pool> g_read_ahead_pool GUARDED_BY(g_read_ahead_pool_mutex);
+
+static std::shared_ptr<ctpl::thread_pool> GetReadAheadPool()
+{
+    LOCK(g_read_ahead_pool_mutex);
+    std::shared_ptr<ctpl::thread_pool> pool = g_read_ahead_pool.lock();
+    if (!pool) {
+        const int n_threads = std::max(1, std::min(GetNumCores() - 1, MAX_SYNC_READ_AHEAD_THREADS));
+        pool = std::make_shared<ctpl::thread_pool>(n_threads);
+        RenameThreadPool(*pool, "emrals-idx-read");
+        g_read_ahead_pool = pool;
+    }
+    return pool;
+}
+
+class BaseIndex::ReadAhead
+{
+private:
+    struct Item
+    {
+        const CBlockIndex* pindex;
+        bool done{false};
+        bool ok{false};
+        CBlock block;
+        std::unique_ptr<BlockPreparation> prep;
+
+        explicit Item(const CBlockIndex* pindex_in) : pindex(pindex_in) {}
+    };
+
+    const BaseIndex& m_index;
+    const Consensus::Params& m_consensus_params;
+    const std::shared_ptr<ctpl::thread_pool> m_pool;
+    const size_t m_depth;
+
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    //! Blocks in chain order, from the next one to be written to the last one scheduled
+    std::deque<std::shared_ptr<Item>> m_pending GUARDED_BY(m_mutex);
+    //! Blocks not yet picked up by a worker
+    std::deque<std::shared_ptr<Item>> m_work GUARDED_BY(m_mutex);
+    //! Tasks pushed to the pool which have not finished yet. They refer to this object.
+    size_t m_tasks GUARDED_BY(m_mutex){0};
+
+    void Enqueue(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        auto item = std::make_shared<Item>(pindex);
+        m_pending.push_back(item);
+        m_work.push_back(std::move(item));
+        // Every task reads the oldest block not picked up yet, so blocks are read roughly in chain order even
+        // if tasks of other indexes are interleaved. Tasks whose block was dropped by Schedule do nothing.
+        m_tasks++;
+        m_pool->push([this](int) { ReadNext(); });
+    }
+
+    void ReadNext()
+    {
+        std::shared_ptr<Item> item;
+        {
+            LOCK(m_mutex);
+            if (!m_work.empty()) {
+                item = std::move(m_work.front());
+                m_work.pop_front();
+            }
+        }
+
+        bool ok = false;
+        if (item) {
+            ok = ReadBlockFromDisk(item->block, item->pindex, m_consensus_params);
+            if (ok) {
+                item->prep = m_index.PrepareBlock(item->block, item->pindex);
+            }
+        }
+
+        LOCK(m_mutex);
+        if (item) {
+            item->ok = ok;
+            item->done = true;
+        }
+        m_tasks--;
+        m_cond.notify_all();
+    }
+
+public:
+    ReadAhead(const BaseIndex& index, const Consensus::Params& consensus_params)
+        : m_index(index), m_consensus_params(consensus_params), m_pool(GetReadAheadPool()),
+          m_depth(m_pool->size() * SYNC_READ_AHEAD_BLOCKS_PER_THREAD)
+    {
+    }
+
+    ~ReadAhead()
+    {
+        // The pool is shared, so wait for the tasks of this index instead of stopping its threads
+        WAIT_LOCK(m_mutex, lock);
+        m_work.clear();
+        m_cond.wait(lock, [&] { return m_tasks == 0; });
+    }
+
+    /// Make sure pindex and the blocks following it in the active chain are being read. Blocks
+    /// scheduled earlier which are not on the path from pindex anymore, eg. after a reorg, are dropped.
+    void Schedule(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        LOCK(m_mutex);
+        if (!m_pending.empty() && m_pending.front()->pindex != pindex) {
+            m_pending.clear();
+            m_work.clear();
+        }
+        if (m_pending.empty()) {
+            Enqueue(pindex);
+        }
+        while (m_pending.size() < m_depth) {
+            const CBlockIndex* pindex_next = ::ChainActive().Next(m_pending.back()->pindex);
+            if (!pindex_next) break;
+            Enqueue(pindex_next);
+        }
+    }
+
+    /// Wait until the block scheduled first has been read and prepared, and remove it from the queue.
+    bool Take(const CBlockIndex* pindex, CBlock& block, std::unique_ptr<BlockPreparation>& prep)
+    {
+        std::shared_ptr<Item> item;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            assert(!m_pending.empty() && m_pending.front()->pindex == pindex);
+            item = std::move(m_pending.front());
+            m_pending.pop_front();
+            m_cond.wait(lock, [&] { return item->done; });
+        }
+        block = std::move(item->block);
+        prep = std::move(item->prep);
+        return item->ok;
+    }
+};
+
 void BaseIndex::ThreadSync()
 {
     const CBlockIndex* pindex = m_best_block_index.load();
     if (!m_synced) {
         auto& consensus_params = Params().GetConsensus();
 
+        // Reading and deserializing blocks and the index specific preparation work run on the
+        // read-ahead threads, this thread writes the blocks in chain order and commits.
+        ReadAhead read_ahead(*this, consensus_params);
+        CDBBatch batch(GetDB());
+        auto write_batch = [&]() {
+            if (batch.SizeEstimate() == 0) return true;
+            bool ok = GetDB().WriteBatch(batch);
+            batch.Clear();
+            return ok;
+        };
+
         int64_t last_log_time = 0;
-        int64_t last_locator_write_time = 0;
+        int64_t last_locator_write_time = GetTime();
         while (true) {
             if (m_interrupt) {
-                m_best_block_index = pindex;
+                // Entries which cannot be written are no problem, as the locator only moves
+                // forward if they were written.
+                if (write_batch()) {
+                    m_best_block_index = pindex;
+                }
                 // No need to handle errors in Commit. If it fails, the error will be already be
                 // logged. The best way to recover is to continue, as index cannot be corrupted by
                 // a missed commit to disk for an advanced index state.
@@ -108,18 +268,31 @@ void BaseIndex::ThreadSync()
                 LOCK(cs_main);
                 const CBlockIndex* pindex_next = NextSyncBlock(pindex);
                 if (!pindex_next) {
+                    if (!write_batch()) {
+                        FatalError("%s: Failed to write to index database %s", __func__, GetName());
+                        return;
+                    }
                     m_best_block_index = pindex;
                     m_synced = true;
                     // No need to handle errors in Commit. See rationale above.
                     Commit();
                     break;
                 }
-                if (pindex_next->pprev != pindex && !Rewind(pindex, pindex_next->pprev)) {
-                    FatalError("%s: Failed to rewind index %s to a previous chain tip",
-                               __func__, GetName());
-                    return;
+                if (pindex_next->pprev != pindex) {
+                    // Rewinding depends on all entries of the blocks being disconnected having been written.
+                    if (!write_batch()) {
+                        FatalError("%s: Failed to write to index database %s", __func__, GetName());
+                        return;
+                    }
+                    m_best_block_index = pindex;
+                    if (!Rewind(pindex, pindex_next->pprev)) {
+                        FatalError("%s: Failed to rewind index %s to a previous chain tip",
+                                   __func__, GetName());
+                        return;
+                    }
                 }
                 pindex = pindex_next;
+                read_ahead.Schedule(pindex);
             }
 
             int64_t current_time = GetTime();
@@ -129,24 +302,30 @@ void BaseIndex::ThreadSync()
                 last_log_time = current_time;
             }
 
-            if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL < current_time) {
-                m_best_block_index = pindex;
-                last_locator_write_time = current_time;
-                // No need to handle errors in Commit. See rationale above.
-                Commit();
-            }
-
             CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
+            std::unique_ptr<BlockPreparation> prep;
+            if (!read_ahead.Take(pindex, block, prep)) {
                 FatalError("%s: Failed to read block %s from disk",
                            __func__, pindex->GetBlockHash().ToString());
                 return;
             }
-            if (!WriteBlock(block, pindex)) {
+            if (!WritePreparedBlock(block, pindex, prep.get(), batch) ||
+                (batch.SizeEstimate() > SYNC_BATCH_SIZE && !write_batch())) {
                 FatalError("%s: Failed to write block %s to index database",
                            __func__, pindex->GetBlockHash().ToString());
                 return;
             }
+
+            if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL < current_time) {
+                if (!write_batch()) {
+                    FatalError("%s: Failed to write to index database %s", __func__, GetName());
+                    return;
+                }
+                m_best_block_index = pindex;
+                last_locator_write_time = current_time;
+                // No need to handle errors in Commit. See rationale above.
+                Commit();
+            }
         }
     }
 
@@ -21,6 +21,14 @@ class CBlockIndex;
  */
 class BaseIndex : public CValidationInterface
 {
+public:
+    /// Index specific data of a block which does not depend on the state of the index, eg. a block
+    /// filter. During the initial sync it is computed ahead of time by the read-ahead threads.
+    struct BlockPreparation
+    {
+        virtual ~BlockPreparation() {}
+    };
+
 protected:
     class DB : public CDBWrapper
     {
@@ -47,6 +55,10 @@ private:
     std::thread m_thread_sync;
     CThreadInterrupt m_interrupt;
 
+    /// Reads and prepares the next blocks of the active chain on a pool of threads while the sync
+    /// thread writes them to the index in order.
+    class ReadAhead;
+
     /// Sync the index with the block index starting from the current best block.
     /// Intended to be run in its own thread, m_thread_sync, and can be
     /// interrupted with m_interrupt. Once the index gets in sync, the m_synced
@@ -76,6 +88,17 @@ protected:
     /// Write update index entries for a newly connected block.
     virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) { return true; }
 
+    /// Compute the parts of the index entries of a block which do not depend on the index state.
+    /// Called concurrently from the read-ahead threads during the initial sync, in any block order.
+    virtual std::unique_ptr<BlockPreparation> PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const { return nullptr; }
+
+    /// Write index entries for a block during the initial sync, with the result of PrepareBlock.
+    /// Indexes which do not read back their own entries while writing a block can add them to
+    /// batch, which the sync thread writes in large chunks and always before committing the best
+    /// block locator.
+    virtual bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex,
+                                    BlockPreparation* prep, CDBBatch& batch) { return WriteBlock(block, pindex); }
+
     /// Virtual method called internally by Commit that can be overridden to atomically
     /// commit more index state.
     virtual bool CommitInternal(CDBBatch& batch);
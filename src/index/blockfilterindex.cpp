@@ -213,16 +213,60 @@ size_t BlockFilterIndex::WriteFilterToDisk(FlatFilePos& pos, const BlockFilter&
     return data_size;
 }
 
-bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+namespace {
+
+/** A block filter built ahead of time during the initial sync */
+struct FilterPreparation : public BaseIndex::BlockPreparation
+{
+    BlockFilter filter;
+};
+
+}; // namespace
+
+bool BlockFilterIndex::BuildFilter(const CBlock& block, const CBlockIndex* pindex, BlockFilter& filter) const
 {
     CBlockUndo block_undo;
+    if (pindex->nHeight > 0 && !UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+    filter = BlockFilter(m_filter_type, block, block_undo);
+    return true;
+}
+
+bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    BlockFilter filter;
+    if (!BuildFilter(block, pindex, filter)) {
+        return false;
+    }
+    return WriteFilter(filter, pindex);
+}
+
+std::unique_ptr<BaseIndex::BlockPreparation> BlockFilterIndex::PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const
+{
+    auto prep = MakeUnique<FilterPreparation>();
+    if (!BuildFilter(block, pindex, prep->filter)) {
+        return nullptr;
+    }
+    return prep;
+}
+
+bool BlockFilterIndex::WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex,
+                                          BlockPreparation* prep, CDBBatch& batch)
+{
+    // The filter header of a block depends on the one of the previous block, which is read back
+    // from the database, so the entries are written right away instead of being added to batch.
+    if (!prep) {
+        return WriteBlock(block, pindex);
+    }
+    return WriteFilter(static_cast<FilterPreparation*>(prep)->filter, pindex);
+}
+
+bool BlockFilterIndex::WriteFilter(const BlockFilter& filter, const CBlockIndex* pindex)
+{
     uint256 prev_header;
 
     if (pindex->nHeight > 0) {
-        if (!UndoReadFromDisk(block_undo, pindex)) {
-            return false;
-        }
-
         std::pair<uint256, DBVal> read_out;
         if (!m_db->Read(DBHeightKey(pindex->nHeight - 1), read_out)) {
             return false;
@@ -237,8 +281,6 @@ bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex
         prev_header = read_out.second.header;
     }
 
-    BlockFilter filter(m_filter_type, block, block_undo);
-
     size_t bytes_written = WriteFilterToDisk(m_next_filter_pos, filter);
     if (bytes_written == 0) return false;
 
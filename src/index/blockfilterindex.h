@@ -30,6 +30,12 @@ private:
     bool ReadFilterFromDisk(const FlatFilePos& pos, BlockFilter& filter) const;
     size_t WriteFilterToDisk(FlatFilePos& pos, const BlockFilter& filter);
 
+    /** Build the filter of a block from the block and its undo data. */
+    bool BuildFilter(const CBlock& block, const CBlockIndex* pindex, BlockFilter& filter) const;
+
+    /** Write a filter and its header, chained to the header of the previous block, to the index. */
+    bool WriteFilter(const BlockFilter& filter, const CBlockIndex* pindex);
+
 protected:
     bool Init() override;
 
@@ -37,6 +43,12 @@ protected:
 
     bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
 
+    /** Builds the filter of the block, which is the expensive part of indexing a block. */
+    std::unique_ptr<BlockPreparation> PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const override;
+
+    bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex,
+                            BlockPreparation* prep, CDBBatch& batch) override;
+
     bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
 
     BaseIndex::DB& GetDB() const override { return *m_db; }
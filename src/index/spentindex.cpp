@@ -0,0 +1,105 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/spentindex.h>
+
+#include <chainparams.h>
+#include <util/system.h>
+#include <validation.h>
+
+/* Keys have the type [DB_SPENT, uint256, uint32 (BE)] holding the spent outpoint. The value is the
+ * CSpentIndexValue of the input spending it.
+ */
+constexpr char DB_SPENT = 's';
+
+std::unique_ptr<SpentIndex> g_spentindex;
+
+namespace {
+
+struct DBSpentKey {
+    uint256 txid;
+    uint32_t index;
+
+    explicit DBSpentKey(const COutPoint& outpoint) : txid(outpoint.hash), index(outpoint.n) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_SPENT);
+        s << txid;
+        ser_writedata32be(s, index);
+    }
+};
+
+}; // namespace
+
+/** Access to the spent index database (indexes/spentindex/) */
+class SpentIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+SpentIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "spentindex", n_cache_size, f_memory, f_wipe)
+{}
+
+SpentIndex::SpentIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<SpentIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+SpentIndex::~SpentIndex() {}
+
+static void WriteSpentEntries(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex)
+{
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (size_t j = 0; j < tx->vin.size(); j++) {
+            batch.Write(DBSpentKey(tx->vin[j].prevout), CSpentIndexValue{tx->GetHash(), (uint32_t)j, pindex->nHeight});
+        }
+    }
+}
+
+bool SpentIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDBBatch batch(*m_db);
+    WriteSpentEntries(batch, block, pindex);
+    return m_db->WriteBatch(batch);
+}
+
+bool SpentIndex::WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex,
+                                    BlockPreparation* prep, CDBBatch& batch)
+{
+    WriteSpentEntries(batch, block, pindex);
+    return true;
+}
+
+bool SpentIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            return error("%s: Failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+        for (const auto& tx : block.vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (const CTxIn& txin : tx->vin) {
+                batch.Erase(DBSpentKey(txin.prevout));
+            }
+        }
+    }
+    if (!m_db->WriteBatch(batch)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& SpentIndex::GetDB() const { return *m_db; }
+
+bool SpentIndex::FindSpent(const COutPoint& outpoint, CSpentIndexValue& value) const
+{
+    return m_db->Read(DBSpentKey(outpoint), value);
+}
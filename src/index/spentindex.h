@@ -0,0 +1,71 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef EMRALS_INDEX_SPENTINDEX_H
+#define EMRALS_INDEX_SPENTINDEX_H
+
+#include <index/base.h>
+#include <primitives/transaction.h>
+
+/** The input spending an output in the active chain. */
+struct CSpentIndexValue
+{
+    uint256 txid;
+    uint32_t index;
+    int nHeight;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(index);
+        READWRITE(nHeight);
+    }
+};
+
+/**
+ * SpentIndex is used to look up the input spending an output. The index is
+ * written to a LevelDB database and records the spending transaction, input
+ * index and height by the spent outpoint.
+ */
+class SpentIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex,
+                            BlockPreparation* prep, CDBBatch& batch) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "spentindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit SpentIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~SpentIndex() override;
+
+    /// Look up the input spending an output.
+    ///
+    /// @param[in]   outpoint  The spent output.
+    /// @param[out]  value  The spending transaction, input index and height.
+    /// @return  true if the output is spent in the active chain, false otherwise
+    bool FindSpent(const COutPoint& outpoint, CSpentIndexValue& value) const;
+};
+
+/// The global spent index, used by getspentinfo. May be null.
+extern std::unique_ptr<SpentIndex> g_spentindex;
+
+#endif // EMRALS_INDEX_SPENTINDEX_H
@@ -0,0 +1,106 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/timestampindex.h>
+
+#include <chain.h>
+#include <util/system.h>
+
+/* Keys have the type [DB_TIMESTAMP, uint32 (BE), uint256] holding the block time and hash. The time is
+ * represented as big-endian so that a time range can be read sequentially. The value is the height.
+ * Block times are not strictly increasing, so the order of the entries may differ from the chain order.
+ */
+constexpr char DB_TIMESTAMP = 't';
+
+std::unique_ptr<TimestampIndex> g_timestampindex;
+
+namespace {
+
+struct DBTimestampKey {
+    uint32_t time;
+    uint256 hash;
+
+    DBTimestampKey() : time(0) {}
+    DBTimestampKey(uint32_t time_in, const uint256& hash_in) : time(time_in), hash(hash_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_TIMESTAMP);
+        ser_writedata32be(s, time);
+        s << hash;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_TIMESTAMP) {
+            throw std::ios_base::failure("Invalid format for timestamp index DB key");
+        }
+        time = ser_readdata32be(s);
+        s >> hash;
+    }
+};
+
+}; // namespace
+
+/** Access to the timestamp index database (indexes/timestampindex/) */
+class TimestampIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+TimestampIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "timestampindex", n_cache_size, f_memory, f_wipe)
+{}
+
+TimestampIndex::TimestampIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<TimestampIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+TimestampIndex::~TimestampIndex() {}
+
+bool TimestampIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDBBatch batch(*m_db);
+    batch.Write(DBTimestampKey(pindex->nTime, pindex->GetBlockHash()), pindex->nHeight);
+    return m_db->WriteBatch(batch);
+}
+
+bool TimestampIndex::WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex,
+                                        BlockPreparation* prep, CDBBatch& batch)
+{
+    batch.Write(DBTimestampKey(pindex->nTime, pindex->GetBlockHash()), pindex->nHeight);
+    return true;
+}
+
+bool TimestampIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // The keys only depend on the block index, so no block needs to be read from disk.
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        batch.Erase(DBTimestampKey(pindex->nTime, pindex->GetBlockHash()));
+    }
+    if (!m_db->WriteBatch(batch)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& TimestampIndex::GetDB() const { return *m_db; }
+
+bool TimestampIndex::FindBlockHashes(uint32_t high, uint32_t low, std::vector<uint256>& hashes) const
+{
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    db_it->Seek(DBTimestampKey(low, uint256()));
+    for (; db_it->Valid(); db_it->Next()) {
+        DBTimestampKey key;
+        if (!db_it->GetKey(key) || key.time > high) break;
+        hashes.push_back(key.hash);
+    }
+    return true;
+}
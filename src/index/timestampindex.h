@@ -0,0 +1,49 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef EMRALS_INDEX_TIMESTAMPINDEX_H
+#define EMRALS_INDEX_TIMESTAMPINDEX_H
+
+#include <index/base.h>
+
+/**
+ * TimestampIndex is used to look up the blocks of the active chain by their
+ * timestamp. The index is written to a LevelDB database and records the block
+ * hashes ordered by block time.
+ */
+class TimestampIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex,
+                            BlockPreparation* prep, CDBBatch& batch) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "timestampindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit TimestampIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~TimestampIndex() override;
+
+    /// Look up the hashes of all blocks with a timestamp in [low, high], ordered by timestamp.
+    bool FindBlockHashes(uint32_t high, uint32_t low, std::vector<uint256>& hashes) const;
+};
+
+/// The global timestamp index, used by getblockhashes. May be null.
+extern std::unique_ptr<TimestampIndex> g_timestampindex;
+
+#endif // EMRALS_INDEX_TIMESTAMPINDEX_H
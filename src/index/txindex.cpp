@@ -5,6 +5,7 @@
 
 #include <index/txindex.h>
 #include <shutdown.h>
+#include <streams.h>
 #include <ui_interface.h>
 #include <util/system.h>
 #include <util/translation.h>
@@ -36,8 +37,8 @@ public:
     /// transaction hash is not indexed.
     bool ReadTxPos(const uint256& txid, CDiskTxPos& pos) const;
 
-    /// Write a batch of transaction positions to the DB.
-    bool WriteTxs(const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos);
+    /// Add the transaction positions of a block to a batch.
+    void WriteTxs(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex);
 
     /// Migrate txindex data from the block tree DB, where it may be for older nodes that have not
     /// been upgraded yet to the new database.
@@ -53,13 +54,13 @@ bool TxIndex::DB::ReadTxPos(const uint256 &txid, CDiskTxPos& pos) const
     return Read(std::make_pair(DB_TXINDEX, txid), pos);
 }
 
-bool TxIndex::DB::WriteTxs(const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos)
+void TxIndex::DB::WriteTxs(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex)
 {
-    CDBBatch batch(*this);
-    for (const auto& tuple : v_pos) {
-        batch.Write(std::make_pair(DB_TXINDEX, tuple.first), tuple.second);
+    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
+    for (const auto& tx : block.vtx) {
+        batch.Write(std::make_pair(DB_TXINDEX, tx->GetHash()), pos);
+        pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
     }
-    return WriteBatch(batch);
 }
 
 /*
@@ -225,14 +226,19 @@ bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
     // Exclude genesis block transaction because outputs are not spendable.
     if (pindex->nHeight == 0) return true;
 
-    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
-    vPos.reserve(block.vtx.size());
-    for (const auto& tx : block.vtx) {
-        vPos.emplace_back(tx->GetHash(), pos);
-        pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
-    }
-    return m_db->WriteTxs(vPos);
+    CDBBatch batch(*m_db);
+    m_db->WriteTxs(batch, block, pindex);
+    return m_db->WriteBatch(batch);
+}
+
+bool TxIndex::WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex,
+                                 BlockPreparation* prep, CDBBatch& batch)
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight == 0) return true;
+
+    m_db->WriteTxs(batch, block, pindex);
+    return true;
 }
 
 BaseIndex::DB& TxIndex::GetDB() const { return *m_db; }
@@ -264,3 +270,115 @@ bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRe
     block_hash = header.GetHash();
     return true;
 }
+
+bool TxIndex::FindTxView(const uint256& tx_hash, uint256& block_hash, CTransactionView& view) const
+{
+    CDiskTxPos postx;
+    if (!m_db->ReadTxPos(tx_hash, postx)) {
+        return false;
+    }
+
+    std::shared_ptr<const FlatFileMapCache::Mapping> mapping;
+    Span<const unsigned char> data;
+    if (!MapBlockFromDisk(postx, mapping, data)) {
+        // The block file cannot be mapped, read the transaction the regular way
+        CTransactionRef tx;
+        if (!FindTx(tx_hash, block_hash, tx)) {
+            return false;
+        }
+        view = CTransactionView(std::move(tx));
+        return true;
+    }
+
+    CBlockHeader header;
+    try {
+        SpanReader reader(SER_DISK, CLIENT_VERSION, data);
+        reader >> header;
+        reader.ignore(postx.nTxOffset);
+        data = data.last(reader.size());
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    block_hash = header.GetHash();
+    view = CTransactionView(std::move(mapping), data);
+    return true;
+}
+
+bool CTransactionView::ParseOutputs() const
+{
+    if (m_outputs_offset != 0) return true;
+
+    // Skip the inputs, following UnserializeTransaction
+    try {
+        SpanReader reader(SER_DISK, CLIENT_VERSION, m_data);
+        reader.ignore(sizeof(int32_t)); // nVersion and nType
+        uint64_t input_count = ReadCompactSize(reader);
+        uint64_t output_count = 0;
+        bool has_outputs = true;
+        if (input_count == 0) {
+            // Either no inputs, or the dummy of the extended serialization followed by its flags
+            const unsigned char flags = ser_readdata8(reader);
+            if (flags != 0) {
+                input_count = ReadCompactSize(reader);
+            } else {
+                has_outputs = false;
+            }
+        }
+        for (uint64_t i = 0; i < input_count; i++) {
+            reader.ignore(sizeof(uint256) + sizeof(uint32_t)); // prevout
+            reader.ignore(ReadCompactSize(reader)); // scriptSig
+            reader.ignore(sizeof(uint32_t)); // nSequence
+        }
+        if (has_outputs) {
+            output_count = ReadCompactSize(reader);
+        }
+        m_output_count = output_count;
+        m_outputs_offset = m_data.size() - reader.size();
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize error - %s", __func__, e.what());
+    }
+    return true;
+}
+
+size_t CTransactionView::GetOutputCount() const
+{
+    if (m_tx) return m_tx->vout.size();
+    if (!m_mapping || !ParseOutputs()) return 0;
+    return m_output_count;
+}
+
+bool CTransactionView::GetOutput(uint32_t n, CTxOut& out) const
+{
+    if (m_tx) {
+        if (n >= m_tx->vout.size()) return false;
+        out = m_tx->vout[n];
+        return true;
+    }
+    if (!m_mapping || !ParseOutputs() || n >= m_output_count) return false;
+
+    try {
+        SpanReader reader(SER_DISK, CLIENT_VERSION, m_data.subspan(m_outputs_offset));
+        for (uint32_t i = 0; i < n; i++) {
+            reader.ignore(sizeof(CAmount)); // nValue
+            reader.ignore(ReadCompactSize(reader)); // scriptPubKey
+        }
+        reader >> out;
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize error - %s", __func__, e.what());
+    }
+    return true;
+}
+
+CTransactionRef CTransactionView::GetTransaction() const
+{
+    if (m_tx || !m_mapping) return m_tx;
+
+    CTransactionRef tx;
+    try {
+        SpanReader(SER_DISK, CLIENT_VERSION, m_data) >> tx;
+    } catch (const std::exception& e) {
+        error("%s: Deserialize error - %s", __func__, e.what());
+        return nullptr;
+    }
+    return tx;
+}
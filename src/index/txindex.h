@@ -6,7 +6,9 @@
 #define EMRALS_INDEX_TXINDEX_H
 
 #include <chain.h>
+#include <flatfile.h>
 #include <index/base.h>
+#include <span.h>
 #include <txdb.h>
 
 struct CDiskTxPos : public FlatFilePos
@@ -34,6 +36,47 @@ struct CDiskTxPos : public FlatFilePos
     }
 };
 
+/**
+ * A read-only view of an indexed transaction. If the block file can be memory
+ * mapped, the view refers to the serialized transaction inside the mapping and
+ * only parses the fields it is asked for, so reading one output neither
+ * deserializes the other inputs and outputs nor hashes the transaction.
+ * Otherwise it holds the transaction read from the file. Not thread safe.
+ */
+class CTransactionView
+{
+private:
+    //! Keeps m_data valid
+    std::shared_ptr<const FlatFileMapCache::Mapping> m_mapping;
+    //! The serialized transaction, followed by the remainder of its block
+    Span<const unsigned char> m_data;
+    //! The transaction, if the block file is not mapped
+    CTransactionRef m_tx;
+
+    //! Offset of the outputs in m_data and their number, set on first use
+    mutable size_t m_outputs_offset{0};
+    mutable uint64_t m_output_count{0};
+
+    bool ParseOutputs() const;
+
+public:
+    CTransactionView() {}
+    CTransactionView(std::shared_ptr<const FlatFileMapCache::Mapping> mapping, Span<const unsigned char> data)
+        : m_mapping(std::move(mapping)), m_data(data) {}
+    explicit CTransactionView(CTransactionRef tx) : m_tx(std::move(tx)) {}
+
+    bool IsNull() const { return !m_mapping && !m_tx; }
+
+    /** The number of outputs of the transaction, 0 if it cannot be parsed. */
+    size_t GetOutputCount() const;
+
+    /** Read output n of the transaction. Returns false if there is no such output. */
+    bool GetOutput(uint32_t n, CTxOut& out) const;
+
+    /** Deserialize the whole transaction. Returns null if it cannot be parsed. */
+    CTransactionRef GetTransaction() const;
+};
+
 /**
  * TxIndex is used to look up transactions included in the blockchain by hash.
  * The index is written to a LevelDB database and records the filesystem
@@ -53,6 +96,9 @@ protected:
 
     bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
 
+    bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex,
+                            BlockPreparation* prep, CDBBatch& batch) override;
+
     BaseIndex::DB& GetDB() const override;
 
     const char* GetName() const override { return "txindex"; }
@@ -71,6 +117,16 @@ public:
     /// @param[out]  tx  The transaction itself.
     /// @return  true if transaction is found, false otherwise
     bool FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const;
+
+    /// Look up a transaction by hash without deserializing it. Unlike FindTx, the hash of the
+    /// transaction is not recomputed, so this relies on the index being consistent with the block
+    /// files.
+    ///
+    /// @param[in]   tx_hash  The hash of the transaction to be returned.
+    /// @param[out]  block_hash  The hash of the block the transaction is found in.
+    /// @param[out]  view  A view of the transaction.
+    /// @return  true if transaction is found, false otherwise
+    bool FindTxView(const uint256& tx_hash, uint256& block_hash, CTransactionView& view) const;
 };
 
 /// The global transaction index, used in GetTransaction. May be null.
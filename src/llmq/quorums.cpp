@@ -184,24 +184,13 @@ void CQuorumManager::EnsureQuorumConnections(Consensus::LLMQType llmqType, const
 
     // don't remove connections for the currently in-progress DKG round
     int curDkgHeight = pindexNew->nHeight - (pindexNew->nHeight % params.dkgInterval);
-    auto curDkgBlock = pindexNew->GetAncestor(curDkgHeight)->GetBlockHash();
+    const CBlockIndex* pindexCurDkg = pindexNew->GetAncestor(curDkgHeight);
+    auto curDkgBlock = pindexCurDkg->GetBlockHash();
     connmanQuorumsToDelete.erase(curDkgBlock);
 
     for (auto& quorum : lastQuorums) {
-        if (!quorum->IsMember(myProTxHash) && !gArgs.GetBoolArg("-watchquorums", DEFAULT_WATCH_QUORUMS)) {
-            continue;
-        }
-
         if (!g_connman->HasMasternodeQuorumNodes(llmqType, quorum->qc.quorumHash)) {
-            std::set<uint256> connections;
-            if (quorum->IsMember(myProTxHash)) {
-                connections = CLLMQUtils::GetQuorumConnections(llmqType, quorum->pindexQuorum, myProTxHash);
-            } else {
-                auto cindexes = CLLMQUtils::CalcDeterministicWatchConnections(llmqType, quorum->pindexQuorum, quorum->members.size(), 1);
-                for (auto idx : cindexes) {
-                    connections.emplace(quorum->members[idx]->proTxHash);
-                }
-            }
+            auto connections = CLLMQUtils::GetQuorumConnectionsForNode(llmqType, quorum->pindexQuorum, quorum->members, myProTxHash);
             if (!connections.empty()) {
                 if (LogAcceptCategory(BCLog::LLMQ)) {
                     auto mnList = deterministicMNManager->GetListAtChainTip();
@@ -222,9 +211,29 @@ void CQuorumManager::EnsureQuorumConnections(Consensus::LLMQType llmqType, const
         connmanQuorumsToDelete.erase(quorum->qc.quorumHash);
     }
 
+    if (connmanQuorumsToDelete.empty()) {
+        return;
+    }
+
+    // Links to masternodes which are also members of the quorum currently being formed are kept when the old quorum
+    // rotates out, so that they don't have to be set up again for the new quorum
+    auto& upcoming = upcomingQuorumMembers[llmqType];
+    if (upcoming.first != curDkgBlock) {
+        upcoming.first = curDkgBlock;
+        upcoming.second.clear();
+        for (const auto& dmn : CLLMQUtils::GetAllQuorumMembers(llmqType, pindexCurDkg)) {
+            upcoming.second.emplace(dmn->proTxHash);
+        }
+    }
     for (auto& qh : connmanQuorumsToDelete) {
-        LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- removing masternodes quorum connections for quorum %s:\n", __func__, qh.ToString());
-        g_connman->RemoveMasternodeQuorumNodes(llmqType, qh);
+        if (!g_connman->RetainMasternodeQuorumNodes(llmqType, qh, upcoming.second)) {
+            continue;
+        }
+        if (g_connman->HasMasternodeQuorumNodes(llmqType, qh)) {
+            LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- keeping masternodes quorum connections for quorum %s which are members of the upcoming quorum\n", __func__, qh.ToString());
+        } else {
+            LogPrint(BCLog::LLMQ, "CQuorumManager::%s -- removing masternodes quorum connections for quorum %s:\n", __func__, qh.ToString());
+        }
     }
 }
 
@@ -90,6 +90,9 @@ private:
     std::map<std::pair<Consensus::LLMQType, uint256>, CQuorumPtr> quorumsCache;
     unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, std::vector<CQuorumCPtr>, StaticSaltedHasher, 32> scanQuorumsCache;
 
+    // proTxHashes of the members of the quorum in the current DKG round, by its quorum hash. Only used from UpdatedBlockTip
+    std::map<Consensus::LLMQType, std::pair<uint256, std::set<uint256>>> upcomingQuorumMembers;
+
 public:
     CQuorumManager(CSpecialDB& _specialDb, CBLSWorker& _blsWorker, CDKGSessionManager& _dkgManager);
 
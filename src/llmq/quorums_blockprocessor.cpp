@@ -13,9 +13,11 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <consensus/validation.h>
+#include <crypto/sha256.h>
 #include <net.h>
 #include <net_processing.h>
 #include <primitives/block.h>
+#include <random.h>
 #include <validation.h>
 
 namespace llmq
@@ -28,6 +30,17 @@ static const std::string DB_MINED_COMMITMENT_BY_INVERSED_HEIGHT = "q_mcih";
 
 static const std::string DB_BEST_BLOCK_UPGRADE = "q_bbu2";
 
+// There is at most one commitment per LLMQ type and DKG interval, so this covers commitments of many intervals
+static const uint32_t VERIFIED_COMMITMENTS_CACHE_SIZE = 1024;
+
+CQuorumBlockProcessor::CQuorumBlockProcessor(CSpecialDB& _specialDb) :
+    specialDb(_specialDb),
+    verifiedCommitmentsNonce(GetRandHash())
+{
+    LOCK(verifiedCommitmentsCs);
+    verifiedCommitments.setup(VERIFIED_COMMITMENTS_CACHE_SIZE);
+}
+
 void CQuorumBlockProcessor::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman)
 {
     if (strCommand == NetMsgType::QFCOMMITMENT) {
@@ -110,6 +123,8 @@ void CQuorumBlockProcessor::ProcessMessage(CNode* pfrom, const std::string& strC
             return;
         }
 
+        AddVerifiedCommitment(hash);
+
         LogPrint(BCLog::LLMQ, "CQuorumBlockProcessor::%s -- received commitment for quorum %s:%d, validMembers=%d, signers=%d, peer=%d\n", __func__,
                   qc.quorumHash.ToString(), qc.llmqType, qc.CountValidMembers(), qc.CountSigners(), pfrom->GetId());
 
@@ -117,7 +132,58 @@ void CQuorumBlockProcessor::ProcessMessage(CNode* pfrom, const std::string& strC
     }
 }
 
-bool CQuorumBlockProcessor::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state)
+void CQuorumBlockProcessor::GetCommitmentChecks(const CBlock& block, const CBlockIndex* pindex, std::vector<CSpecialTxCheck>& vChecks, std::set<uint256>& setCommitmentHashes)
+{
+    AssertLockHeld(cs_main);
+
+    if (pindex->nHeight < Params().GetConsensus().nLLMQActivationHeight) {
+        return;
+    }
+
+    std::map<Consensus::LLMQType, CFinalCommitment> qcs;
+    CValidationState dummy;
+    if (!GetCommitmentsFromBlock(block, pindex, qcs, dummy)) {
+        return;
+    }
+
+    for (auto& p : qcs) {
+        auto& qc = p.second;
+        if (qc.IsNull() || !Params().GetConsensus().llmqs.count(p.first)) {
+            continue;
+        }
+
+        // The cheap checks of ProcessCommitment, so that the members are not looked up and the signatures are not
+        // verified for a commitment that is rejected anyway
+        if (GetQuorumBlockHash(p.first, pindex->nHeight) != qc.quorumHash ||
+            !IsMiningPhase(p.first, pindex->nHeight) ||
+            HasMinedCommitment(p.first, qc.quorumHash)) {
+            continue;
+        }
+        auto it = ::BlockIndex().find(qc.quorumHash);
+        if (it == ::BlockIndex().end()) {
+            continue;
+        }
+
+        uint256 commitmentHash = ::SerializeHash(qc);
+        if (IsCommitmentVerified(commitmentHash)) {
+            // ProcessBlock finds it in the cache as well
+            continue;
+        }
+        setCommitmentHashes.emplace(commitmentHash);
+
+        // Same members as looked up by ProcessCommitment, so the result applies there
+        auto members = CLLMQUtils::GetAllQuorumMembers(p.first, it->second);
+        vChecks.emplace_back([this, commitmentHash, qc = std::move(qc), members = std::move(members)]() {
+            if (!qc.Verify(members, true)) {
+                return false;
+            }
+            AddVerifiedCommitment(commitmentHash);
+            return true;
+        });
+    }
+}
+
+bool CQuorumBlockProcessor::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck, const std::set<uint256>& setVerifiedCommitments)
 {
     AssertLockHeld(cs_main);
 
@@ -155,13 +221,34 @@ bool CQuorumBlockProcessor::ProcessBlock(const CBlock& block, const CBlockIndex*
 
     auto blockHash = block.GetHash();
 
+    uint64_t nHits = 0, nMisses = 0;
     for (auto& p : qcs) {
         auto& qc = p.second;
-        if (!ProcessCommitment(pindex->nHeight, blockHash, qc, state)) {
+        bool fSigsVerified = false;
+        if (!qc.IsNull()) {
+            uint256 commitmentHash = ::SerializeHash(qc);
+            if (setVerifiedCommitments.count(commitmentHash)) {
+                // verified by the check queue
+                fSigsVerified = true;
+                nMisses++;
+            } else if (IsCommitmentVerified(commitmentHash)) {
+                fSigsVerified = true;
+                nHits++;
+            } else {
+                nMisses++;
+            }
+        }
+        if (!ProcessCommitment(pindex->nHeight, blockHash, qc, state, fSigsVerified)) {
             return false;
         }
     }
 
+    // Only count the commitments of blocks that are connected, not those of templates checked by TestBlockValidity
+    if (!fJustCheck) {
+        nVerifiedCommitmentsHits += nHits;
+        nVerifiedCommitmentsMisses += nMisses;
+    }
+
     specialDb.Write(DB_BEST_BLOCK_UPGRADE, blockHash);
 
     return true;
@@ -175,7 +262,7 @@ static std::tuple<std::string, uint8_t, uint32_t> BuildInversedHeightKey(Consens
     return std::make_tuple(DB_MINED_COMMITMENT_BY_INVERSED_HEIGHT, (uint8_t)llmqType, htobe32(std::numeric_limits<uint32_t>::max() - nMinedHeight));
 }
 
-bool CQuorumBlockProcessor::ProcessCommitment(int nHeight, const uint256& blockHash, const CFinalCommitment& qc, CValidationState& state)
+bool CQuorumBlockProcessor::ProcessCommitment(int nHeight, const uint256& blockHash, const CFinalCommitment& qc, CValidationState& state, bool fSigsVerified)
 {
     auto& params = Params().GetConsensus().llmqs.at((Consensus::LLMQType)qc.llmqType);
 
@@ -207,9 +294,12 @@ bool CQuorumBlockProcessor::ProcessCommitment(int nHeight, const uint256& blockH
     auto quorumIndex = ::BlockIndex().at(qc.quorumHash);
     auto members = CLLMQUtils::GetAllQuorumMembers(params.type, quorumIndex);
 
-    if (!qc.Verify(members, true)) {
+    if (!qc.Verify(members, !fSigsVerified)) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-qc-invalid");
     }
+    if (!fSigsVerified) {
+        AddVerifiedCommitment(::SerializeHash(qc));
+    }
 
     // Store commitment in DB
     specialDb.Write(std::make_pair(DB_MINED_COMMITMENT, std::make_pair((uint8_t)params.type, quorumHash)), std::make_pair(qc, blockHash));
@@ -287,6 +377,34 @@ bool CQuorumBlockProcessor::GetCommitmentsFromBlock(const CBlock& block, const C
     return true;
 }
 
+uint256 CQuorumBlockProcessor::GetVerifiedCommitmentEntry(const uint256& commitmentHash) const
+{
+    uint256 entry;
+    CSHA256().Write(verifiedCommitmentsNonce.begin(), 32).Write(commitmentHash.begin(), 32).Finalize(entry.begin());
+    return entry;
+}
+
+bool CQuorumBlockProcessor::IsCommitmentVerified(const uint256& commitmentHash)
+{
+    uint256 entry = GetVerifiedCommitmentEntry(commitmentHash);
+    LOCK(verifiedCommitmentsCs);
+    // Keep the entry, so that it is found again when the block is reconnected after a reorg
+    return verifiedCommitments.contains(entry, false);
+}
+
+void CQuorumBlockProcessor::AddVerifiedCommitment(const uint256& commitmentHash)
+{
+    uint256 entry = GetVerifiedCommitmentEntry(commitmentHash);
+    LOCK(verifiedCommitmentsCs);
+    verifiedCommitments.insert(entry);
+}
+
+void CQuorumBlockProcessor::GetVerifiedCommitmentsStats(uint64_t& nHits, uint64_t& nMisses) const
+{
+    nHits = nVerifiedCommitmentsHits;
+    nMisses = nVerifiedCommitmentsMisses;
+}
+
 bool CQuorumBlockProcessor::IsMiningPhase(Consensus::LLMQType llmqType, int nHeight)
 {
     const auto& params = Params().GetConsensus().llmqs.at(llmqType);
@@ -10,15 +10,20 @@
 #include <llmq/quorums_utils.h>
 
 #include <consensus/params.h>
+#include <cuckoocache.h>
 #include <primitives/transaction.h>
 #include <saltedhasher.h>
+#include <script/sigcache.h>
 #include <sync.h>
 
+#include <atomic>
 #include <map>
+#include <set>
 #include <unordered_map>
 
 class CNode;
 class CConnman;
+class CSpecialTxCheck;
 
 namespace llmq
 {
@@ -35,12 +40,32 @@ private:
 
     std::unordered_map<std::pair<Consensus::LLMQType, uint256>, bool, StaticSaltedHasher> hasMinedCommitmentCache;
 
+    // Commitments with valid signatures, so that commitments received as qfcommit are not verified again when they
+    // are mined. Entries are SHA256(nonce || commitment hash), like in the script execution cache.
+    CCriticalSection verifiedCommitmentsCs;
+    uint256 verifiedCommitmentsNonce;
+    CuckooCache::cache<uint256, SignatureCacheHasher> verifiedCommitments GUARDED_BY(verifiedCommitmentsCs);
+    std::atomic<uint64_t> nVerifiedCommitmentsHits{0};
+    std::atomic<uint64_t> nVerifiedCommitmentsMisses{0};
+
 public:
-    CQuorumBlockProcessor(CSpecialDB& _specialDb) : specialDb(_specialDb) {}
+    CQuorumBlockProcessor(CSpecialDB& _specialDb);
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman);
 
-    bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state);
+    /**
+     * Queue the signature verification of the non-null commitments of a block onto vChecks, and add the hashes of
+     * the queued commitments to setCommitmentHashes. Commitments in the verified commitment cache are not queued.
+     * Commitments that fail the cheap checks of ProcessCommitment are skipped, ProcessBlock rejects them without
+     * verifying their signatures.
+     */
+    void GetCommitmentChecks(const CBlock& block, const CBlockIndex* pindex, std::vector<CSpecialTxCheck>& vChecks, std::set<uint256>& setCommitmentHashes);
+
+    /**
+     * Process the commitments of a block. The signatures of the commitments in setVerifiedCommitments or in the
+     * verified commitment cache are not checked again. The cache statistics are only updated if !fJustCheck.
+     */
+    bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck, const std::set<uint256>& setVerifiedCommitments = {});
     bool UndoBlock(const CBlock& block, const CBlockIndex* pindex);
 
     void AddMinableCommitment(const CFinalCommitment& fqc);
@@ -52,15 +77,23 @@ public:
     bool HasMinedCommitment(Consensus::LLMQType llmqType, const uint256& quorumHash);
     bool GetMinedCommitment(Consensus::LLMQType llmqType, const uint256& quorumHash, CFinalCommitment& ret, uint256& retMinedBlockHash);
 
+    /** Number of commitments in connected blocks whose signatures were (not) found in the verified commitment cache */
+    void GetVerifiedCommitmentsStats(uint64_t& nHits, uint64_t& nMisses) const;
+    /** Whether the signatures of the commitment with this hash were verified before, does not count as a hit or miss */
+    bool IsCommitmentVerified(const uint256& commitmentHash);
+    void AddVerifiedCommitment(const uint256& commitmentHash);
+
     std::vector<const CBlockIndex*> GetMinedCommitmentsUntilBlock(Consensus::LLMQType llmqType, const CBlockIndex* pindex, size_t maxCount);
     std::map<Consensus::LLMQType, std::vector<const CBlockIndex*>> GetMinedAndActiveCommitmentsUntilBlock(const CBlockIndex* pindex);
 
 private:
     bool GetCommitmentsFromBlock(const CBlock& block, const CBlockIndex* pindex, std::map<Consensus::LLMQType, CFinalCommitment>& ret, CValidationState& state);
-    bool ProcessCommitment(int nHeight, const uint256& blockHash, const CFinalCommitment& qc, CValidationState& state);
+    bool ProcessCommitment(int nHeight, const uint256& blockHash, const CFinalCommitment& qc, CValidationState& state, bool fSigsVerified);
     bool IsMiningPhase(Consensus::LLMQType llmqType, int nHeight);
     bool IsCommitmentRequired(Consensus::LLMQType llmqType, int nHeight);
     uint256 GetQuorumBlockHash(Consensus::LLMQType llmqType, int nHeight);
+
+    uint256 GetVerifiedCommitmentEntry(const uint256& commitmentHash) const;
 };
 
 extern CQuorumBlockProcessor* quorumBlockProcessor;
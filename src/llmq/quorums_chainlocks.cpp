@@ -77,6 +77,12 @@ bool CChainLocksHandler::GetChainLockByHash(const uint256& hash, llmq::CChainLoc
     return true;
 }
 
+bool CChainLocksHandler::IsBestChainLock(const uint256& hash)
+{
+    LOCK(cs);
+    return hash == bestChainLockHash;
+}
+
 void CChainLocksHandler::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman)
 {
     if (!sporkManager.IsSporkActive(SPORK_4_CHAINLOCKS_ENABLED))
@@ -5,6 +5,7 @@
 
 #include <llmq/quorums_dkgsession.h>
 
+#include <llmq/quorums_blockprocessor.h>
 #include <llmq/quorums_commitment.h>
 #include <llmq/quorums_debug.h>
 #include <llmq/quorums_dkgsessionmgr.h>
@@ -1139,6 +1140,12 @@ std::vector<CFinalCommitment> CDKGSession::FinalizeCommitments()
         it->second.emplace_back(qc);
     }
 
+    std::vector<CDeterministicMNCPtr> memberDmns;
+    memberDmns.reserve(members.size());
+    for (const auto& m : members) {
+        memberDmns.emplace_back(m->dmn);
+    }
+
     std::vector<CFinalCommitment> finalCommitments;
     for (const auto& p : commitmentsMap) {
         auto& cvec = p.second;
@@ -1194,11 +1201,21 @@ std::vector<CFinalCommitment> CDKGSession::FinalizeCommitments()
         }
         t2.stop();
 
+        // Verify the commitment like the block which mines it would, so that the block finds it in the verified
+        // commitment cache
+        cxxtimer::Timer t3(true);
+        if (!fqc.Verify(memberDmns, true)) {
+            LogPrint(BCLog::LLMQDKG, "CDKGSession::%s: final commitment is not valid\n", __func__);
+            continue;
+        }
+        quorumBlockProcessor->AddVerifiedCommitment(::SerializeHash(fqc));
+        t3.stop();
+
         finalCommitments.emplace_back(fqc);
 
-        LogPrint(BCLog::BENCHMARK, "CDKGSession::%s: final commitment: validMembers=%d, signers=%d, quorumPublicKey=%s, time1=%d, time2=%d\n",
+        LogPrint(BCLog::BENCHMARK, "CDKGSession::%s: final commitment: validMembers=%d, signers=%d, quorumPublicKey=%s, time1=%d, time2=%d, time3=%d\n",
             __func__, fqc.CountValidMembers(), fqc.CountSigners(), fqc.quorumPublicKey.ToString(),
-            t1.count(), t2.count());
+            t1.count(), t2.count(), t3.count());
     }
 
     return finalCommitments;
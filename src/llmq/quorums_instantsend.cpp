@@ -666,10 +666,10 @@ void CInstantSendManager::ProcessMessage(CNode* pfrom, const std::string& strCom
     }
 }
 
-void CInstantSendManager::ProcessMessageInstantSendLock(CNode* pfrom, const llmq::CInstantSendLock& islock, CConnman* connman)
+void CInstantSendManager::ProcessMessageInstantSendLock(CNode* pfrom, const llmq::CInstantSendLock& islock, CConnman* connman, bool fPreVerified)
 {
     bool ban = false;
-    if (!PreVerifyInstantSendLock(pfrom->GetId(), islock, ban)) {
+    if (!fPreVerified && !PreVerifyInstantSendLock(pfrom->GetId(), islock, ban)) {
         if (ban) {
             LOCK(cs_main);
             Misbehaving(pfrom->GetId(), 100);
@@ -925,6 +925,7 @@ void CInstantSendManager::ProcessInstantSendLock(NodeId from, const uint256& has
             db.WriteInstantSendLockMined(hash, pindexMined->nHeight);
         }
 
+        AddRecentLockedTxIfUnmined(islock.txid);
         // This will also add children TXs to pendingRetryTxs
         RemoveNonLockedTx(islock.txid, true);
     }
@@ -978,7 +979,8 @@ void CInstantSendManager::SyncTransaction(const CTransaction& tx, const CBlockIn
         return;
     }
 
-    bool inMempool = mempool.get(tx.GetHash()) != nullptr;
+    CTransactionRef mempoolTx = mempool.get(tx.GetHash());
+    bool inMempool = mempoolTx != nullptr;
     bool isDisconnect = pindex && posInBlock == CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK;
 
     // Are we called from validation.cpp/MemPoolConflictRemovalTracker?
@@ -1023,7 +1025,15 @@ void CInstantSendManager::SyncTransaction(const CTransaction& tx, const CBlockIn
         AddNonLockedTx(MakeTransactionRef(tx));
         nonLockedTxs.at(tx.GetHash()).pindexMined = !isDisconnect ? pindex : nullptr;
     } else {
-        // TX is locked, so make sure we don't track it anymore
+        // TX is locked, so make sure we don't track it anymore. Only TXs with an ISLOCK are kept in recentLockedTxs,
+        // a ChainLocked TX is mined already
+        if (!islockHash.IsNull()) {
+            if (!pindex && inMempool && !nonLockedTxs.count(tx.GetHash())) {
+                AddRecentLockedTx(mempoolTx);
+            } else {
+                AddRecentLockedTxIfUnmined(tx.GetHash());
+            }
+        }
         RemoveNonLockedTx(tx.GetHash(), true);
     }
 }
@@ -1101,6 +1111,43 @@ void CInstantSendManager::RemoveConflictedTx(const CTransaction& tx)
     }
 }
 
+void CInstantSendManager::AddRecentLockedTx(const CTransactionRef& tx)
+{
+    AssertLockHeld(cs);
+
+    if (recentLockedTxs.size() < MAX_RECENT_LOCKED_TXS) {
+        recentLockedTxs.emplace_back(tx);
+        return;
+    }
+    recentLockedTxs[recentLockedTxsPos] = tx;
+    recentLockedTxsPos = (recentLockedTxsPos + 1) % MAX_RECENT_LOCKED_TXS;
+}
+
+void CInstantSendManager::AddRecentLockedTxIfUnmined(const uint256& txid)
+{
+    AssertLockHeld(cs);
+
+    auto it = nonLockedTxs.find(txid);
+    if (it != nonLockedTxs.end() && it->second.tx && !it->second.pindexMined) {
+        AddRecentLockedTx(it->second.tx);
+    }
+}
+
+void CInstantSendManager::GetTransactionsForCompactBlocks(std::vector<std::pair<uint256, CTransactionRef>>& ret)
+{
+    LOCK(cs);
+    ret.reserve(ret.size() + nonLockedTxs.size() + recentLockedTxs.size());
+    for (const auto& p : nonLockedTxs) {
+        // entries without a TX are only parents we track children for
+        if (p.second.tx && !p.second.pindexMined) {
+            ret.emplace_back(p.second.tx->GetWitnessHash(), p.second.tx);
+        }
+    }
+    for (const auto& tx : recentLockedTxs) {
+        ret.emplace_back(tx->GetWitnessHash(), tx);
+    }
+}
+
 void CInstantSendManager::NotifyChainLock(const CBlockIndex* pindexChainLock)
 {
     HandleFullyConfirmedBlock(pindexChainLock);
@@ -1425,6 +1472,16 @@ bool CInstantSendManager::GetInstantSendLockByHash(const uint256& hash, llmq::CI
     return true;
 }
 
+bool CInstantSendManager::HasInstantSendLock(const uint256& hash)
+{
+    if (!IsInstantSendEnabled()) {
+        return false;
+    }
+
+    LOCK(cs);
+    return db.GetInstantSendLockByHash(hash) != nullptr;
+}
+
 bool CInstantSendManager::IsLocked(const uint256& txHash)
 {
     if (!IsInstantSendEnabled()) {
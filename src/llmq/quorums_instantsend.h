@@ -15,6 +15,8 @@
 #include <unordered_map>
 #include <unordered_set>
 
+struct CInstantSendManagerTest;
+
 namespace llmq
 {
 
@@ -112,6 +114,14 @@ private:
 
     std::unordered_set<uint256, StaticSaltedHasher> pendingRetryTxs;
 
+    // Ring buffer of recently IS locked mempool TXs. These are likely to be included in the next blocks and are kept
+    // around for compact block reconstruction, even if they got evicted from the mempool in the meantime
+    static const size_t MAX_RECENT_LOCKED_TXS = 1000;
+    std::vector<CTransactionRef> recentLockedTxs;
+    size_t recentLockedTxsPos{0};
+
+    friend struct ::CInstantSendManagerTest;
+
 public:
     CInstantSendManager(CDBWrapper& _llmqDb);
     ~CInstantSendManager();
@@ -135,7 +145,8 @@ public:
     void TrySignInstantSendLock(const CTransaction& tx);
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman);
-    void ProcessMessageInstantSendLock(CNode* pfrom, const CInstantSendLock& islock, CConnman* connman);
+    // fPreVerified is set when PreVerifyInstantSendLock already succeeded on a message worker thread
+    void ProcessMessageInstantSendLock(CNode* pfrom, const CInstantSendLock& islock, CConnman* connman, bool fPreVerified = false);
     bool PreVerifyInstantSendLock(NodeId nodeId, const CInstantSendLock& islock, bool& retBan);
     bool ProcessPendingInstantSendLocks();
     std::unordered_set<uint256> ProcessPendingInstantSendLocks(int signHeight, const std::unordered_map<uint256, std::pair<NodeId, CInstantSendLock>>& pend, bool ban);
@@ -146,6 +157,11 @@ public:
     void AddNonLockedTx(const CTransactionRef& tx);
     void RemoveNonLockedTx(const uint256& txid, bool retryChildren);
     void RemoveConflictedTx(const CTransaction& tx);
+    void AddRecentLockedTx(const CTransactionRef& tx);
+    void AddRecentLockedTxIfUnmined(const uint256& txid);
+
+    // Appends (wtxid, tx) pairs of TXs which are likely to be included in upcoming blocks, for compact block reconstruction
+    void GetTransactionsForCompactBlocks(std::vector<std::pair<uint256, CTransactionRef>>& ret);
 
     void NotifyChainLock(const CBlockIndex* pindexChainLock);
     void UpdatedBlockTip(const CBlockIndex* pindexNew);
@@ -160,6 +176,7 @@ public:
 
     bool AlreadyHave(const CInv& inv);
     bool GetInstantSendLockByHash(const uint256& hash, CInstantSendLock& ret);
+    bool HasInstantSendLock(const uint256& hash);
 
     size_t GetInstantSendLockCount();
 
@@ -445,6 +445,11 @@ bool CSigningManager::GetRecoveredSigForGetData(const uint256& hash, CRecoveredS
     return true;
 }
 
+bool CSigningManager::HasRecoveredSigForGetData(const uint256& hash, Consensus::LLMQType llmqType, const uint256& quorumHash)
+{
+    return db.HasRecoveredSigForHash(hash) && CLLMQUtils::IsQuorumActive(llmqType, quorumHash);
+}
+
 void CSigningManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman)
 {
     if (strCommand == NetMsgType::QSIGREC) {
@@ -140,6 +140,8 @@ public:
 
     bool AlreadyHave(const CInv& inv);
     bool GetRecoveredSigForGetData(const uint256& hash, CRecoveredSig& ret);
+    // Same as GetRecoveredSigForGetData, for a recovered sig of the given quorum which was looked up before
+    bool HasRecoveredSigForGetData(const uint256& hash, Consensus::LLMQType llmqType, const uint256& quorumHash);
 
     void ProcessMessage(CNode* pnode, const std::string& strCommand, CDataStream& vRecv, CConnman* connman);
 
@@ -151,8 +153,9 @@ public:
     // mechanism prevents possible conflicts. As an example, ChainLocks prevent conflicts in confirmed TXs InstantSend votes
     void RemoveRecoveredSig(Consensus::LLMQType llmqType, const uint256& id);
 
-private:
     void ProcessMessageRecoveredSig(CNode* pfrom, const CRecoveredSig& recoveredSig, CConnman* connman);
+
+private:
     bool PreVerifyRecoveredSig(NodeId nodeId, const CRecoveredSig& recoveredSig, bool& retBan);
 
     void CollectPendingRecoveredSigsToVerify(size_t maxUniqueSessions,
@@ -5,6 +5,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <llmq/quorums.h>
+#include <llmq/quorums_init.h>
 #include <llmq/quorums_utils.h>
 
 #include <chainparams.h>
@@ -95,6 +96,26 @@ std::set<size_t> CLLMQUtils::CalcDeterministicWatchConnections(Consensus::LLMQTy
     return result;
 }
 
+std::set<uint256> CLLMQUtils::GetQuorumConnectionsForNode(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, const std::vector<CDeterministicMNCPtr>& members, const uint256& myProTxHash)
+{
+    bool isMember = !myProTxHash.IsNull() && std::any_of(members.begin(), members.end(), [&](const CDeterministicMNCPtr& dmn) {
+        return dmn->proTxHash == myProTxHash;
+    });
+    if (isMember) {
+        return GetQuorumConnections(llmqType, pindexQuorum, myProTxHash);
+    }
+
+    std::set<uint256> result;
+    if (members.empty() || !gArgs.GetBoolArg("-watchquorums", DEFAULT_WATCH_QUORUMS)) {
+        return result;
+    }
+    auto cindexes = CalcDeterministicWatchConnections(llmqType, pindexQuorum, members.size(), 1);
+    for (auto idx : cindexes) {
+        result.emplace(members[idx]->proTxHash);
+    }
+    return result;
+}
+
 bool CLLMQUtils::IsQuorumActive(Consensus::LLMQType llmqType, const uint256& quorumHash)
 {
     auto& params = Params().GetConsensus().llmqs.at(llmqType);
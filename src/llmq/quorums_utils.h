@@ -34,6 +34,9 @@ public:
 
     static std::set<uint256> GetQuorumConnections(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, const uint256& forMember);
     static std::set<size_t> CalcDeterministicWatchConnections(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, size_t memberCount, size_t connectionCount);
+    // The masternodes this node connects to for a quorum: the connections of a member, or the deterministic watch
+    // connections if this node is not a member but watches quorums. Empty otherwise.
+    static std::set<uint256> GetQuorumConnectionsForNode(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, const std::vector<CDeterministicMNCPtr>& members, const uint256& myProTxHash);
 
     static bool IsQuorumActive(Consensus::LLMQType llmqType, const uint256& quorumHash);
 
@@ -4,10 +4,18 @@
 
 #include <masternodes/meta.h>
 
+#include <dbwrapper.h>
+#include <util/system.h>
+
+#include <algorithm>
+
 CMasternodeMetaMan mmetaman;
 
 const std::string CMasternodeMetaMan::SERIALIZATION_VERSION_STRING = "CMasternodeMetaMan-Version-1";
 
+static const std::string DB_META_INFO = "mm_i";
+static const std::string DB_DSQ_COUNT = "mm_dsq";
+
 void CMasternodeMetaInfo::AddGovernanceVote(const uint256& nGovernanceObjectHash)
 {
     LOCK(cs);
@@ -15,13 +23,16 @@ void CMasternodeMetaInfo::AddGovernanceVote(const uint256& nGovernanceObjectHash
     // ensures the value is in the map.
     const auto& pair = mapGovernanceObjectsVotedOn.emplace(nGovernanceObjectHash, 0);
     pair.first->second++;
+    fDirty = true;
 }
 
 void CMasternodeMetaInfo::RemoveGovernanceObject(const uint256& nGovernanceObjectHash)
 {
     LOCK(cs);
     // Whether or not the govobj hash exists in the map first is irrelevant.
-    mapGovernanceObjectsVotedOn.erase(nGovernanceObjectHash);
+    if (mapGovernanceObjectsVotedOn.erase(nGovernanceObjectHash)) {
+        fDirty = true;
+    }
 }
 
 /**
@@ -38,23 +49,119 @@ void CMasternodeMetaInfo::FlagGovernanceItemsAsDirty()
     }
 }
 
+CMasternodeMetaMan::CMasternodeMetaMan()
+{
+}
+
+CMasternodeMetaMan::~CMasternodeMetaMan()
+{
+    // free the remaining nodes of the dirty hash stack
+    GetAndClearDirtyGovernanceObjectHashes();
+}
+
+CMasternodeMetaMan::Shard& CMasternodeMetaMan::GetShard(const uint256& proTxHash)
+{
+    return shards[proTxHash.GetCheapHash() % SHARD_COUNT];
+}
+
+bool CMasternodeMetaMan::InitDB(bool fWipe)
+{
+    LOCK(cs_db);
+
+    Clear();
+    try {
+        db = std::make_unique<CDBWrapper>(GetDataDir() / "mnmeta", 1 << 20, false, fWipe);
+    } catch (const std::exception& e) {
+        return error("CMasternodeMetaMan::%s -- failed to open database: %s", __func__, e.what());
+    }
+
+    int64_t nDsqCountTmp = 0;
+    db->Read(DB_DSQ_COUNT, nDsqCountTmp);
+    nDsqCount = nDsqCountTmp;
+
+    std::unique_ptr<CDBIterator> pcursor(db->NewIterator());
+    auto start = std::make_tuple(DB_META_INFO, uint256());
+    pcursor->Seek(start);
+
+    size_t cnt = 0;
+    while (pcursor->Valid()) {
+        decltype(start) k;
+        if (!pcursor->GetKey(k) || std::get<0>(k) != DB_META_INFO) {
+            break;
+        }
+        auto mm = std::make_shared<CMasternodeMetaInfo>();
+        if (!pcursor->GetValue(*mm)) {
+            return error("CMasternodeMetaMan::%s -- failed to read meta info for %s", __func__, std::get<1>(k).ToString());
+        }
+        mm->fDirty = false;
+
+        auto& shard = GetShard(mm->GetProTxHash());
+        {
+            LOCK(shard.cs);
+            shard.metaInfos.emplace(mm->GetProTxHash(), std::move(mm));
+        }
+        cnt++;
+        pcursor->Next();
+    }
+
+    LogPrintf("CMasternodeMetaMan::%s -- loaded %d meta infos\n", __func__, cnt);
+    return true;
+}
+
+void CMasternodeMetaMan::Flush()
+{
+    LOCK(cs_db);
+    if (!db) {
+        return;
+    }
+
+    int64_t nStart = GetTimeMillis();
+
+    // only hold the shard locks while collecting, serialization happens outside of them
+    std::vector<CMasternodeMetaInfoPtr> vecDirty;
+    for (auto& shard : shards) {
+        LOCK(shard.cs);
+        for (const auto& p : shard.metaInfos) {
+            if (p.second->fDirty.exchange(false)) {
+                vecDirty.emplace_back(p.second);
+            }
+        }
+    }
+
+    CDBBatch batch(*db);
+    for (const auto& mm : vecDirty) {
+        batch.Write(std::make_tuple(DB_META_INFO, mm->GetProTxHash()), *mm);
+    }
+    batch.Write(DB_DSQ_COUNT, nDsqCount.load());
+    db->WriteBatch(batch);
+
+    LogPrint(BCLog::MASTERNODE, "CMasternodeMetaMan::%s -- wrote %d changed meta infos, %dms\n", __func__, vecDirty.size(), GetTimeMillis() - nStart);
+}
+
+void CMasternodeMetaMan::CloseDB()
+{
+    Flush();
+    LOCK(cs_db);
+    db.reset();
+}
+
 CMasternodeMetaInfoPtr CMasternodeMetaMan::GetMetaInfo(const uint256& proTxHash, bool fCreate)
 {
-    LOCK(cs);
-    auto it = metaInfos.find(proTxHash);
-    if (it != metaInfos.end()) {
+    auto& shard = GetShard(proTxHash);
+    LOCK(shard.cs);
+    auto it = shard.metaInfos.find(proTxHash);
+    if (it != shard.metaInfos.end()) {
         return it->second;
     }
     if (!fCreate) {
         return nullptr;
     }
-    it = metaInfos.emplace(proTxHash, std::make_shared<CMasternodeMetaInfo>(proTxHash)).first;
+    it = shard.metaInfos.emplace(proTxHash, std::make_shared<CMasternodeMetaInfo>(proTxHash)).first;
     return it->second;
 }
 
 bool CMasternodeMetaMan::AddGovernanceVote(const uint256& proTxHash, const uint256& nGovernanceObjectHash)
 {
-    LOCK(cs);
     auto mm = GetMetaInfo(proTxHash);
     mm->AddGovernanceVote(nGovernanceObjectHash);
     return true;
@@ -62,31 +169,44 @@ bool CMasternodeMetaMan::AddGovernanceVote(const uint256& proTxHash, const uint2
 
 void CMasternodeMetaMan::RemoveGovernanceObject(const uint256& nGovernanceObjectHash)
 {
-    LOCK(cs);
-    for(auto& p : metaInfos) {
-        p.second->RemoveGovernanceObject(nGovernanceObjectHash);
+    for (auto& shard : shards) {
+        LOCK(shard.cs);
+        for (auto& p : shard.metaInfos) {
+            p.second->RemoveGovernanceObject(nGovernanceObjectHash);
+        }
     }
 }
 
 void CMasternodeMetaMan::AddDirtyGovernanceObjectHash(const uint256& nHash)
 {
-    LOCK(cs);
-    vecDirtyGovernanceObjectHashes.push_back(nHash);
+    DirtyHashNode* node = new DirtyHashNode{nHash, dirtyGovernanceObjectHashes.load(std::memory_order_relaxed)};
+    while (!dirtyGovernanceObjectHashes.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+    }
 }
 
 std::vector<uint256> CMasternodeMetaMan::GetAndClearDirtyGovernanceObjectHashes()
 {
-    LOCK(cs);
-    std::vector<uint256> vecTmp = std::move(vecDirtyGovernanceObjectHashes);
-    vecDirtyGovernanceObjectHashes.clear();
+    // nodes are never popped individually, so taking the whole stack at once is not prone to ABA
+    DirtyHashNode* node = dirtyGovernanceObjectHashes.exchange(nullptr, std::memory_order_acquire);
+    std::vector<uint256> vecTmp;
+    while (node) {
+        vecTmp.push_back(node->hash);
+        DirtyHashNode* next = node->next;
+        delete node;
+        node = next;
+    }
+    // restore insertion order
+    std::reverse(vecTmp.begin(), vecTmp.end());
     return vecTmp;
 }
 
 void CMasternodeMetaMan::Clear()
 {
-    LOCK(cs);
-    metaInfos.clear();
-    vecDirtyGovernanceObjectHashes.clear();
+    for (auto& shard : shards) {
+        LOCK(shard.cs);
+        shard.metaInfos.clear();
+    }
+    GetAndClearDirtyGovernanceObjectHashes();
 }
 
 void CMasternodeMetaMan::CheckAndRemove()
@@ -96,9 +216,15 @@ void CMasternodeMetaMan::CheckAndRemove()
 
 std::string CMasternodeMetaMan::ToString() const
 {
+    size_t nCount = 0;
+    for (const auto& shard : shards) {
+        LOCK(shard.cs);
+        nCount += shard.metaInfos.size();
+    }
+
     std::ostringstream info;
 
-    info << "Masternodes: meta infos object count: " << (int)metaInfos.size() <<
+    info << "Masternodes: meta infos object count: " << (int)nCount <<
          ", nDsqCount: " << (int)nDsqCount;
     return info.str();
 }
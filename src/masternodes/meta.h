@@ -5,12 +5,16 @@
 #ifndef EMRALS_MASTERNODE_META_H
 #define EMRALS_MASTERNODE_META_H
 
+#include <saltedhasher.h>
 #include <serialize.h>
 #include <special/deterministicmns.h>
 
+#include <atomic>
 #include <memory>
+#include <unordered_map>
 
 class CConnman;
+class CDBWrapper;
 
 static const int MASTERNODE_MAX_MIXING_TXES             = 5;
 
@@ -21,26 +25,31 @@ class CMasternodeMetaInfo
     friend class CMasternodeMetaMan;
 
 private:
+    // protects mapGovernanceObjectsVotedOn, the counters are atomics and proTxHash never changes
     mutable CCriticalSection cs;
 
     uint256 proTxHash;
 
     //the dsq count from the last dsq broadcast of this node
-    int64_t nLastDsq = 0;
-    int nMixingTxCount = 0;
+    std::atomic<int64_t> nLastDsq{0};
+    std::atomic<int> nMixingTxCount{0};
 
     // KEEP TRACK OF GOVERNANCE ITEMS EACH MASTERNODE HAS VOTE UPON FOR RECALCULATION
     std::map<uint256, int> mapGovernanceObjectsVotedOn;
 
+    // set when the entry changed since it was last written to the database
+    std::atomic<bool> fDirty{true};
+
 public:
     CMasternodeMetaInfo() {}
     CMasternodeMetaInfo(const uint256& _proTxHash) : proTxHash(_proTxHash) {}
     CMasternodeMetaInfo(const CMasternodeMetaInfo& ref) :
         proTxHash(ref.proTxHash),
-        nLastDsq(ref.nLastDsq),
-        nMixingTxCount(ref.nMixingTxCount),
-        mapGovernanceObjectsVotedOn(ref.mapGovernanceObjectsVotedOn)
+        nLastDsq(ref.nLastDsq.load()),
+        nMixingTxCount(ref.nMixingTxCount.load())
     {
+        LOCK(ref.cs);
+        mapGovernanceObjectsVotedOn = ref.mapGovernanceObjectsVotedOn;
     }
 
     template <typename Stream>
@@ -54,16 +63,22 @@ public:
     inline void SerializationOp(Stream& s, Operation ser_action)
     {
         LOCK(cs);
+        int64_t nLastDsqTmp = nLastDsq;
+        int nMixingTxCountTmp = nMixingTxCount;
         READWRITE(proTxHash);
-        READWRITE(nLastDsq);
-        READWRITE(nMixingTxCount);
+        READWRITE(nLastDsqTmp);
+        READWRITE(nMixingTxCountTmp);
         READWRITE(mapGovernanceObjectsVotedOn);
+        if (ser_action.ForRead()) {
+            nLastDsq = nLastDsqTmp;
+            nMixingTxCount = nMixingTxCountTmp;
+        }
     }
 
 public:
-    const uint256& GetProTxHash() const { LOCK(cs); return proTxHash; }
-    int64_t GetLastDsq() const { LOCK(cs); return nLastDsq; }
-    int GetMixingTxCount() const { LOCK(cs); return nMixingTxCount; }
+    const uint256& GetProTxHash() const { return proTxHash; }
+    int64_t GetLastDsq() const { return nLastDsq; }
+    int GetMixingTxCount() const { return nMixingTxCount; }
 
     bool IsValidForMixingTxes() const { return GetMixingTxCount() <= MASTERNODE_MAX_MIXING_TXES; }
 
@@ -81,22 +96,42 @@ class CMasternodeMetaMan
 private:
     static const std::string SERIALIZATION_VERSION_STRING;
 
-    CCriticalSection cs;
+    // meta infos are spread over a fixed number of independently locked shards, so that votes for different
+    // masternodes don't contend with each other
+    static const size_t SHARD_COUNT = 16;
 
-    std::map<uint256, CMasternodeMetaInfoPtr> metaInfos;
-    std::vector<uint256> vecDirtyGovernanceObjectHashes;
+    struct Shard {
+        mutable CCriticalSection cs;
+        std::unordered_map<uint256, CMasternodeMetaInfoPtr, StaticSaltedHasher> metaInfos;
+    };
+    Shard shards[SHARD_COUNT];
+
+    // lock-free stack of dirty governance object hashes, appended to by vote processing and drained by governance
+    struct DirtyHashNode {
+        uint256 hash;
+        DirtyHashNode* next;
+    };
+    std::atomic<DirtyHashNode*> dirtyGovernanceObjectHashes{nullptr};
 
     // keep track of dsq count to prevent masternodes from gaming privatesend queue
-    int64_t nDsqCount = 0;
+    std::atomic<int64_t> nDsqCount{0};
+
+    // protects db
+    CCriticalSection cs_db;
+    std::unique_ptr<CDBWrapper> db;
+
+    Shard& GetShard(const uint256& proTxHash);
 
 public:
+    CMasternodeMetaMan();
+    ~CMasternodeMetaMan();
+
     ADD_SERIALIZE_METHODS
 
+    // Only used to read the legacy mncache.dat, the database is written through Flush
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action)
     {
-        LOCK(cs);
-
         std::string strVersion;
         if(ser_action.ForRead()) {
             Clear();
@@ -113,21 +148,33 @@ public:
         std::vector<CMasternodeMetaInfo> tmpMetaInfo;
         if (ser_action.ForRead()) {
             READWRITE(tmpMetaInfo);
-            metaInfos.clear();
             for (auto& mm : tmpMetaInfo) {
-                metaInfos.emplace(mm.GetProTxHash(), std::make_shared<CMasternodeMetaInfo>(std::move(mm)));
+                auto& shard = GetShard(mm.GetProTxHash());
+                LOCK(shard.cs);
+                shard.metaInfos.emplace(mm.GetProTxHash(), std::make_shared<CMasternodeMetaInfo>(mm));
             }
         } else {
-            for (auto& p : metaInfos) {
-                tmpMetaInfo.emplace_back(*p.second);
+            for (auto& shard : shards) {
+                LOCK(shard.cs);
+                for (auto& p : shard.metaInfos) {
+                    tmpMetaInfo.emplace_back(*p.second);
+                }
             }
             READWRITE(tmpMetaInfo);
         }
 
-        READWRITE(nDsqCount);
+        int64_t nDsqCountTmp = nDsqCount;
+        READWRITE(nDsqCountTmp);
+        nDsqCount = nDsqCountTmp;
     }
 
 public:
+    // Opens the database at <datadir>/mnmeta and loads all meta infos from it
+    bool InitDB(bool fWipe);
+    // Writes all meta infos which changed since the last flush
+    void Flush();
+    void CloseDB();
+
     CMasternodeMetaInfoPtr GetMetaInfo(const uint256& proTxHash, bool fCreate = true);
 
     bool AddGovernanceVote(const uint256& proTxHash, const uint256& nGovernanceObjectHash);
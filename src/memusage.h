@@ -6,6 +6,7 @@
 #define EMRALS_MEMUSAGE_H
 
 #include <indirectmap.h>
+#include <prevector.h>
 
 #include <stdlib.h>
 
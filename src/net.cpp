@@ -24,18 +24,26 @@
 #include <ui_interface.h>
 #include <util/init.h>
 #include <util/strencodings.h>
+#include <util/threadnames.h>
 #include <util/translation.h>
 
+#include <ctpl.h>
+
 #ifdef WIN32
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
 #endif
 
 #ifdef USE_POLL
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -50,7 +58,7 @@ static_assert(MINIUPNPC_API_VERSION >= 10, "miniUPnPc API version >= 10 assumed"
 
 #include <math.h>
 
-// Dump addresses to peers.dat every 15 minutes (900s)
+// Flush changed addresses to the peers database every 15 minutes (900s)
 static constexpr int DUMP_PEERS_INTERVAL = 15 * 60;
 
 // We add a random period time (0 to 1 seconds) to feeler connections to prevent synchronization.
@@ -532,6 +540,11 @@ void CNode::copyStats(CNodeStats &stats)
         X(mapRecvBytesPerMsgCmd);
         X(nRecvBytes);
     }
+    {
+        LOCK(cs_msgCost);
+        X(mapRecvCostPerMsgCmd);
+        X(nCpuBudgetExceeded);
+    }
     X(fWhitelisted);
     {
         LOCK(cs_feeFilter);
@@ -713,33 +726,79 @@ const uint256& CNetMessage::GetMessageHash() const
     return data_hash;
 }
 
+// Maximum number of buffers handed to a single sendmsg call, well below IOV_MAX everywhere
+static const int MAX_SEND_IOV = 64;
+
 size_t CConnman::SocketSendData(CNode *pnode) const EXCLUSIVE_LOCKS_REQUIRED(pnode->cs_vSend)
 {
     auto it = pnode->vSendMsg.begin();
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert((*it)->size() > pnode->nSendOffset);
+        size_t nToSend = 0;
         int nBytes = 0;
+#ifndef WIN32
+        // Gather the headers and payloads of as many queued messages as possible into a single call, the payloads
+        // may be shared with other peers so they are sent from where they are instead of being copied
+        struct iovec iov[MAX_SEND_IOV];
+        int nIov = 0;
+        size_t nSkip = pnode->nSendOffset;
+        for (auto it2 = it; it2 != pnode->vSendMsg.end() && nIov + 2 <= MAX_SEND_IOV; ++it2) {
+            for (const auto* buf : {&(*it2)->header, &(*it2)->data}) {
+                if (nSkip >= buf->size()) {
+                    nSkip -= buf->size();
+                    continue;
+                }
+                iov[nIov].iov_base = const_cast<unsigned char*>(buf->data()) + nSkip;
+                iov[nIov].iov_len = buf->size() - nSkip;
+                nToSend += iov[nIov].iov_len;
+                nIov++;
+                nSkip = 0;
+            }
+        }
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = nIov;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
         }
+#else
+        // no gather writes here, send the header and the payload of the first message one after the other
+        const CPreparedNetMsg& prepared = **it;
+        const bool fHeader = pnode->nSendOffset < prepared.header.size();
+        const auto& buf = fHeader ? prepared.header : prepared.data;
+        size_t nOffset = fHeader ? pnode->nSendOffset : pnode->nSendOffset - prepared.header.size();
+        nToSend = buf.size() - nOffset;
+        {
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                break;
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(buf.data()) + nOffset, nToSend, MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+#endif
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            size_t nRemaining = nBytes;
+            while (nRemaining != 0) {
+                size_t nLeft = (*it)->size() - pnode->nSendOffset;
+                if (nRemaining < nLeft) {
+                    pnode->nSendOffset += nRemaining;
+                    break;
+                }
+                nRemaining -= nLeft;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                pnode->nSendSize -= (*it)->size();
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if ((size_t)nBytes < nToSend) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -762,6 +821,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const EXCLUSIVE_LOCKS_REQUIRED(pno
         assert(pnode->nSendSize == 0);
     }
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
+    UpdateSocketEvents(pnode);
     return nSentSize;
 }
 
@@ -1035,6 +1095,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
+    RegisterSocketEvents(pnode);
 }
 
 void CConnman::DisconnectNodes()
@@ -1066,6 +1127,7 @@ void CConnman::DisconnectNodes()
                 pnode->grantMasternodeOutbound.Release();
 
                 // close socket and cleanup
+                UnregisterSocketEvents(pnode);
                 pnode->CloseSocketDisconnect();
 
                 // hold in disconnected pool until all refs are released
@@ -1147,6 +1209,49 @@ void CConnman::InactivityCheck(CNode *pnode)
     }
 }
 
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& modeRet)
+{
+    if (strMode == "select") {
+        modeRet = SOCKETEVENTS_SELECT;
+        return true;
+    }
+#ifdef USE_POLL
+    if (strMode == "poll") {
+        modeRet = SOCKETEVENTS_POLL;
+        return true;
+    }
+#endif
+#ifdef USE_EPOLL
+    if (strMode == "epoll") {
+        modeRet = SOCKETEVENTS_EPOLL;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string GetSocketEventsModeName(SocketEventsMode mode)
+{
+    switch (mode) {
+    case SOCKETEVENTS_SELECT: return "select";
+    case SOCKETEVENTS_POLL:   return "poll";
+    case SOCKETEVENTS_EPOLL:  return "epoll";
+    }
+    return "unknown";
+}
+
+std::string GetSupportedSocketEventsModes()
+{
+    std::string strModes = GetSocketEventsModeName(SOCKETEVENTS_SELECT);
+#ifdef USE_POLL
+    strModes += ", " + GetSocketEventsModeName(SOCKETEVENTS_POLL);
+#endif
+#ifdef USE_EPOLL
+    strModes += ", " + GetSocketEventsModeName(SOCKETEVENTS_EPOLL);
+#endif
+    return strModes;
+}
+
 bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     for (const ListenSocket& hListenSocket : vhListenSocket) {
@@ -1194,7 +1299,7 @@ bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &s
 }
 
 #ifdef USE_POLL
-void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+void CConnman::SocketEventsPoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
     if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
@@ -1235,8 +1340,9 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
         if (pollfd_entry.revents & (POLLERR|POLLHUP)) error_set.insert(pollfd_entry.fd);
     }
 }
-#else
-void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+#endif
+
+void CConnman::SocketEventsSelect(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
     if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
@@ -1309,12 +1415,159 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
         }
     }
 }
+
+#ifdef USE_EPOLL
+void CConnman::SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, std::vector<CNode*>& vNodesRet)
+{
+    const size_t maxEvents = 1024;
+    epoll_event events[maxEvents];
+
+    // The interest set is kept up to date by RegisterSocketEvents/UpdateSocketEvents, so unlike select/poll there
+    // is nothing to rebuild here. Sockets which are ready but did not fit into events are reported on the next call.
+    int nEvents = epoll_wait(epollFd, events, maxEvents, SELECT_TIMEOUT_MILLISECONDS);
+    if (interruptNet) return;
+
+    if (nEvents < 0) {
+        int nErr = errno;
+        if (nErr != EINTR) {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        return;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+        const epoll_event& e = events[i];
+
+        const ListenSocket* pListenSocket = nullptr;
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            if (&hListenSocket == e.data.ptr) {
+                pListenSocket = &hListenSocket;
+                break;
+            }
+        }
+        if (pListenSocket) {
+            recv_set.insert(pListenSocket->socket);
+            continue;
+        }
+
+        // Nodes are only deleted by this thread and are removed from the interest set before that, see DisconnectNodes
+        CNode* pnode = static_cast<CNode*>(e.data.ptr);
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET) {
+            continue;
+        }
+        if (e.events & EPOLLIN)               recv_set.insert(pnode->hSocket);
+        if (e.events & EPOLLOUT)              send_set.insert(pnode->hSocket);
+        if (e.events & (EPOLLERR | EPOLLHUP)) error_set.insert(pnode->hSocket);
+        vNodesRet.emplace_back(pnode);
+    }
+}
+#endif
+
+void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, std::vector<CNode*>& vNodesRet)
+{
+    switch (socketEventsMode) {
+#ifdef USE_EPOLL
+    case SOCKETEVENTS_EPOLL:
+        SocketEventsEpoll(recv_set, send_set, error_set, vNodesRet);
+        return;
+#endif
+#ifdef USE_POLL
+    case SOCKETEVENTS_POLL:
+        SocketEventsPoll(recv_set, send_set, error_set);
+        break;
+#endif
+    case SOCKETEVENTS_SELECT:
+        SocketEventsSelect(recv_set, send_set, error_set);
+        break;
+    default:
+        assert(false);
+    }
+
+    // select and poll only report sockets, so all nodes need to be looked at
+    LOCK(cs_vNodes);
+    vNodesRet = vNodes;
+}
+
+#ifdef USE_EPOLL
+static uint32_t GetWantedSocketEvents(CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(pnode->cs_vSend)
+{
+    // Same logic as in GenerateSelectSet: drain the send queue first, then receive if there is space left
+    if (!pnode->vSendMsg.empty()) {
+        return EPOLLOUT;
+    }
+    return pnode->fPauseRecv ? 0u : (uint32_t)EPOLLIN;
+}
 #endif
 
+void CConnman::RegisterSocketEvents(CNode* pnode)
+{
+#ifdef USE_EPOLL
+    if (epollFd == -1) return;
+
+    LOCK2(pnode->cs_vSend, pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET || pnode->fSocketEventsRegistered) return;
+
+    epoll_event e;
+    e.events = GetWantedSocketEvents(pnode);
+    e.data.ptr = pnode;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, pnode->hSocket, &e) != 0) {
+        // without registration we would never hear from this peer again
+        LogPrintf("%s -- epoll_ctl failed for peer=%d: %s\n", __func__, pnode->GetId(), NetworkErrorString(errno));
+        pnode->fDisconnect = true;
+        return;
+    }
+    pnode->fSocketEventsRegistered = true;
+    pnode->nSocketEvents = e.events;
+#endif
+}
+
+void CConnman::UnregisterSocketEvents(CNode* pnode)
+{
+#ifdef USE_EPOLL
+    if (epollFd == -1) return;
+
+    LOCK(pnode->cs_hSocket);
+    if (!pnode->fSocketEventsRegistered) return;
+    pnode->fSocketEventsRegistered = false;
+    // a closed socket was already removed from the interest set by the kernel
+    if (pnode->hSocket == INVALID_SOCKET) return;
+
+    epoll_event e;
+    if (epoll_ctl(epollFd, EPOLL_CTL_DEL, pnode->hSocket, &e) != 0) {
+        LogPrintf("%s -- epoll_ctl failed for peer=%d: %s\n", __func__, pnode->GetId(), NetworkErrorString(errno));
+    }
+#endif
+}
+
+void CConnman::UpdateSocketEvents(CNode* pnode) const
+{
+#ifdef USE_EPOLL
+    if (epollFd == -1) return;
+
+    LOCK2(pnode->cs_vSend, pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET || !pnode->fSocketEventsRegistered) return;
+
+    uint32_t nEvents = GetWantedSocketEvents(pnode);
+    if (nEvents == pnode->nSocketEvents) return;
+
+    epoll_event e;
+    e.events = nEvents;
+    e.data.ptr = pnode;
+    if (epoll_ctl(epollFd, EPOLL_CTL_MOD, pnode->hSocket, &e) != 0) {
+        LogPrintf("%s -- epoll_ctl failed for peer=%d: %s\n", __func__, pnode->GetId(), NetworkErrorString(errno));
+        return;
+    }
+    pnode->nSocketEvents = nEvents;
+#endif
+}
+
 void CConnman::SocketHandler()
 {
     std::set<SOCKET> recv_set, send_set, error_set;
-    SocketEvents(recv_set, send_set, error_set);
+    std::vector<CNode*> vNodesCopy;
+    SocketEvents(recv_set, send_set, error_set, vNodesCopy);
 
     if (interruptNet) return;
 
@@ -1332,10 +1585,8 @@ void CConnman::SocketHandler()
     //
     // Service each socket
     //
-    std::vector<CNode*> vNodesCopy;
     {
         LOCK(cs_vNodes);
-        vNodesCopy = vNodes;
         for (CNode* pnode : vNodesCopy)
             pnode->AddRef();
     }
@@ -1376,19 +1627,8 @@ void CConnman::SocketHandler()
                     pnode->CloseSocketDisconnect();
                 RecordBytesRecv(nBytes);
                 if (notify) {
-                    size_t nSizeAdded = 0;
-                    auto it(pnode->vRecvMsg.begin());
-                    for (; it != pnode->vRecvMsg.end(); ++it) {
-                        if (!it->complete())
-                            break;
-                        nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                    }
-                    {
-                        LOCK(pnode->cs_vProcessMsg);
-                        pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                        pnode->nProcessQueueSize += nSizeAdded;
-                        pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                    }
+                    QueueProcessMessages(pnode);
+                    UpdateSocketEvents(pnode);
                     WakeMessageHandler();
                 }
             }
@@ -1424,14 +1664,23 @@ void CConnman::SocketHandler()
                 RecordBytesSent(nBytes);
             }
         }
-
-        InactivityCheck(pnode);
     }
     {
         LOCK(cs_vNodes);
         for (CNode* pnode : vNodesCopy)
             pnode->Release();
     }
+
+    // Timeouts are in the order of seconds, so there is no need to check all nodes on every iteration. This also
+    // covers nodes which did not show up in vNodesCopy because they had no socket events.
+    int64_t nTime = GetSystemTimeInSeconds();
+    if (nTime != nLastInactivityCheck) {
+        nLastInactivityCheck = nTime;
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes) {
+            InactivityCheck(pnode);
+        }
+    }
 }
 
 void CConnman::ThreadSocketHandler()
@@ -1648,10 +1897,9 @@ void CConnman::DumpAddresses()
 {
     int64_t nStart = GetTimeMillis();
 
-    CAddrDB adb;
-    adb.Write(addrman);
+    addrman.Flush();
 
-    LogPrint(BCLog::NET, "Flushed %d addresses to peers.dat  %dms\n",
+    LogPrint(BCLog::NET, "Flushed %d addresses to peers database  %dms\n",
            addrman.size(), GetTimeMillis() - nStart);
 }
 
@@ -1957,10 +2205,13 @@ void CConnman::ThreadOpenMasternodeConnections()
     if (gArgs.IsArgSet("-connect") && gArgs.GetArgs("-connect").size() > 0)
         return;
 
+    // quorum connections are opened back to back, so that a new quorum is fully connected as soon as possible
+    bool fMoreQuorumNodesPending = false;
     while (!interruptNet)
     {
-        if (!interruptNet.sleep_for(std::chrono::milliseconds(1000)))
+        if (!fMoreQuorumNodesPending && !interruptNet.sleep_for(std::chrono::milliseconds(1000)))
             return;
+        fMoreQuorumNodesPending = false;
 
         std::set<CService> connectedNodes;
         std::set<uint256> connectedProRegTxHashes;
@@ -1977,38 +2228,51 @@ void CConnman::ThreadOpenMasternodeConnections()
         if (interruptNet)
             return;
 
-        int64_t nANow = GetAdjustedTime();
+        int64_t nNow = GetTime();
 
         // NOTE: Process only one pending masternode at a time
 
         CService addr;
+        uint256 proRegTxHash; // only set for masternodes wanted by a quorum
         { // don't hold lock while calling OpenMasternodeConnection as cs_main is locked deep inside
             LOCK2(cs_vNodes, cs_vPendingMasternodes);
 
-            std::vector<CService> pending;
+            std::vector<std::pair<CService, uint256>> pending;
+            std::set<uint256> wanted;
             for (const auto& group : masternodeQuorumNodes) {
-                for (const auto& proRegTxHash : group.second) {
-                    auto dmn = mnList.GetMN(proRegTxHash);
+                for (const auto& proRegTxHash2 : group.second) {
+                    if (!wanted.emplace(proRegTxHash2).second) {
+                        continue;
+                    }
+                    auto dmn = mnList.GetMN(proRegTxHash2);
                     if (!dmn) {
                         continue;
                     }
                     const auto& addr2 = dmn->pdmnState->addr;
-                    if (!connectedNodes.count(addr2) && !IsMasternodeOrDisconnectRequested(addr2) && !connectedProRegTxHashes.count(proRegTxHash)) {
-                        auto addrInfo = addrman.GetAddressInfo(addr2);
-                        // back off trying connecting to an address if we already tried recently
-                        if (addrInfo.IsValid() && nANow - addrInfo.nLastTry < 60) {
+                    if (!connectedNodes.count(addr2) && !IsMasternodeOrDisconnectRequested(addr2) && !connectedProRegTxHashes.count(proRegTxHash2)) {
+                        // back off trying connecting to a masternode if we failed recently
+                        if (quorumConnectionHealth[proRegTxHash2].nNextAttempt > nNow) {
                             continue;
                         }
-                        pending.emplace_back(addr2);
+                        pending.emplace_back(addr2, proRegTxHash2);
                     }
                 }
             }
+            // forget about masternodes which are not wanted by any quorum anymore
+            for (auto it = quorumConnectionHealth.begin(); it != quorumConnectionHealth.end(); ) {
+                if (!wanted.count(it->first)) {
+                    it = quorumConnectionHealth.erase(it);
+                } else {
+                    ++it;
+                }
+            }
 
-            if (!vPendingMasternodes.empty()) {
+            // probes only get a chance when all quorum connections are established
+            if (pending.empty() && !vPendingMasternodes.empty()) {
                 auto addr2 = vPendingMasternodes.front();
                 vPendingMasternodes.erase(vPendingMasternodes.begin());
                 if (!connectedNodes.count(addr2) && !IsMasternodeOrDisconnectRequested(addr2)) {
-                    pending.emplace_back(addr2);
+                    pending.emplace_back(addr2, uint256());
                 }
             }
 
@@ -2018,10 +2282,18 @@ void CConnman::ThreadOpenMasternodeConnections()
             }
 
             std::random_shuffle(pending.begin(), pending.end());
-            addr = pending.front();
+            addr = pending.front().first;
+            proRegTxHash = pending.front().second;
+
+            if (!proRegTxHash.IsNull()) {
+                quorumConnectionHealth[proRegTxHash].nConnectStartTime = GetTimeMicros();
+                quorumConnectionStats.nAttempts++;
+                fMoreQuorumNodesPending = pending.size() > 1;
+            }
         }
 
         OpenMasternodeConnection(CAddress(addr, NODE_NETWORK));
+        bool fConnected = FindNode(addr) != nullptr;
         // should be in the list now if connection was opened
         ForNode(addr, [&](CNode* pnode) {
             if (pnode->fDisconnect) {
@@ -2030,6 +2302,23 @@ void CConnman::ThreadOpenMasternodeConnections()
             grant.MoveTo(pnode->grantMasternodeOutbound);
             return true;
         });
+
+        if (!proRegTxHash.IsNull()) {
+            LOCK(cs_vPendingMasternodes);
+            auto it = quorumConnectionHealth.find(proRegTxHash);
+            if (it != quorumConnectionHealth.end()) {
+                auto& health = it->second;
+                if (fConnected) {
+                    // the setup time is recorded in MasternodeAuthenticated, and if the link drops we retry soon
+                    health.nNextAttempt = GetTime() + QUORUM_CONNECT_RETRY_MIN;
+                } else {
+                    health.nConnectStartTime = 0;
+                    health.nNextAttempt = GetTime() + std::min(QUORUM_CONNECT_RETRY_MIN << std::min(health.nFailures, 8), QUORUM_CONNECT_RETRY_MAX);
+                    health.nFailures++;
+                    quorumConnectionStats.nFailures++;
+                }
+            }
+        }
     }
 }
 
@@ -2073,16 +2362,292 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
+    RegisterSocketEvents(pnode);
 }
 
 void CConnman::OpenMasternodeConnection(const CAddress &addrConnect) {
     OpenNetworkConnection(addrConnect, false, nullptr, nullptr, false, false, false, true);
 }
 
+std::string GetMessageLaneName(MessageLane lane)
+{
+    switch (lane) {
+    case MSGLANE_PRIORITY: return "priority";
+    case MSGLANE_DEFAULT:  return "default";
+    case MSGLANE_BULK:     return "bulk";
+    default:               return "unknown";
+    }
+}
+
+bool CConnman::IsPriorityPeer(CNode* pnode)
+{
+    // Only verified masternodes qualify, everything they sent before MNAUTH was processed stays in the default lane
+    if (!pnode->fSuccessfullyConnected || pnode->verifiedProRegTxHash.IsNull()) {
+        return false;
+    }
+
+    int64_t nNow = GetSystemTimeInSeconds();
+    if (pnode->nPriorityPeerCheckTime.exchange(nNow) != nNow) {
+        pnode->fPriorityPeer = IsMasternodeQuorumNode(pnode);
+    }
+    return pnode->fPriorityPeer;
+}
+
+MessageLane CConnman::GetMessageLane(CNode* pnode, const CNetMessage& msg, bool fPriorityPeer) const
+{
+    AssertLockHeld(pnode->cs_vProcessMsg);
+
+    if (!pnode->fSuccessfullyConnected) {
+        return MSGLANE_DEFAULT;
+    }
+
+    const std::string strCommand = msg.hdr.GetCommand();
+
+    // These are verified on their own and don't depend on anything the peer sent before, so they may overtake
+    // older messages of the same peer
+    if (strCommand == NetMsgType::ISLOCK || strCommand == NetMsgType::CLSIG || strCommand == NetMsgType::QSIGREC) {
+        return MSGLANE_PRIORITY;
+    }
+    if (strCommand == NetMsgType::MNGOVERNANCESYNC || strCommand == NetMsgType::MNGOVERNANCEOBJECT ||
+        strCommand == NetMsgType::MNGOVERNANCEOBJECTVOTE || strCommand == NetMsgType::SYNCSTATUSCOUNT) {
+        return MSGLANE_BULK;
+    }
+    // Everything else of a quorum peer (DKG and signing sessions) depends on the order of messages, so we only
+    // switch lanes once nothing is waiting in the default lane anymore
+    if (fPriorityPeer && pnode->vProcessMsg[MSGLANE_DEFAULT].empty()) {
+        return MSGLANE_PRIORITY;
+    }
+    return MSGLANE_DEFAULT;
+}
+
+void CConnman::QueueProcessMessages(CNode* pnode)
+{
+    bool fPriorityPeer = IsPriorityPeer(pnode);
+    // the receive version is only known after the handshake, nothing can be deserialized before that
+    bool fPreprocess = msgWorkerPool && pnode->fSuccessfullyConnected;
+
+    std::vector<CNetMessage*> vecPreprocess;
+    {
+        LOCK(pnode->cs_vProcessMsg);
+        auto it = pnode->vRecvMsg.begin();
+        while (it != pnode->vRecvMsg.end() && it->complete()) {
+            auto itNext = std::next(it);
+            MessageLane lane = GetMessageLane(pnode, *it, fPriorityPeer);
+            it->lane = lane;
+            it->fReadyForProcessing = !fPreprocess || !m_msgproc->WantsPreprocessing(*it);
+            if (!it->fReadyForProcessing) {
+                vecPreprocess.emplace_back(&*it);
+            } else if (lane == MSGLANE_PRIORITY) {
+                nPriorityMsgsReadySeq++;
+            }
+            pnode->nProcessQueueSize += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+            // list elements stay where they are when spliced, so the pointers in vecPreprocess remain valid
+            pnode->vProcessMsg[lane].splice(pnode->vProcessMsg[lane].end(), pnode->vRecvMsg, it);
+            nLaneQueued[lane]++;
+            it = itNext;
+        }
+        pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+    }
+
+    for (CNetMessage* pmsg : vecPreprocess) {
+        // released by PreprocessMessage, the node must not be deleted while a worker looks at one of its messages
+        pnode->AddRef();
+        msgWorkerPool->push([this, pnode, pmsg](int threadId) {
+            PreprocessMessage(pnode, pmsg);
+        });
+    }
+}
+
+void CConnman::PreprocessMessage(CNode* pnode, CNetMessage* pmsg)
+{
+    // The message can't be popped from the process queue before fReadyForProcessing is set, so it's safe to
+    // access it without holding cs_vProcessMsg until then
+    int64_t nCpuStart = GetThreadCpuTimeMicros();
+    try {
+        m_msgproc->PreprocessMessage(pnode, *pmsg);
+    } catch (const std::exception& e) {
+        LogPrint(BCLog::NET, "%s -- exception '%s' while preprocessing %s, peer=%d\n", __func__, e.what(), SanitizeString(pmsg->hdr.GetCommand()), pnode->GetId());
+        pmsg->preprocessed.reset();
+    }
+    pmsg->nPreprocessCpuTime = GetThreadCpuTimeMicros() - nCpuStart;
+
+    {
+        LOCK(pnode->cs_vProcessMsg);
+        pmsg->fReadyForProcessing = true;
+        if (pmsg->lane == MSGLANE_PRIORITY) {
+            nPriorityMsgsReadySeq++;
+        }
+    }
+    pnode->Release();
+    WakeMessageHandler();
+}
+
+bool CConnman::PopProcessMessage(CNode* pnode, bool fPriorityOnly, std::list<CNetMessage>& msgsRet, bool& fMoreWorkRet)
+{
+    bool fPauseRecvChanged;
+    MessageLane lane;
+    {
+        LOCK(pnode->cs_vProcessMsg);
+        auto& vProcessMsg = pnode->vProcessMsg;
+        // messages within a lane are processed in order, so a lane is blocked while its oldest message is still
+        // waiting for a message worker
+        auto isReady = [&](int i) {
+            return !vProcessMsg[i].empty() && vProcessMsg[i].front().fReadyForProcessing;
+        };
+        if (isReady(MSGLANE_PRIORITY)) {
+            lane = MSGLANE_PRIORITY;
+        } else if (fPriorityOnly) {
+            return false;
+        } else if (isReady(MSGLANE_BULK) && (!isReady(MSGLANE_DEFAULT) || pnode->nBulkLaneCredit >= MSGLANE_BULK_WEIGHT)) {
+            lane = MSGLANE_BULK;
+            pnode->nBulkLaneCredit = 0;
+        } else if (isReady(MSGLANE_DEFAULT)) {
+            lane = MSGLANE_DEFAULT;
+            pnode->nBulkLaneCredit++;
+        } else {
+            return false;
+        }
+
+        // Just take one message
+        msgsRet.splice(msgsRet.begin(), vProcessMsg[lane], vProcessMsg[lane].begin());
+        pnode->nProcessQueueSize -= msgsRet.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+        bool fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+        fPauseRecvChanged = pnode->fPauseRecv.exchange(fPauseRecv) != fPauseRecv;
+        // lanes which are blocked by a message worker don't count, the worker wakes us up once it's done
+        fMoreWorkRet = false;
+        for (int i = 0; i < MSGLANE_COUNT; i++) {
+            fMoreWorkRet |= isReady(i);
+        }
+    }
+    if (fPauseRecvChanged) {
+        UpdateSocketEvents(pnode);
+    }
+
+    // msg.nTime is set when the last byte of the message was received
+    int64_t nLatency = std::max(GetTimeMicros() - msgsRet.front().nTime, int64_t(0));
+    nLaneQueued[lane]--;
+    nLaneProcessed[lane]++;
+    nLaneTotalLatency[lane] += nLatency;
+    // only the message handler thread writes these, so there are no lost updates
+    nLaneRecentLatency[lane] = (nLaneRecentLatency[lane] * 15 + nLatency) / 16;
+    if (nLatency > nLaneMaxLatency[lane]) {
+        nLaneMaxLatency[lane] = nLatency;
+    }
+    return true;
+}
+
+std::vector<MessageLaneStats> CConnman::GetMessageLaneStats() const
+{
+    std::vector<MessageLaneStats> vecStats;
+    for (int i = 0; i < MSGLANE_COUNT; i++) {
+        MessageLaneStats stats;
+        stats.lane = (MessageLane)i;
+        stats.nQueued = nLaneQueued[i];
+        stats.nProcessed = nLaneProcessed[i];
+        stats.nAvgLatency = stats.nProcessed ? nLaneTotalLatency[i] / (int64_t)stats.nProcessed : 0;
+        stats.nRecentLatency = nLaneRecentLatency[i];
+        stats.nMaxLatency = nLaneMaxLatency[i];
+        vecStats.emplace_back(stats);
+    }
+    return vecStats;
+}
+
+// Returns the budget of a peer which was last charged at nBudgetTime, refilled up to nNow
+static int64_t GetRefilledCpuBudget(int64_t nBudget, int64_t nBudgetTime, int64_t nNow, int nPercent)
+{
+    int64_t nMaxBudget = PEER_CPU_BUDGET_WINDOW * 1000000 * nPercent / 100;
+    if (nBudgetTime == 0) {
+        return nMaxBudget;
+    }
+    return std::min(nBudget + std::max(nNow - nBudgetTime, int64_t(0)) * nPercent / 100, nMaxBudget);
+}
+
+// Outbound, whitelisted and verified quorum peers are never deprioritized, we depend on them
+static bool IsCpuBudgetLimited(const CNode* pnode)
+{
+    return pnode->fInbound && !pnode->fWhitelisted && !pnode->fPriorityPeer;
+}
+
+void CConnman::RecordMessageCost(CNode* pnode, const std::string& strCommand, uint64_t nBytes, int64_t nCpuTime, int64_t nWaitTime)
+{
+    int64_t nBudget;
+    bool fExceeded = false;
+    {
+        LOCK(pnode->cs_msgCost);
+        auto it = pnode->mapRecvCostPerMsgCmd.find(strCommand);
+        if (it == pnode->mapRecvCostPerMsgCmd.end()) {
+            it = pnode->mapRecvCostPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
+        }
+        assert(it != pnode->mapRecvCostPerMsgCmd.end());
+        MessageCost& cost = it->second;
+        cost.nCount++;
+        cost.nBytes += nBytes;
+        cost.nCpuTime += nCpuTime;
+        cost.nMaxCpuTime = std::max(cost.nMaxCpuTime, nCpuTime);
+        cost.nWaitTime += nWaitTime;
+
+        if (nPeerCpuBudget <= 0) {
+            return;
+        }
+        int64_t nNow = GetTimeMicros();
+        int64_t nPrevBudget = GetRefilledCpuBudget(pnode->nCpuBudget, pnode->nCpuBudgetTime, nNow, nPeerCpuBudget);
+        nBudget = nPrevBudget - nCpuTime;
+        pnode->nCpuBudget = nBudget;
+        pnode->nCpuBudgetTime = nNow;
+        if (nPrevBudget >= 0 && nBudget < 0) {
+            pnode->nCpuBudgetExceeded++;
+            fExceeded = true;
+        }
+    }
+
+    if (!IsCpuBudgetLimited(pnode)) {
+        return;
+    }
+    if (nBudget < -PEER_CPU_BUDGET_WINDOW * 1000000 * nPeerCpuBudget / 100) {
+        if (!pnode->fDisconnect) {
+            LogPrintf("CConnman::%s -- peer=%d exceeded its CPU budget by %d ms with %s, disconnecting\n", __func__,
+                      pnode->GetId(), -nBudget / 1000, SanitizeString(strCommand));
+            pnode->fDisconnect = true;
+        }
+    } else if (fExceeded) {
+        LogPrint(BCLog::NET, "CConnman::%s -- peer=%d exceeded its CPU budget with %s, deprioritizing\n", __func__,
+                 pnode->GetId(), SanitizeString(strCommand));
+    }
+}
+
+bool CConnman::HasCpuBudget(CNode* pnode) const
+{
+    if (nPeerCpuBudget <= 0 || !IsCpuBudgetLimited(pnode)) {
+        return true;
+    }
+    LOCK(pnode->cs_msgCost);
+    return GetRefilledCpuBudget(pnode->nCpuBudget, pnode->nCpuBudgetTime, GetTimeMicros(), nPeerCpuBudget) >= 0;
+}
+
+bool CConnman::ProcessPriorityMessages(const std::vector<CNode*>& vNodesCopy, uint64_t nRound)
+{
+    // Take at most one priority message per node and round. Further priority messages of a node are left to its
+    // regular processing, so a peer flooding its priority lane can't starve the regular traffic of the others.
+    for (CNode* pnode : vNodesCopy) {
+        if (pnode->fDisconnect || pnode->nPriorityRound == nRound || !HasCpuBudget(pnode))
+            continue;
+        uint64_t nProcessedBefore = nLaneProcessed[MSGLANE_PRIORITY];
+        m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc, true);
+        if (nLaneProcessed[MSGLANE_PRIORITY] != nProcessedBefore)
+            pnode->nPriorityRound = nRound;
+        if (flagInterruptMsgProc)
+            return false;
+    }
+    return true;
+}
+
 void CConnman::ThreadMessageHandler()
 {
+    uint64_t nRound = 0;
+    uint64_t nPrioritySweepSeq = 0;
     while (!flagInterruptMsgProc)
     {
+        nRound++;
         std::vector<CNode*> vNodesCopy;
         {
             LOCK(cs_vNodes);
@@ -2099,8 +2664,22 @@ void CConnman::ThreadMessageHandler()
             if (pnode->fDisconnect)
                 continue;
 
-            // Receive messages
-            bool fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
+            // Priority traffic of the other nodes which became ready since the last sweep is picked up before the next
+            // node processes its regular traffic. Priority messages left behind by a sweep, e.g. of a node without CPU
+            // budget, don't trigger another one, they are processed in the regular turn of their node.
+            uint64_t nSeq = nPriorityMsgsReadySeq;
+            if (nSeq != nPrioritySweepSeq) {
+                nPrioritySweepSeq = nSeq;
+                if (!ProcessPriorityMessages(vNodesCopy, nRound))
+                    return;
+            }
+
+            // Receive messages. Nodes which used up their CPU budget are skipped until it has recovered, the
+            // periodic wakeup below picks up their pending messages again.
+            bool fMoreNodeWork = false;
+            if (HasCpuBudget(pnode)) {
+                fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc, false);
+            }
             fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
             if (flagInterruptMsgProc)
                 return;
@@ -2270,6 +2849,14 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
 {
     SetTryNewOutboundPeer(false);
 
+    for (int i = 0; i < MSGLANE_COUNT; i++) {
+        nLaneQueued[i] = 0;
+        nLaneProcessed[i] = 0;
+        nLaneTotalLatency[i] = 0;
+        nLaneRecentLatency[i] = 0;
+        nLaneMaxLatency[i] = 0;
+    }
+
     Options connOptions;
     Init(connOptions);
 }
@@ -2335,6 +2922,30 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         return false;
     }
 
+#ifdef USE_EPOLL
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd == -1) {
+            LogPrintf("epoll_create1 failed: %s, falling back to -socketevents=%s\n", NetworkErrorString(errno), GetSocketEventsModeName(SOCKETEVENTS_POLL));
+            socketEventsMode = SOCKETEVENTS_POLL;
+        }
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            if (epollFd == -1) break;
+            epoll_event e;
+            e.events = EPOLLIN;
+            e.data.ptr = (void*)&hListenSocket;
+            if (epoll_ctl(epollFd, EPOLL_CTL_ADD, hListenSocket.socket, &e) != 0) {
+                if (clientInterface) {
+                    clientInterface->ThreadSafeMessageBox(
+                        strprintf(_("Failed to add listening socket to epoll set: %s").translated, NetworkErrorString(errno)),
+                        "", CClientUIInterface::MSG_ERROR);
+                }
+                return false;
+            }
+        }
+    }
+#endif
+
     for (const auto& strDest : connOptions.vSeedNodes) {
         AddOneShot(strDest);
     }
@@ -2342,17 +2953,29 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     if (clientInterface) {
         clientInterface->InitMessage(_("Loading P2P addresses...").translated);
     }
-    // Load addresses from peers.dat
+    // Load addresses from the peers database
     int64_t nStart = GetTimeMillis();
-    {
-        CAddrDB adb;
-        if (adb.Read(addrman))
-            LogPrintf("Loaded %i addresses from peers.dat  %dms\n", addrman.size(), GetTimeMillis() - nStart);
-        else {
-            addrman.Clear(); // Addrman can be in an inconsistent state after failure, reset it
-            LogPrintf("Invalid or missing peers.dat; recreating\n");
-            DumpAddresses();
+    if (addrman.InitDB(false)) {
+        LogPrintf("Loaded %i addresses from peers database  %dms\n", addrman.size(), GetTimeMillis() - nStart);
+    } else {
+        LogPrintf("Invalid peers database; recreating\n");
+        if (!addrman.InitDB(true)) {
+            LogPrintf("Failed to recreate peers database, addresses will not be persisted\n");
+        }
+    }
+    // import the peers.dat of previous versions once, the database is written incrementally from now on
+    fs::path pathAddr = GetDataDir() / "peers.dat";
+    if (fs::exists(pathAddr)) {
+        if (addrman.size() == 0) {
+            CAddrDB adb;
+            if (adb.Read(addrman)) {
+                LogPrintf("Imported %i addresses from peers.dat\n", addrman.size());
+                addrman.Flush();
+            } else {
+                addrman.Clear(); // Addrman can be in an inconsistent state after failure, reset it
+            }
         }
+        fs::remove(pathAddr);
     }
 
     uiInterface.InitMessage(_("Starting network threads...").translated);
@@ -2411,6 +3034,11 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     threadOpenMasternodeConnections = std::thread(&TraceThread<std::function<void()> >, "mncon", std::function<void()>(std::bind(&CConnman::ThreadOpenMasternodeConnections, this)));
 
     // Process messages
+    if (nMsgWorkers > 0) {
+        msgWorkerPool = MakeUnique<ctpl::thread_pool>(nMsgWorkers);
+        RenameThreadPool(*msgWorkerPool, "msgworker");
+    }
+
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
 
     // Dump network addresses
@@ -2479,6 +3107,11 @@ void CConnman::Stop()
         threadDNSAddressSeed.join();
     if (threadSocketHandler.joinable())
         threadSocketHandler.join();
+    // the workers hold references to nodes, so they have to finish before the nodes are deleted below
+    if (msgWorkerPool) {
+        msgWorkerPool->stop(true);
+        msgWorkerPool.reset();
+    }
 
     if (fAddressesInitialized)
     {
@@ -2493,6 +3126,12 @@ void CConnman::Stop()
         if (hListenSocket.socket != INVALID_SOCKET)
             if (!CloseSocket(hListenSocket.socket))
                 LogPrintf("CloseSocket(hListenSocket) failed with error %s\n", NetworkErrorString(WSAGetLastError()));
+#ifdef USE_EPOLL
+    if (epollFd != -1) {
+        close(epollFd);
+        epollFd = -1;
+    }
+#endif
 
     // clean up some globals (to help leak detection)
     for (CNode *pnode : vNodes) {
@@ -2512,6 +3151,12 @@ void CConnman::Stop()
 void CConnman::DeleteNode(CNode* pnode)
 {
     assert(pnode);
+    {
+        LOCK(pnode->cs_vProcessMsg);
+        for (int i = 0; i < MSGLANE_COUNT; i++) {
+            nLaneQueued[i] -= pnode->vProcessMsg[i].size();
+        }
+    }
     bool fUpdateConnectionTime = false;
     m_msgproc->FinalizeNode(pnode->GetId(), fUpdateConnectionTime);
     if(fUpdateConnectionTime) {
@@ -2598,6 +3243,12 @@ void CConnman::GetNodeStats(std::vector<CNodeStats>& vstats)
     for (CNode* pnode : vNodes) {
         vstats.emplace_back();
         pnode->copyStats(vstats.back());
+        if (nPeerCpuBudget > 0) {
+            LOCK(pnode->cs_msgCost);
+            vstats.back().nCpuBudget = GetRefilledCpuBudget(pnode->nCpuBudget, pnode->nCpuBudgetTime, GetTimeMicros(), nPeerCpuBudget);
+        } else {
+            vstats.back().nCpuBudget = 0;
+        }
     }
 }
 
@@ -2787,9 +3438,12 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     filterInventoryKnown.reset();
     pfilter = MakeUnique<CBloomFilter>();
 
-    for (const std::string &msg : getAllNetMessageTypes())
+    for (const std::string &msg : getAllNetMessageTypes()) {
         mapRecvBytesPerMsgCmd[msg] = 0;
+        mapRecvCostPerMsgCmd[msg] = MessageCost();
+    }
     mapRecvBytesPerMsgCmd[NET_MESSAGE_COMMAND_OTHER] = 0;
+    mapRecvCostPerMsgCmd[NET_MESSAGE_COMMAND_OTHER] = MessageCost();
 
     if (fLogIPs) {
         LogPrint(BCLog::NET, "Added connection to %s peer=%d\n", addrName, id);
@@ -2808,19 +3462,33 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
     return pnode && pnode->fSuccessfullyConnected && !pnode->fDisconnect;
 }
 
-void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+CPreparedNetMsgRef CConnman::PrepareMessage(CSerializedNetMsg&& msg)
 {
+    auto prepared = std::make_shared<CPreparedNetMsg>();
     size_t nMessageSize = msg.data.size();
-    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
-    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
 
-    std::vector<unsigned char> serializedHeader;
-    serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
+    prepared->header.reserve(CMessageHeader::HEADER_SIZE);
     uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
     CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
-    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, prepared->header, 0, hdr};
+
+    prepared->command = std::move(msg.command);
+    prepared->data = std::move(msg.data);
+    return prepared;
+}
+
+void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+{
+    PushMessage(pnode, PrepareMessage(std::move(msg)));
+}
+
+void CConnman::PushMessage(CNode* pnode, const CPreparedNetMsgRef& msg)
+{
+    size_t nMessageSize = msg->data.size();
+    size_t nTotalSize = msg->size();
+    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg->command.c_str()), nMessageSize, pnode->GetId());
 
     size_t nBytesSent = 0;
     {
@@ -2828,14 +3496,12 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         bool optimisticSend(pnode->vSendMsg.empty());
 
         //log total amount of bytes per command
-        pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
+        pnode->mapSendBytesPerMsgCmd[msg->command] += nTotalSize;
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->vSendMsg.push_back(msg);
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
@@ -2984,6 +3650,28 @@ void CConnman::RemoveMasternodeQuorumNodes(Consensus::LLMQType llmqType, const u
     masternodeQuorumNodes.erase(std::make_pair(llmqType, quorumHash));
 }
 
+bool CConnman::RetainMasternodeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash, const std::set<uint256>& proTxHashes)
+{
+    LOCK(cs_vPendingMasternodes);
+    auto it = masternodeQuorumNodes.find(std::make_pair(llmqType, quorumHash));
+    if (it == masternodeQuorumNodes.end()) {
+        return false;
+    }
+    bool changed = false;
+    for (auto jt = it->second.begin(); jt != it->second.end(); ) {
+        if (proTxHashes.count(*jt)) {
+            ++jt;
+        } else {
+            jt = it->second.erase(jt);
+            changed = true;
+        }
+    }
+    if (it->second.empty()) {
+        masternodeQuorumNodes.erase(it);
+    }
+    return changed;
+}
+
 bool CConnman::IsMasternodeQuorumNode(const CNode* pnode)
 {
     // Let's see if this is an outgoing connection to an address that is known to be a masternode
@@ -3014,6 +3702,48 @@ bool CConnman::IsMasternodeQuorumNode(const CNode* pnode)
     return false;
 }
 
+void CConnman::MasternodeAuthenticated(const CNode* pnode)
+{
+    LOCK(cs_vPendingMasternodes);
+    auto it = quorumConnectionHealth.find(pnode->verifiedProRegTxHash);
+    if (it == quorumConnectionHealth.end()) {
+        return;
+    }
+    auto& health = it->second;
+    health.nFailures = 0;
+    if (health.nConnectStartTime != 0 && !pnode->fInbound) {
+        int64_t nSetupTime = GetTimeMicros() - health.nConnectStartTime;
+        quorumConnectionStats.nAuthenticated++;
+        quorumConnectionStats.nLastSetupTime = nSetupTime;
+        quorumConnectionStats.nMaxSetupTime = std::max(quorumConnectionStats.nMaxSetupTime, nSetupTime);
+        nQuorumTotalSetupTime += nSetupTime;
+        LogPrint(BCLog::NET, "CConnman::%s -- quorum connection to %s established in %d ms, peer=%d\n", __func__,
+                 pnode->verifiedProRegTxHash.ToString(), nSetupTime / 1000, pnode->GetId());
+    }
+    health.nConnectStartTime = 0;
+}
+
+QuorumConnectionStats CConnman::GetQuorumConnectionStats() const
+{
+    LOCK2(cs_vNodes, cs_vPendingMasternodes);
+    QuorumConnectionStats stats = quorumConnectionStats;
+
+    std::set<uint256> wanted;
+    for (const auto& p : masternodeQuorumNodes) {
+        wanted.insert(p.second.begin(), p.second.end());
+    }
+    stats.nWanted = wanted.size();
+    for (const auto pnode : vNodes) {
+        if (!pnode->fDisconnect && !pnode->verifiedProRegTxHash.IsNull() && wanted.count(pnode->verifiedProRegTxHash)) {
+            stats.nConnected++;
+        }
+    }
+    if (stats.nAuthenticated != 0) {
+        stats.nAvgSetupTime = nQuorumTotalSetupTime / (int64_t)stats.nAuthenticated;
+    }
+    return stats;
+}
+
 void CConnman::RelayInv(CInv &inv, const int minProtoVersion)
 {
     g_connman->ForEachNode([&inv, minProtoVersion](CNode* node) {
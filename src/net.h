@@ -89,6 +89,78 @@ static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
+/** How CConnman::ThreadSocketHandler waits for socket events (-socketevents) */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT = 0,
+    SOCKETEVENTS_POLL = 1,
+    SOCKETEVENTS_EPOLL = 2,
+};
+#if defined(USE_EPOLL)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_EPOLL;
+#elif defined(USE_POLL)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_POLL;
+#else
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_SELECT;
+#endif
+
+/** Default number of threads which deserialize and pre-verify messages before they are processed (-msgworkers) */
+static const int DEFAULT_MSG_WORKERS = 2;
+static const int MAX_MSG_WORKERS = 16;
+
+/** Default share of one CPU core in percent which a single inbound peer may use for its messages (-peercpubudget),
+    off by default as block and header processing during sync is charged as well */
+static const int DEFAULT_PEER_CPU_BUDGET = 0;
+/** The CPU budget of a peer accumulates for at most this many seconds, which is the largest burst it may cause */
+static const int64_t PEER_CPU_BUDGET_WINDOW = 30;
+
+/** Lanes of the per-node message processing queue, lower lanes are drained first */
+enum MessageLane {
+    MSGLANE_PRIORITY = 0, // verified quorum peers and self-contained lock messages (ISLOCK, CLSIG, QSIGREC)
+    MSGLANE_DEFAULT = 1,
+    MSGLANE_BULK = 2,     // governance objects, votes and sync
+    MSGLANE_COUNT = 3,
+};
+/** Number of default lane messages which are processed for each bulk lane message when both are waiting */
+static const int MSGLANE_BULK_WEIGHT = 4;
+
+std::string GetMessageLaneName(MessageLane lane);
+
+struct MessageLaneStats
+{
+    MessageLane lane;
+    int64_t nQueued;
+    uint64_t nProcessed;
+    // time messages spent in the queue, in microseconds
+    int64_t nAvgLatency;
+    int64_t nRecentLatency;
+    int64_t nMaxLatency;
+};
+
+/** Retry delays for masternodes wanted by a quorum which we failed to connect to, doubled on every failure */
+static const int64_t QUORUM_CONNECT_RETRY_MIN = 5;
+static const int64_t QUORUM_CONNECT_RETRY_MAX = 10 * 60;
+
+/** Statistics of the connections to masternodes which are wanted by a quorum, see CConnman::GetQuorumConnectionStats */
+struct QuorumConnectionStats
+{
+    // distinct masternodes wanted by any quorum and how many of them we have an authenticated connection to
+    size_t nWanted{0};
+    size_t nConnected{0};
+    uint64_t nAttempts{0};
+    uint64_t nFailures{0};
+    uint64_t nAuthenticated{0};
+    // time from opening an outbound connection until the masternode authenticated itself, in microseconds
+    int64_t nAvgSetupTime{0};
+    int64_t nLastSetupTime{0};
+    int64_t nMaxSetupTime{0};
+};
+
+/** Parse a -socketevents value, fails for modes which are not available on this platform */
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& modeRet);
+std::string GetSocketEventsModeName(SocketEventsMode mode);
+/** Comma separated list of the modes which are available on this platform */
+std::string GetSupportedSocketEventsModes();
+
 typedef int64_t NodeId;
 
 struct AddedNodeInfo
@@ -99,6 +171,7 @@ struct AddedNodeInfo
     bool fInbound;
 };
 
+class CNetMessage;
 class CNodeStats;
 class CClientUIInterface;
 
@@ -115,6 +188,25 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/**
+ * A message as it goes over the wire, i.e. the serialized header followed by the payload. It never changes once
+ * prepared, so the same instance can be queued for any number of peers instead of serializing and copying the
+ * message once per peer. See CConnman::PrepareMessage.
+ */
+struct CPreparedNetMsg
+{
+    std::string command;
+    std::vector<unsigned char> header;
+    std::vector<unsigned char> data;
+
+    size_t size() const { return header.size() + data.size(); }
+};
+typedef std::shared_ptr<const CPreparedNetMsg> CPreparedNetMsgRef;
+
+
+namespace ctpl {
+    class thread_pool;
+}
 
 class NetEventsInterface;
 class CConnman
@@ -150,6 +242,9 @@ public:
         bool m_use_addrman_outgoing = true;
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
+        SocketEventsMode socketEventsMode = DEFAULT_SOCKETEVENTS;
+        int nMsgWorkers = 0;
+        int nPeerCpuBudget = DEFAULT_PEER_CPU_BUDGET;
     };
 
     void Init(const Options& connOptions) {
@@ -166,6 +261,9 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        socketEventsMode = connOptions.socketEventsMode;
+        nMsgWorkers = connOptions.nMsgWorkers;
+        nPeerCpuBudget = connOptions.nPeerCpuBudget;
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -205,7 +303,10 @@ public:
     bool ForNode(const CService& addr, std::function<bool(CNode* pnode)> func);
     bool IsMasternodeOrDisconnectRequested(const CService& addr);
 
+    /** Serializes the message header, the result can be pushed to all peers for which msg was serialized */
+    static CPreparedNetMsgRef PrepareMessage(CSerializedNetMsg&& msg);
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    void PushMessage(CNode* pnode, const CPreparedNetMsgRef& msg);
 
     template<typename Callable>
     void ForEachNode(Callable&& func)
@@ -327,6 +428,23 @@ public:
 
     void WakeMessageHandler();
 
+    /** Takes the next message of pnode which should be processed and moves it into msgsRet. With fPriorityOnly,
+        only the priority lane is looked at. fMoreWorkRet is set when more messages of the node are waiting. */
+    bool PopProcessMessage(CNode* pnode, bool fPriorityOnly, std::list<CNetMessage>& msgsRet, bool& fMoreWorkRet);
+    std::vector<MessageLaneStats> GetMessageLaneStats() const;
+
+    /** Accounts the processing of one message of pnode and charges its CPU time to the CPU budget of the node.
+        Nodes which exceed their budget are deprioritized until it has recovered, nodes which exceed it by more
+        than PEER_CPU_BUDGET_WINDOW seconds worth of budget are disconnected. */
+    void RecordMessageCost(CNode* pnode, const std::string& strCommand, uint64_t nBytes, int64_t nCpuTime, int64_t nWaitTime);
+    /** Returns false while pnode is deprioritized because it used up its CPU budget */
+    bool HasCpuBudget(CNode* pnode) const;
+
+    /** Re-evaluates which socket events are of interest for the node. Must be called after fPauseRecv changed,
+        changes of the send queue are picked up by SocketSendData. Only has an effect with -socketevents=epoll,
+        the other modes rebuild their interest sets on every iteration. */
+    void UpdateSocketEvents(CNode* pnode) const;
+
     /** Attempts to obfuscate tx time through exponentially distributed emitting.
         Works assuming that a single interval is used.
         Variable intervals will result in privacy decrease.
@@ -339,7 +457,13 @@ public:
     // also returns QWATCH nodes
     std::set<NodeId> GetMasternodeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash) const;
     void RemoveMasternodeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash);
+    // Removes the masternodes which are not in proTxHashes from the connections of a quorum, and the quorum if none
+    // are left. Returns false if nothing changed
+    bool RetainMasternodeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash, const std::set<uint256>& proTxHashes);
     bool IsMasternodeQuorumNode(const CNode* pnode);
+    /** Called once a node authenticated itself as a masternode, used for the quorum connection health and metrics */
+    void MasternodeAuthenticated(const CNode* pnode);
+    QuorumConnectionStats GetQuorumConnectionStats() const;
 
     //! Relay message only to minProtoVersion peers.
     void RelayInv(CInv &inv, const int minProtoVersion = MIN_PEER_PROTO_VERSION);
@@ -368,11 +492,25 @@ private:
     void ThreadOpenConnections(std::vector<std::string> connect);
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
+    bool IsPriorityPeer(CNode* pnode);
+    MessageLane GetMessageLane(CNode* pnode, const CNetMessage& msg, bool fPriorityPeer) const EXCLUSIVE_LOCKS_REQUIRED(pnode->cs_vProcessMsg);
+    void QueueProcessMessages(CNode* pnode);
+    void PreprocessMessage(CNode* pnode, CNetMessage* pmsg);
+    bool ProcessPriorityMessages(const std::vector<CNode*>& vNodesCopy, uint64_t nRound);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
     void InactivityCheck(CNode *pnode);
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
-    void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+    void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, std::vector<CNode*>& vNodesRet);
+    void SocketEventsSelect(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#ifdef USE_POLL
+    void SocketEventsPoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#endif
+#ifdef USE_EPOLL
+    void SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, std::vector<CNode*>& vNodesRet);
+#endif
+    void RegisterSocketEvents(CNode* pnode);
+    void UnregisterSocketEvents(CNode* pnode);
     void SocketHandler();
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -425,6 +563,11 @@ private:
     unsigned int nSendBufferMaxSize{0};
     unsigned int nReceiveFloodSize{0};
 
+    SocketEventsMode socketEventsMode{DEFAULT_SOCKETEVENTS};
+    // persistent epoll interest set, only valid with -socketevents=epoll
+    int epollFd{-1};
+    int64_t nLastInactivityCheck{0};
+
     std::vector<ListenSocket> vhListenSocket;
     std::atomic<bool> fNetworkActive{true};
     bool fAddressesInitialized{false};
@@ -440,6 +583,15 @@ private:
     unsigned int nPrevNodeCount{0};
     std::vector<CService> vPendingMasternodes;
     std::map<std::pair<Consensus::LLMQType, uint256>, std::set<uint256>> masternodeQuorumNodes GUARDED_BY(cs_vPendingMasternodes);
+    // health of the links to the masternodes in masternodeQuorumNodes, keyed by proTxHash
+    struct QuorumConnectionHealth {
+        int64_t nConnectStartTime{0}; // GetTimeMicros() of the pending outbound attempt, 0 if none is pending
+        int64_t nNextAttempt{0};      // don't retry before this time (seconds)
+        int nFailures{0};             // consecutive failed attempts
+    };
+    std::map<uint256, QuorumConnectionHealth> quorumConnectionHealth GUARDED_BY(cs_vPendingMasternodes);
+    QuorumConnectionStats quorumConnectionStats GUARDED_BY(cs_vPendingMasternodes);
+    int64_t nQuorumTotalSetupTime GUARDED_BY(cs_vPendingMasternodes){0};
     mutable CCriticalSection cs_vPendingMasternodes;
 
     /** Services this instance offers */
@@ -468,6 +620,23 @@ private:
     Mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc{false};
 
+    // deserializes and pre-verifies messages before they are handed to ThreadMessageHandler, see QueueProcessMessages
+    int nMsgWorkers{0};
+    std::unique_ptr<ctpl::thread_pool> msgWorkerPool;
+
+    // percentage of a CPU core an inbound peer may use for its messages, 0 = unlimited, see RecordMessageCost
+    int nPeerCpuBudget{DEFAULT_PEER_CPU_BUDGET};
+    // incremented whenever a priority lane message becomes ready for processing, i.e. is not waiting for
+    // msgWorkerPool anymore. ThreadMessageHandler sweeps the priority lanes of all nodes when it changed
+    std::atomic<uint64_t> nPriorityMsgsReadySeq{0};
+
+    // per lane message processing statistics, see GetMessageLaneStats
+    std::atomic<int64_t> nLaneQueued[MSGLANE_COUNT];
+    std::atomic<uint64_t> nLaneProcessed[MSGLANE_COUNT];
+    std::atomic<int64_t> nLaneTotalLatency[MSGLANE_COUNT];
+    std::atomic<int64_t> nLaneRecentLatency[MSGLANE_COUNT];
+    std::atomic<int64_t> nLaneMaxLatency[MSGLANE_COUNT];
+
     CThreadInterrupt interruptNet;
 
     std::thread threadDNSAddressSeed;
@@ -510,13 +679,25 @@ struct CombinerAll
     }
 };
 
+/** Result of NetEventsInterface::PreprocessMessage, the concrete type depends on the message */
+class CPreprocessedMessage
+{
+public:
+    virtual ~CPreprocessedMessage() = default;
+};
+
 /**
  * Interface for message handling
  */
 class NetEventsInterface
 {
 public:
-    virtual bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) = 0;
+    virtual bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt, bool fPriorityOnly) = 0;
+    /** Whether a message should go through PreprocessMessage before it is processed */
+    virtual bool WantsPreprocessing(const CNetMessage& msg) = 0;
+    /** Called on a message worker thread. May only do stateless work, e.g. deserialization and checks which don't
+        need cs_main, and may store the result in msg.preprocessed for ProcessMessages. */
+    virtual void PreprocessMessage(CNode* pnode, CNetMessage& msg) = 0;
     virtual bool SendMessages(CNode* pnode) = 0;
     virtual void InitializeNode(CNode* pnode) = 0;
     virtual void FinalizeNode(NodeId id, bool& update_connection_time) = 0;
@@ -580,6 +761,18 @@ extern std::map<CNetAddr, LocalServiceInfo> mapLocalHost GUARDED_BY(cs_mapLocalH
 extern const std::string NET_MESSAGE_COMMAND_OTHER;
 typedef std::map<std::string, uint64_t> mapMsgCmdSize; //command, total bytes
 
+/** Processing cost of the received messages of one command, see CConnman::RecordMessageCost */
+struct MessageCost
+{
+    uint64_t nCount{0};
+    uint64_t nBytes{0};
+    // all times are in microseconds, CPU time includes preprocessing by the message workers
+    int64_t nCpuTime{0};
+    int64_t nMaxCpuTime{0};
+    int64_t nWaitTime{0};
+};
+typedef std::map<std::string, MessageCost> mapMsgCmdCost;
+
 class CNodeStats
 {
 public:
@@ -600,6 +793,10 @@ public:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    mapMsgCmdCost mapRecvCostPerMsgCmd;
+    // remaining CPU budget in microseconds, negative while the peer is deprioritized
+    int64_t nCpuBudget;
+    uint64_t nCpuBudgetExceeded;
     bool fWhitelisted;
     double dPingTime;
     double dPingWait;
@@ -632,6 +829,12 @@ public:
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
+    // false while the message is waiting for a message worker, see CConnman::QueueProcessMessages
+    bool fReadyForProcessing{true}; // protected by the owning node's cs_vProcessMsg once queued
+    MessageLane lane{MSGLANE_DEFAULT};
+    std::shared_ptr<const CPreprocessedMessage> preprocessed;
+    int64_t nPreprocessCpuTime{0};  // CPU time (in microseconds) a message worker spent on preprocessed
+
     CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         hdrbuf.resize(24);
         in_data = false;
@@ -671,14 +874,25 @@ public:
     size_t nSendSize{0}; // total size of all vSendMsg entries
     size_t nSendOffset{0}; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    std::deque<CPreparedNetMsgRef> vSendMsg GUARDED_BY(cs_vSend);
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
+    // whether hSocket is part of the epoll interest set and for which events
+    bool fSocketEventsRegistered GUARDED_BY(cs_hSocket){false};
+    uint32_t nSocketEvents GUARDED_BY(cs_hSocket){0};
 
     CCriticalSection cs_vProcessMsg;
-    std::list<CNetMessage> vProcessMsg GUARDED_BY(cs_vProcessMsg);
+    std::list<CNetMessage> vProcessMsg[MSGLANE_COUNT] GUARDED_BY(cs_vProcessMsg);
     size_t nProcessQueueSize{0};
+    // default lane messages taken since the last bulk lane message, see CConnman::PopProcessMessage
+    int nBulkLaneCredit GUARDED_BY(cs_vProcessMsg){0};
+    // cached result of CConnman::IsPriorityPeer, refreshed once per second
+    std::atomic<bool> fPriorityPeer{false};
+    std::atomic<int64_t> nPriorityPeerCheckTime{0};
+    // message handler round in which a priority message of this node was last processed out of turn, only
+    // accessed by ThreadMessageHandler, see CConnman::ProcessPriorityMessages
+    uint64_t nPriorityRound{0};
 
     CCriticalSection cs_sendProcessing;
 
@@ -737,6 +951,13 @@ protected:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     mapMsgCmdSize mapRecvBytesPerMsgCmd GUARDED_BY(cs_vRecv);
 
+    // processing cost of received messages and the CPU budget derived from it, see CConnman::RecordMessageCost
+    mutable CCriticalSection cs_msgCost;
+    mapMsgCmdCost mapRecvCostPerMsgCmd GUARDED_BY(cs_msgCost);
+    int64_t nCpuBudget GUARDED_BY(cs_msgCost){0};
+    int64_t nCpuBudgetTime GUARDED_BY(cs_msgCost){0};
+    uint64_t nCpuBudgetExceeded GUARDED_BY(cs_msgCost){0};
+
 public:
     uint256 hashContinue;
     std::atomic<int> nStartingHeight{-1};
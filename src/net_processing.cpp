@@ -104,6 +104,10 @@ static const unsigned int MAX_GETDATA_SZ = 1000;
 static constexpr int32_t MAX_PEER_INV_ANNOUNCEMENTS = 2 * MAX_INV_SZ;
 /** How long to wait (in microseconds) before downloading an inventory from an additional peer */
 static constexpr int64_t GETDATA_INV_INTERVAL = 60 * 1000000; // 1 minute
+/** How long (in microseconds) serialized ISLOCK, CLSIG and QSIGREC messages stay in the LLMQ relay cache */
+static constexpr int64_t LLMQ_RELAY_EXPIRY = 60 * 1000000; // 1 minute
+/** Maximum total size of the messages in the LLMQ relay cache */
+static constexpr size_t MAX_LLMQ_RELAY_BYTES = 1024 * 1024;
 
 struct COrphanTx {
     // When modifying, adapt the copy of this definition in tests/DoS_tests.
@@ -204,6 +208,21 @@ namespace {
     /** Expiration-time ordered list of (expire time, relay map entry) pairs. */
     std::deque<std::pair<int64_t, MapRelay::iterator>> vRelayExpiration GUARDED_BY(cs_main);
 
+    /** Relay cache of serialized ISLOCK, CLSIG and QSIGREC messages, keyed by inv type and hash. New LLMQ objects
+     *  are usually requested by most peers at about the same time, this answers all but the first request without
+     *  looking the object up and serializing it again. */
+    struct LLMQRelayEntry {
+        CPreparedNetMsgRef msg;
+        //! The quorum of a recovered sig, these are only relayed while the quorum is active
+        Consensus::LLMQType llmqType{Consensus::LLMQ_NONE};
+        uint256 quorumHash;
+    };
+    typedef std::map<std::pair<int, uint256>, LLMQRelayEntry> MapLLMQRelay;
+    MapLLMQRelay mapLLMQRelay GUARDED_BY(cs_main);
+    /** Insertion ordered list of (expire time, relay cache entry) pairs, also used to evict when the cache is full */
+    std::deque<std::pair<int64_t, MapLLMQRelay::iterator>> vLLMQRelayExpiration GUARDED_BY(cs_main);
+    size_t nLLMQRelayBytes GUARDED_BY(cs_main) = 0;
+
     struct IteratorComparator
     {
         template<typename I>
@@ -1028,6 +1047,33 @@ static void AddToCompactExtraTransactions(const CTransactionRef& tx) EXCLUSIVE_L
     vExtraTxnForCompactIt = (vExtraTxnForCompactIt + 1) % max_extra_txn;
 }
 
+// Collects the TXs which are not necessarily in our mempool but might still be part of a compact block at nHeight:
+// recently rejected/orphaned TXs, TXs tracked by InstantSend and the quorum commitments we'd mine ourself
+static std::vector<std::pair<uint256, CTransactionRef>> GetCompactBlockExtraTransactions(int nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs_main, g_cs_orphans)
+{
+    std::vector<std::pair<uint256, CTransactionRef>> ret;
+    ret.reserve(vExtraTxnForCompact.size());
+    for (const auto& p : vExtraTxnForCompact) {
+        if (p.second) {
+            ret.emplace_back(p);
+        }
+    }
+
+    if (llmq::quorumInstantSendManager) {
+        llmq::quorumInstantSendManager->GetTransactionsForCompactBlocks(ret);
+    }
+
+    if (llmq::quorumBlockProcessor) {
+        for (const auto& p : Params().GetConsensus().llmqs) {
+            CTransactionRef qcTx;
+            if (llmq::quorumBlockProcessor->GetMinableCommitmentTx(p.first, nHeight, qcTx)) {
+                ret.emplace_back(qcTx->GetWitnessHash(), qcTx);
+            }
+        }
+    }
+    return ret;
+}
+
 bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
 {
     const uint256& hash = tx->GetHash();
@@ -1345,6 +1391,11 @@ static std::shared_ptr<const CBlock> most_recent_block GUARDED_BY(cs_most_recent
 static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block GUARDED_BY(cs_most_recent_block);
 static uint256 most_recent_block_hash GUARDED_BY(cs_most_recent_block);
 static bool fWitnessesPresentInMostRecentCompactBlock GUARDED_BY(cs_most_recent_block);
+// Serialized CMPCTBLOCK message of most_recent_compact_block, shared by all peers we announce it to
+static CPreparedNetMsgRef most_recent_compact_block_msg GUARDED_BY(cs_most_recent_block);
+// Serialized BLOCK messages of most_recent_block without and with witness data, created on the first getdata for it.
+// Block serialization only depends on the witness flag, so these are shared by all peers requesting the block
+static CPreparedNetMsgRef most_recent_block_msg[2] GUARDED_BY(cs_most_recent_block);
 
 /**
  * Maintain state about the best-seen block and fast-announce a compact block
@@ -1364,18 +1415,23 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
     bool fWitnessEnabled = IsWitnessEnabled(pindex->pprev, Params().GetConsensus());
     uint256 hashBlock(pblock->GetHash());
 
+    // serialized once for all peers
+    CPreparedNetMsgRef cmpctblockMsg = CConnman::PrepareMessage(msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+
     {
         LOCK(cs_most_recent_block);
         most_recent_block_hash = hashBlock;
         most_recent_block = pblock;
         most_recent_compact_block = pcmpctblock;
+        most_recent_compact_block_msg = cmpctblockMsg;
+        most_recent_block_msg[0].reset();
+        most_recent_block_msg[1].reset();
         fWitnessesPresentInMostRecentCompactBlock = fWitnessEnabled;
     }
 
-    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) {
+    connman->ForEachNode([this, &cmpctblockMsg, pindex, fWitnessEnabled, &hashBlock](CNode* pnode) {
         AssertLockHeld(cs_main);
 
-        // TODO: Avoid the repeated-serialization here
         if (pnode->nVersion < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -1387,7 +1443,7 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
 
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            connman->PushMessage(pnode, cmpctblockMsg);
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -1671,10 +1727,26 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
             pblock = pblockRead;
         }
         if (pblock) {
-            if (inv.type == MSG_BLOCK)
-                connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
-            else if (inv.type == MSG_WITNESS_BLOCK)
-                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+            if (inv.type == MSG_BLOCK || inv.type == MSG_WITNESS_BLOCK) {
+                const int nSendFlags = inv.type == MSG_BLOCK ? SERIALIZE_TRANSACTION_NO_WITNESS : 0;
+                CPreparedNetMsgRef blockMsg;
+                if (pblock == a_recent_block) {
+                    LOCK(cs_most_recent_block);
+                    if (most_recent_block == pblock) {
+                        blockMsg = most_recent_block_msg[inv.type == MSG_WITNESS_BLOCK];
+                    }
+                }
+                if (!blockMsg) {
+                    blockMsg = CConnman::PrepareMessage(msgMaker.Make(nSendFlags, NetMsgType::BLOCK, *pblock));
+                    if (pblock == a_recent_block) {
+                        LOCK(cs_most_recent_block);
+                        if (most_recent_block == pblock) {
+                            most_recent_block_msg[inv.type == MSG_WITNESS_BLOCK] = blockMsg;
+                        }
+                    }
+                }
+                connman->PushMessage(pfrom, blockMsg);
+            }
             else if (inv.type == MSG_FILTERED_BLOCK)
             {
                 bool sendMerkleBlock = false;
@@ -1736,6 +1808,80 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
     }
 }
 
+static void EraseOldestLLMQRelayMessage() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    nLLMQRelayBytes -= vLLMQRelayExpiration.front().second->second.msg->size();
+    mapLLMQRelay.erase(vLLMQRelayExpiration.front().second);
+    vLLMQRelayExpiration.pop_front();
+}
+
+static CPreparedNetMsgRef GetLLMQRelayMessage(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    int64_t nNow = GetTimeMicros();
+    while (!vLLMQRelayExpiration.empty() && vLLMQRelayExpiration.front().first < nNow) {
+        EraseOldestLLMQRelayMessage();
+    }
+
+    auto it = mapLLMQRelay.find(std::make_pair(inv.type, inv.hash));
+    if (it == mapLLMQRelay.end()) {
+        return nullptr;
+    }
+
+    // The managers stop handing out objects they no longer want to propagate: chainlocks which are not the best one
+    // anymore, removed islocks and recovered sigs of inactive quorums. Ask them again instead of serving the entry.
+    const LLMQRelayEntry& entry = it->second;
+    bool fCurrent = false;
+    if (inv.type == MSG_QUORUM_RECOVERED_SIG) {
+        fCurrent = llmq::quorumSigningManager->HasRecoveredSigForGetData(inv.hash, entry.llmqType, entry.quorumHash);
+    } else if (inv.type == MSG_CLSIG) {
+        fCurrent = llmq::chainLocksHandler->IsBestChainLock(inv.hash);
+    } else if (inv.type == MSG_ISLOCK) {
+        fCurrent = llmq::quorumInstantSendManager->HasInstantSendLock(inv.hash);
+    }
+    return fCurrent ? entry.msg : nullptr;
+}
+
+/**
+ * Looks up an ISLOCK, CLSIG or QSIGREC for a getdata and adds the serialized message to the LLMQ relay cache. None of
+ * these depend on the send version of the peer, so the message can be shared by all of them.
+ */
+static CPreparedNetMsgRef PrepareLLMQRelayMessage(const CInv& inv, const CNetMsgMaker& msgMaker) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    LLMQRelayEntry entry;
+    if (inv.type == MSG_QUORUM_RECOVERED_SIG) {
+        llmq::CRecoveredSig o;
+        if (llmq::quorumSigningManager->GetRecoveredSigForGetData(inv.hash, o)) {
+            entry.msg = CConnman::PrepareMessage(msgMaker.Make(NetMsgType::QSIGREC, o));
+            entry.llmqType = (Consensus::LLMQType)o.llmqType;
+            entry.quorumHash = o.quorumHash;
+        }
+    } else if (inv.type == MSG_CLSIG) {
+        llmq::CChainLockSig o;
+        if (llmq::chainLocksHandler->GetChainLockByHash(inv.hash, o)) {
+            entry.msg = CConnman::PrepareMessage(msgMaker.Make(NetMsgType::CLSIG, o));
+        }
+    } else if (inv.type == MSG_ISLOCK) {
+        llmq::CInstantSendLock o;
+        if (llmq::quorumInstantSendManager->GetInstantSendLockByHash(inv.hash, o)) {
+            entry.msg = CConnman::PrepareMessage(msgMaker.Make(NetMsgType::ISLOCK, o));
+        }
+    }
+    if (!entry.msg) {
+        return nullptr;
+    }
+    CPreparedNetMsgRef msg = entry.msg;
+
+    auto ret = mapLLMQRelay.emplace(std::make_pair(inv.type, inv.hash), std::move(entry));
+    if (ret.second) {
+        nLLMQRelayBytes += msg->size();
+        vLLMQRelayExpiration.emplace_back(GetTimeMicros() + LLMQ_RELAY_EXPIRY, ret.first);
+        while (nLLMQRelayBytes > MAX_LLMQ_RELAY_BYTES) {
+            EraseOldestLLMQRelayMessage();
+        }
+    }
+    return msg;
+}
+
 void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc) LOCKS_EXCLUDED(cs_main)
 {
     AssertLockNotHeld(cs_main);
@@ -1869,26 +2015,13 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
                 }
             }
 
-            if (!push && (inv.type == MSG_QUORUM_RECOVERED_SIG)) {
-                llmq::CRecoveredSig o;
-                if (llmq::quorumSigningManager->GetRecoveredSigForGetData(inv.hash, o)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::QSIGREC, o));
-                    push = true;
+            if (!push && (inv.type == MSG_QUORUM_RECOVERED_SIG || inv.type == MSG_CLSIG || inv.type == MSG_ISLOCK)) {
+                CPreparedNetMsgRef msg = GetLLMQRelayMessage(inv);
+                if (!msg) {
+                    msg = PrepareLLMQRelayMessage(inv, msgMaker);
                 }
-            }
-
-            if (!push && (inv.type == MSG_CLSIG)) {
-                llmq::CChainLockSig o;
-                if (llmq::chainLocksHandler->GetChainLockByHash(inv.hash, o)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CLSIG, o));
-                    push = true;
-                }
-            }
-
-            if (!push && (inv.type == MSG_ISLOCK)) {
-                llmq::CInstantSendLock o;
-                if (llmq::quorumInstantSendManager->GetInstantSendLockByHash(inv.hash, o)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::ISLOCK, o));
+                if (msg) {
+                    connman->PushMessage(pfrom, msg);
                     push = true;
                 }
             }
@@ -1967,6 +2100,9 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
         return true;
     }
 
+    // Hashing a full batch of headers is done before taking cs_main (and in parallel for big batches)
+    const std::vector<uint256> hashes = GetBlockHeaderHashes(headers);
+
     bool received_new_header = false;
     const CBlockIndex *pindexLast = nullptr;
     {
@@ -1985,14 +2121,14 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
             nodestate->nUnconnectingHeaders++;
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, ::ChainActive().GetLocator(pindexBestHeader), uint256()));
             LogPrint(BCLog::NET, "received header %s: missing prev block %s, sending getheaders (%d) to end (peer=%d, nUnconnectingHeaders=%d)\n",
-                    headers[0].GetHash().ToString(),
+                    hashes[0].ToString(),
                     headers[0].hashPrevBlock.ToString(),
                     pindexBestHeader->nHeight,
                     pfrom->GetId(), nodestate->nUnconnectingHeaders);
             // Set hashLastUnknownBlock for this peer, so that if we
             // eventually get the headers - even from a different peer -
             // we can use this peer to download.
-            UpdateBlockAvailability(pfrom->GetId(), headers.back().GetHash());
+            UpdateBlockAvailability(pfrom->GetId(), hashes.back());
 
             if (nodestate->nUnconnectingHeaders % MAX_UNCONNECTING_HEADERS == 0) {
                 Misbehaving(pfrom->GetId(), 20);
@@ -2001,12 +2137,12 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
         }
 
         uint256 hashLastBlock;
-        for (const CBlockHeader& header : headers) {
-            if (!hashLastBlock.IsNull() && header.hashPrevBlock != hashLastBlock) {
+        for (size_t i = 0; i < nCount; i++) {
+            if (!hashLastBlock.IsNull() && headers[i].hashPrevBlock != hashLastBlock) {
                 Misbehaving(pfrom->GetId(), 20, "non-continuous headers sequence");
                 return false;
             }
-            hashLastBlock = header.GetHash();
+            hashLastBlock = hashes[i];
         }
 
         // If we don't have the last header, then they'll have given us
@@ -2018,7 +2154,7 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
 
     CValidationState state;
     CBlockHeader first_invalid_header;
-    if (!ProcessNewBlockHeaders(headers, state, chainparams, &pindexLast, &first_invalid_header)) {
+    if (!ProcessNewBlockHeaders(headers, hashes, state, chainparams, &pindexLast, &first_invalid_header)) {
         if (state.IsInvalid()) {
             MaybePunishNode(pfrom->GetId(), state, via_compact_block, "invalid header received");
             return false;
@@ -2200,7 +2336,128 @@ void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_se
     }
 }
 
-bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, bool enable_bip61)
+/**
+ * Result of PeerLogicValidation::PreprocessMessage. The object was deserialized on a message worker thread, so that
+ * the message handler thread doesn't have to pay for the deserialization (which includes BLS point decompression for
+ * the LLMQ messages).
+ */
+template<typename T>
+struct CPreprocessedObject : public CPreprocessedMessage
+{
+    T obj;
+    uint256 hash;
+    // set when the stateless checks already passed
+    bool fPreVerified{false};
+};
+
+template<typename T>
+static const CPreprocessedObject<T>* GetPreprocessed(const CPreprocessedMessage* preprocessed)
+{
+    return dynamic_cast<const CPreprocessedObject<T>*>(preprocessed);
+}
+
+bool PeerLogicValidation::WantsPreprocessing(const CNetMessage& msg)
+{
+    const std::string strCommand = msg.hdr.GetCommand();
+    return strCommand == NetMsgType::TX ||
+           strCommand == NetMsgType::BLOCK ||
+           strCommand == NetMsgType::ISLOCK ||
+           strCommand == NetMsgType::QSIGREC ||
+           strCommand == NetMsgType::CLSIG;
+}
+
+void PeerLogicValidation::PreprocessMessage(CNode* pnode, CNetMessage& msg)
+{
+    msg.SetVersion(pnode->GetRecvVersion());
+
+    // Don't bother with messages which will be dropped by ProcessMessages anyway. GetMessageHash caches the hash, so
+    // this is not computed twice
+    const uint256& msgHash = msg.GetMessageHash();
+    if (memcmp(msgHash.begin(), msg.hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) != 0) {
+        return;
+    }
+
+    const std::string strCommand = msg.hdr.GetCommand();
+    // Work on a copy, vRecv is still needed as-is if the message handler falls back to the regular path
+    CDataStream vRecv(msg.vRecv.begin(), msg.vRecv.end(), msg.vRecv.GetType(), msg.vRecv.GetVersion());
+
+    try {
+        if (strCommand == NetMsgType::TX) {
+            auto p = std::make_shared<CPreprocessedObject<CTransactionRef>>();
+            vRecv >> p->obj;
+            p->hash = p->obj->GetHash();
+            msg.preprocessed = std::move(p);
+        } else if (strCommand == NetMsgType::BLOCK) {
+            auto p = std::make_shared<CPreprocessedObject<std::shared_ptr<CBlock>>>();
+            p->obj = std::make_shared<CBlock>();
+            vRecv >> *p->obj;
+            p->hash = p->obj->GetHash();
+            msg.preprocessed = std::move(p);
+        } else if (strCommand == NetMsgType::ISLOCK) {
+            auto p = std::make_shared<CPreprocessedObject<llmq::CInstantSendLock>>();
+            vRecv >> p->obj;
+            bool fBan = false;
+            p->fPreVerified = llmq::quorumInstantSendManager && llmq::quorumInstantSendManager->PreVerifyInstantSendLock(pnode->GetId(), p->obj, fBan);
+            msg.preprocessed = std::move(p);
+        } else if (strCommand == NetMsgType::QSIGREC) {
+            auto p = std::make_shared<CPreprocessedObject<llmq::CRecoveredSig>>();
+            vRecv >> p->obj;
+            p->hash = p->obj.GetHash();
+            msg.preprocessed = std::move(p);
+        } else if (strCommand == NetMsgType::CLSIG) {
+            auto p = std::make_shared<CPreprocessedObject<llmq::CChainLockSig>>();
+            vRecv >> p->obj;
+            p->hash = ::SerializeHash(p->obj);
+            msg.preprocessed = std::move(p);
+        }
+    } catch (const std::exception&) {
+        // Let the message handler run into the same error on the regular path, so that it is logged and handled there
+        msg.preprocessed.reset();
+    }
+}
+
+/**
+ * Handles the LLMQ messages which were already deserialized by PreprocessMessage. Returns false if the message has to
+ * go through the regular path.
+ */
+static bool ProcessPreprocessedMessage(CNode* pfrom, const std::string& strCommand, const CPreprocessedMessage* preprocessed, CConnman* connman)
+{
+    if (preprocessed == nullptr) {
+        return false;
+    }
+
+    if (strCommand == NetMsgType::ISLOCK) {
+        auto p = GetPreprocessed<llmq::CInstantSendLock>(preprocessed);
+        if (p == nullptr) {
+            return false;
+        }
+        if (llmq::IsInstantSendEnabled()) {
+            llmq::quorumInstantSendManager->ProcessMessageInstantSendLock(pfrom, p->obj, connman, p->fPreVerified);
+        }
+        return true;
+    }
+    if (strCommand == NetMsgType::QSIGREC) {
+        auto p = GetPreprocessed<llmq::CRecoveredSig>(preprocessed);
+        if (p == nullptr) {
+            return false;
+        }
+        llmq::quorumSigningManager->ProcessMessageRecoveredSig(pfrom, p->obj, connman);
+        return true;
+    }
+    if (strCommand == NetMsgType::CLSIG) {
+        auto p = GetPreprocessed<llmq::CChainLockSig>(preprocessed);
+        if (p == nullptr) {
+            return false;
+        }
+        if (sporkManager.IsSporkActive(SPORK_4_CHAINLOCKS_ENABLED)) {
+            llmq::chainLocksHandler->ProcessNewChainLock(pfrom->GetId(), p->obj, p->hash);
+        }
+        return true;
+    }
+    return false;
+}
+
+bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, bool enable_bip61, const CPreprocessedMessage* preprocessed = nullptr)
 {
     LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->GetId());
     if (gArgs.IsArgSet("-dropmessagestest") && GetRand(gArgs.GetArg("-dropmessagestest", 0)) == 0)
@@ -2866,7 +3123,11 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         }
 
         CTransactionRef ptx;
-        vRecv >> ptx;
+        if (auto p = GetPreprocessed<CTransactionRef>(preprocessed)) {
+            ptx = p->obj;
+        } else {
+            vRecv >> ptx;
+        }
         const CTransaction& tx = *ptx;
 
         CInv inv(MSG_TX, tx.GetHash());
@@ -3118,7 +3379,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 }
 
                 PartiallyDownloadedBlock& partialBlock = *(*queuedBlockIt)->partialBlock;
-                ReadStatus status = partialBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                ReadStatus status = partialBlock.InitData(cmpctblock, GetCompactBlockExtraTransactions(pindex->nHeight));
                 if (status == READ_STATUS_INVALID) {
                     MarkBlockAsReceived(pindex->GetBlockHash()); // Reset in-flight state in case of whitelist
                     Misbehaving(pfrom->GetId(), 100, strprintf("Peer %d sent us invalid compact block\n", pfrom->GetId()));
@@ -3153,7 +3414,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 // Optimistically try to reconstruct anyway since we might be
                 // able to without any round trips.
                 PartiallyDownloadedBlock tempBlock(&mempool);
-                ReadStatus status = tempBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                ReadStatus status = tempBlock.InitData(cmpctblock, GetCompactBlockExtraTransactions(pindex->nHeight));
                 if (status != READ_STATUS_OK) {
                     // TODO: don't ignore failures
                     return true;
@@ -3345,8 +3606,13 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
-        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-        vRecv >> *pblock;
+        std::shared_ptr<CBlock> pblock;
+        if (auto p = GetPreprocessed<std::shared_ptr<CBlock>>(preprocessed)) {
+            pblock = p->obj;
+        } else {
+            pblock = std::make_shared<CBlock>();
+            vRecv >> *pblock;
+        }
         int64_t nTimeNow = GetSystemTimeInSeconds();
 
         LogPrint(BCLog::NET, "received block %s peer=%d\n", pblock->GetHash().ToString(), pfrom->GetId());
@@ -3718,6 +3984,9 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
         if (found)
         {
+            if (ProcessPreprocessedMessage(pfrom, strCommand, preprocessed, connman)) {
+                return true;
+            }
             sporkManager.ProcessSpork(pfrom, strCommand, vRecv, *connman);
             masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
             governance.ProcessMessage(pfrom, strCommand, vRecv, *connman);
@@ -3771,7 +4040,7 @@ bool PeerLogicValidation::SendRejectsAndCheckIfBanned(CNode* pnode, bool enable_
     return false;
 }
 
-bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
+bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc, bool fPriorityOnly)
 {
     const CChainParams& chainparams = Params();
     //
@@ -3784,10 +4053,11 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     //
     bool fMoreWork = false;
 
-    if (!pfrom->vRecvGetData.empty())
+    // Priority messages don't wait for pending getdata or orphans, this is done in the regular pass
+    if (!fPriorityOnly && !pfrom->vRecvGetData.empty())
         ProcessGetData(pfrom, chainparams, connman, interruptMsgProc);
 
-    if (!pfrom->orphan_work_set.empty()) {
+    if (!fPriorityOnly && !pfrom->orphan_work_set.empty()) {
         std::list<CTransactionRef> removed_txn;
         LOCK2(cs_main, g_cs_orphans);
         ProcessOrphanTx(connman, pfrom->orphan_work_set, removed_txn);
@@ -3801,24 +4071,16 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
 
     // this maintains the order of responses
     // and prevents vRecvGetData to grow unbounded
-    if (!pfrom->vRecvGetData.empty()) return true;
-    if (!pfrom->orphan_work_set.empty()) return true;
+    if (!fPriorityOnly && !pfrom->vRecvGetData.empty()) return true;
+    if (!fPriorityOnly && !pfrom->orphan_work_set.empty()) return true;
 
     // Don't bother if send buffer is too full to respond anyway
     if (pfrom->fPauseSend)
         return false;
 
     std::list<CNetMessage> msgs;
-    {
-        LOCK(pfrom->cs_vProcessMsg);
-        if (pfrom->vProcessMsg.empty())
-            return false;
-        // Just take one message
-        msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
-        pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
-        pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
-        fMoreWork = !pfrom->vProcessMsg.empty();
-    }
+    if (!connman->PopProcessMessage(pfrom, fPriorityOnly, msgs, fMoreWork))
+        return false;
     CNetMessage& msg(msgs.front());
 
     msg.SetVersion(pfrom->GetRecvVersion());
@@ -3855,9 +4117,11 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
 
     // Process message
     bool fRet = false;
+    int64_t nWaitTime = std::max(GetTimeMicros() - msg.nTime, int64_t(0));
+    int64_t nCpuStart = GetThreadCpuTimeMicros();
     try
     {
-        fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
+        fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61, msg.preprocessed.get());
         if (interruptMsgProc)
             return false;
         if (!pfrom->vRecvGetData.empty())
@@ -3867,6 +4131,9 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     } catch (...) {
             LogPrint(BCLog::NET, "%s(%s, %u bytes): Unknown exception caught\n", __func__, SanitizeString(strCommand), nMessageSize);
     }
+    // covers the LLMQ, governance and masternode handlers as well, they are all dispatched by ProcessMessage
+    int64_t nCpuTime = GetThreadCpuTimeMicros() - nCpuStart + msg.nPreprocessCpuTime;
+    connman->RecordMessageCost(pfrom, strCommand, nMessageSize + CMessageHeader::HEADER_SIZE, nCpuTime, nWaitTime);
 
     if (!fRet) {
         LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
@@ -4217,8 +4484,10 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                     {
                         LOCK(cs_most_recent_block);
                         if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
+                            // the message prepared in NewPoWValidBlock is serialized with witnesses, which is
+                            // what the peer gets in both of these cases
                             if (state.fWantsCmpctWitness || !fWitnessesPresentInMostRecentCompactBlock)
-                                connman->PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *most_recent_compact_block));
+                                connman->PushMessage(pto, most_recent_compact_block_msg);
                             else {
                                 CBlockHeaderAndShortTxIDs cmpctblock(*most_recent_block, state.fWantsCmpctWitness);
                                 connman->PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
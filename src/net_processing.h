@@ -56,8 +56,13 @@ public:
     *
     * @param[in]   pfrom           The node which we have received messages from.
     * @param[in]   interrupt       Interrupt condition for processing threads
+    * @param[in]   fPriorityOnly   Only look at the priority lane of the node's message queue
     */
-    bool ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt) override;
+    bool ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt, bool fPriorityOnly) override;
+    /** Whether a message is worth deserializing on a message worker thread before it is processed */
+    bool WantsPreprocessing(const CNetMessage& msg) override;
+    /** Deserialize and statelessly check a message on a message worker thread, see CConnman::PreprocessMessage */
+    void PreprocessMessage(CNode* pnode, CNetMessage& msg) override;
     /**
     * Send queued protocol messages to be sent to a give node.
     *
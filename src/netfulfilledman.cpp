@@ -9,32 +9,70 @@
 
 CNetFulfilledRequestManager netfulfilledman;
 
+CNetFulfilledRequestManager::RequestId CNetFulfilledRequestManager::GetRequestId(const std::string& strRequest)
+{
+    AssertLockHeld(cs_mapFulfilledRequests);
+    auto it = mapRequestIds.emplace(strRequest, (RequestId)mapRequestIds.size()).first;
+    return it->second;
+}
+
+bool CNetFulfilledRequestManager::FindRequestId(const std::string& strRequest, RequestId& idRet) const
+{
+    AssertLockHeld(cs_mapFulfilledRequests);
+    auto it = mapRequestIds.find(strRequest);
+    if (it == mapRequestIds.end()) {
+        return false;
+    }
+    idRet = it->second;
+    return true;
+}
+
 void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addr, const std::string& strRequest)
 {
     LOCK(cs_mapFulfilledRequests);
     CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    mapFulfilledRequests[addrSquashed][strRequest] = GetTime() + Params().FulfilledRequestExpireTime();
+    int64_t nNow = GetTime();
+    int64_t nExpire = nNow + Params().FulfilledRequestExpireTime();
+    RequestId id = GetRequestId(strRequest);
+
+    AdvanceWheel(nNow);
+    mapFulfilledRequests[addrSquashed][id] = nExpire;
+    AddToWheel({addrSquashed, id, nExpire});
 }
 
 bool CNetFulfilledRequestManager::HasFulfilledRequest(const CService& addr, const std::string& strRequest)
 {
     LOCK(cs_mapFulfilledRequests);
+    RequestId id;
+    if (!FindRequestId(strRequest, id)) {
+        return false;
+    }
     CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
     fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
+    if (it == mapFulfilledRequests.end()) {
+        return false;
+    }
+    fulfilledreqmapentry_t::iterator it_entry = it->second.find(id);
 
-    return  it != mapFulfilledRequests.end() &&
-            it->second.find(strRequest) != it->second.end() &&
-            it->second[strRequest] > GetTime();
+    return it_entry != it->second.end() && it_entry->second > GetTime();
 }
 
 void CNetFulfilledRequestManager::RemoveFulfilledRequest(const CService& addr, const std::string& strRequest)
 {
     LOCK(cs_mapFulfilledRequests);
+    RequestId id;
+    if (!FindRequestId(strRequest, id)) {
+        return;
+    }
     CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
     fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
 
+    // the wheel entry is left behind and ignored once it expires
     if (it != mapFulfilledRequests.end()) {
-        it->second.erase(strRequest);
+        it->second.erase(id);
+        if (it->second.empty()) {
+            mapFulfilledRequests.erase(it);
+        }
     }
 }
 
@@ -42,45 +80,138 @@ void CNetFulfilledRequestManager::RemoveAllFulfilledRequests(const CService& add
 {
     LOCK(cs_mapFulfilledRequests);
     CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
+    mapFulfilledRequests.erase(addrSquashed);
+}
 
-    if (it != mapFulfilledRequests.end()) {
-        mapFulfilledRequests.erase(it++);
+void CNetFulfilledRequestManager::AddToWheel(const WheelEntry& entry)
+{
+    AssertLockHeld(cs_mapFulfilledRequests);
+
+    // entries which are already due go into the next slot to be processed
+    int64_t nWhen = std::max(entry.nExpire, nWheelNextTick);
+    int64_t nDelta = nWhen - nWheelNextTick;
+
+    int nLevel = 0;
+    int64_t nLevelSpan = WHEEL_SIZE;
+    while (nDelta >= nLevelSpan && nLevel < WHEEL_LEVELS - 1) {
+        nLevel++;
+        nLevelSpan <<= WHEEL_BITS;
+    }
+    if (nDelta >= nLevelSpan) {
+        // too far in the future even for the top level, park it in the last top level slot and let the cascade
+        // re-insert it once we get there
+        nWhen = nWheelNextTick + WHEEL_RANGE - 1;
     }
+
+    int64_t nSlot = (nWhen >> (WHEEL_BITS * nLevel)) & WHEEL_MASK;
+    wheel[nLevel][nSlot].emplace_back(entry);
 }
 
-void CNetFulfilledRequestManager::CheckAndRemove()
+void CNetFulfilledRequestManager::CascadeWheel(int nLevel, int64_t nSlot)
 {
-    LOCK(cs_mapFulfilledRequests);
+    AssertLockHeld(cs_mapFulfilledRequests);
+
+    wheelslot_t vecEntries;
+    vecEntries.swap(wheel[nLevel][nSlot]);
+    for (const auto& entry : vecEntries) {
+        AddToWheel(entry);
+    }
+}
+
+void CNetFulfilledRequestManager::ExpireEntry(const WheelEntry& entry, int64_t nNow)
+{
+    AssertLockHeld(cs_mapFulfilledRequests);
 
-    int64_t now = GetTime();
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.begin();
+    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(entry.addr);
+    if (it == mapFulfilledRequests.end()) {
+        return;
+    }
+    fulfilledreqmapentry_t::iterator it_entry = it->second.find(entry.id);
+    // the request might have been removed or fulfilled again in the meantime, a newer wheel entry covers it then
+    if (it_entry == it->second.end() || it_entry->second > nNow) {
+        return;
+    }
+    it->second.erase(it_entry);
+    if (it->second.empty()) {
+        mapFulfilledRequests.erase(it);
+    }
+}
 
-    while(it != mapFulfilledRequests.end()) {
-        fulfilledreqmapentry_t::iterator it_entry = it->second.begin();
-        while(it_entry != it->second.end()) {
-            if(now > it_entry->second) {
-                it->second.erase(it_entry++);
+void CNetFulfilledRequestManager::AdvanceWheel(int64_t nNow)
+{
+    AssertLockHeld(cs_mapFulfilledRequests);
+
+    if (nNow - nWheelNextTick >= WHEEL_RANGE) {
+        // first call or a huge time jump (e.g. mocktime), walking all ticks would be pointless,
+        // so rebuild the wheel relative to the current time instead
+        std::vector<WheelEntry> vecEntries;
+        for (auto& level : wheel) {
+            for (auto& slot : level) {
+                vecEntries.insert(vecEntries.end(), slot.begin(), slot.end());
+                slot.clear();
+            }
+        }
+        nWheelNextTick = nNow + 1;
+        for (const auto& entry : vecEntries) {
+            if (entry.nExpire <= nNow) {
+                ExpireEntry(entry, nNow);
             } else {
-                ++it_entry;
+                AddToWheel(entry);
+            }
+        }
+        return;
+    }
+
+    while (nWheelNextTick <= nNow) {
+        int64_t nTick = nWheelNextTick;
+        if ((nTick & WHEEL_MASK) == 0) {
+            // higher levels first, so that entries can trickle down more than one level at once
+            for (int nLevel = WHEEL_LEVELS - 1; nLevel > 0; nLevel--) {
+                if ((nTick & ((int64_t(1) << (WHEEL_BITS * nLevel)) - 1)) == 0) {
+                    CascadeWheel(nLevel, (nTick >> (WHEEL_BITS * nLevel)) & WHEEL_MASK);
+                }
             }
         }
-        if(it->second.size() == 0) {
-            mapFulfilledRequests.erase(it++);
-        } else {
-            ++it;
+
+        wheelslot_t vecEntries;
+        vecEntries.swap(wheel[0][nTick & WHEEL_MASK]);
+        for (const auto& entry : vecEntries) {
+            ExpireEntry(entry, nTick);
         }
+        nWheelNextTick++;
     }
 }
 
+void CNetFulfilledRequestManager::CheckAndRemove()
+{
+    LOCK(cs_mapFulfilledRequests);
+    AdvanceWheel(GetTime());
+}
+
 void CNetFulfilledRequestManager::Clear()
 {
     LOCK(cs_mapFulfilledRequests);
     mapFulfilledRequests.clear();
+    for (auto& level : wheel) {
+        for (auto& slot : level) {
+            slot.clear();
+        }
+    }
+}
+
+size_t CNetFulfilledRequestManager::GetFulfilledRequestCount() const
+{
+    LOCK(cs_mapFulfilledRequests);
+    size_t nCount = 0;
+    for (const auto& p : mapFulfilledRequests) {
+        nCount += p.second.size();
+    }
+    return nCount;
 }
 
 std::string CNetFulfilledRequestManager::ToString() const
 {
+    LOCK(cs_mapFulfilledRequests);
     std::ostringstream info;
     info << "Nodes with fulfilled requests: " << (int)mapFulfilledRequests.size();
     return info.str();
@@ -6,37 +6,63 @@
 #define NETFULFILLEDMAN_H
 
 #include <netaddress.h>
-#include <serialize.h>
 #include <sync.h>
 
+#include <map>
+#include <unordered_map>
+#include <vector>
+
 class CNetFulfilledRequestManager;
 extern CNetFulfilledRequestManager netfulfilledman;
 
 // Fulfilled requests are used to prevent nodes from asking for the same data on sync
 // and from being banned for doing so too often.
+// Requests are only kept in memory, they expire much sooner than a node is usually restarted.
 class CNetFulfilledRequestManager
 {
 private:
-    typedef std::map<std::string, int64_t> fulfilledreqmapentry_t;
+    // request strings are interned into small ids, there is only a handful of distinct requests
+    typedef uint32_t RequestId;
+    typedef std::map<RequestId, int64_t> fulfilledreqmapentry_t;
     typedef std::map<CService, fulfilledreqmapentry_t> fulfilledreqmap_t;
 
+    // Expiry is tracked by a hierarchical timing wheel with one second ticks. Each level has WHEEL_SIZE slots,
+    // a slot on level N covers WHEEL_SIZE^N seconds and is cascaded into the lower level once its time
+    // comes, so that every entry is touched only a constant number of times before it expires.
+    static const int WHEEL_BITS = 6;
+    static const int64_t WHEEL_SIZE = 1 << WHEEL_BITS;
+    static const int64_t WHEEL_MASK = WHEEL_SIZE - 1;
+    static const int WHEEL_LEVELS = 3;
+    static const int64_t WHEEL_RANGE = 1 << (WHEEL_BITS * WHEEL_LEVELS);
+
+    struct WheelEntry {
+        CService addr;
+        RequestId id;
+        int64_t nExpire;
+    };
+    typedef std::vector<WheelEntry> wheelslot_t;
+
     //keep track of what node has/was asked for and when
     fulfilledreqmap_t mapFulfilledRequests;
-    CCriticalSection cs_mapFulfilledRequests;
+    std::unordered_map<std::string, RequestId> mapRequestIds;
+    wheelslot_t wheel[WHEEL_LEVELS][WHEEL_SIZE];
+    // first tick (unix time) which was not processed by the wheel yet
+    int64_t nWheelNextTick{0};
+    mutable CCriticalSection cs_mapFulfilledRequests;
+
+    RequestId GetRequestId(const std::string& strRequest);
+    bool FindRequestId(const std::string& strRequest, RequestId& idRet) const;
 
     void RemoveFulfilledRequest(const CService& addr, const std::string& strRequest);
 
+    void AddToWheel(const WheelEntry& entry);
+    void CascadeWheel(int nLevel, int64_t nSlot);
+    void ExpireEntry(const WheelEntry& entry, int64_t nNow);
+    void AdvanceWheel(int64_t nNow);
+
 public:
     CNetFulfilledRequestManager() {}
 
-    ADD_SERIALIZE_METHODS;
-
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        LOCK(cs_mapFulfilledRequests);
-        READWRITE(mapFulfilledRequests);
-    }
-
     void AddFulfilledRequest(const CService& addr, const std::string& strRequest);
     bool HasFulfilledRequest(const CService& addr, const std::string& strRequest);
 
@@ -45,6 +71,9 @@ public:
     void CheckAndRemove();
     void Clear();
 
+    // number of fulfilled requests of all nodes, including expired ones which were not removed yet
+    size_t GetFulfilledRequestCount() const;
+
     std::string ToString() const;
 
     void DoMaintenance();
@@ -0,0 +1,310 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef EMRALS_POOLEDMAP_H
+#define EMRALS_POOLEDMAP_H
+
+#include <memusage.h>
+
+#include <stdint.h>
+
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* Hash map built for caches with many small entries, such as the UTXO cache.
+ *
+ * Entries are allocated from a pool of chunks, so the entries do not need an
+ * allocation each, and are looked up through an open addressing table with
+ * linear probing, which stores the hash of each entry next to its pointer so
+ * that probing mostly touches a single cache line.
+ *
+ * The interface is the subset of std::unordered_map used by the coins cache,
+ * with the same guarantees: pointers and references to entries stay valid
+ * until the entry is erased, and iterators stay valid until the next
+ * insertion. Erasing leaves a marker in the table, so erasing while iterating
+ * is supported like with std::unordered_map.
+ */
+template <class K, class T, class Hash>
+class pooledmap {
+public:
+    typedef std::pair<const K, T> value_type;
+    typedef size_t size_type;
+
+private:
+    union Node {
+        value_type value;
+        Node* next_free;
+
+        Node() {}
+        ~Node() {}
+    };
+
+    struct Slot {
+        //! The entry, or nullptr if the slot is empty or erased
+        Node* node;
+        //! The hash of the entry, or one of the markers below if node is nullptr
+        size_t hash;
+    };
+    static constexpr size_t SLOT_EMPTY = 0;
+    static constexpr size_t SLOT_ERASED = 1;
+
+    //! Number of entries in the first pool chunk; every next chunk is twice as large, up to MAX_CHUNK_NODES
+    static constexpr size_t MIN_CHUNK_NODES = 16;
+    static constexpr size_t MAX_CHUNK_NODES = 4096;
+    //! Number of slots of the first table
+    static constexpr size_t MIN_SLOTS = 16;
+
+    Hash m_hash;
+
+    std::unique_ptr<Slot[]> m_slots;
+    //! Number of slots, zero or a power of two
+    size_t m_slot_count = 0;
+    //! Number of entries
+    size_t m_size = 0;
+    //! Number of erased slots
+    size_t m_erased = 0;
+
+    std::vector<std::pair<std::unique_ptr<Node[]>, size_t>> m_chunks;
+    //! Unused entries of the allocated chunks
+    Node* m_free = nullptr;
+
+    template <bool is_const>
+    class iter {
+    private:
+        friend class pooledmap;
+        Slot* m_slot;
+        Slot* m_end;
+
+        void skip() { while (m_slot != m_end && !m_slot->node) ++m_slot; }
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef pooledmap::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef typename std::conditional<is_const, const value_type*, value_type*>::type pointer;
+        typedef typename std::conditional<is_const, const value_type&, value_type&>::type reference;
+
+        iter() : m_slot(nullptr), m_end(nullptr) {}
+        iter(Slot* slot, Slot* end) : m_slot(slot), m_end(end) { skip(); }
+        template <bool other_const, typename = typename std::enable_if<is_const && !other_const>::type>
+        iter(const iter<other_const>& other) : m_slot(other.m_slot), m_end(other.m_end) {}
+
+        reference operator*() const { return m_slot->node->value; }
+        pointer operator->() const { return &m_slot->node->value; }
+        iter& operator++() { ++m_slot; skip(); return *this; }
+        iter operator++(int) { iter copy(*this); ++(*this); return copy; }
+        bool operator==(const iter& other) const { return m_slot == other.m_slot; }
+        bool operator!=(const iter& other) const { return m_slot != other.m_slot; }
+
+        friend class iter<true>;
+    };
+
+public:
+    typedef iter<false> iterator;
+    typedef iter<true> const_iterator;
+
+    pooledmap() {}
+    ~pooledmap() { clear(); }
+    pooledmap(const pooledmap&) = delete;
+    pooledmap& operator=(const pooledmap&) = delete;
+
+    bool empty() const { return m_size == 0; }
+    size_type size() const { return m_size; }
+    size_type bucket_count() const { return m_slot_count; }
+
+    iterator begin() { return iterator(m_slots.get(), m_slots.get() + m_slot_count); }
+    iterator end() { return iterator(m_slots.get() + m_slot_count, m_slots.get() + m_slot_count); }
+    const_iterator begin() const { return const_iterator(m_slots.get(), m_slots.get() + m_slot_count); }
+    const_iterator end() const { return const_iterator(m_slots.get() + m_slot_count, m_slots.get() + m_slot_count); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    iterator find(const K& key)
+    {
+        Slot* slot = Find(key, HashKey(key));
+        return slot ? iterator(slot, m_slots.get() + m_slot_count) : end();
+    }
+    const_iterator find(const K& key) const
+    {
+        Slot* slot = Find(key, HashKey(key));
+        return slot ? const_iterator(slot, m_slots.get() + m_slot_count) : end();
+    }
+    size_type count(const K& key) const { return Find(key, HashKey(key)) ? 1 : 0; }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        // Like std::unordered_map, construct the entry first to get to its key
+        Node* node = AllocateNode();
+        try {
+            new (&node->value) value_type(std::forward<Args>(args)...);
+        } catch (...) {
+            FreeNode(node);
+            throw;
+        }
+        const size_t hash = HashKey(node->value.first);
+        Slot* slot = Find(node->value.first, hash);
+        if (slot) {
+            node->value.~value_type();
+            FreeNode(node);
+            return std::make_pair(iterator(slot, m_slots.get() + m_slot_count), false);
+        }
+        return std::make_pair(Insert(node, hash), true);
+    }
+
+    T& operator[](const K& key)
+    {
+        iterator it = find(key);
+        if (it != end()) return it->second;
+        return emplace(std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>()).first->second;
+    }
+
+    iterator erase(iterator it)
+    {
+        Slot* slot = it.m_slot;
+        slot->node->value.~value_type();
+        FreeNode(slot->node);
+        slot->node = nullptr;
+        slot->hash = SLOT_ERASED;
+        --m_size;
+        ++m_erased;
+        return iterator(slot, it.m_end);
+    }
+
+    size_type erase(const K& key)
+    {
+        iterator it = find(key);
+        if (it == end()) return 0;
+        erase(it);
+        return 1;
+    }
+
+    /** Remove all entries and release all memory. */
+    void clear()
+    {
+        for (size_t i = 0; i < m_slot_count; ++i) {
+            if (m_slots[i].node) m_slots[i].node->value.~value_type();
+        }
+        m_slots.reset();
+        m_slot_count = 0;
+        m_size = 0;
+        m_erased = 0;
+        decltype(m_chunks)().swap(m_chunks);
+        m_free = nullptr;
+    }
+
+    void swap(pooledmap& other)
+    {
+        std::swap(m_hash, other.m_hash);
+        std::swap(m_slots, other.m_slots);
+        std::swap(m_slot_count, other.m_slot_count);
+        std::swap(m_size, other.m_size);
+        std::swap(m_erased, other.m_erased);
+        std::swap(m_chunks, other.m_chunks);
+        std::swap(m_free, other.m_free);
+    }
+
+    size_t DynamicMemoryUsage() const
+    {
+        size_t usage = m_slot_count ? memusage::MallocUsage(sizeof(Slot) * m_slot_count) : 0;
+        usage += memusage::DynamicUsage(m_chunks);
+        for (const auto& chunk : m_chunks) {
+            usage += memusage::MallocUsage(sizeof(Node) * chunk.second);
+        }
+        return usage;
+    }
+
+private:
+    size_t HashKey(const K& key) const { return m_hash(key); }
+
+    Slot* Find(const K& key, size_t hash) const
+    {
+        if (m_slot_count == 0) return nullptr;
+        const size_t mask = m_slot_count - 1;
+        for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+            Slot& slot = m_slots[i];
+            if (slot.node) {
+                if (slot.hash == hash && slot.node->value.first == key) return &slot;
+            } else if (slot.hash == SLOT_EMPTY) {
+                return nullptr;
+            }
+        }
+    }
+
+    iterator Insert(Node* node, size_t hash)
+    {
+        // Keep the table at most three quarters full, counting erased slots
+        if ((m_size + m_erased + 1) * 4 > m_slot_count * 3) {
+            size_t slot_count = m_slot_count ? m_slot_count : MIN_SLOTS;
+            while ((m_size + 1) * 2 > slot_count) slot_count *= 2;
+            Rehash(slot_count);
+        }
+        const size_t mask = m_slot_count - 1;
+        size_t i = hash & mask;
+        while (m_slots[i].node) i = (i + 1) & mask;
+        if (m_slots[i].hash == SLOT_ERASED) --m_erased;
+        m_slots[i].node = node;
+        m_slots[i].hash = hash;
+        ++m_size;
+        return iterator(&m_slots[i], m_slots.get() + m_slot_count);
+    }
+
+    void Rehash(size_t slot_count)
+    {
+        std::unique_ptr<Slot[]> slots(new Slot[slot_count]);
+        for (size_t i = 0; i < slot_count; ++i) {
+            slots[i].node = nullptr;
+            slots[i].hash = SLOT_EMPTY;
+        }
+        const size_t mask = slot_count - 1;
+        for (size_t i = 0; i < m_slot_count; ++i) {
+            if (!m_slots[i].node) continue;
+            size_t j = m_slots[i].hash & mask;
+            while (slots[j].node) j = (j + 1) & mask;
+            slots[j] = m_slots[i];
+        }
+        m_slots = std::move(slots);
+        m_slot_count = slot_count;
+        m_erased = 0;
+    }
+
+    Node* AllocateNode()
+    {
+        if (!m_free) {
+            size_t count = m_chunks.empty() ? MIN_CHUNK_NODES : m_chunks.back().second * 2;
+            if (count > MAX_CHUNK_NODES) count = MAX_CHUNK_NODES;
+            m_chunks.emplace_back(std::unique_ptr<Node[]>(new Node[count]), count);
+            Node* chunk = m_chunks.back().first.get();
+            for (size_t i = count; i > 0; --i) {
+                FreeNode(&chunk[i - 1]);
+            }
+        }
+        Node* node = m_free;
+        m_free = node->next_free;
+        return node;
+    }
+
+    void FreeNode(Node* node)
+    {
+        node->next_free = m_free;
+        m_free = node;
+    }
+};
+
+namespace memusage {
+
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const pooledmap<X, Y, Z>& m)
+{
+    return m.DynamicMemoryUsage();
+}
+
+}
+
+#endif // EMRALS_POOLEDMAP_H
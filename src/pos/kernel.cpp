@@ -76,6 +76,8 @@ static bool SelectBlockFromCandidates(
     uint64_t nStakeModifierPrev,
     const CBlockIndex** pindexSelected)
 {
+    AssertLockHeld(cs_main);
+
     bool fSelected = false;
     arith_uint256 hashBest = 0;
     *pindexSelected = (const CBlockIndex*) 0;
@@ -90,7 +92,7 @@ static bool SelectBlockFromCandidates(
             continue;
         // compute the selection hash by hashing its proof-hash and the
         // previous proof-of-stake modifier
-        uint256 hashProof = pindex->IsProofOfStake() ? pindex->hashProofOfStake : pindex->GetBlockHash();
+        uint256 hashProof = pindex->IsProofOfStake() ? pindex->GetPoSData().hashProofOfStake : pindex->GetBlockHash();
         CDataStream ss(SER_GETHASH, 0);
         ss << hashProof << nStakeModifierPrev;
         arith_uint256 hashSelection = UintToArith256(Hash(ss.begin(), ss.end()));
@@ -308,7 +310,7 @@ static bool GetKernelStakeModifier(CBlockIndex* pindexPrev, uint256 hashBlockFro
 //   quantities so as to generate blocks faster, degrading the system back into
 //   a proof-of-work situation.
 //
-bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBlockHeader blockFrom, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake)
+bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBlockHeader blockFrom, CAmount nValueIn, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake)
 {
     const Consensus::Params& params = Params().GetConsensus();
     bool fHardenedChecks = pindexPrev->nHeight+1 > params.StakeEnforcement();
@@ -335,7 +337,6 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
 
     arith_uint256 bnTargetPerCoinDay;
     bnTargetPerCoinDay.SetCompact(nBits);
-    CAmount nValueIn = txPrev->vout[prevout.n].nValue;
 
     //! enforce minimum stake amount
     if (nValueIn < Params().GetConsensus().MinStakeAmount() && fHardenedChecks) {
@@ -384,15 +385,16 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
 
 int GetLastHeight(uint256 txHash)
 {
-    uint256 hashBlock;
-    CTransactionRef stakeInput;
-    if (!GetTransaction(txHash, stakeInput, Params().GetConsensus(), hashBlock))
+    if (!g_txindex)
         return 0;
 
-    if (hashBlock == uint256())
+    uint256 hashBlock;
+    CTransactionView stakeInput;
+    if (!g_txindex->FindTxView(txHash, hashBlock, stakeInput))
         return 0;
 
-    return ::LookupBlockIndex(hashBlock)->nHeight;
+    const CBlockIndex* pindex = ::LookupBlockIndex(hashBlock);
+    return pindex ? pindex->nHeight : 0;
 }
 
 // Check kernel hash target and coinstake signature
@@ -412,51 +414,51 @@ bool CheckProofOfStake(const CBlock &block, CBlockIndex* pindexPrev, uint256& ha
     if (!g_txindex)
         return error("%s: transaction index not available", __func__);
 
-    // First try finding the previous transaction in database
+    // Look up the previous transaction in the index, only the spent output is read
     uint256 hashBlock;
-    CTransactionRef txPrev;
-    if (!GetTransaction(txin.prevout.hash, txPrev, Params().GetConsensus(), hashBlock))
+    CTransactionView txPrev;
+    CTxOut prevOut;
+    if (!g_txindex->FindTxView(txin.prevout.hash, hashBlock, txPrev) || !txPrev.GetOutput(txin.prevout.n, prevOut))
         return error("%s: read txPrev failed", __func__);
 
+    const CBlockIndex* pindexFrom = LookupBlockIndex(hashBlock);
+    if (!pindexFrom)
+        return error("%s: block of txPrev not found", __func__);
+
     // Enforce minimum stake depth
     const int nPreviousBlockHeight = pindexPrev->nHeight;
-    const int nBlockFromHeight = GetLastHeight(txin.prevout.hash);
-
-    // returning zero from GetLastHeight() indicates error
-    if (nBlockFromHeight == 0 && fHardenedChecks)
-        return error("%s: returning zero from GetLastHeight()", __func__);
+    const int nBlockFromHeight = pindexFrom->nHeight;
 
     if (!Params().GetConsensus().HasStakeMinDepth(nPreviousBlockHeight+1, nBlockFromHeight) && fHardenedChecks) {
         LogPrintf("\n%s : min age violation - height=%d - nHeightBlockFrom=%d (depth=%d)\n", __func__, nPreviousBlockHeight, nBlockFromHeight, nPreviousBlockHeight - nBlockFromHeight);
         return false;
     }
 
-    CBlockHeader header = LookupBlockIndex(hashBlock)->GetBlockHeader();
+    CBlockHeader header = pindexFrom->GetBlockHeader();
 
     // Verify signature
     {
-        const CTxOut& prevOut = txPrev->vout[txin.prevout.n];
         TransactionSignatureChecker checker(&(*tx), 0, prevOut.nValue, PrecomputedTransactionData(*tx));
 
         if (!VerifyScript(txin.scriptSig, prevOut.scriptPubKey, &(txin.scriptWitness), SCRIPT_VERIFY_P2SH, checker, nullptr))
             return error("%s: check kernel script failed on coinstake %s, hashProof=%s\n", __func__, tx->GetHash().ToString(), hashProofOfStake.ToString());
     }
 
-    if (!CheckStakeKernelHash(block.nBits, pindexPrev, header, txPrev, txin.prevout, block.nTime, hashProofOfStake, gArgs.IsArgSet("-debug")))
+    if (!CheckStakeKernelHash(block.nBits, pindexPrev, header, prevOut.nValue, txin.prevout, block.nTime, hashProofOfStake, gArgs.IsArgSet("-debug")))
         return error("%s: check kernel failed on coinstake %s, hashProof=%s", __func__, tx->GetHash().ToString(), hashProofOfStake.ToString()); // may occur during initial download or if behind on block chain sync
 
     return true;
 }
 
 // Get stake modifier checksum
-unsigned int GetStakeModifierChecksum(const CBlockIndex* pindex)
+unsigned int GetStakeModifierChecksum(const CBlockIndex* pindex, const uint256& hashProofOfStake)
 {
     assert (pindex->pprev || pindex->GetBlockHash() == Params().GetConsensus().hashGenesisBlock);
     // Hash previous checksum with flags, hashProofOfStake and nStakeModifier
     CDataStream ss(SER_GETHASH, 0);
     if (pindex->pprev)
         ss << pindex->pprev->nStakeModifierChecksum;
-    ss << pindex->nFlags << pindex->hashProofOfStake << pindex->nStakeModifier;
+    ss << pindex->nFlags << hashProofOfStake << pindex->nStakeModifier;
     arith_uint256 hashChecksum = UintToArith256(Hash(ss.begin(), ss.end()));
     hashChecksum >>= (256 - 32);
     return hashChecksum.GetLow64();
@@ -16,6 +16,7 @@
 #include <net.h>
 #include <netbase.h>
 #include <util/system.h>
+#include <validation.h>
 
 #include <masternodes/sync.h>
 #include <llmq/quorums_instantsend.h>
@@ -330,3 +331,16 @@ void ClientModel::refreshMasternodeList()
     LOCK(cs_mnlist);
     setMasternodeList(deterministicMNManager->GetListAtChainTip());
 }
+
+bool ClientModel::getMasternodeListChanges(const CDeterministicMNList& oldList, const CDeterministicMNList& newList,
+                                           std::vector<CDeterministicMNCPtr>& changedRet, std::vector<CDeterministicMNCPtr>& removedRet) const
+{
+    const CBlockIndex* pindexOld;
+    const CBlockIndex* pindexNew;
+    {
+        LOCK(cs_main);
+        pindexOld = LookupBlockIndex(oldList.GetBlockHash());
+        pindexNew = LookupBlockIndex(newList.GetBlockHash());
+    }
+    return deterministicMNManager->GetListChangesSince(pindexOld, pindexNew, changedRet, removedRet);
+}
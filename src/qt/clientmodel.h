@@ -82,6 +82,9 @@ public:
     void setMasternodeList(const CDeterministicMNList& mnList);
     CDeterministicMNList getMasternodeList() const;
     void refreshMasternodeList();
+    /** The MNs which were added/updated and removed between two lists, false if the change feed can't provide them */
+    bool getMasternodeListChanges(const CDeterministicMNList& oldList, const CDeterministicMNList& newList,
+                                  std::vector<CDeterministicMNCPtr>& changedRet, std::vector<CDeterministicMNCPtr>& removedRet) const;
 
     // caches for the best header
     mutable std::atomic<int> cachedBestHeaderHeight;
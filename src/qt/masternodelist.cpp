@@ -137,12 +137,36 @@ void MasternodeList::updateDIP3ListScheduled()
         int64_t nSecondsToWait = nTimeUpdatedDIP3 - GetTime() + MASTERNODELIST_UPDATE_SECONDS;
 
         if (nSecondsToWait <= 0) {
-            updateDIP3List();
+            applyDIP3ListChanges();
             mnListChanged = false;
         }
     }
 }
 
+std::map<uint256, int> MasternodeList::getDIP3NextPayments(const CDeterministicMNList& mnList)
+{
+    auto projectedPayees = mnList.GetProjectedMNPayees(mnList.GetValidMNsCount());
+    std::map<uint256, int> nextPayments;
+    for (size_t i = 0; i < projectedPayees.size(); i++) {
+        const auto& dmn = projectedPayees[i];
+        nextPayments.emplace(dmn->proTxHash, mnList.GetHeight() + (int)i + 1);
+    }
+    return nextPayments;
+}
+
+std::set<COutPoint> MasternodeList::getDIP3MyOutpoints()
+{
+    std::set<COutPoint> setOutpts;
+    if (walletModel && ui->checkBoxMyMasternodesOnly->isChecked()) {
+        std::vector<COutPoint> vOutpts;
+        walletModel->listProTxCoins(vOutpts);
+        for (const auto& outpt : vOutpts) {
+            setOutpts.emplace(outpt);
+        }
+    }
+    return setOutpts;
+}
+
 void MasternodeList::updateDIP3List()
 {
     if (!clientModel || ShutdownRequested()) {
@@ -151,107 +175,209 @@ void MasternodeList::updateDIP3List()
 
     LOCK(cs_dip3list);
 
-    QString strToFilter;
     ui->countLabelDIP3->setText("Updating...");
     ui->tableWidgetMasternodesDIP3->setSortingEnabled(false);
     ui->tableWidgetMasternodesDIP3->clearContents();
     ui->tableWidgetMasternodesDIP3->setRowCount(0);
+    mapProTxHashItemsDIP3.clear();
 
     auto mnList = clientModel->getMasternodeList();
     nTimeUpdatedDIP3 = GetTime();
 
-    auto projectedPayees = mnList.GetProjectedMNPayees(mnList.GetValidMNsCount());
-    std::map<uint256, int> nextPayments;
-    for (size_t i = 0; i < projectedPayees.size(); i++) {
-        const auto& dmn = projectedPayees[i];
-        nextPayments.emplace(dmn->proTxHash, mnList.GetHeight() + (int)i + 1);
+    auto nextPayments = getDIP3NextPayments(mnList);
+    auto setOutpts = getDIP3MyOutpoints();
+
+    mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+        addDIP3Row(mnList, dmn, nextPayments, setOutpts);
+    });
+    mnListDIP3 = mnList;
+    mapNextPaymentsDIP3 = std::move(nextPayments);
+
+    ui->countLabelDIP3->setText(QString::number(ui->tableWidgetMasternodesDIP3->rowCount()));
+    ui->tableWidgetMasternodesDIP3->setSortingEnabled(true);
+}
+
+void MasternodeList::applyDIP3ListChanges()
+{
+    if (!clientModel || ShutdownRequested()) {
+        return;
     }
 
-    std::set<COutPoint> setOutpts;
-    if (walletModel && ui->checkBoxMyMasternodesOnly->isChecked()) {
-        std::vector<COutPoint> vOutpts;
-        walletModel->listProTxCoins(vOutpts);
-        for (const auto& outpt : vOutpts) {
-            setOutpts.emplace(outpt);
-        }
+    LOCK(cs_dip3list);
+
+    if (mnListDIP3.GetBlockHash().IsNull()) {
+        // nothing shown yet
+        updateDIP3List();
+        return;
     }
 
-    mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
-        if (walletModel && ui->checkBoxMyMasternodesOnly->isChecked()) {
-            bool fMyMasternode = setOutpts.count(dmn->collateralOutpoint) ||
-                walletModel->havePrivKey(dmn->pdmnState->keyIDOwner) ||
-                walletModel->havePrivKey(dmn->pdmnState->keyIDVoting) ||
-                walletModel->havePrivKey(dmn->pdmnState->scriptPayout) ||
-                walletModel->havePrivKey(dmn->pdmnState->scriptOperatorPayout);
-            if (!fMyMasternode) return;
+    auto mnList = clientModel->getMasternodeList();
+    nTimeUpdatedDIP3 = GetTime();
+    if (mnList.GetBlockHash() == mnListDIP3.GetBlockHash()) {
+        return;
+    }
+
+    // Only touch the rows of MNs which were actually added, updated or removed, as reported by the list diffs
+    std::vector<CDeterministicMNCPtr> vecChanged;
+    std::vector<CDeterministicMNCPtr> vecRemoved;
+    if (!clientModel->getMasternodeListChanges(mnListDIP3, mnList, vecChanged, vecRemoved)) {
+        // the shown list is too old or not an ancestor of the new one anymore (reorg)
+        updateDIP3List();
+        return;
+    }
+    auto nextPayments = getDIP3NextPayments(mnList);
+    auto setOutpts = getDIP3MyOutpoints();
+
+    ui->tableWidgetMasternodesDIP3->setSortingEnabled(false);
+
+    std::set<uint256> setUpdated;
+    for (const auto& dmn : vecRemoved) {
+        removeDIP3Row(dmn->proTxHash);
+    }
+    for (const auto& dmn : vecChanged) {
+        removeDIP3Row(dmn->proTxHash);
+        addDIP3Row(mnList, dmn, nextPayments, setOutpts);
+        setUpdated.emplace(dmn->proTxHash);
+    }
+
+    // The payment order shifts for all MNs behind a changed one, update the rows whose next payment changed
+    for (const auto& p : nextPayments) {
+        auto it = mapNextPaymentsDIP3.find(p.first);
+        if ((it == mapNextPaymentsDIP3.end() || it->second != p.second) && !setUpdated.count(p.first)) {
+            updateDIP3NextPayment(mnList, p.first, nextPayments, setOutpts);
         }
-        // populate list
-        // Address, Protocol, Status, Active Seconds, Last Seen, Pub Key
-        QTableWidgetItem* addressItem = new QTableWidgetItem(QString::fromStdString(dmn->pdmnState->addr.ToString()));
-        QTableWidgetItem* statusItem = new QTableWidgetItem(mnList.IsMNValid(dmn) ? tr("ENABLED") : (mnList.IsMNPoSeBanned(dmn) ? tr("POSE_BANNED") : tr("UNKNOWN")));
-        QTableWidgetItem* PoSeScoreItem = new QTableWidgetItem(QString::number(dmn->pdmnState->nPoSePenalty));
-        QTableWidgetItem* registeredItem = new QTableWidgetItem(QString::number(dmn->pdmnState->nRegisteredHeight));
-        QTableWidgetItem* lastPaidItem = new QTableWidgetItem(QString::number(dmn->pdmnState->nLastPaidHeight));
-        QTableWidgetItem* nextPaymentItem = new QTableWidgetItem(nextPayments.count(dmn->proTxHash) ? QString::number(nextPayments[dmn->proTxHash]) : tr("UNKNOWN"));
-
-        CTxDestination payeeDest;
-        QString payeeStr;
-        if (ExtractDestination(dmn->pdmnState->scriptPayout, payeeDest)) {
-            std::string payeeString = EncodeDestination(payeeDest);
-            payeeStr = QString::fromStdString(payeeString);
-        } else {
-            payeeStr = tr("UNKNOWN");
+    }
+    for (const auto& p : mapNextPaymentsDIP3) {
+        if (!nextPayments.count(p.first) && !setUpdated.count(p.first)) {
+            updateDIP3NextPayment(mnList, p.first, nextPayments, setOutpts);
+        }
+    }
+    mnListDIP3 = mnList;
+    mapNextPaymentsDIP3 = std::move(nextPayments);
+
+    ui->countLabelDIP3->setText(QString::number(ui->tableWidgetMasternodesDIP3->rowCount()));
+    ui->tableWidgetMasternodesDIP3->setSortingEnabled(true);
+}
+
+void MasternodeList::removeDIP3Row(const uint256& proTxHash)
+{
+    auto it = mapProTxHashItemsDIP3.find(proTxHash);
+    if (it == mapProTxHashItemsDIP3.end()) {
+        return;
+    }
+    ui->tableWidgetMasternodesDIP3->removeRow(it->second->row());
+    mapProTxHashItemsDIP3.erase(it);
+}
+
+void MasternodeList::updateDIP3NextPayment(const CDeterministicMNList& mnList, const uint256& proTxHash, const std::map<uint256, int>& nextPayments, const std::set<COutPoint>& setOutpts)
+{
+    if (strCurrentFilterDIP3 != "") {
+        // The next payment is part of the filtered text, so the row might have to be shown or hidden now
+        removeDIP3Row(proTxHash);
+        auto dmn = mnList.GetMN(proTxHash);
+        if (dmn) {
+            addDIP3Row(mnList, dmn, nextPayments, setOutpts);
         }
-        QTableWidgetItem* payeeItem = new QTableWidgetItem(payeeStr);
-
-        QString operatorRewardStr;
-        if (dmn->nOperatorReward) {
-            operatorRewardStr += QString::number(dmn->nOperatorReward / 100.0, 'f', 2) + "% ";
-
-            if (dmn->pdmnState->scriptOperatorPayout != CScript()) {
-                CTxDestination operatorDest;
-                if (ExtractDestination(dmn->pdmnState->scriptOperatorPayout, operatorDest)) {
-                    std::string operatorDestString = EncodeDestination(operatorDest);
-                    operatorRewardStr += tr("to %1").arg(QString::fromStdString(operatorDestString));
-                } else {
-                    operatorRewardStr += tr("to UNKNOWN");
-                }
+        return;
+    }
+
+    auto it = mapProTxHashItemsDIP3.find(proTxHash);
+    if (it == mapProTxHashItemsDIP3.end()) {
+        return;
+    }
+    QTableWidgetItem* nextPaymentItem = ui->tableWidgetMasternodesDIP3->item(it->second->row(), 5);
+    auto itPayment = nextPayments.find(proTxHash);
+    if (nextPaymentItem) {
+        nextPaymentItem->setText(itPayment != nextPayments.end() ? QString::number(itPayment->second) : tr("UNKNOWN"));
+    }
+}
+
+void MasternodeList::addDIP3Row(const CDeterministicMNList& mnList, const CDeterministicMNCPtr& dmn, const std::map<uint256, int>& nextPayments, const std::set<COutPoint>& setOutpts)
+{
+    if (walletModel && ui->checkBoxMyMasternodesOnly->isChecked()) {
+        bool fMyMasternode = setOutpts.count(dmn->collateralOutpoint) ||
+            walletModel->havePrivKey(dmn->pdmnState->keyIDOwner) ||
+            walletModel->havePrivKey(dmn->pdmnState->keyIDVoting) ||
+            walletModel->havePrivKey(dmn->pdmnState->scriptPayout) ||
+            walletModel->havePrivKey(dmn->pdmnState->scriptOperatorPayout);
+        if (!fMyMasternode) return;
+    }
+    // populate list
+    // Address, Protocol, Status, Active Seconds, Last Seen, Pub Key
+    auto nextPayment = nextPayments.find(dmn->proTxHash);
+    QTableWidgetItem* addressItem = new QTableWidgetItem(QString::fromStdString(dmn->pdmnState->addr.ToString()));
+    QTableWidgetItem* statusItem = new QTableWidgetItem(mnList.IsMNValid(dmn) ? tr("ENABLED") : (mnList.IsMNPoSeBanned(dmn) ? tr("POSE_BANNED") : tr("UNKNOWN")));
+    QTableWidgetItem* PoSeScoreItem = new QTableWidgetItem(QString::number(dmn->pdmnState->nPoSePenalty));
+    QTableWidgetItem* registeredItem = new QTableWidgetItem(QString::number(dmn->pdmnState->nRegisteredHeight));
+    QTableWidgetItem* lastPaidItem = new QTableWidgetItem(QString::number(dmn->pdmnState->nLastPaidHeight));
+    QTableWidgetItem* nextPaymentItem = new QTableWidgetItem(nextPayment != nextPayments.end() ? QString::number(nextPayment->second) : tr("UNKNOWN"));
+
+    CTxDestination payeeDest;
+    QString payeeStr;
+    if (ExtractDestination(dmn->pdmnState->scriptPayout, payeeDest)) {
+        std::string payeeString = EncodeDestination(payeeDest);
+        payeeStr = QString::fromStdString(payeeString);
+    } else {
+        payeeStr = tr("UNKNOWN");
+    }
+    QTableWidgetItem* payeeItem = new QTableWidgetItem(payeeStr);
+
+    QString operatorRewardStr;
+    if (dmn->nOperatorReward) {
+        operatorRewardStr += QString::number(dmn->nOperatorReward / 100.0, 'f', 2) + "% ";
+
+        if (dmn->pdmnState->scriptOperatorPayout != CScript()) {
+            CTxDestination operatorDest;
+            if (ExtractDestination(dmn->pdmnState->scriptOperatorPayout, operatorDest)) {
+                std::string operatorDestString = EncodeDestination(operatorDest);
+                operatorRewardStr += tr("to %1").arg(QString::fromStdString(operatorDestString));
             } else {
-                operatorRewardStr += tr("but not claimed");
+                operatorRewardStr += tr("to UNKNOWN");
             }
         } else {
-            operatorRewardStr = tr("NONE");
+            operatorRewardStr += tr("but not claimed");
         }
-        QTableWidgetItem* operatorRewardItem = new QTableWidgetItem(operatorRewardStr);
-        QTableWidgetItem* proTxHashItem = new QTableWidgetItem(QString::fromStdString(dmn->proTxHash.ToString()));
-
-        if (strCurrentFilterDIP3 != "") {
-            strToFilter = addressItem->text() + " " +
-                          statusItem->text() + " " +
-                          PoSeScoreItem->text() + " " +
-                          registeredItem->text() + " " +
-                          lastPaidItem->text() + " " +
-                          nextPaymentItem->text() + " " +
-                          payeeItem->text() + " " +
-                          operatorRewardItem->text() + " " +
-                          proTxHashItem->text();
-            if (!strToFilter.contains(strCurrentFilterDIP3)) return;
+    } else {
+        operatorRewardStr = tr("NONE");
+    }
+    QTableWidgetItem* operatorRewardItem = new QTableWidgetItem(operatorRewardStr);
+    QTableWidgetItem* proTxHashItem = new QTableWidgetItem(QString::fromStdString(dmn->proTxHash.ToString()));
+
+    if (strCurrentFilterDIP3 != "") {
+        QString strToFilter = addressItem->text() + " " +
+                              statusItem->text() + " " +
+                              PoSeScoreItem->text() + " " +
+                              registeredItem->text() + " " +
+                              lastPaidItem->text() + " " +
+                              nextPaymentItem->text() + " " +
+                              payeeItem->text() + " " +
+                              operatorRewardItem->text() + " " +
+                              proTxHashItem->text();
+        if (!strToFilter.contains(strCurrentFilterDIP3)) {
+            delete addressItem;
+            delete statusItem;
+            delete PoSeScoreItem;
+            delete registeredItem;
+            delete lastPaidItem;
+            delete nextPaymentItem;
+            delete payeeItem;
+            delete operatorRewardItem;
+            delete proTxHashItem;
+            return;
         }
+    }
 
-        ui->tableWidgetMasternodesDIP3->insertRow(0);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 0, addressItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 1, statusItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 2, PoSeScoreItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 3, registeredItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 4, lastPaidItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 5, nextPaymentItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 6, payeeItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 7, operatorRewardItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 8, proTxHashItem);
-    });
-
-    ui->countLabelDIP3->setText(QString::number(ui->tableWidgetMasternodesDIP3->rowCount()));
-    ui->tableWidgetMasternodesDIP3->setSortingEnabled(true);
+    ui->tableWidgetMasternodesDIP3->insertRow(0);
+    ui->tableWidgetMasternodesDIP3->setItem(0, 0, addressItem);
+    ui->tableWidgetMasternodesDIP3->setItem(0, 1, statusItem);
+    ui->tableWidgetMasternodesDIP3->setItem(0, 2, PoSeScoreItem);
+    ui->tableWidgetMasternodesDIP3->setItem(0, 3, registeredItem);
+    ui->tableWidgetMasternodesDIP3->setItem(0, 4, lastPaidItem);
+    ui->tableWidgetMasternodesDIP3->setItem(0, 5, nextPaymentItem);
+    ui->tableWidgetMasternodesDIP3->setItem(0, 6, payeeItem);
+    ui->tableWidgetMasternodesDIP3->setItem(0, 7, operatorRewardItem);
+    ui->tableWidgetMasternodesDIP3->setItem(0, 8, proTxHashItem);
+    mapProTxHashItemsDIP3[dmn->proTxHash] = proTxHashItem;
 }
 
 void MasternodeList::on_filterLineEditDIP3_textChanged(const QString& strFilterIn)
@@ -25,6 +25,7 @@ class WalletModel;
 
 QT_BEGIN_NAMESPACE
 class QModelIndex;
+class QTableWidgetItem;
 QT_END_NAMESPACE
 
 /** Masternode Manager page widget */
@@ -57,9 +58,21 @@ private:
 
     bool mnListChanged;
 
+    // The list currently shown in tableWidgetMasternodesDIP3, the hidden proTxHash item of each shown row and the
+    // next payments shown for that list
+    CDeterministicMNList mnListDIP3;
+    std::map<uint256, QTableWidgetItem*> mapProTxHashItemsDIP3;
+    std::map<uint256, int> mapNextPaymentsDIP3;
+
     CDeterministicMNCPtr GetSelectedDIP3MN();
 
     void updateDIP3List();
+    void applyDIP3ListChanges();
+    void addDIP3Row(const CDeterministicMNList& mnList, const CDeterministicMNCPtr& dmn, const std::map<uint256, int>& nextPayments, const std::set<COutPoint>& setOutpts);
+    void removeDIP3Row(const uint256& proTxHash);
+    void updateDIP3NextPayment(const CDeterministicMNList& mnList, const uint256& proTxHash, const std::map<uint256, int>& nextPayments, const std::set<COutPoint>& setOutpts);
+    std::map<uint256, int> getDIP3NextPayments(const CDeterministicMNList& mnList);
+    std::set<COutPoint> getDIP3MyOutpoints();
 
 Q_SIGNALS:
     void doubleClicked(const QModelIndex&);
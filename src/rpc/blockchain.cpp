@@ -15,6 +15,7 @@
 #include <core_io.h>
 #include <hash.h>
 #include <index/blockfilterindex.h>
+#include <index/timestampindex.h>
 #include <llmq/quorums_chainlocks.h>
 #include <llmq/quorums_instantsend.h>
 #include <policy/feerate.h>
@@ -177,10 +178,12 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIn
     if (pnext)
         result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
 
-    result.pushKV("mint", ValueFromAmount(blockindex->nMint));
-    result.pushKV("moneysupply",ValueFromAmount(blockindex->nMoneySupply));
+    // The cold fields may be released by a flush, so copy them while holding cs_main
+    const CBlockIndexPoSData posData = WITH_LOCK(cs_main, return blockindex->GetPoSData());
+    result.pushKV("mint", ValueFromAmount(posData.nMint));
+    result.pushKV("moneysupply",ValueFromAmount(posData.nMoneySupply));
     result.pushKV("flags", strprintf("%s%s", blockindex->IsProofOfStake() ? "proof-of-stake" : "proof-of-work", blockindex->GeneratedStakeModifier() ? " stake-modifier": ""));
-    result.pushKV("proofhash", blockindex->IsProofOfStake() ? blockindex->hashProofOfStake.GetHex() : blockindex->GetBlockHash().GetHex());
+    result.pushKV("proofhash", blockindex->IsProofOfStake() ? posData.hashProofOfStake.GetHex() : blockindex->GetBlockHash().GetHex());
     result.pushKV("entropybit", (int)blockindex->GetStakeEntropyBit());
     result.pushKV("modifier", strprintf("%016llx", blockindex->nStakeModifier));
     result.pushKV("modifierchecksum", strprintf("%08x", blockindex->nStakeModifierChecksum));
@@ -2343,6 +2346,52 @@ static UniValue getblockfilter(const JSONRPCRequest& request)
     return ret;
 }
 
+static UniValue getblockhashes(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getblockhashes",
+                "\nReturns the hashes of the active chain blocks with a timestamp in the given range, ordered by timestamp.\n"
+                "Requires -timestampindex.\n",
+                {
+                    {"high", RPCArg::Type::NUM, RPCArg::Optional::NO, "The newer block timestamp"},
+                    {"low", RPCArg::Type::NUM, RPCArg::Optional::NO, "The older block timestamp"},
+                },
+                RPCResult{
+            "[\n"
+            "  \"hash\"         (string) The block hash\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getblockhashes", "1231614698 1231024505")
+            + HelpExampleRpc("getblockhashes", "1231614698, 1231024505")
+                },
+            }.Check(request);
+
+    int64_t high = request.params[0].get_int64();
+    int64_t low = request.params[1].get_int64();
+    if (low < 0 || high < low || high > std::numeric_limits<uint32_t>::max()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid timestamp range");
+    }
+
+    if (!g_timestampindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Timestamp index not enabled, start with -timestampindex");
+    }
+    if (!g_timestampindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Timestamp index is still in the process of being synced");
+    }
+
+    std::vector<uint256> hashes;
+    if (!g_timestampindex->FindBlockHashes(high, low, hashes)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read the timestamp index");
+    }
+
+    UniValue result(UniValue::VARR);
+    for (const uint256& hash : hashes) {
+        result.push_back(hash.GetHex());
+    }
+    return result;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -2354,6 +2403,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockcount",          &getblockcount,          {} },
     { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"} },
     { "blockchain",         "getblockhash",           &getblockhash,           {"height"} },
+    { "blockchain",         "getblockhashes",         &getblockhashes,         {"high","low"} },
     { "blockchain",         "getblockheader",         &getblockheader,         {"blockhash","verbose"} },
     { "blockchain",         "getchaintips",           &getchaintips,           {} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          {} },
@@ -57,6 +57,14 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getbalance", 2, "include_watchonly" },
     { "getbalance", 3, "avoid_reuse" },
     { "getblockhash", 0, "height" },
+    { "getblockhashes", 0, "high" },
+    { "getblockhashes", 1, "low" },
+    { "getaddressbalance", 0, "addresses" },
+    { "getaddressdeltas", 0, "addresses" },
+    { "getaddressdeltas", 1, "start" },
+    { "getaddressdeltas", 2, "end" },
+    { "getaddressutxos", 0, "addresses" },
+    { "getspentinfo", 1, "index" },
     { "waitforblockheight", 0, "height" },
     { "waitforblockheight", 1, "timeout" },
     { "waitforblock", 1, "timeout" },
@@ -180,7 +188,11 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "createwallet", 2, "blank"},
     { "createwallet", 4, "avoid_reuse"},
     { "getnodeaddresses", 0, "count"},
+    { "getpeermessagecosts", 0, "nodeid" },
     { "spork", 1, "value" },
+    { "masternodelist", 2, "sinceheight" },
+    { "masternodelist", 3, "start" },
+    { "masternodelist", 4, "count" },
     { "getsuperblockbudget", 0, "index"},
     { "stop", 0, "wait" },
     { "setstakesplitthreshold", 0, "value" },
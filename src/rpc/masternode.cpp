@@ -34,12 +34,20 @@ UniValue masternodelist(const JSONRPCRequest& request);
 void masternode_list_help()
 {
     throw std::runtime_error(
-        "masternode list ( \"mode\" \"filter\" )\n"
+        "masternode list ( \"mode\" \"filter\" sinceheight start count )\n"
         "Get a list of masternodes in different modes. This call is identical to masternodelist call.\n"
         "\nArguments:\n"
         "1. \"mode\"      (string, optional/required to use filter, defaults = json) The mode to run list in\n"
         "2. \"filter\"    (string, optional) Filter results. Partial match by outpoint by default in all modes,\n"
         "                                    additional matches in some modes are also available\n"
+        "3. sinceheight   (numeric, optional) Only return masternodes which changed after this block height.\n"
+        "                                    The result is then wrapped into an object with \"height\" (use it as\n"
+        "                                    sinceheight for the next call), \"full\" (true if the height was too far\n"
+        "                                    back and the full list is returned), \"masternodes\" and \"removed\"\n"
+        "                                    (collateral outpoints of removed masternodes). Use -1 to get the full list\n"
+        "                                    in this format.\n"
+        "4. start         (numeric, optional, default=0) Skip this many matching masternodes, ordered by proTxHash\n"
+        "5. count         (numeric, optional, default=all) Return at most this many masternodes\n"
         "\nAvailable modes:\n"
         "  addr           - Print ip address associated with a masternode (can be additionally filtered, partial match)\n"
         "  full           - Print info in format 'status payee lastpaidtime lastpaidblock IP'\n"
@@ -359,9 +367,19 @@ UniValue masternodelist(const JSONRPCRequest& request)
 {
     std::string strMode = "json";
     std::string strFilter = "";
+    bool fChanges = false;
+    int nSinceHeight = -1;
+    int nStart = 0;
+    int nCount = -1;
 
     if (request.params.size() >= 1) strMode = request.params[0].get_str();
-    if (request.params.size() == 2) strFilter = request.params[1].get_str();
+    if (request.params.size() >= 2) strFilter = request.params[1].get_str();
+    if (request.params.size() >= 3) {
+        fChanges = true;
+        nSinceHeight = request.params[2].get_int();
+    }
+    if (request.params.size() >= 4) nStart = request.params[3].get_int();
+    if (request.params.size() >= 5) nCount = request.params[4].get_int();
 
     std::transform(strMode.begin(), strMode.end(), strMode.begin(), ::tolower);
 
@@ -369,13 +387,50 @@ UniValue masternodelist(const JSONRPCRequest& request)
                              strMode != "owneraddress" && strMode != "votingaddress" &&
                              strMode != "lastpaidtime" && strMode != "lastpaidblock" &&
                              strMode != "payee" && strMode != "pubkeyoperator" &&
-                             strMode != "status")) {
+                             strMode != "status") || request.params.size() > 5) {
         masternode_list_help();
     }
 
+    if (nStart < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "start must be non-negative");
+    }
+
     UniValue obj(UniValue::VOBJ);
 
-    auto mnList = deterministicMNManager->GetListAtChainTip();
+    const CBlockIndex* pindexTip;
+    const CBlockIndex* pindexSince = nullptr;
+    {
+        LOCK(cs_main);
+        pindexTip = ChainActive().Tip();
+        if (nSinceHeight >= 0 && nSinceHeight <= ChainActive().Height()) {
+            pindexSince = ChainActive()[nSinceHeight];
+        }
+    }
+    if (!pindexTip) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "No blocks in chain");
+    }
+
+    // the list of pindexTip and the changes are taken from the same block so that the returned height can
+    // safely be used as the cursor for the next call
+    auto mnList = deterministicMNManager->GetListForBlock(pindexTip);
+    std::vector<CDeterministicMNCPtr> vecMNs;
+    std::vector<CDeterministicMNCPtr> vecRemovedMNs;
+    bool fFullList = !pindexSince || !deterministicMNManager->GetListChangesSince(pindexSince, pindexTip, vecMNs, vecRemovedMNs);
+    if (fFullList) {
+        vecMNs.clear();
+        vecRemovedMNs.clear();
+        vecMNs.reserve(mnList.GetAllMNsCount());
+        mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+            vecMNs.emplace_back(dmn);
+        });
+    }
+    if (nStart > 0 || nCount >= 0) {
+        // stable order for paging
+        std::sort(vecMNs.begin(), vecMNs.end(), [](const CDeterministicMNCPtr& a, const CDeterministicMNCPtr& b) {
+            return a->proTxHash < b->proTxHash;
+        });
+    }
+
     auto dmnToStatus = [&](const CDeterministicMNCPtr& dmn) {
         if (mnList.IsMNValid(dmn)) {
             return "ENABLED";
@@ -395,7 +450,14 @@ UniValue masternodelist(const JSONRPCRequest& request)
         return (int)pindex->nTime;
     };
 
-    mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+    int nMatched = 0;
+    auto pushMN = [&](const std::string& strOutpoint, const UniValue& value) {
+        if (nMatched++ < nStart) return;
+        obj.pushKV(strOutpoint, value);
+    };
+
+    for (const auto& dmn : vecMNs) {
+        if (nCount >= 0 && nMatched >= nStart + nCount) break;
         std::string strOutpoint = dmn->collateralOutpoint.ToStringShort();
         Coin coin;
         std::string collateralAddressStr = "UNKNOWN";
@@ -416,28 +478,28 @@ UniValue masternodelist(const JSONRPCRequest& request)
         if (strMode == "addr") {
             std::string strAddress = dmn->pdmnState->addr.ToString();
             if (strFilter != "" && strAddress.find(strFilter) == std::string::npos &&
-                strOutpoint.find(strFilter) == std::string::npos) return;
-            obj.pushKV(strOutpoint, strAddress);
+                strOutpoint.find(strFilter) == std::string::npos) continue;
+            pushMN(strOutpoint, strAddress);
         } else if (strMode == "full") {
             std::ostringstream streamFull;
             streamFull << std::setw(18) << dmnToStatus(dmn) << " " << payeeStr << " " << std::setw(10) << dmnToLastPaidTime(dmn) << " " << std::setw(6) << dmn->pdmnState->nLastPaidHeight << " " << dmn->pdmnState->addr.ToString();
             std::string strFull = streamFull.str();
             if (strFilter != "" && strFull.find(strFilter) == std::string::npos &&
-                strOutpoint.find(strFilter) == std::string::npos) return;
-            obj.pushKV(strOutpoint, strFull);
+                strOutpoint.find(strFilter) == std::string::npos) continue;
+            pushMN(strOutpoint, strFull);
         } else if (strMode == "info") {
             std::ostringstream streamInfo;
             streamInfo << std::setw(18) << dmnToStatus(dmn) << " " << payeeStr << " " << dmn->pdmnState->addr.ToString();
             std::string strInfo = streamInfo.str();
             if (strFilter != "" && strInfo.find(strFilter) == std::string::npos &&
-                strOutpoint.find(strFilter) == std::string::npos) return;
-            obj.pushKV(strOutpoint, strInfo);
+                strOutpoint.find(strFilter) == std::string::npos) continue;
+            pushMN(strOutpoint, strInfo);
         } else if (strMode == "json") {
             std::ostringstream streamInfo;
             streamInfo << dmn->proTxHash.ToString() << " " << dmn->pdmnState->addr.ToString() << " " << payeeStr << " " << dmnToStatus(dmn) << " " << dmnToLastPaidTime(dmn) << " " << dmn->pdmnState->nLastPaidHeight << " " << EncodeDestination(PKHash(dmn->pdmnState->keyIDOwner)) << " " << EncodeDestination(PKHash(dmn->pdmnState->keyIDVoting)) << " " << collateralAddressStr << " " << dmn->pdmnState->pubKeyOperator.Get().ToString();
             std::string strInfo = streamInfo.str();
             if (strFilter != "" && strInfo.find(strFilter) == std::string::npos &&
-                strOutpoint.find(strFilter) == std::string::npos) return;
+                strOutpoint.find(strFilter) == std::string::npos) continue;
             UniValue objMN(UniValue::VOBJ);
             objMN.pushKV("proTxHash", dmn->proTxHash.ToString());
             objMN.pushKV("address", dmn->pdmnState->addr.ToString());
@@ -449,35 +511,49 @@ UniValue masternodelist(const JSONRPCRequest& request)
             objMN.pushKV("votingaddress", EncodeDestination(PKHash(dmn->pdmnState->keyIDVoting)));
             objMN.pushKV("collateraladdress", collateralAddressStr);
             objMN.pushKV("pubkeyoperator", dmn->pdmnState->pubKeyOperator.Get().ToString());
-            obj.pushKV(strOutpoint, objMN);
+            pushMN(strOutpoint, objMN);
         } else if (strMode == "lastpaidblock") {
-            if (strFilter != "" && strOutpoint.find(strFilter) == std::string::npos) return;
-            obj.pushKV(strOutpoint, dmn->pdmnState->nLastPaidHeight);
+            if (strFilter != "" && strOutpoint.find(strFilter) == std::string::npos) continue;
+            pushMN(strOutpoint, dmn->pdmnState->nLastPaidHeight);
         } else if (strMode == "lastpaidtime") {
-            if (strFilter != "" && strOutpoint.find(strFilter) == std::string::npos) return;
-            obj.pushKV(strOutpoint, dmnToLastPaidTime(dmn));
+            if (strFilter != "" && strOutpoint.find(strFilter) == std::string::npos) continue;
+            pushMN(strOutpoint, dmnToLastPaidTime(dmn));
         } else if (strMode == "payee") {
             if (strFilter != "" && payeeStr.find(strFilter) == std::string::npos &&
-                strOutpoint.find(strFilter) == std::string::npos) return;
-            obj.pushKV(strOutpoint, payeeStr);
+                strOutpoint.find(strFilter) == std::string::npos) continue;
+            pushMN(strOutpoint, payeeStr);
         } else if (strMode == "owneraddress") {
-            if (strFilter != "" && strOutpoint.find(strFilter) == std::string::npos) return;
-            obj.pushKV(strOutpoint, EncodeDestination(PKHash(dmn->pdmnState->keyIDOwner)));
+            if (strFilter != "" && strOutpoint.find(strFilter) == std::string::npos) continue;
+            pushMN(strOutpoint, EncodeDestination(PKHash(dmn->pdmnState->keyIDOwner)));
         } else if (strMode == "pubkeyoperator") {
-            if (strFilter != "" && strOutpoint.find(strFilter) == std::string::npos) return;
-            obj.pushKV(strOutpoint, dmn->pdmnState->pubKeyOperator.Get().ToString());
+            if (strFilter != "" && strOutpoint.find(strFilter) == std::string::npos) continue;
+            pushMN(strOutpoint, dmn->pdmnState->pubKeyOperator.Get().ToString());
         } else if (strMode == "status") {
             std::string strStatus = dmnToStatus(dmn);
             if (strFilter != "" && strStatus.find(strFilter) == std::string::npos &&
-                strOutpoint.find(strFilter) == std::string::npos) return;
-            obj.pushKV(strOutpoint, strStatus);
+                strOutpoint.find(strFilter) == std::string::npos) continue;
+            pushMN(strOutpoint, strStatus);
         } else if (strMode == "votingaddress") {
-            if (strFilter != "" && strOutpoint.find(strFilter) == std::string::npos) return;
-            obj.pushKV(strOutpoint, EncodeDestination(PKHash(dmn->pdmnState->keyIDVoting)));
+            if (strFilter != "" && strOutpoint.find(strFilter) == std::string::npos) continue;
+            pushMN(strOutpoint, EncodeDestination(PKHash(dmn->pdmnState->keyIDVoting)));
         }
-    });
+    }
 
-    return obj;
+    if (!fChanges) {
+        return obj;
+    }
+
+    UniValue removed(UniValue::VARR);
+    for (const auto& dmn : vecRemovedMNs) {
+        removed.push_back(dmn->collateralOutpoint.ToStringShort());
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("height", pindexTip->nHeight);
+    result.pushKV("full", fFullList);
+    result.pushKV("masternodes", obj);
+    result.pushKV("removed", removed);
+    return result;
 }
 
 static const CRPCCommand commands[] =
@@ -5,6 +5,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <crypto/ripemd160.h>
+#include <index/addressindex.h>
+#include <index/spentindex.h>
 #include <key_io.h>
 #include <httpserver.h>
 #include <outputtype.h>
@@ -13,9 +15,11 @@
 #include <rpc/util.h>
 #include <script/descriptor.h>
 #include <spork.h>
+#include <txmempool.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 #include <util/validation.h>
+#include <validation.h>
 
 #include <masternodes/sync.h>
 
@@ -678,6 +682,322 @@ static UniValue echo(const JSONRPCRequest& request)
     return request.params;
 }
 
+/** The scripts queried by one of the address index RPCs, with the address they were given as */
+struct AddressIndexScript
+{
+    std::string address;
+    CScript script;
+    uint256 script_hash;
+};
+
+static std::vector<AddressIndexScript> ParseAddressIndexScripts(const UniValue& param)
+{
+    std::vector<AddressIndexScript> scripts;
+    std::set<uint256> seen;
+    for (const UniValue& value : param.get_array().getValues()) {
+        const std::string& address = value.get_str();
+        CTxDestination dest = DecodeDestination(address);
+        if (!IsValidDestination(dest)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address: " + address);
+        }
+        CScript script = GetScriptForDestination(dest);
+        uint256 script_hash = GetAddressIndexScriptHash(script);
+        if (seen.insert(script_hash).second) {
+            scripts.push_back({address, script, script_hash});
+        }
+    }
+    return scripts;
+}
+
+static AddressIndex& EnsureSyncedAddressIndex()
+{
+    if (!g_addressindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled, start with -addressindex");
+    }
+    if (!g_addressindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is still in the process of being synced");
+    }
+    return *g_addressindex;
+}
+
+/** Collects the address index deltas of all mempool transactions paying to or spending from one of the scripts */
+static std::vector<std::pair<const AddressIndexScript*, CAddressIndexDelta>> GetMempoolAddressDeltas(const std::vector<AddressIndexScript>& scripts)
+{
+    std::map<uint256, const AddressIndexScript*> mapScripts;
+    for (const auto& script : scripts) {
+        mapScripts.emplace(script.script_hash, &script);
+    }
+
+    std::vector<std::pair<const AddressIndexScript*, CAddressIndexDelta>> deltas;
+    LOCK2(cs_main, mempool.cs);
+    CCoinsViewMemPool view_mempool(pcoinsTip.get(), mempool);
+    for (const CTxMemPoolEntry& entry : mempool.mapTx) {
+        const CTransaction& tx = entry.GetTx();
+        for (size_t j = 0; j < tx.vin.size(); j++) {
+            Coin coin;
+            if (!view_mempool.GetCoin(tx.vin[j].prevout, coin)) continue;
+            auto it = mapScripts.find(GetAddressIndexScriptHash(coin.out.scriptPubKey));
+            if (it == mapScripts.end()) continue;
+            deltas.emplace_back(it->second, CAddressIndexDelta{tx.GetHash(), (uint32_t)j, -1, true, -coin.out.nValue});
+        }
+        for (size_t j = 0; j < tx.vout.size(); j++) {
+            auto it = mapScripts.find(GetAddressIndexScriptHash(tx.vout[j].scriptPubKey));
+            if (it == mapScripts.end()) continue;
+            deltas.emplace_back(it->second, CAddressIndexDelta{tx.GetHash(), (uint32_t)j, -1, false, tx.vout[j].nValue});
+        }
+    }
+    return deltas;
+}
+
+static UniValue getaddressbalance(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getaddressbalance",
+                "\nReturns the balance of one or more addresses. Requires -addressindex.\n",
+                {
+                    {"addresses", RPCArg::Type::ARR, RPCArg::Optional::NO, "The addresses",
+                        {
+                            {"address", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "An address"},
+                        },
+                    },
+                },
+                RPCResult{
+            "{\n"
+            "  \"balance\" : n,      (numeric) The confirmed balance in satoshis\n"
+            "  \"received\" : n,     (numeric) The total number of satoshis received by the confirmed outputs, including change\n"
+            "  \"unconfirmed\" : n,  (numeric) The change of the balance by mempool transactions in satoshis\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddressbalance", "'[\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]'")
+            + HelpExampleRpc("getaddressbalance", "[\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]")
+                },
+            }.Check(request);
+
+    const std::vector<AddressIndexScript> scripts = ParseAddressIndexScripts(request.params[0]);
+    const AddressIndex& index = EnsureSyncedAddressIndex();
+
+    CAmount balance = 0;
+    CAmount received = 0;
+    for (const auto& script : scripts) {
+        std::vector<CAddressIndexDelta> deltas;
+        if (!index.FindDeltas(script.script_hash, 0, -1, deltas)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read the address index");
+        }
+        for (const auto& delta : deltas) {
+            balance += delta.nAmount;
+            if (!delta.fSpending) received += delta.nAmount;
+        }
+    }
+
+    CAmount unconfirmed = 0;
+    for (const auto& item : GetMempoolAddressDeltas(scripts)) {
+        unconfirmed += item.second.nAmount;
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("balance", balance);
+    result.pushKV("received", received);
+    result.pushKV("unconfirmed", unconfirmed);
+    return result;
+}
+
+static UniValue getaddressutxos(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getaddressutxos",
+                "\nReturns the unspent outputs of one or more addresses, with the mempool applied: outputs spent\n"
+                "by mempool transactions are left out and unspent outputs of mempool transactions are included.\n"
+                "Requires -addressindex.\n",
+                {
+                    {"addresses", RPCArg::Type::ARR, RPCArg::Optional::NO, "The addresses",
+                        {
+                            {"address", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "An address"},
+                        },
+                    },
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"address\" : \"address\",  (string) The address\n"
+            "    \"txid\" : \"hash\",        (string) The output txid\n"
+            "    \"outputIndex\" : n,      (numeric) The output index\n"
+            "    \"script\" : \"hex\",       (string) The script hex-encoded\n"
+            "    \"satoshis\" : n,         (numeric) The amount of the output in satoshis\n"
+            "    \"height\" : n            (numeric) The height of the block containing the output, -1 for mempool outputs\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddressutxos", "'[\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]'")
+            + HelpExampleRpc("getaddressutxos", "[\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]")
+                },
+            }.Check(request);
+
+    const std::vector<AddressIndexScript> scripts = ParseAddressIndexScripts(request.params[0]);
+    const AddressIndex& index = EnsureSyncedAddressIndex();
+
+    auto pushUtxo = [](UniValue& result, const AddressIndexScript& script, const COutPoint& outpoint, CAmount amount, int height) {
+        UniValue output(UniValue::VOBJ);
+        output.pushKV("address", script.address);
+        output.pushKV("txid", outpoint.hash.GetHex());
+        output.pushKV("outputIndex", (int)outpoint.n);
+        output.pushKV("script", HexStr(script.script.begin(), script.script.end()));
+        output.pushKV("satoshis", amount);
+        output.pushKV("height", height);
+        result.push_back(output);
+    };
+
+    UniValue result(UniValue::VARR);
+    for (const auto& script : scripts) {
+        std::vector<CAddressUnspent> unspent;
+        if (!index.FindUnspent(script.script_hash, unspent)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read the address index");
+        }
+        std::sort(unspent.begin(), unspent.end(), [](const CAddressUnspent& a, const CAddressUnspent& b) {
+            return a.nHeight < b.nHeight;
+        });
+        for (const auto& utxo : unspent) {
+            if (mempool.isSpent(utxo.outpoint)) continue;
+            pushUtxo(result, script, utxo.outpoint, utxo.nAmount, utxo.nHeight);
+        }
+    }
+    for (const auto& item : GetMempoolAddressDeltas(scripts)) {
+        const CAddressIndexDelta& delta = item.second;
+        if (delta.fSpending) continue;
+        const COutPoint outpoint(delta.txid, delta.index);
+        if (mempool.isSpent(outpoint)) continue;
+        pushUtxo(result, *item.first, outpoint, delta.nAmount, delta.nHeight);
+    }
+    return result;
+}
+
+static UniValue getaddressdeltas(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getaddressdeltas",
+                "\nReturns all changes to the balance of one or more addresses. Requires -addressindex.\n",
+                {
+                    {"addresses", RPCArg::Type::ARR, RPCArg::Optional::NO, "The addresses",
+                        {
+                            {"address", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "An address"},
+                        },
+                    },
+                    {"start", RPCArg::Type::NUM, /* default */ "0", "The first block height to return deltas for"},
+                    {"end", RPCArg::Type::NUM, /* default */ "no limit", "The last block height to return deltas for. If omitted, the deltas of mempool transactions are included as well"},
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"address\" : \"address\",  (string) The address\n"
+            "    \"txid\" : \"hash\",        (string) The txid\n"
+            "    \"index\" : n,            (numeric) The input or output index\n"
+            "    \"spending\" : true|false,(boolean) Whether this is an input spending from the address\n"
+            "    \"satoshis\" : n,         (numeric) The change of the balance in satoshis\n"
+            "    \"height\" : n            (numeric) The block height, -1 for mempool transactions\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddressdeltas", "'[\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]' 1000 2000")
+            + HelpExampleRpc("getaddressdeltas", "[\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"], 1000, 2000")
+                },
+            }.Check(request);
+
+    const std::vector<AddressIndexScript> scripts = ParseAddressIndexScripts(request.params[0]);
+    int start = request.params[1].isNull() ? 0 : request.params[1].get_int();
+    int end = request.params[2].isNull() ? -1 : request.params[2].get_int();
+    if (start < 0 || (end >= 0 && end < start)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid height range");
+    }
+    const AddressIndex& index = EnsureSyncedAddressIndex();
+
+    auto pushDelta = [](UniValue& result, const AddressIndexScript& script, const CAddressIndexDelta& delta) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("address", script.address);
+        entry.pushKV("txid", delta.txid.GetHex());
+        entry.pushKV("index", (int)delta.index);
+        entry.pushKV("spending", delta.fSpending);
+        entry.pushKV("satoshis", delta.nAmount);
+        entry.pushKV("height", delta.nHeight);
+        result.push_back(entry);
+    };
+
+    UniValue result(UniValue::VARR);
+    for (const auto& script : scripts) {
+        std::vector<CAddressIndexDelta> deltas;
+        if (!index.FindDeltas(script.script_hash, start, end, deltas)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read the address index");
+        }
+        for (const auto& delta : deltas) {
+            pushDelta(result, script, delta);
+        }
+    }
+    if (end < 0) {
+        for (const auto& item : GetMempoolAddressDeltas(scripts)) {
+            pushDelta(result, *item.first, item.second);
+        }
+    }
+    return result;
+}
+
+static UniValue getspentinfo(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getspentinfo",
+                "\nReturns the input spending an output, also looking at mempool transactions. Requires -spentindex.\n",
+                {
+                    {"txid", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The hash of the transaction containing the output"},
+                    {"index", RPCArg::Type::NUM, RPCArg::Optional::NO, "The output index"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"txid\" : \"hash\",  (string) The hash of the spending transaction\n"
+            "  \"index\" : n,      (numeric) The input index in the spending transaction\n"
+            "  \"height\" : n      (numeric) The height of the block containing the spending transaction, -1 for the mempool\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getspentinfo", "\"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\" 0")
+            + HelpExampleRpc("getspentinfo", "\"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\", 0")
+                },
+            }.Check(request);
+
+    const COutPoint outpoint(ParseHashV(request.params[0], "txid"), request.params[1].get_int());
+
+    if (!g_spentindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index not enabled, start with -spentindex");
+    }
+
+    CSpentIndexValue value;
+    bool found = false;
+    {
+        LOCK(mempool.cs);
+        const CTransaction* spender = mempool.GetConflictTx(outpoint);
+        if (spender) {
+            for (size_t j = 0; j < spender->vin.size(); j++) {
+                if (spender->vin[j].prevout == outpoint) {
+                    value = CSpentIndexValue{spender->GetHash(), (uint32_t)j, -1};
+                    found = true;
+                    break;
+                }
+            }
+        }
+    }
+    if (!found) {
+        if (!g_spentindex->BlockUntilSyncedToCurrentChain()) {
+            throw JSONRPCError(RPC_MISC_ERROR, "Spent index is still in the process of being synced");
+        }
+        if (!g_spentindex->FindSpent(outpoint, value)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
+        }
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("txid", value.txid.GetHex());
+    result.pushKV("index", (int)value.index);
+    result.pushKV("height", value.nHeight);
+    return result;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -691,6 +1011,12 @@ static const CRPCCommand commands[] =
     { "util",               "verifymessage",          &verifymessage,          {"address","signature","message"} },
     { "util",               "signmessagewithprivkey", &signmessagewithprivkey, {"privkey","message"} },
 
+    /* Address index */
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      {"addresses"} },
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       {"addresses","start","end"} },
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        {"addresses"} },
+    { "addressindex",       "getspentinfo",           &getspentinfo,           {"txid","index"} },
+
     /* EMRALS features */
     { "emrals",           "mnsync",                 &mnsync,                 {} },
     { "emrals",           "spork",                  &spork,                  {"mode"} },
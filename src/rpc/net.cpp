@@ -106,6 +106,8 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
             "    ],\n"
             "    \"whitelisted\": true|false, (boolean) Whether the peer is whitelisted\n"
             "    \"minfeefilter\": n,         (numeric) The minimum fee rate for transactions this peer accepts\n"
+            "    \"cpubudget\": n,            (numeric) The CPU time in milliseconds the peer may still use for its messages, negative while it is deprioritized\n"
+            "    \"cpubudgetexceeded\": n,    (numeric) How often the peer used up its CPU budget\n"
             "    \"bytessent_per_msg\": {\n"
             "       \"msg\": n,               (numeric) The total bytes sent aggregated by message type\n"
             "                               When a message type is not listed in this json object, the bytes sent are 0.\n"
@@ -180,6 +182,8 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
         }
         obj.pushKV("whitelisted", stats.fWhitelisted);
         obj.pushKV("minfeefilter", ValueFromAmount(stats.minFeeFilter));
+        obj.pushKV("cpubudget", stats.nCpuBudget / 1000.0);
+        obj.pushKV("cpubudgetexceeded", stats.nCpuBudgetExceeded);
 
         UniValue sendPerMsgCmd(UniValue::VOBJ);
         for (const auto& i : stats.mapSendBytesPerMsgCmd) {
@@ -465,6 +469,17 @@ static UniValue getnetworkinfo(const JSONRPCRequest& request)
             "  }\n"
             "  ,...\n"
             "  ]\n"
+            "  \"messagelanes\": [                      (array) message processing queues, in the order they are drained\n"
+            "  {\n"
+            "    \"name\": \"xxx\",                     (string) lane name (priority, default or bulk)\n"
+            "    \"queued\": xxx,                       (numeric) messages currently waiting in this lane\n"
+            "    \"processed\": xxx,                    (numeric) messages taken from this lane since startup\n"
+            "    \"avglatency\": xxx,                   (numeric) average time in milliseconds messages waited in this lane\n"
+            "    \"recentlatency\": xxx,                (numeric) same as avglatency, but weighted towards recent messages\n"
+            "    \"maxlatency\": xxx                    (numeric) longest time in milliseconds a message waited in this lane\n"
+            "  }\n"
+            "  ,...\n"
+            "  ]\n"
             "  \"warnings\": \"...\"                    (string) any network and blockchain warnings\n"
             "}\n"
                 },
@@ -503,6 +518,20 @@ static UniValue getnetworkinfo(const JSONRPCRequest& request)
         }
     }
     obj.pushKV("localaddresses", localAddresses);
+    if (g_connman) {
+        UniValue messageLanes(UniValue::VARR);
+        for (const auto& stats : g_connman->GetMessageLaneStats()) {
+            UniValue rec(UniValue::VOBJ);
+            rec.pushKV("name", GetMessageLaneName(stats.lane));
+            rec.pushKV("queued", stats.nQueued);
+            rec.pushKV("processed", stats.nProcessed);
+            rec.pushKV("avglatency", stats.nAvgLatency / 1000.0);
+            rec.pushKV("recentlatency", stats.nRecentLatency / 1000.0);
+            rec.pushKV("maxlatency", stats.nMaxLatency / 1000.0);
+            messageLanes.push_back(rec);
+        }
+        obj.pushKV("messagelanes", messageLanes);
+    }
     obj.pushKV("warnings",       GetWarnings("statusbar"));
     return obj;
 }
@@ -713,6 +742,102 @@ static UniValue getnodeaddresses(const JSONRPCRequest& request)
     return ret;
 }
 
+static UniValue getpeermessagecosts(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getpeermessagecosts",
+                "\nReturns how much CPU time, queueing delay and bandwidth the messages received from each peer cost,\n"
+                "aggregated by message type. Peers are sorted by the CPU time they used, most expensive first.\n"
+                "CPU time includes the preprocessing by message workers and all LLMQ, governance and masternode handlers.\n",
+                {
+                    {"nodeid", RPCArg::Type::NUM, /* default */ "all peers", "Only return the costs of the peer with this id (see getpeerinfo for nodeids)"},
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"id\": n,                   (numeric) Peer index\n"
+            "    \"addr\":\"host:port\",      (string) The IP address and port of the peer\n"
+            "    \"inbound\": true|false,     (boolean) Inbound (true) or Outbound (false)\n"
+            "    \"cputime\": n,              (numeric) Total CPU time in milliseconds used for the messages of this peer\n"
+            "    \"cpubudget\": n,            (numeric) The CPU time in milliseconds the peer may still use for its messages, negative while it is deprioritized\n"
+            "    \"cpubudgetexceeded\": n,    (numeric) How often the peer used up its CPU budget\n"
+            "    \"costs_per_msg\": {\n"
+            "       \"msg\": {                (object) The costs of a message type, only message types which were received are listed\n"
+            "         \"count\": n,           (numeric) Number of messages processed\n"
+            "         \"bytes\": n,           (numeric) Total size of these messages including headers\n"
+            "         \"cputime\": n,         (numeric) Total CPU time in milliseconds\n"
+            "         \"maxcputime\": n,      (numeric) CPU time in milliseconds of the most expensive message\n"
+            "         \"waittime\": n         (numeric) Total time in milliseconds the messages waited to be processed\n"
+            "       },\n"
+            "       ...\n"
+            "    }\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getpeermessagecosts", "")
+            + HelpExampleCli("getpeermessagecosts", "23")
+            + HelpExampleRpc("getpeermessagecosts", "23")
+                },
+            }.Check(request);
+
+    if (!g_connman) {
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+    }
+
+    std::vector<CNodeStats> vstats;
+    g_connman->GetNodeStats(vstats);
+    if (!request.params[0].isNull()) {
+        NodeId nodeid = (NodeId)request.params[0].get_int64();
+        vstats.erase(std::remove_if(vstats.begin(), vstats.end(), [&](const CNodeStats& stats) {
+            return stats.nodeid != nodeid;
+        }), vstats.end());
+        if (vstats.empty()) {
+            throw JSONRPCError(RPC_CLIENT_NODE_NOT_CONNECTED, "Node not found in connected nodes");
+        }
+    }
+
+    std::vector<std::pair<int64_t, UniValue>> vecPeers;
+    vecPeers.reserve(vstats.size());
+    for (const CNodeStats& stats : vstats) {
+        int64_t nCpuTime = 0;
+        UniValue costPerMsgCmd(UniValue::VOBJ);
+        for (const auto& p : stats.mapRecvCostPerMsgCmd) {
+            const MessageCost& cost = p.second;
+            if (cost.nCount == 0) {
+                continue;
+            }
+            nCpuTime += cost.nCpuTime;
+            UniValue costObj(UniValue::VOBJ);
+            costObj.pushKV("count", cost.nCount);
+            costObj.pushKV("bytes", cost.nBytes);
+            costObj.pushKV("cputime", cost.nCpuTime / 1000.0);
+            costObj.pushKV("maxcputime", cost.nMaxCpuTime / 1000.0);
+            costObj.pushKV("waittime", cost.nWaitTime / 1000.0);
+            costPerMsgCmd.pushKV(p.first, costObj);
+        }
+
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("id", stats.nodeid);
+        obj.pushKV("addr", stats.addrName);
+        obj.pushKV("inbound", stats.fInbound);
+        obj.pushKV("cputime", nCpuTime / 1000.0);
+        obj.pushKV("cpubudget", stats.nCpuBudget / 1000.0);
+        obj.pushKV("cpubudgetexceeded", stats.nCpuBudgetExceeded);
+        obj.pushKV("costs_per_msg", costPerMsgCmd);
+        vecPeers.emplace_back(nCpuTime, std::move(obj));
+    }
+    std::stable_sort(vecPeers.begin(), vecPeers.end(), [](const std::pair<int64_t, UniValue>& a, const std::pair<int64_t, UniValue>& b) {
+        return a.first > b.first;
+    });
+
+    UniValue ret(UniValue::VARR);
+    for (auto& p : vecPeers) {
+        ret.push_back(p.second);
+    }
+    return ret;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -730,6 +855,7 @@ static const CRPCCommand commands[] =
     { "network",            "clearbanned",            &clearbanned,            {} },
     { "network",            "setnetworkactive",       &setnetworkactive,       {"state"} },
     { "network",            "getnodeaddresses",       &getnodeaddresses,       {"count"} },
+    { "network",            "getpeermessagecosts",    &getpeermessagecosts,    {"nodeid"} },
 };
 // clang-format on
 
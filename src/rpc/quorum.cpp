@@ -5,6 +5,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <net.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <validation.h>
@@ -154,7 +155,8 @@ void quorum_dkgstatus_help()
     throw std::runtime_error(
         RPCHelpMan{"quorum dkgstatus",
             "\nReturn the status of the current DKG process.\n"
-            "Works only when SPORK_3_QUORUM_DKG_ENABLED spork is ON.\n",
+            "Works only when SPORK_3_QUORUM_DKG_ENABLED spork is ON.\n"
+            "Also reports the connections to quorum members under \"connectionPool\" (setup times in milliseconds).\n",
             {
                 {"detail_level", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "Detail level of output.\n"
                     "                        0=Only show counts. 1=Show member indexes. 2=Show member's ProTxHashes."}
@@ -200,6 +202,21 @@ UniValue quorum_dkgstatus(const JSONRPCRequest& request)
 
     ret.pushKV("minableCommitments", minableCommitments);
 
+    if (g_connman) {
+        auto stats = g_connman->GetQuorumConnectionStats();
+        UniValue pool(UniValue::VOBJ);
+        pool.pushKV("wanted", (int64_t)stats.nWanted);
+        pool.pushKV("connected", (int64_t)stats.nConnected);
+        pool.pushKV("attempts", stats.nAttempts);
+        pool.pushKV("failures", stats.nFailures);
+        pool.pushKV("authenticated", stats.nAuthenticated);
+        // connection setup times in milliseconds, measured until the masternode authenticated itself
+        pool.pushKV("avgsetuptime", stats.nAvgSetupTime / 1000.0);
+        pool.pushKV("lastsetuptime", stats.nLastSetupTime / 1000.0);
+        pool.pushKV("maxsetuptime", stats.nMaxSetupTime / 1000.0);
+        ret.pushKV("connectionPool", pool);
+    }
+
     return ret;
 }
 
@@ -376,6 +393,43 @@ UniValue quorum_sigs_cmd(const JSONRPCRequest& request)
     }
 }
 
+void quorum_commitmentcache_help()
+{
+    throw std::runtime_error(
+        RPCHelpMan{"quorum commitmentcache",
+            "\nReturns how often the signatures of a commitment in a connected block were already verified.\n",
+            {},
+            RPCResult{
+                "{\n"
+                "  \"hits\" : n,         (numeric) Commitments found in the verified commitment cache\n"
+                "  \"misses\" : n,       (numeric) Commitments whose signatures had to be verified\n"
+                "  \"hitrate\" : x.xxx,  (numeric) Share of the commitments found in the cache\n"
+                "}\n"
+            },
+            RPCExamples{
+                HelpExampleCli("quorum", "commitmentcache") +
+                HelpExampleRpc("quorum", "commitmentcache")
+            },
+        }.ToString()
+    );
+}
+
+UniValue quorum_commitmentcache(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1) {
+        quorum_commitmentcache_help();
+    }
+
+    uint64_t nHits, nMisses;
+    llmq::quorumBlockProcessor->GetVerifiedCommitmentsStats(nHits, nMisses);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("hits", nHits);
+    ret.pushKV("misses", nMisses);
+    ret.pushKV("hitrate", nHits + nMisses ? (double)nHits / (nHits + nMisses) : 0.0);
+    return ret;
+}
+
 void quorum_dkgsimerror_help()
 {
     throw std::runtime_error(
@@ -430,6 +484,7 @@ UniValue quorum_dkgsimerror(const JSONRPCRequest& request)
                 "  hasrecsig         - Test if a valid recovered signature is present\n"
                 "  getrecsig         - Get a recovered signature\n"
                 "  isconflicting     - Test if a conflict exists\n"
+                "  commitmentcache   - Return the hit rate of the verified commitment cache\n"
             },
             RPCExamples{""},
         }.ToString()
@@ -457,6 +512,8 @@ UniValue quorum(const JSONRPCRequest& request)
         return quorum_memberof(request);
     } else if (command == "sign" || command == "hasrecsig" || command == "getrecsig" || command == "isconflicting") {
         return quorum_sigs_cmd(request);
+    } else if (command == "commitmentcache") {
+        return quorum_commitmentcache(request);
     } else if (command == "dkgsimerror") {
         return quorum_dkgsimerror(request);
     } else {
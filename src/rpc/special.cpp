@@ -946,10 +946,10 @@ UniValue BuildDMNListEntry(CWallet* pwallet, const CDeterministicMNCPtr& dmn, bo
     bool hasVotingKey = CheckWalletOwnsKey(pwallet, dmn->pdmnState->keyIDVoting);
 
     bool ownsCollateral = false;
-    CTransactionRef collateralTx;
+    CTxOut collateralOut;
     uint256 tmpHashBlock;
-    if (GetTransaction(dmn->collateralOutpoint.hash, collateralTx, Params().GetConsensus(), tmpHashBlock))
-        ownsCollateral = CheckWalletOwnsScript(pwallet, collateralTx->vout[dmn->collateralOutpoint.n].scriptPubKey);
+    if (GetTransactionOutput(dmn->collateralOutpoint, collateralOut, tmpHashBlock))
+        ownsCollateral = CheckWalletOwnsScript(pwallet, collateralOut.scriptPubKey);
 
     UniValue walletObj(UniValue::VOBJ);
     walletObj.pushKV("hasOwnerKey", hasOwnerKey);
@@ -201,35 +201,12 @@ static int CompareByLastPaid_GetHeight(const CDeterministicMN& dmn)
     return height;
 }
 
-static bool CompareByLastPaid(const CDeterministicMN& _a, const CDeterministicMN& _b)
-{
-    int ah = CompareByLastPaid_GetHeight(_a);
-    int bh = CompareByLastPaid_GetHeight(_b);
-    if (ah == bh) {
-        return _a.proTxHash < _b.proTxHash;
-    } else {
-        return ah < bh;
-    }
-}
-static bool CompareByLastPaid(const CDeterministicMNCPtr& _a, const CDeterministicMNCPtr& _b)
-{
-    return CompareByLastPaid(*_a, *_b);
-}
-
 CDeterministicMNCPtr CDeterministicMNList::GetMNPayee() const
 {
-    if (mnMap.size() == 0) {
+    if (payeeQueue.empty()) {
         return nullptr;
     }
-
-    CDeterministicMNCPtr best;
-    ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-        if (!best || CompareByLastPaid(dmn, best)) {
-            best = dmn;
-        }
-    });
-
-    return best;
+    return GetMN(payeeQueue.front().second);
 }
 
 std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(int nCount) const
@@ -241,14 +218,12 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(int
     std::vector<CDeterministicMNCPtr> result;
     result.reserve(nCount);
 
-    ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-        result.emplace_back(dmn);
-    });
-    std::sort(result.begin(), result.end(), [&](const CDeterministicMNCPtr& a, const CDeterministicMNCPtr& b) {
-        return CompareByLastPaid(a, b);
-    });
-
-    result.resize(nCount);
+    if (nCount <= 0) {
+        return result;
+    }
+    for (auto it = payeeQueue.begin(); it != payeeQueue.end() && (int)result.size() < nCount; ++it) {
+        result.emplace_back(GetMN(it->second));
+    }
 
     return result;
 }
@@ -437,11 +412,36 @@ CDeterministicMNList CDeterministicMNList::ApplyDiff(const CBlockIndex* pindex,
     return result;
 }
 
+void CDeterministicMNList::AddToPayeeQueue(const CDeterministicMNCPtr& dmn)
+{
+    if (!IsMNValid(dmn)) {
+        return;
+    }
+    auto entry = std::make_pair(CompareByLastPaid_GetHeight(*dmn), dmn->proTxHash);
+    size_t pos = std::lower_bound(payeeQueue.begin(), payeeQueue.end(), entry) - payeeQueue.begin();
+    if (pos == payeeQueue.size() || payeeQueue[pos] != entry) {
+        payeeQueue = payeeQueue.insert(pos, entry);
+    }
+}
+
+void CDeterministicMNList::RemoveFromPayeeQueue(const CDeterministicMNCPtr& dmn)
+{
+    if (!IsMNValid(dmn)) {
+        return;
+    }
+    auto entry = std::make_pair(CompareByLastPaid_GetHeight(*dmn), dmn->proTxHash);
+    size_t pos = std::lower_bound(payeeQueue.begin(), payeeQueue.end(), entry) - payeeQueue.begin();
+    if (pos != payeeQueue.size() && payeeQueue[pos] == entry) {
+        payeeQueue = payeeQueue.erase(pos);
+    }
+}
+
 void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn)
 {
     assert(!mnMap.find(dmn->proTxHash));
     mnMap = mnMap.set(dmn->proTxHash, dmn);
     mnInternalIdMap = mnInternalIdMap.set(dmn->internalId, dmn->proTxHash);
+    AddToPayeeQueue(dmn);
     AddUniqueProperty(dmn, dmn->collateralOutpoint);
     if (dmn->pdmnState->addr != CService()) {
         AddUniqueProperty(dmn, dmn->pdmnState->addr);
@@ -460,6 +460,9 @@ void CDeterministicMNList::UpdateMN(const CDeterministicMNCPtr& oldDmn, const CD
     dmn->pdmnState = pdmnState;
     mnMap = mnMap.set(oldDmn->proTxHash, dmn);
 
+    RemoveFromPayeeQueue(oldDmn);
+    AddToPayeeQueue(dmn);
+
     UpdateUniqueProperty(dmn, oldState->addr, pdmnState->addr);
     UpdateUniqueProperty(dmn, oldState->keyIDOwner, pdmnState->keyIDOwner);
     UpdateUniqueProperty(dmn, oldState->pubKeyOperator, pdmnState->pubKeyOperator);
@@ -493,6 +496,7 @@ void CDeterministicMNList::RemoveMN(const uint256& proTxHash)
     if (dmn->pdmnState->pubKeyOperator.Get().IsValid()) {
         DeleteUniqueProperty(dmn, dmn->pdmnState->pubKeyOperator);
     }
+    RemoveFromPayeeQueue(dmn);
     mnMap = mnMap.erase(proTxHash);
     mnInternalIdMap = mnInternalIdMap.erase(dmn->internalId);
 }
@@ -530,8 +534,10 @@ bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockInde
 
         oldList = GetListForBlock(pindex->pprev);
         diff = oldList.BuildDiff(newList);
+        diff.nHeight = nHeight;
 
         specialDb.Write(std::make_pair(DB_LIST_DIFF, newList.GetBlockHash()), diff);
+        mnListDiffsCache.emplace(newList.GetBlockHash(), diff);
         if ((nHeight % SNAPSHOT_LIST_PERIOD) == 0 || oldList.GetHeight() == -1) {
             specialDb.Write(std::make_pair(DB_LIST_SNAPSHOT, newList.GetBlockHash()), newList);
             LogPrintf("CDeterministicMNManager::%s -- Wrote snapshot. nHeight=%d, mapCurMNs.allMNsCount=%d\n",
@@ -573,6 +579,7 @@ bool CDeterministicMNManager::UndoBlock(const CBlock& block, const CBlockIndex*
         specialDb.Erase(std::make_pair(DB_LIST_SNAPSHOT, blockHash));
 
         mnListsCache.erase(blockHash);
+        mnListDiffsCache.erase(blockHash);
     }
 
     if (diff.HasChanges()) {
@@ -899,7 +906,7 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
         }
 
         CDeterministicMNListDiff diff;
-        if (!specialDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), diff)) {
+        if (!GetListDiff(pindex, diff)) {
             snapshot = CDeterministicMNList(pindex->GetBlockHash(), -1, 0);
             mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
             break;
@@ -934,6 +941,65 @@ CDeterministicMNList CDeterministicMNManager::GetListAtChainTip()
     return GetListForBlock(tipIndex);
 }
 
+bool CDeterministicMNManager::GetListChangesSince(const CBlockIndex* pindexSince, const CBlockIndex* pindexTip,
+                                                  std::vector<CDeterministicMNCPtr>& changedRet, std::vector<CDeterministicMNCPtr>& removedRet)
+{
+    changedRet.clear();
+    removedRet.clear();
+
+    if (!pindexSince || !pindexTip || pindexSince->nHeight > pindexTip->nHeight ||
+        pindexTip->nHeight - pindexSince->nHeight > LIST_CHANGES_MAX_DEPTH ||
+        pindexTip->GetAncestor(pindexSince->nHeight) != pindexSince) {
+        return false;
+    }
+
+    LOCK(cs);
+
+    // internalIds are never reused within a chain, so they identify MNs across all diffs in between
+    std::set<uint64_t> changedIds;
+    std::set<uint64_t> removedIds;
+    for (const CBlockIndex* pindex = pindexTip; pindex != pindexSince; pindex = pindex->pprev) {
+        CDeterministicMNListDiff diff;
+        if (!GetListDiff(pindex, diff)) {
+            return false;
+        }
+        for (const auto& dmn : diff.addedMNs) {
+            changedIds.emplace(dmn->internalId);
+        }
+        for (const auto& p : diff.updatedMNs) {
+            changedIds.emplace(p.first);
+        }
+        for (const auto& id : diff.removedMns) {
+            removedIds.emplace(id);
+        }
+    }
+    if (changedIds.empty() && removedIds.empty()) {
+        return true;
+    }
+
+    auto tipList = GetListForBlock(pindexTip);
+    auto sinceList = GetListForBlock(pindexSince);
+
+    for (const auto& id : changedIds) {
+        auto dmn = tipList.GetMNByInternalId(id);
+        if (dmn) {
+            changedRet.emplace_back(dmn);
+        }
+    }
+    for (const auto& id : removedIds) {
+        if (tipList.GetMNByInternalId(id)) {
+            continue;
+        }
+        // MNs which were added and removed again after pindexSince are not of interest
+        auto dmn = sinceList.GetMNByInternalId(id);
+        if (dmn) {
+            removedRet.emplace_back(dmn);
+        }
+    }
+
+    return true;
+}
+
 bool CDeterministicMNManager::IsProTxWithCollateral(const CTransactionRef& tx, uint32_t n)
 {
     if (tx->nVersion != 2 || tx->nType != TRANSACTION_PROVIDER_REGISTER) {
@@ -956,6 +1022,23 @@ bool CDeterministicMNManager::IsProTxWithCollateral(const CTransactionRef& tx, u
     return true;
 }
 
+bool CDeterministicMNManager::GetListDiff(const CBlockIndex* pindex, CDeterministicMNListDiff& diffRet)
+{
+    AssertLockHeld(cs);
+
+    auto it = mnListDiffsCache.find(pindex->GetBlockHash());
+    if (it != mnListDiffsCache.end()) {
+        diffRet = it->second;
+        return true;
+    }
+    if (!specialDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), diffRet)) {
+        return false;
+    }
+    diffRet.nHeight = pindex->nHeight;
+    mnListDiffsCache.emplace(pindex->GetBlockHash(), diffRet);
+    return true;
+}
+
 void CDeterministicMNManager::CleanupCache(int nHeight)
 {
     AssertLockHeld(cs);
@@ -969,4 +1052,14 @@ void CDeterministicMNManager::CleanupCache(int nHeight)
     for (const auto& h : toDelete) {
         mnListsCache.erase(h);
     }
+
+    toDelete.clear();
+    for (const auto& p : mnListDiffsCache) {
+        if (p.second.nHeight + LISTS_CACHE_SIZE < nHeight) {
+            toDelete.emplace_back(p.first);
+        }
+    }
+    for (const auto& h : toDelete) {
+        mnListDiffsCache.erase(h);
+    }
 }
@@ -14,10 +14,12 @@
 #include <sync.h>
 #include <uint256.h>
 
+#include <immer/flex_vector.hpp>
 #include <immer/map.hpp>
 #include <immer/map_transient.hpp>
 
 #include <map>
+#include <set>
 
 class CBlock;
 class CBlockIndex;
@@ -277,6 +279,8 @@ public:
     typedef immer::map<uint256, CDeterministicMNCPtr> MnMap;
     typedef immer::map<uint64_t, uint256> MnInternalIdMap;
     typedef immer::map<uint256, std::pair<uint256, uint32_t> > MnUniquePropertyMap;
+    // valid MNs sorted by (last paid height, proTxHash), the first entry is the next payee
+    typedef immer::flex_vector<std::pair<int, uint256> > MnPayeeQueue;
 
 private:
     uint256 blockHash;
@@ -289,6 +293,10 @@ private:
     // we keep track of this as checking for duplicates would otherwise be painfully slow
     MnUniquePropertyMap mnUniquePropertyMap;
 
+    // payment order of all valid MNs, kept up to date by AddMN/UpdateMN/RemoveMN
+    // persistent like the maps above, so copies of the list share all entries which were not modified
+    MnPayeeQueue payeeQueue;
+
 public:
     CDeterministicMNList() {}
     explicit CDeterministicMNList(const uint256& _blockHash, int _height, uint32_t _totalRegisteredCount) :
@@ -322,6 +330,7 @@ public:
         mnMap = MnMap();
         mnUniquePropertyMap = MnUniquePropertyMap();
         mnInternalIdMap = MnInternalIdMap();
+        payeeQueue = MnPayeeQueue();
 
         SerializationOpBase(s, CSerActionUnserialize());
 
@@ -339,13 +348,7 @@ public:
 
     size_t GetValidMNsCount() const
     {
-        size_t count = 0;
-        for (const auto& p : mnMap) {
-            if (IsMNValid(p.second)) {
-                count++;
-            }
-        }
-        return count;
+        return payeeQueue.size();
     }
 
     template <typename Callback>
@@ -491,6 +494,9 @@ public:
     }
 
 private:
+    void AddToPayeeQueue(const CDeterministicMNCPtr& dmn);
+    void RemoveFromPayeeQueue(const CDeterministicMNCPtr& dmn);
+
     template <typename T>
     void AddUniqueProperty(const CDeterministicMNCPtr& dmn, const T& v)
     {
@@ -542,6 +548,8 @@ private:
 class CDeterministicMNListDiff
 {
 public:
+    int nHeight{-1}; //memory only
+
     std::vector<CDeterministicMNCPtr> addedMNs;
     // keys are all relating to the internalId of MNs
     std::map<uint64_t, CDeterministicMNStateDiff> updatedMNs;
@@ -628,6 +636,7 @@ class CDeterministicMNManager
 {
     static const int SNAPSHOT_LIST_PERIOD = 576; // once per day
     static const int LISTS_CACHE_SIZE = 576;
+    static const int LIST_CHANGES_MAX_DEPTH = LISTS_CACHE_SIZE;
 
 public:
     CCriticalSection cs;
@@ -636,6 +645,7 @@ private:
     CSpecialDB& specialDb;
 
     std::map<uint256, CDeterministicMNList> mnListsCache;
+    std::map<uint256, CDeterministicMNListDiff> mnListDiffsCache;
     const CBlockIndex* tipIndex{nullptr};
 
 public:
@@ -654,10 +664,21 @@ public:
     CDeterministicMNList GetListForBlock(const CBlockIndex* pindex);
     CDeterministicMNList GetListAtChainTip();
 
+    /**
+     * Collects the MNs which were added, updated or removed by the blocks following pindexSince up to and including
+     * pindexTip, using the per-block list diffs. Returns false when pindexSince is not an ancestor of pindexTip or
+     * is too far behind it, in which case the caller should fall back to the full list.
+     * @param changedRet MNs added or updated since pindexSince, as they are in the list of pindexTip
+     * @param removedRet MNs removed since pindexSince, as they were in the list of pindexSince
+     */
+    bool GetListChangesSince(const CBlockIndex* pindexSince, const CBlockIndex* pindexTip,
+                             std::vector<CDeterministicMNCPtr>& changedRet, std::vector<CDeterministicMNCPtr>& removedRet);
+
     // Test if given TX is a ProRegTx which also contains the collateral at index n
     bool IsProTxWithCollateral(const CTransactionRef& tx, uint32_t n);
 
 private:
+    bool GetListDiff(const CBlockIndex* pindex, CDeterministicMNListDiff& diffRet);
     void CleanupCache(int nHeight);
 };
 
@@ -46,30 +46,59 @@ static bool CheckService(const uint256& proTxHash, const ProTx& proTx, CValidati
     return true;
 }
 
+// If pvChecks is not nullptr, the signature checks below only queue the verification. The closures copy what they
+// need, as the payload goes out of scope before they are run.
+
 template <typename ProTx>
-static bool CheckHashSig(const ProTx& proTx, const CKeyID& keyID, CValidationState& state)
+static bool CheckHashSig(const ProTx& proTx, const CKeyID& keyID, CValidationState& state, std::vector<CSpecialTxCheck>* pvChecks)
 {
+    uint256 hash = ::SerializeHash(proTx);
+    if (pvChecks) {
+        pvChecks->emplace_back([hash, keyID, vchSig = proTx.vchSig]() {
+            std::string strError;
+            return CHashSigner::VerifyHash(hash, keyID, vchSig, strError);
+        });
+        return true;
+    }
+
     std::string strError;
-    if (!CHashSigner::VerifyHash(::SerializeHash(proTx), keyID, proTx.vchSig, strError)) {
+    if (!CHashSigner::VerifyHash(hash, keyID, proTx.vchSig, strError)) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-sig", strError);
     }
     return true;
 }
 
 template <typename ProTx>
-static bool CheckStringSig(const ProTx& proTx, const CKeyID& keyID, CValidationState& state)
+static bool CheckStringSig(const ProTx& proTx, const CKeyID& keyID, CValidationState& state, std::vector<CSpecialTxCheck>* pvChecks)
 {
+    std::string strMessage = proTx.MakeSignString();
+    if (pvChecks) {
+        pvChecks->emplace_back([strMessage, keyID, vchSig = proTx.vchSig]() {
+            std::string strError;
+            return CMessageSigner::VerifyMessage(keyID, vchSig, strMessage, strError);
+        });
+        return true;
+    }
+
     std::string strError;
-    if (!CMessageSigner::VerifyMessage(keyID, proTx.vchSig, proTx.MakeSignString(), strError)) {
+    if (!CMessageSigner::VerifyMessage(keyID, proTx.vchSig, strMessage, strError)) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-sig", strError);
     }
     return true;
 }
 
 template <typename ProTx>
-static bool CheckHashSig(const ProTx& proTx, const CBLSPublicKey& pubKey, CValidationState& state)
+static bool CheckHashSig(const ProTx& proTx, const CBLSPublicKey& pubKey, CValidationState& state, std::vector<CSpecialTxCheck>* pvChecks)
 {
-    if (!proTx.sig.VerifyInsecure(pubKey, ::SerializeHash(proTx)))
+    uint256 hash = ::SerializeHash(proTx);
+    if (pvChecks) {
+        pvChecks->emplace_back([hash, pubKey, sig = proTx.sig]() {
+            return sig.VerifyInsecure(pubKey, hash);
+        });
+        return true;
+    }
+
+    if (!proTx.sig.VerifyInsecure(pubKey, hash))
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-sig");
     return true;
 }
@@ -85,7 +114,7 @@ static bool CheckInputsHash(const CTransaction& tx, const ProTx& proTx, CValidat
     return true;
 }
 
-bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CSpecialTxCheck>* pvChecks)
 {
     if (tx.nType != TRANSACTION_PROVIDER_REGISTER)
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-type");
@@ -180,7 +209,7 @@ bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValid
 
     if (!keyForPayloadSig.IsNull()) {
         // collateral is not part of this ProRegTx, so we must verify ownership of the collateral
-        if (!CheckStringSig(ptx, keyForPayloadSig, state))
+        if (!CheckStringSig(ptx, keyForPayloadSig, state, pvChecks))
             return false;
     } else {
         // collateral is part of this ProRegTx, so we know the collateral is owned by the issuer
@@ -191,7 +220,7 @@ bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValid
     return true;
 }
 
-bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CSpecialTxCheck>* pvChecks)
 {
     if (tx.nType != TRANSACTION_PROVIDER_UPDATE_SERVICE) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-type");
@@ -233,14 +262,14 @@ bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVa
         // we can only check the signature if pindexPrev != NULL and the MN is known
         if (!CheckInputsHash(tx, ptx, state))
             return false;
-        if (!CheckHashSig(ptx, mn->pdmnState->pubKeyOperator.Get(), state))
+        if (!CheckHashSig(ptx, mn->pdmnState->pubKeyOperator.Get(), state, pvChecks))
             return false;
     }
 
     return true;
 }
 
-bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CSpecialTxCheck>* pvChecks)
 {
     if (tx.nType != TRANSACTION_PROVIDER_UPDATE_REGISTRAR)
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-type");
@@ -297,14 +326,14 @@ bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
 
         if (!CheckInputsHash(tx, ptx, state))
             return false;
-        if (!CheckHashSig(ptx, dmn->pdmnState->keyIDOwner, state))
+        if (!CheckHashSig(ptx, dmn->pdmnState->keyIDOwner, state, pvChecks))
             return false;
     }
 
     return true;
 }
 
-bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CSpecialTxCheck>* pvChecks)
 {
     if (tx.nType != TRANSACTION_PROVIDER_UPDATE_REVOKE)
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-type");
@@ -329,7 +358,7 @@ bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
 
         if (!CheckInputsHash(tx, ptx, state))
             return false;
-        if (!CheckHashSig(ptx, dmn->pdmnState->pubKeyOperator.Get(), state))
+        if (!CheckHashSig(ptx, dmn->pdmnState->pubKeyOperator.Get(), state, pvChecks))
             return false;
     }
 
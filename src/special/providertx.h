@@ -12,7 +12,10 @@
 #include <netaddress.h>
 #include <pubkey.h>
 
+#include <vector>
+
 class CBlockIndex;
+class CSpecialTxCheck;
 class UniValue;
 
 class CProRegTx
@@ -178,9 +181,9 @@ public:
 };
 
 
-bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
-bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
-bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
-bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
+bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CSpecialTxCheck>* pvChecks = nullptr);
+bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CSpecialTxCheck>* pvChecks = nullptr);
+bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CSpecialTxCheck>* pvChecks = nullptr);
+bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CSpecialTxCheck>* pvChecks = nullptr);
 
 #endif // EMRALS_SPECIAL_PROVIDERTX_H
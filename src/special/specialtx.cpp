@@ -5,6 +5,7 @@
 
 #include <special/cbtx.h>
 #include <chainparams.h>
+#include <checkqueue.h>
 #include <clientversion.h>
 #include <consensus/validation.h>
 #include <hash.h>
@@ -12,6 +13,7 @@
 #include <primitives/transaction.h>
 #include <primitives/block.h>
 #include <special/providertx.h>
+#include <util/threadnames.h>
 #include <util/time.h>
 #include <validation.h>
 
@@ -19,8 +21,17 @@
 #include <llmq/quorums_commitment.h>
 #include <llmq/quorums_blockprocessor.h>
 
+#include <set>
 
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+// Signature checks are expensive, so small batches keep all workers busy
+static CCheckQueue<CSpecialTxCheck> specialtxcheckqueue(8);
+
+void ThreadSpecialTxCheck(int worker_num) {
+    util::ThreadRename(strprintf("specialch.%i", worker_num));
+    specialtxcheckqueue.Thread();
+}
+
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CSpecialTxCheck>* pvChecks)
 {
     if (tx.nVersion < 2 || tx.nType == TRANSACTION_NORMAL || tx.nType == TRANSACTION_STAKE)
         return true;
@@ -29,13 +40,13 @@ bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVali
     case TRANSACTION_COINBASE:
         return CheckCbTx(tx, pindexPrev, state);
     case TRANSACTION_PROVIDER_REGISTER:
-        return CheckProRegTx(tx, pindexPrev, state);
+        return CheckProRegTx(tx, pindexPrev, state, pvChecks);
     case TRANSACTION_PROVIDER_UPDATE_SERVICE:
-        return CheckProUpServTx(tx, pindexPrev, state);
+        return CheckProUpServTx(tx, pindexPrev, state, pvChecks);
     case TRANSACTION_PROVIDER_UPDATE_REGISTRAR:
-        return CheckProUpRegTx(tx, pindexPrev, state);
+        return CheckProUpRegTx(tx, pindexPrev, state, pvChecks);
     case TRANSACTION_PROVIDER_UPDATE_REVOKE:
-        return CheckProUpRevTx(tx, pindexPrev, state);
+        return CheckProUpRevTx(tx, pindexPrev, state, pvChecks);
     case TRANSACTION_QUORUM_COMMITMENT:
         return llmq::CheckLLMQCommitment(tx, pindexPrev, state);
     }
@@ -92,18 +103,48 @@ bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CV
 
     int64_t nTime1 = GetTimeMicros();
 
+    // The signatures of the special transactions and quorum commitments only depend on the state before the block,
+    // so they are verified by the check queue workers while the payloads are checked here. The state transitions
+    // below still happen in block order once all signatures are known to be valid.
+    const bool fParallel = nScriptCheckThreads > 0;
+    CCheckQueueControl<CSpecialTxCheck> control(fParallel ? &specialtxcheckqueue : nullptr);
+    std::vector<CSpecialTxCheck> vChecks;
+    std::set<uint256> setVerifiedCommitments;
+
+    if (fParallel) {
+        // Queue the commitments first, their aggregated signatures are the most expensive ones. Add() leaves the
+        // emptied checks behind, so the vector has to be cleared before it is reused.
+        llmq::quorumBlockProcessor->GetCommitmentChecks(block, pindex, vChecks, setVerifiedCommitments);
+        control.Add(vChecks);
+        vChecks.clear();
+    }
+
     for (int i = 0; i < (int)block.vtx.size(); i++) {
         const CTransaction& tx = *block.vtx[i];
-        if (!CheckSpecialTx(tx, pindex->pprev, state))
+        if (!CheckSpecialTx(tx, pindex->pprev, state, fParallel ? &vChecks : nullptr))
             return false;
         if (!ProcessSpecialTx(tx, pindex, state))
             return false;
     }
 
+    if (fParallel) {
+        control.Add(vChecks);
+        vChecks.clear();
+        if (!control.Wait()) {
+            // Some signature is invalid. Check everything again in block order, so that the block is rejected for
+            // the same reason as without the check queue.
+            for (int i = 0; i < (int)block.vtx.size(); i++) {
+                if (!CheckSpecialTx(*block.vtx[i], pindex->pprev, state))
+                    return false;
+            }
+            setVerifiedCommitments.clear();
+        }
+    }
+
     int64_t nTime2 = GetTimeMicros(); nTimeLoop += nTime2 - nTime1;
     LogPrint(BCLog::BENCHMARK, "        - Loop: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeLoop * 0.000001);
 
-    if (!llmq::quorumBlockProcessor->ProcessBlock(block, pindex, state))
+    if (!llmq::quorumBlockProcessor->ProcessBlock(block, pindex, state, fJustCheck, setVerifiedCommitments))
         return false;
 
     int64_t nTime3 = GetTimeMicros(); nTimeQuorum += nTime3 - nTime2;
@@ -9,15 +9,44 @@
 #include <streams.h>
 #include <version.h>
 
+#include <functional>
+#include <vector>
+
 class CTransaction;
 class CBlock;
 class CBlockIndex;
 class CValidationState;
 
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
+/**
+ * Closure representing one signature verification of a special transaction, so that the signatures of a block's
+ * special transactions can be verified by the check queue workers. Everything the signature is checked against
+ * (keys, quorum members) is looked up beforehand, so the closure does not depend on any chain state.
+ */
+class CSpecialTxCheck
+{
+private:
+    std::function<bool()> check;
+
+public:
+    CSpecialTxCheck() {}
+    explicit CSpecialTxCheck(std::function<bool()> checkIn) : check(std::move(checkIn)) {}
+
+    // An empty check fails, which makes the caller check the block again without the check queue
+    bool operator()() { return check && check(); }
+
+    void swap(CSpecialTxCheck& other) { check.swap(other.check); }
+};
+
+/**
+ * Check a special transaction against the state at pindexPrev. If pvChecks is not nullptr, the payload signatures
+ * are not verified but appended to pvChecks instead, and the caller has to run them.
+ */
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CSpecialTxCheck>* pvChecks = nullptr);
 bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck, bool fCheckCbTxMerleRoots);
 bool UndoSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex);
 
+void ThreadSpecialTxCheck(int worker_num);
+
 template <typename T>
 inline bool GetTxPayload(const std::vector<unsigned char>& payload, T& obj)
 {
@@ -15,8 +15,6 @@
 #include <validation.h>
 #include <string>
 
-CSporkManager sporkManager;
-
 const std::string CSporkManager::SERIALIZATION_VERSION_STRING = "CSporkManager-Version-2";
 
 std::map<int, int64_t> mapSporkDefaults = {
@@ -29,6 +27,14 @@ std::map<int, int64_t> mapSporkDefaults = {
     {SPORK_7_INSTANTSEND_AUTOLOCKS,         4070908800ULL}, // OFF
 };
 
+// must be defined after mapSporkDefaults, the constructor already reads the defaults
+CSporkManager sporkManager;
+
+CSporkManager::CSporkManager()
+{
+    UpdateSporkValues();
+}
+
 bool CSporkManager::SporkValueIsActive(int nSporkID, int64_t &nActiveValueRet) const
 {
     LOCK(cs);
@@ -50,11 +56,25 @@ bool CSporkManager::SporkValueIsActive(int nSporkID, int64_t &nActiveValueRet) c
     return false;
 }
 
+void CSporkManager::UpdateSporkValues()
+{
+    LOCK(cs);
+    for (int nSporkID = SPORK_START; nSporkID <= SPORK_END; nSporkID++) {
+        int64_t nSporkValue = -1;
+        if (!SporkValueIsActive(nSporkID, nSporkValue)) {
+            auto it = mapSporkDefaults.find(nSporkID);
+            nSporkValue = it != mapSporkDefaults.end() ? it->second : -1;
+        }
+        arrSporkValues[nSporkID - SPORK_START].store(nSporkValue, std::memory_order_release);
+    }
+}
+
 void CSporkManager::Clear()
 {
     LOCK(cs);
     mapSporksActive.clear();
     mapSporksByHash.clear();
+    UpdateSporkValues();
 }
 
 void CSporkManager::CheckAndRemove()
@@ -103,6 +123,8 @@ void CSporkManager::CheckAndRemove()
         }
         ++itByHash;
     }
+
+    UpdateSporkValues();
 }
 
 void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
@@ -161,6 +183,7 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
             LOCK(cs); // make sure to not lock this together with cs_main
             mapSporksByHash[hash] = spork;
             mapSporksActive[spork.nSporkID][keyIDSigner] = spork;
+            UpdateSporkValues();
         }
         spork.Relay();
 
@@ -224,6 +247,7 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue)
             LOCK(cs);
             mapSporksByHash[spork.GetHash()] = spork;
             mapSporksActive[nSporkID][keyIDSigner] = spork;
+            UpdateSporkValues();
         }
         spork.Relay();
         return true;
@@ -234,15 +258,8 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue)
 
 bool CSporkManager::IsSporkActive(int nSporkID)
 {
-    LOCK(cs);
-    int64_t nSporkValue = -1;
-
-    if (SporkValueIsActive(nSporkID, nSporkValue)) {
-        return nSporkValue < GetAdjustedTime();
-    }
-
-    if (mapSporkDefaults.count(nSporkID)) {
-        return  mapSporkDefaults[nSporkID] < GetAdjustedTime();
+    if (nSporkID >= SPORK_START && nSporkID <= SPORK_END) {
+        return arrSporkValues[nSporkID - SPORK_START].load(std::memory_order_acquire) < GetAdjustedTime();
     }
 
     LogPrint(BCLog::SPORK, "CSporkManager::IsSporkActive -- Unknown Spork ID %d\n", nSporkID);
@@ -251,15 +268,8 @@ bool CSporkManager::IsSporkActive(int nSporkID)
 
 int64_t CSporkManager::GetSporkValue(int nSporkID)
 {
-    LOCK(cs);
-
-    int64_t nSporkValue = -1;
-    if (SporkValueIsActive(nSporkID, nSporkValue)) {
-        return nSporkValue;
-    }
-
-    if (mapSporkDefaults.count(nSporkID)) {
-        return mapSporkDefaults[nSporkID];
+    if (nSporkID >= SPORK_START && nSporkID <= SPORK_END) {
+        return arrSporkValues[nSporkID - SPORK_START].load(std::memory_order_acquire);
     }
 
     LogPrint(BCLog::SPORK, "CSporkManager::GetSporkValue -- Unknown Spork ID %d\n", nSporkID);
@@ -331,6 +341,7 @@ bool CSporkManager::SetMinSporkKeys(int minSporkKeys)
         return false;
     }
     nMinSporkKeys = minSporkKeys;
+    UpdateSporkValues();
     return true;
 }
 
@@ -10,6 +10,8 @@
 #include "util/strencodings.h"
 #include "key.h"
 
+#include <array>
+#include <atomic>
 
 class CSporkMessage;
 class CSporkManager;
@@ -140,15 +142,28 @@ private:
     int nMinSporkKeys;
     CKey sporkPrivKey;
 
+    /**
+     * Effective value (agreed upon or default) of every known spork, indexed
+     * by nSporkID - SPORK_START. Readers only do an atomic load, the values
+     * are rebuilt under cs whenever the active spork messages change.
+     */
+    std::array<std::atomic<int64_t>, SPORK_END - SPORK_START + 1> arrSporkValues;
+
     /**
      * SporkValueIsActive is used to get the value agreed upon by the majority
      * of signed spork messages for a given Spork ID.
      */
     bool SporkValueIsActive(int nSporkID, int64_t& nActiveValueRet) const;
 
+    /**
+     * UpdateSporkValues recalculates arrSporkValues. It must be called after
+     * every change to mapSporksActive or nMinSporkKeys.
+     */
+    void UpdateSporkValues();
+
 public:
 
-    CSporkManager() {}
+    CSporkManager();
 
     ADD_SERIALIZE_METHODS;
 
@@ -170,6 +185,10 @@ public:
         READWRITE(mapSporksByHash);
         READWRITE(mapSporksActive);
         // we don't serialize private key to prevent its leakage
+
+        if (ser_action.ForRead()) {
+            UpdateSporkValues();
+        }
     }
 
     /**
@@ -0,0 +1,335 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/addressindex.h>
+#include <index/spentindex.h>
+#include <index/timestampindex.h>
+#include <script/interpreter.h>
+#include <test/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+static void WaitUntilSynced(BaseIndex& index)
+{
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+}
+
+// Spend the first output of a coinbase transaction paying to coinbase_key into a single output with the given script
+static CMutableTransaction CreateSpend(const CTransactionRef& coinbase, const CKey& coinbase_key, const CScript& script, CAmount amount)
+{
+    const CScript coinbase_script = CScript() << ToByteVector(coinbase_key.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(coinbase->GetHash(), 0);
+    spend.vout.resize(1);
+    spend.vout[0].nValue = amount;
+    spend.vout[0].scriptPubKey = script;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(coinbase_script, spend, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(coinbase_key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+    return spend;
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_spentindex_timestampindex, TestChain100Setup)
+{
+    AddressIndex addressindex(1 << 20, true);
+    SpentIndex spentindex(1 << 20, true);
+    TimestampIndex timestampindex(1 << 20, true);
+
+    addressindex.Start();
+    spentindex.Start();
+    timestampindex.Start();
+    WaitUntilSynced(addressindex);
+    WaitUntilSynced(spentindex);
+    WaitUntilSynced(timestampindex);
+
+    CScript coinbase_script = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const uint256 coinbase_script_hash = GetAddressIndexScriptHash(coinbase_script);
+
+    // All coinbase outputs created before the indexes were started are unspent.
+    std::vector<CAddressUnspent> unspent;
+    BOOST_CHECK(addressindex.FindUnspent(coinbase_script_hash, unspent));
+    BOOST_CHECK_EQUAL(unspent.size(), m_coinbase_txns.size());
+
+    std::vector<CAddressIndexDelta> deltas;
+    BOOST_CHECK(addressindex.FindDeltas(coinbase_script_hash, 10, 19, deltas));
+    BOOST_CHECK_EQUAL(deltas.size(), 10U);
+    for (const auto& delta : deltas) {
+        BOOST_CHECK(!delta.fSpending);
+        BOOST_CHECK(delta.nHeight >= 10 && delta.nHeight <= 19);
+    }
+
+    // Spend the first coinbase output to another script.
+    CKey key;
+    key.MakeNewKey(true);
+    CScript script = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    const uint256 script_hash = GetAddressIndexScriptHash(script);
+
+    const CMutableTransaction spend = CreateSpend(m_coinbase_txns[0], coinbaseKey, script, 11 * CENT);
+
+    const CBlock& block = CreateAndProcessBlock({spend}, coinbase_script);
+    BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(spentindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(timestampindex.BlockUntilSyncedToCurrentChain());
+    const int height = WITH_LOCK(cs_main, return ::ChainActive().Height());
+
+    unspent.clear();
+    BOOST_CHECK(addressindex.FindUnspent(script_hash, unspent));
+    BOOST_REQUIRE_EQUAL(unspent.size(), 1U);
+    BOOST_CHECK(unspent[0].outpoint == COutPoint(spend.GetHash(), 0));
+    BOOST_CHECK_EQUAL(unspent[0].nAmount, 11 * CENT);
+    BOOST_CHECK_EQUAL(unspent[0].nHeight, height);
+
+    // The spent coinbase output is gone from the unspent set, and the spend shows up as a delta.
+    unspent.clear();
+    BOOST_CHECK(addressindex.FindUnspent(coinbase_script_hash, unspent));
+    BOOST_CHECK_EQUAL(unspent.size(), m_coinbase_txns.size());
+    for (const auto& utxo : unspent) {
+        BOOST_CHECK(utxo.outpoint != spend.vin[0].prevout);
+    }
+    deltas.clear();
+    BOOST_CHECK(addressindex.FindDeltas(coinbase_script_hash, height, -1, deltas));
+    BOOST_CHECK_EQUAL(deltas.size(), 2U);
+    BOOST_CHECK(std::any_of(deltas.begin(), deltas.end(), [&](const CAddressIndexDelta& delta) {
+        return delta.fSpending && delta.txid == spend.GetHash() && delta.nAmount == -m_coinbase_txns[0]->vout[0].nValue;
+    }));
+
+    CSpentIndexValue spent;
+    BOOST_CHECK(spentindex.FindSpent(spend.vin[0].prevout, spent));
+    BOOST_CHECK(spent.txid == spend.GetHash());
+    BOOST_CHECK_EQUAL(spent.index, 0U);
+    BOOST_CHECK_EQUAL(spent.nHeight, height);
+    BOOST_CHECK(!spentindex.FindSpent(COutPoint(spend.GetHash(), 0), spent));
+
+    std::vector<uint256> hashes;
+    BOOST_CHECK(timestampindex.FindBlockHashes(block.nTime, block.nTime, hashes));
+    BOOST_CHECK(std::find(hashes.begin(), hashes.end(), block.GetHash()) != hashes.end());
+    hashes.clear();
+    BOOST_CHECK(timestampindex.FindBlockHashes(std::numeric_limits<uint32_t>::max(), 0, hashes));
+    BOOST_CHECK_EQUAL(hashes.size(), (size_t)height + 1);
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    addressindex.Stop();
+    spentindex.Stop();
+    timestampindex.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    // Rest of shutdown sequence and destructors happen in ~TestingSetup()
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_spentindex_timestampindex_reorg, TestChain100Setup)
+{
+    AddressIndex addressindex(1 << 20, true);
+    SpentIndex spentindex(1 << 20, true);
+    TimestampIndex timestampindex(1 << 20, true);
+
+    addressindex.Start();
+    spentindex.Start();
+    timestampindex.Start();
+    WaitUntilSynced(addressindex);
+    WaitUntilSynced(spentindex);
+    WaitUntilSynced(timestampindex);
+
+    CScript coinbase_script = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const uint256 coinbase_script_hash = GetAddressIndexScriptHash(coinbase_script);
+    CKey key;
+    key.MakeNewKey(true);
+    CScript script = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    const uint256 script_hash = GetAddressIndexScriptHash(script);
+    // The blocks of the competing chain pay their coinbase elsewhere, so that none of their entries collide with
+    // the entries of the disconnected block
+    CKey other_key;
+    other_key.MakeNewKey(true);
+    CScript other_script = CScript() << ToByteVector(other_key.GetPubKey()) << OP_CHECKSIG;
+
+    std::vector<CAddressUnspent> unspent_before;
+    BOOST_CHECK(addressindex.FindUnspent(coinbase_script_hash, unspent_before));
+    const COutPoint prevout(m_coinbase_txns[0]->GetHash(), 0);
+    auto it_before = std::find_if(unspent_before.begin(), unspent_before.end(), [&](const CAddressUnspent& utxo) {
+        return utxo.outpoint == prevout;
+    });
+    BOOST_REQUIRE(it_before != unspent_before.end());
+    const CAddressUnspent utxo_before = *it_before;
+    const int fork_height = WITH_LOCK(cs_main, return ::ChainActive().Height());
+
+    // Spend the first coinbase output in a block which is reorged out below.
+    const CMutableTransaction spend = CreateSpend(m_coinbase_txns[0], coinbaseKey, script, 11 * CENT);
+    const CBlock& stale_block = CreateAndProcessBlock({spend}, coinbase_script);
+    const uint256 stale_hash = stale_block.GetHash();
+    const uint256 stale_coinbase_hash = stale_block.vtx[0]->GetHash();
+    BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(spentindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(timestampindex.BlockUntilSyncedToCurrentChain());
+
+    CSpentIndexValue spent;
+    BOOST_CHECK(spentindex.FindSpent(prevout, spent));
+    std::vector<CAddressUnspent> unspent;
+    BOOST_CHECK(addressindex.FindUnspent(script_hash, unspent));
+    BOOST_CHECK_EQUAL(unspent.size(), 1U);
+
+    // Replace the block with a longer chain which spends another coinbase output instead.
+    CBlockIndex* stale_index = WITH_LOCK(cs_main, return LookupBlockIndex(stale_hash));
+    CValidationState state;
+    BOOST_CHECK(InvalidateBlock(state, Params(), stale_index));
+    const CMutableTransaction other_spend = CreateSpend(m_coinbase_txns[1], coinbaseKey, script, 12 * CENT);
+    std::vector<uint256> new_hashes;
+    new_hashes.push_back(CreateAndProcessBlock({other_spend}, other_script).GetHash());
+    new_hashes.push_back(CreateAndProcessBlock({}, other_script).GetHash());
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return ::ChainActive().Height()), fork_height + 2);
+    BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(spentindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(timestampindex.BlockUntilSyncedToCurrentChain());
+
+    // The unspent outputs of the coinbase script are the same as before the stale block, except for the output
+    // spent by the new chain.
+    unspent.clear();
+    BOOST_CHECK(addressindex.FindUnspent(coinbase_script_hash, unspent));
+    BOOST_CHECK_EQUAL(unspent.size(), unspent_before.size() - 1);
+    bool restored = false;
+    for (const auto& utxo : unspent) {
+        BOOST_CHECK(utxo.outpoint.hash != stale_coinbase_hash);
+        BOOST_CHECK(utxo.outpoint != other_spend.vin[0].prevout);
+        if (utxo.outpoint == prevout) {
+            restored = true;
+            BOOST_CHECK_EQUAL(utxo.nAmount, utxo_before.nAmount);
+            BOOST_CHECK_EQUAL(utxo.nHeight, utxo_before.nHeight);
+        }
+    }
+    BOOST_CHECK(restored);
+
+    // Only the output of the new spend is left for the spent-to script.
+    unspent.clear();
+    BOOST_CHECK(addressindex.FindUnspent(script_hash, unspent));
+    BOOST_REQUIRE_EQUAL(unspent.size(), 1U);
+    BOOST_CHECK(unspent[0].outpoint == COutPoint(other_spend.GetHash(), 0));
+    BOOST_CHECK_EQUAL(unspent[0].nHeight, fork_height + 1);
+
+    // The deltas of the stale block are gone: its coinbase, the spending input and the output of the spend.
+    std::vector<CAddressIndexDelta> deltas;
+    BOOST_CHECK(addressindex.FindDeltas(coinbase_script_hash, fork_height + 1, -1, deltas));
+    BOOST_REQUIRE_EQUAL(deltas.size(), 1U);
+    BOOST_CHECK(deltas[0].fSpending);
+    BOOST_CHECK(deltas[0].txid == other_spend.GetHash());
+    deltas.clear();
+    BOOST_CHECK(addressindex.FindDeltas(script_hash, 0, -1, deltas));
+    BOOST_REQUIRE_EQUAL(deltas.size(), 1U);
+    BOOST_CHECK(deltas[0].txid == other_spend.GetHash());
+    BOOST_CHECK_EQUAL(deltas[0].nAmount, 12 * CENT);
+
+    // The spent entry of the stale spend is removed, the one of the new spend is written.
+    BOOST_CHECK(!spentindex.FindSpent(prevout, spent));
+    BOOST_CHECK(spentindex.FindSpent(other_spend.vin[0].prevout, spent));
+    BOOST_CHECK(spent.txid == other_spend.GetHash());
+    BOOST_CHECK_EQUAL(spent.nHeight, fork_height + 1);
+
+    // The stale block is no longer found by its timestamp, the blocks of the new chain are.
+    std::vector<uint256> hashes;
+    BOOST_CHECK(timestampindex.FindBlockHashes(std::numeric_limits<uint32_t>::max(), 0, hashes));
+    BOOST_CHECK_EQUAL(hashes.size(), (size_t)fork_height + 3);
+    BOOST_CHECK(std::find(hashes.begin(), hashes.end(), stale_hash) == hashes.end());
+    for (const uint256& hash : new_hashes) {
+        BOOST_CHECK(std::find(hashes.begin(), hashes.end(), hash) != hashes.end());
+    }
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    addressindex.Stop();
+    spentindex.Stop();
+    timestampindex.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    // Rest of shutdown sequence and destructors happen in ~TestingSetup()
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_timestampindex_reorg_during_sync, TestChain100Setup)
+{
+    // The indexes are started while the active chain is about to be replaced by a longer branch. Depending on how
+    // far the initial sync got when the branches are switched, the blocks of the replaced branch are rewound while
+    // their entries are still in the batch of the sync, or after the sync finished. Either way the entries of the
+    // replaced branch have to be gone afterwards.
+    const int branch_length = 50;
+    for (int delay_ms : {0, 1, 5, 20}) {
+        CKey key_old, key_new;
+        key_old.MakeNewKey(true);
+        key_new.MakeNewKey(true);
+        const CScript script_old = CScript() << ToByteVector(key_old.GetPubKey()) << OP_CHECKSIG;
+        const CScript script_new = CScript() << ToByteVector(key_new.GetPubKey()) << OP_CHECKSIG;
+
+        // Build the longer branch first and invalidate it, so that the shorter one becomes the active chain.
+        std::vector<uint256> new_hashes;
+        for (int i = 0; i < branch_length + 1; i++) {
+            new_hashes.push_back(CreateAndProcessBlock({}, script_new).GetHash());
+        }
+        CBlockIndex* new_root = WITH_LOCK(cs_main, return LookupBlockIndex(new_hashes[0]));
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), new_root));
+        std::vector<uint256> old_hashes;
+        for (int i = 0; i < branch_length; i++) {
+            old_hashes.push_back(CreateAndProcessBlock({}, script_old).GetHash());
+        }
+        BOOST_CHECK(WITH_LOCK(cs_main, return ::ChainActive().Tip()->GetBlockHash()) == old_hashes.back());
+
+        // Both indexes sync at the same time, sharing the read-ahead workers.
+        AddressIndex addressindex(1 << 20, true);
+        TimestampIndex timestampindex(1 << 20, true);
+        addressindex.Start();
+        timestampindex.Start();
+        MilliSleep(delay_ms);
+        {
+            LOCK(cs_main);
+            ResetBlockFailureFlags(new_root);
+        }
+        BOOST_CHECK(ActivateBestChain(state, Params()));
+        BOOST_CHECK(WITH_LOCK(cs_main, return ::ChainActive().Tip()->GetBlockHash()) == new_hashes.back());
+        WaitUntilSynced(addressindex);
+        WaitUntilSynced(timestampindex);
+
+        std::vector<CAddressUnspent> unspent;
+        BOOST_CHECK(addressindex.FindUnspent(GetAddressIndexScriptHash(script_old), unspent));
+        BOOST_CHECK(unspent.empty());
+        std::vector<CAddressIndexDelta> deltas;
+        BOOST_CHECK(addressindex.FindDeltas(GetAddressIndexScriptHash(script_old), 0, -1, deltas));
+        BOOST_CHECK(deltas.empty());
+        BOOST_CHECK(addressindex.FindUnspent(GetAddressIndexScriptHash(script_new), unspent));
+        BOOST_CHECK_EQUAL(unspent.size(), new_hashes.size());
+
+        std::vector<uint256> hashes;
+        BOOST_CHECK(timestampindex.FindBlockHashes(std::numeric_limits<uint32_t>::max(), 0, hashes));
+        BOOST_CHECK_EQUAL(hashes.size(), (size_t)WITH_LOCK(cs_main, return ::ChainActive().Height()) + 1);
+        for (const uint256& hash : old_hashes) {
+            BOOST_CHECK(std::find(hashes.begin(), hashes.end(), hash) == hashes.end());
+        }
+        for (const uint256& hash : new_hashes) {
+            BOOST_CHECK(std::find(hashes.begin(), hashes.end(), hash) != hashes.end());
+        }
+
+        addressindex.Stop();
+        timestampindex.Stop();
+    }
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    // Rest of shutdown sequence and destructors happen in ~TestingSetup()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 #include <addrman.h>
+#include <dbwrapper.h>
 #include <test/setup_common.h>
 #include <string>
 #include <boost/test/unit_test.hpp>
@@ -410,6 +411,110 @@ BOOST_AUTO_TEST_CASE(addrman_getaddr)
 }
 
 
+BOOST_AUTO_TEST_CASE(addrman_db)
+{
+    CAddress addr1 = CAddress(ResolveService("250.250.2.1", 30001), NODE_NONE);
+    addr1.nTime = GetAdjustedTime();
+    CAddress addr2 = CAddress(ResolveService("250.251.2.2", 9999), NODE_NONE);
+    addr2.nTime = GetAdjustedTime();
+    CAddress addr3 = CAddress(ResolveService("251.252.2.3", 30001), NODE_NONE);
+    addr3.nTime = GetAdjustedTime();
+    CNetAddr source1 = ResolveIP("250.1.2.1");
+    CNetAddr source2 = ResolveIP("250.2.3.3");
+
+    size_t nSize;
+    {
+        CAddrManTest addrman;
+        BOOST_CHECK(addrman.InitDB(true));
+        BOOST_CHECK(addrman.Add(addr1, source1));
+        BOOST_CHECK(addrman.Add(addr2, source2));
+        addrman.Good(CAddress(addr1, NODE_NONE));
+        for (unsigned int i = 1; i < 256; i++) {
+            std::string strAddr = std::to_string(i) + ".1.1.23";
+            CAddress addr = CAddress(ResolveService(strAddr), NODE_NONE);
+            addr.nTime = GetAdjustedTime();
+            addrman.Add(addr, ResolveIP(strAddr));
+        }
+        nSize = addrman.size();
+        addrman.Flush();
+    }
+
+    // Test: The tables are restored from the peers database, including the tried entries.
+    {
+        CAddrManTest addrman(false);
+        BOOST_CHECK(addrman.InitDB(false));
+        BOOST_CHECK_EQUAL(addrman.size(), nSize);
+        BOOST_CHECK(addrman.GetAddressInfo(addr1) == addr1);
+        BOOST_CHECK(addrman.GetAddressInfo(addr2) == addr2);
+        BOOST_CHECK(addrman.Select(true) != addr1);
+
+        // Test: Only changes are written, but they survive the next restart as well.
+        BOOST_CHECK(addrman.Add(addr3, source1));
+        addrman.SetServices(addr2, NODE_NETWORK);
+        addrman.Flush();
+    }
+    {
+        CAddrManTest addrman(false);
+        BOOST_CHECK(addrman.InitDB(false));
+        BOOST_CHECK_EQUAL(addrman.size(), nSize + 1);
+        BOOST_CHECK(addrman.GetAddressInfo(addr3) == addr3);
+        BOOST_CHECK_EQUAL(addrman.GetAddressInfo(addr2).nServices, NODE_NETWORK);
+    }
+
+    // Test: Clearing the tables also clears the database.
+    {
+        CAddrManTest addrman(false);
+        BOOST_CHECK(addrman.InitDB(false));
+        addrman.Clear();
+        addrman.Flush();
+    }
+    {
+        CAddrManTest addrman(false);
+        BOOST_CHECK(addrman.InitDB(false));
+        BOOST_CHECK_EQUAL(addrman.size(), 0U);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(addrman_db_corrupt)
+{
+    CAddress addr1 = CAddress(ResolveService("250.250.2.1", 30001), NODE_NONE);
+    addr1.nTime = GetAdjustedTime();
+    CAddress addr2 = CAddress(ResolveService("250.251.2.2", 9999), NODE_NONE);
+    addr2.nTime = GetAdjustedTime();
+    CNetAddr source = ResolveIP("250.1.2.1");
+
+    {
+        CAddrManTest addrman;
+        BOOST_CHECK(addrman.InitDB(true));
+        BOOST_CHECK(addrman.Add(addr1, source));
+        addrman.Flush();
+    }
+
+    // An entry which cannot be deserialized, under the key prefix of the entries in addrman.cpp
+    {
+        CDBWrapper db(GetDataDir() / "peers", 1 << 20, false, false);
+        BOOST_CHECK(db.Write(std::make_tuple(std::string("am_a"), CService(addr2)), (uint8_t)1));
+    }
+
+    // Test: Loading fails, and the database can be recreated like in CConnman::Start while the failed handle is open.
+    {
+        CAddrManTest addrman(false);
+        BOOST_CHECK(!addrman.InitDB(false));
+        BOOST_CHECK(addrman.InitDB(true));
+        BOOST_CHECK_EQUAL(addrman.size(), 0U);
+        BOOST_CHECK(addrman.Add(addr2, source));
+        addrman.Flush();
+    }
+
+    // Test: The recreated database only holds the entries added after the wipe.
+    {
+        CAddrManTest addrman(false);
+        BOOST_CHECK(addrman.InitDB(false));
+        BOOST_CHECK_EQUAL(addrman.size(), 1U);
+        BOOST_CHECK(addrman.GetAddressInfo(addr2) == addr2);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(caddrinfo_get_tried_bucket)
 {
     CAddrManTest addrman;
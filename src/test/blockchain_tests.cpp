@@ -3,8 +3,11 @@
 #include <stdlib.h>
 
 #include <chain.h>
+#include <clientversion.h>
 #include <rpc/blockchain.h>
+#include <streams.h>
 #include <test/setup_common.h>
+#include <validation.h>
 
 /* Equality between doubles is imprecise. Comparison should be done
  * with a small threshold of tolerance, rather than exact equality.
@@ -69,4 +72,60 @@ BOOST_AUTO_TEST_CASE(get_difficulty_for_very_high_target)
     TestDifficulty(0x12345678, 5913134931067755359633408.0);
 }
 
+BOOST_AUTO_TEST_CASE(block_index_pos_data)
+{
+    LOCK(cs_main);
+    uint256 hash = InsecureRand256();
+    CBlockIndex index;
+    index.phashBlock = &hash;
+    index.SetProofOfStake();
+    index.nStakeModifier = 0x0123456789abcdef;
+
+    CBlockIndexPoSData data;
+    data.nMint = 5 * COIN;
+    data.nMoneySupply = 1000 * COIN;
+    data.prevoutStake = COutPoint(InsecureRand256(), 1);
+    data.nStakeTime = 1269211443;
+    data.hashProofOfStake = InsecureRand256();
+    index.SetPoSData(data);
+
+    // copies hold their own cold fields
+    CBlockIndex copy = index;
+    copy.GetMutablePoSData().nMint = 0;
+    BOOST_CHECK_EQUAL(index.GetPoSData().nMint, 5 * COIN);
+
+    // the cold fields are written with the entry, but not held by the entry which is read back
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << CDiskBlockIndex(&index);
+    CDiskBlockIndex diskindex;
+    ss >> diskindex;
+    BOOST_CHECK(!diskindex.HasPoSData());
+    BOOST_CHECK(diskindex.IsProofOfStake());
+    BOOST_CHECK_EQUAL(diskindex.nStakeModifier, index.nStakeModifier);
+    BOOST_CHECK_EQUAL(diskindex.diskPoSData.nMint, data.nMint);
+    BOOST_CHECK_EQUAL(diskindex.diskPoSData.nMoneySupply, data.nMoneySupply);
+    BOOST_CHECK(diskindex.diskPoSData.prevoutStake == data.prevoutStake);
+    BOOST_CHECK_EQUAL(diskindex.diskPoSData.nStakeTime, data.nStakeTime);
+    BOOST_CHECK(diskindex.diskPoSData.hashProofOfStake == data.hashProofOfStake);
+
+    index.ReleasePoSData();
+    BOOST_CHECK(!index.HasPoSData());
+}
+
+BOOST_FIXTURE_TEST_CASE(block_index_pos_data_flush, TestChain100Setup)
+{
+    LOCK(cs_main);
+    const CBlockIndex* pindex = ::ChainActive().Tip()->pprev;
+    BOOST_CHECK(pindex->HasPoSData());
+    CAmount nMoneySupply = pindex->GetPoSData().nMoneySupply;
+    BOOST_CHECK(nMoneySupply > 0);
+
+    // the cold fields of the written entries are released, except for the tip, and read again on the next access
+    ::ChainstateActive().ForceFlushStateToDisk();
+    BOOST_CHECK(!pindex->HasPoSData());
+    BOOST_CHECK(::ChainActive().Tip()->HasPoSData());
+    BOOST_CHECK_EQUAL(pindex->GetPoSData().nMoneySupply, nMoneySupply);
+    BOOST_CHECK(pindex->HasPoSData());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
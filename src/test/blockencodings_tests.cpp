@@ -8,13 +8,13 @@
 #include <pow.h>
 #include <streams.h>
 
-#include <test/util/setup_common.h>
+#include <test/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
 
 std::vector<std::pair<uint256, CTransactionRef>> extra_txn;
 
-BOOST_FIXTURE_TEST_SUITE(blockencodings_tests, RegTestingSetup)
+BOOST_FIXTURE_TEST_SUITE(blockencodings_tests, TestingSetup)
 
 static CBlock BuildBlockTestCase() {
     CBlock block;
@@ -113,6 +113,7 @@ class TestHeaderAndShortIDs {
 public:
     CBlockHeader header;
     uint64_t nonce;
+    std::vector<unsigned char> vchBlockSig;
     std::vector<uint64_t> shorttxids;
     std::vector<PrefilledTransaction> prefilledtxn;
 
@@ -132,7 +133,25 @@ public:
         return base.GetShortID(txhash);
     }
 
-    SERIALIZE_METHODS(TestHeaderAndShortIDs, obj) { READWRITE(obj.header, obj.nonce, Using<VectorFormatter<CustomUintFormatter<CBlockHeaderAndShortTxIDs::SHORTTXIDS_LENGTH>>>(obj.shorttxids), obj.prefilledtxn); }
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(header);
+        READWRITE(nonce);
+        READWRITE(vchBlockSig);
+        uint64_t shorttxids_size = shorttxids.size();
+        READWRITE(COMPACTSIZE(shorttxids_size));
+        shorttxids.resize(shorttxids_size);
+        for (size_t i = 0; i < shorttxids.size(); i++) {
+            uint32_t lsb = shorttxids[i] & 0xffffffff;
+            uint16_t msb = (shorttxids[i] >> 32) & 0xffff;
+            READWRITE(lsb);
+            READWRITE(msb);
+            shorttxids[i] = (uint64_t(msb) << 32) | uint64_t(lsb);
+        }
+        READWRITE(prefilledtxn);
+    }
 };
 
 BOOST_AUTO_TEST_CASE(NonCoinbasePreforwardRTTest)
@@ -300,6 +319,79 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(NonMempoolPrefillRoundTripTest)
+{
+    CTxMemPool pool;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig.resize(10);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 42;
+
+    CBlock block;
+    block.vtx.resize(5);
+    block.vtx[0] = MakeTransactionRef(tx);
+    block.nVersion = 42;
+    block.hashPrevBlock = InsecureRand256();
+    block.nBits = 0x207fffff;
+
+    // coinstake
+    tx.vin[0].prevout.hash = InsecureRand256();
+    tx.vin[0].prevout.n = 0;
+    tx.vout.resize(2);
+    tx.vout[0].SetEmpty();
+    tx.vout[1].nValue = 42;
+    block.vtx[1] = MakeTransactionRef(tx);
+    BOOST_CHECK(block.vtx[1]->IsCoinStake());
+
+    tx.vin[0].prevout.hash = InsecureRand256();
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 42;
+    block.vtx[2] = MakeTransactionRef(tx);
+
+    // quorum commitment
+    CMutableTransaction qcTx;
+    qcTx.nVersion = 3;
+    qcTx.nType = TRANSACTION_QUORUM_COMMITMENT;
+    qcTx.vExtraPayload.resize(10);
+    block.vtx[3] = MakeTransactionRef(qcTx);
+
+    tx.vin[0].prevout.hash = InsecureRand256();
+    block.vtx[4] = MakeTransactionRef(tx);
+
+    bool mutated;
+    block.hashMerkleRoot = BlockMerkleRoot(block, &mutated);
+    assert(!mutated);
+    while (!CheckProofOfWork(block.GetHash(), block.nBits, Params().GetConsensus())) ++block.nNonce;
+
+    // Coinbase, coinstake and quorum commitment can't be in the receivers mempool, so they must be prefilled
+    {
+        CBlockHeaderAndShortTxIDs shortIDs(block, false);
+        BOOST_CHECK_EQUAL(shortIDs.BlockTxCount(), 5U);
+
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << shortIDs;
+
+        CBlockHeaderAndShortTxIDs shortIDs2;
+        stream >> shortIDs2;
+
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(shortIDs2, extra_txn) == READ_STATUS_OK);
+        BOOST_CHECK( partialBlock.IsTxAvailable(0));
+        BOOST_CHECK( partialBlock.IsTxAvailable(1));
+        BOOST_CHECK(!partialBlock.IsTxAvailable(2));
+        BOOST_CHECK( partialBlock.IsTxAvailable(3));
+        BOOST_CHECK(!partialBlock.IsTxAvailable(4));
+
+        CBlock block2;
+        std::vector<CTransactionRef> vtx_missing{block.vtx[2], block.vtx[4]};
+        BOOST_CHECK(partialBlock.FillBlock(block2, vtx_missing) == READ_STATUS_OK);
+        BOOST_CHECK_EQUAL(block.GetHash().ToString(), block2.GetHash().ToString());
+        BOOST_CHECK_EQUAL(block.hashMerkleRoot.ToString(), BlockMerkleRoot(block2, &mutated).ToString());
+        BOOST_CHECK(!mutated);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(TransactionsRequestSerializationTest) {
     BlockTransactionsRequest req1;
     req1.blockhash = InsecureRand256();
@@ -9,6 +9,7 @@
 #include <script/standard.h>
 #include <streams.h>
 #include <test/setup_common.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <util/strencodings.h>
@@ -862,4 +863,85 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+void CheckDetachDirty(CAmount cache_value, char cache_flags, bool erase,
+                      CAmount expected_cache_value, char expected_cache_flags,
+                      CAmount expected_detached_value, char expected_detached_flags)
+{
+    SingleEntryCacheTest test(ABSENT, cache_value, cache_flags);
+    size_t usage;
+    std::unique_ptr<CCoinsMap> detached = test.cache.DetachDirty(erase, usage);
+    test.cache.SelfTest();
+
+    CAmount result_value;
+    char result_flags;
+    GetCoinsMapEntry(test.cache.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_cache_value);
+    BOOST_CHECK_EQUAL(result_flags, expected_cache_flags);
+    GetCoinsMapEntry(*detached, result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_detached_value);
+    BOOST_CHECK_EQUAL(result_flags, expected_detached_flags);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_detach_dirty)
+{
+    /* Check DetachDirty behavior, requesting the changes of a single cache
+     * entry, either keeping the unspent coins cached or erasing them.
+     *
+     *              Cache   Cache        Erase  Result  Result       Detached  Detached
+     *              Value   Flags               Value   Flags        Value     Flags
+     */
+    CheckDetachDirty(ABSENT, NO_ENTRY   , false, ABSENT, NO_ENTRY   , ABSENT  , NO_ENTRY   );
+    CheckDetachDirty(PRUNED, 0          , false, PRUNED, 0          , ABSENT  , NO_ENTRY   );
+    CheckDetachDirty(PRUNED, FRESH      , false, PRUNED, FRESH      , ABSENT  , NO_ENTRY   );
+    CheckDetachDirty(PRUNED, DIRTY      , false, ABSENT, NO_ENTRY   , PRUNED  , DIRTY      );
+    CheckDetachDirty(PRUNED, DIRTY|FRESH, false, ABSENT, NO_ENTRY   , ABSENT  , NO_ENTRY   );
+    CheckDetachDirty(VALUE1, 0          , false, VALUE1, 0          , ABSENT  , NO_ENTRY   );
+    CheckDetachDirty(VALUE1, FRESH      , false, VALUE1, FRESH      , ABSENT  , NO_ENTRY   );
+    CheckDetachDirty(VALUE1, DIRTY      , false, VALUE1, 0          , VALUE1  , DIRTY      );
+    CheckDetachDirty(VALUE1, DIRTY|FRESH, false, VALUE1, 0          , VALUE1  , DIRTY      );
+    CheckDetachDirty(ABSENT, NO_ENTRY   , true , ABSENT, NO_ENTRY   , ABSENT  , NO_ENTRY   );
+    CheckDetachDirty(PRUNED, 0          , true , ABSENT, NO_ENTRY   , PRUNED  , 0          );
+    CheckDetachDirty(PRUNED, DIRTY|FRESH, true , ABSENT, NO_ENTRY   , PRUNED  , DIRTY|FRESH);
+    CheckDetachDirty(VALUE1, 0          , true , ABSENT, NO_ENTRY   , VALUE1  , 0          );
+    CheckDetachDirty(VALUE1, DIRTY      , true , ABSENT, NO_ENTRY   , VALUE1  , DIRTY      );
+}
+
+BOOST_AUTO_TEST_CASE(coins_db_async_write)
+{
+    CCoinsViewDB db(1 << 20, true);
+    const COutPoint spent(InsecureRand256(), 0);
+    const COutPoint created(InsecureRand256(), 1);
+    const uint256 first_block = InsecureRand256();
+    const uint256 second_block = InsecureRand256();
+
+    CCoinsMap map;
+    InsertCoinsMapEntry(map, VALUE1, DIRTY);
+    map.emplace(spent, CCoinsCacheEntry(Coin(CTxOut(VALUE1, CScript()), 1, false, false)));
+    map.find(spent)->second.flags = DIRTY;
+    BOOST_CHECK(db.BatchWrite(map, first_block));
+    BOOST_CHECK(db.HaveCoin(spent));
+
+    // Spend one coin and create another in the background, reads see the new state right away
+    std::unique_ptr<CCoinsMap> changes = MakeUnique<CCoinsMap>();
+    InsertCoinsMapEntry(*changes, PRUNED, DIRTY);
+    changes->emplace(spent, CCoinsCacheEntry());
+    changes->find(spent)->second.flags = DIRTY;
+    changes->emplace(created, CCoinsCacheEntry(Coin(CTxOut(VALUE2, CScript()), 2, false, false)));
+    changes->find(created)->second.flags = DIRTY;
+    BOOST_CHECK(db.BatchWriteAsync(std::move(changes), second_block, 0));
+    Coin coin;
+    BOOST_CHECK(!db.GetCoin(spent, coin));
+    BOOST_CHECK(!db.HaveCoin(OUTPOINT));
+    BOOST_CHECK(db.GetCoin(created, coin) && coin.out.nValue == VALUE2);
+    BOOST_CHECK(db.GetBestBlock() == second_block);
+
+    BOOST_CHECK(db.WaitForAsyncWrite());
+    BOOST_CHECK_EQUAL(db.AsyncWriteMemoryUsage(), 0U);
+    BOOST_CHECK(!db.GetCoin(spent, coin));
+    BOOST_CHECK(!db.HaveCoin(OUTPOINT));
+    BOOST_CHECK(db.GetCoin(created, coin) && coin.out.nValue == VALUE2);
+    BOOST_CHECK(db.GetBestBlock() == second_block);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
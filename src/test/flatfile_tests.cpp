@@ -124,4 +124,70 @@ BOOST_AUTO_TEST_CASE(flatfile_flush)
     BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(0, 1))), 1);
 }
 
+#ifndef WIN32
+BOOST_AUTO_TEST_CASE(flatfile_map_cache)
+{
+    const auto data_dir = GetDataDir();
+    FlatFileSeq seq(data_dir, "a", 100);
+    FlatFileMapCache cache(1);
+
+    const std::string line1("A purely peer-to-peer version of electronic cash would allow online "
+                            "payments to be sent directly from one party to another without going "
+                            "through a financial institution.");
+    const std::string line2("Digital signatures provide part of the solution, but the main "
+                            "benefits are lost if a trusted third party is still required to "
+                            "prevent double-spending.");
+
+    const fs::path path = seq.FileName(FlatFilePos(0, 0));
+    BOOST_CHECK(cache.Get(path, 1) == nullptr);
+
+    {
+        CAutoFile file(seq.Open(FlatFilePos(0, 0)), SER_DISK, CLIENT_VERSION);
+        file << LIMITED_STRING(line1, 256);
+    }
+    const size_t size1 = fs::file_size(path);
+
+    auto mapping1 = cache.Get(path, size1);
+    BOOST_REQUIRE(mapping1 != nullptr);
+    BOOST_CHECK_EQUAL(mapping1->GetData().size(), size1);
+    std::string text;
+    SpanReader(SER_DISK, CLIENT_VERSION, mapping1->GetData()) >> LIMITED_STRING(text, 256);
+    BOOST_CHECK_EQUAL(text, line1);
+    BOOST_CHECK(cache.Get(path, size1) == mapping1);
+
+    // The file is mapped again once it has grown, while the old mapping stays valid.
+    {
+        CAutoFile file(seq.Open(FlatFilePos(0, size1)), SER_DISK, CLIENT_VERSION);
+        file << LIMITED_STRING(line2, 256);
+    }
+    const size_t size2 = fs::file_size(path);
+    BOOST_CHECK(cache.Get(path, size2 + 1) == nullptr);
+    auto mapping2 = cache.Get(path, size2);
+    BOOST_REQUIRE(mapping2 != nullptr);
+    BOOST_CHECK(mapping2 != mapping1);
+    SpanReader(SER_DISK, CLIENT_VERSION, mapping2->GetData().subspan(size1)) >> LIMITED_STRING(text, 256);
+    BOOST_CHECK_EQUAL(text, line2);
+    SpanReader(SER_DISK, CLIENT_VERSION, mapping1->GetData()) >> LIMITED_STRING(text, 256);
+    BOOST_CHECK_EQUAL(text, line1);
+
+    // Only one file is kept mapped.
+    {
+        CAutoFile file(seq.Open(FlatFilePos(1, 0)), SER_DISK, CLIENT_VERSION);
+        file << LIMITED_STRING(line1, 256);
+    }
+    BOOST_CHECK(cache.Get(seq.FileName(FlatFilePos(1, 0)), 1) != nullptr);
+    BOOST_CHECK(cache.Get(path, size2) != mapping2);
+
+    cache.Invalidate(path);
+    BOOST_CHECK(cache.Get(path, size2) != nullptr);
+
+    // A truncated file is not served from its old, larger mapping.
+    BOOST_CHECK(seq.Flush(FlatFilePos(0, size1), true));
+    BOOST_CHECK(cache.Get(path, size2) == nullptr);
+    auto mapping3 = cache.Get(path, size1);
+    BOOST_REQUIRE(mapping3 != nullptr);
+    BOOST_CHECK_EQUAL(mapping3->GetData().size(), size1);
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,131 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <dbwrapper.h>
+#include <llmq/quorums_instantsend.h>
+#include <primitives/transaction.h>
+#include <test/setup_common.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+struct CInstantSendManagerTest : public llmq::CInstantSendManager {
+    using llmq::CInstantSendManager::CInstantSendManager;
+
+    void AddNonLocked(const CTransactionRef& tx, const CBlockIndex* pindexMined = nullptr)
+    {
+        LOCK(cs);
+        AddNonLockedTx(tx);
+        nonLockedTxs.at(tx->GetHash()).pindexMined = pindexMined;
+    }
+    // What SyncTransaction and ProcessInstantSendLock do once a TX got an ISLOCK
+    void ReceiveISLock(const uint256& txid)
+    {
+        LOCK(cs);
+        AddRecentLockedTxIfUnmined(txid);
+        RemoveNonLockedTx(txid, true);
+    }
+    // What SyncTransaction does once a TX got ChainLocked without an ISLOCK
+    void ReceiveChainLock(const uint256& txid)
+    {
+        LOCK(cs);
+        RemoveNonLockedTx(txid, true);
+    }
+    void AddRecentLocked(const CTransactionRef& tx)
+    {
+        LOCK(cs);
+        AddRecentLockedTx(tx);
+    }
+    std::vector<uint256> GetCompactBlockTxids()
+    {
+        std::vector<std::pair<uint256, CTransactionRef>> txs;
+        GetTransactionsForCompactBlocks(txs);
+        std::vector<uint256> ret;
+        for (const auto& p : txs) {
+            ret.emplace_back(p.second->GetHash());
+        }
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    }
+};
+
+static CTransactionRef MakeTx(uint32_t n)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(InsecureRand256(), n);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = n;
+    return MakeTransactionRef(tx);
+}
+
+static bool Contains(const std::vector<uint256>& txids, const CTransactionRef& tx)
+{
+    return std::binary_search(txids.begin(), txids.end(), tx->GetHash());
+}
+
+BOOST_FIXTURE_TEST_SUITE(instantsend_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(recent_locked_txs_ring)
+{
+    CDBWrapper db(GetDataDir() / "llmq", 1 << 20, true);
+    CInstantSendManagerTest isman(db);
+
+    const size_t nMax = 1000;
+    std::vector<CTransactionRef> txs;
+    for (uint32_t i = 0; i < nMax + 10; i++) {
+        txs.emplace_back(MakeTx(i));
+        isman.AddRecentLocked(txs.back());
+    }
+
+    // Only the most recent TXs are kept, the oldest ones were overwritten
+    const auto txids = isman.GetCompactBlockTxids();
+    BOOST_CHECK_EQUAL(txids.size(), nMax);
+    for (size_t i = 0; i < txs.size(); i++) {
+        BOOST_CHECK_EQUAL(Contains(txids, txs[i]), i >= 10);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(recent_locked_txs_is_locked_only)
+{
+    CDBWrapper db(GetDataDir() / "llmq", 1 << 20, true);
+    CInstantSendManagerTest isman(db);
+    CBlockIndex index;
+
+    const auto txUnmined = MakeTx(1);
+    const auto txMined = MakeTx(2);
+    const auto txChainLocked = MakeTx(3);
+    isman.AddNonLocked(txUnmined);
+    isman.AddNonLocked(txMined, &index);
+    isman.AddNonLocked(txChainLocked);
+
+    // Mined TXs are not needed for compact blocks anymore
+    auto txids = isman.GetCompactBlockTxids();
+    BOOST_CHECK_EQUAL(txids.size(), 2U);
+    BOOST_CHECK(Contains(txids, txUnmined));
+    BOOST_CHECK(Contains(txids, txChainLocked));
+
+    // An IS locked mempool TX moves over to the ring, a mined one does not
+    isman.ReceiveISLock(txUnmined->GetHash());
+    isman.ReceiveISLock(txMined->GetHash());
+    txids = isman.GetCompactBlockTxids();
+    BOOST_CHECK_EQUAL(txids.size(), 2U);
+    BOOST_CHECK(Contains(txids, txUnmined));
+    BOOST_CHECK(Contains(txids, txChainLocked));
+
+    // A TX which is only ChainLocked is in a block already and is not kept
+    isman.ReceiveChainLock(txChainLocked->GetHash());
+    txids = isman.GetCompactBlockTxids();
+    BOOST_CHECK_EQUAL(txids.size(), 1U);
+    BOOST_CHECK(Contains(txids, txUnmined));
+
+    // Locking the same TX again doesn't add it twice
+    isman.ReceiveISLock(txUnmined->GetHash());
+    BOOST_CHECK_EQUAL(isman.GetCompactBlockTxids().size(), 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,184 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <clientversion.h>
+#include <masternodes/meta.h>
+#include <streams.h>
+#include <test/setup_common.h>
+
+#include <map>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternode_meta_tests, BasicTestingSetup)
+
+typedef std::map<uint256, std::map<uint256, int> > VoteMap;
+
+// Reads the governance votes of a meta info back from its serialization
+static std::map<uint256, int> GetVotes(const CMasternodeMetaInfo& mm)
+{
+    CDataStream ds(SER_DISK, CLIENT_VERSION);
+    ds << mm;
+    uint256 proTxHash;
+    int64_t nLastDsq;
+    int nMixingTxCount;
+    std::map<uint256, int> votes;
+    ds >> proTxHash >> nLastDsq >> nMixingTxCount >> votes;
+    BOOST_CHECK(proTxHash == mm.GetProTxHash());
+    return votes;
+}
+
+static void CheckVotes(CMasternodeMetaMan& metaman, const VoteMap& expected)
+{
+    for (const auto& p : expected) {
+        auto mm = metaman.GetMetaInfo(p.first, false);
+        BOOST_CHECK(mm != nullptr);
+        if (mm) {
+            BOOST_CHECK(GetVotes(*mm) == p.second);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(masternode_meta_db_roundtrip)
+{
+    // Enough masternodes to put entries into every shard
+    std::vector<uint256> proTxHashes;
+    for (int i = 0; i < 100; i++) {
+        proTxHashes.emplace_back(InsecureRand256());
+    }
+    const uint256 gobj1 = InsecureRand256();
+    const uint256 gobj2 = InsecureRand256();
+
+    VoteMap expected;
+    {
+        CMasternodeMetaMan metaman;
+        BOOST_CHECK(metaman.InitDB(true));
+        for (size_t i = 0; i < proTxHashes.size(); i++) {
+            metaman.AddGovernanceVote(proTxHashes[i], gobj1);
+            expected[proTxHashes[i]][gobj1]++;
+            if (i % 3 == 0) {
+                metaman.AddGovernanceVote(proTxHashes[i], gobj1);
+                metaman.AddGovernanceVote(proTxHashes[i], gobj2);
+                expected[proTxHashes[i]][gobj1]++;
+                expected[proTxHashes[i]][gobj2]++;
+            }
+        }
+        CheckVotes(metaman, expected);
+        metaman.CloseDB();
+    }
+
+    {
+        // Everything is loaded back, and entries which are not touched again survive later flushes
+        CMasternodeMetaMan metaman;
+        BOOST_CHECK(metaman.InitDB(false));
+        CheckVotes(metaman, expected);
+        BOOST_CHECK(metaman.GetMetaInfo(InsecureRand256(), false) == nullptr);
+
+        metaman.RemoveGovernanceObject(gobj2);
+        for (auto& p : expected) {
+            p.second.erase(gobj2);
+        }
+        metaman.AddGovernanceVote(proTxHashes[1], gobj2);
+        expected[proTxHashes[1]][gobj2]++;
+        metaman.Flush();
+        metaman.AddGovernanceVote(proTxHashes[2], gobj2);
+        expected[proTxHashes[2]][gobj2]++;
+        metaman.CloseDB();
+    }
+
+    {
+        CMasternodeMetaMan metaman;
+        BOOST_CHECK(metaman.InitDB(false));
+        CheckVotes(metaman, expected);
+        metaman.CloseDB();
+    }
+
+    {
+        // Wiping drops all entries
+        CMasternodeMetaMan metaman;
+        BOOST_CHECK(metaman.InitDB(true));
+        for (const auto& proTxHash : proTxHashes) {
+            BOOST_CHECK(metaman.GetMetaInfo(proTxHash, false) == nullptr);
+        }
+        metaman.CloseDB();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(masternode_meta_import_flat_file)
+{
+    const uint256 proTxHash = InsecureRand256();
+    const uint256 gobj = InsecureRand256();
+
+    // The legacy mncache.dat contents, as init.cpp imports them
+    CDataStream ds(SER_DISK, CLIENT_VERSION);
+    {
+        CMasternodeMetaMan metaman;
+        metaman.AddGovernanceVote(proTxHash, gobj);
+        ds << metaman;
+    }
+    {
+        CMasternodeMetaMan metaman;
+        BOOST_CHECK(metaman.InitDB(true));
+        ds >> metaman;
+        metaman.Flush();
+        metaman.CloseDB();
+    }
+    {
+        CMasternodeMetaMan metaman;
+        BOOST_CHECK(metaman.InitDB(false));
+        CheckVotes(metaman, {{proTxHash, {{gobj, 1}}}});
+        metaman.CloseDB();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(masternode_meta_concurrent_votes)
+{
+    CMasternodeMetaMan metaman;
+    BOOST_CHECK(metaman.InitDB(true));
+
+    std::vector<uint256> proTxHashes;
+    for (int i = 0; i < 32; i++) {
+        proTxHashes.emplace_back(InsecureRand256());
+    }
+    const uint256 gobj = InsecureRand256();
+
+    // Every thread votes for every masternode and flushes in between, no vote or dirty hash may get lost
+    const int nThreads = 4;
+    const int nRounds = 50;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < nRounds; i++) {
+                for (const auto& proTxHash : proTxHashes) {
+                    metaman.AddGovernanceVote(proTxHash, gobj);
+                }
+                metaman.AddDirtyGovernanceObjectHash(gobj);
+                if (i % 10 == 0) {
+                    metaman.Flush();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    VoteMap expected;
+    for (const auto& proTxHash : proTxHashes) {
+        expected[proTxHash][gobj] = nThreads * nRounds;
+    }
+    CheckVotes(metaman, expected);
+    BOOST_CHECK_EQUAL(metaman.GetAndClearDirtyGovernanceObjectHashes().size(), (size_t)(nThreads * nRounds));
+    BOOST_CHECK(metaman.GetAndClearDirtyGovernanceObjectHashes().empty());
+    metaman.CloseDB();
+
+    CMasternodeMetaMan metaman2;
+    BOOST_CHECK(metaman2.InitDB(false));
+    CheckVotes(metaman2, expected);
+    metaman2.CloseDB();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -304,5 +304,51 @@ BOOST_AUTO_TEST_CASE(LocalAddress_BasicLifecycle)
     BOOST_CHECK_EQUAL(IsLocal(addr), false);
 }
 
+BOOST_AUTO_TEST_CASE(prepared_message)
+{
+    CSerializedNetMsg msg;
+    msg.command = "ping";
+    msg.data = {1, 2, 3, 4, 5, 6, 7, 8};
+
+    CPreparedNetMsgRef prepared = CConnman::PrepareMessage(std::move(msg));
+    BOOST_CHECK_EQUAL(prepared->command, "ping");
+    BOOST_CHECK_EQUAL(prepared->header.size(), CMessageHeader::HEADER_SIZE);
+    BOOST_CHECK_EQUAL(prepared->data.size(), 8U);
+    BOOST_CHECK_EQUAL(prepared->size(), CMessageHeader::HEADER_SIZE + 8);
+
+    // the header must read back as a valid header for the payload
+    CDataStream ss(prepared->header, SER_NETWORK, INIT_PROTO_VERSION);
+    CMessageHeader hdr(Params().MessageStart());
+    ss >> hdr;
+    BOOST_CHECK(hdr.IsValid(Params().MessageStart()));
+    BOOST_CHECK_EQUAL(hdr.GetCommand(), "ping");
+    BOOST_CHECK_EQUAL(hdr.nMessageSize, 8U);
+    uint256 hash = Hash(prepared->data.begin(), prepared->data.end());
+    BOOST_CHECK(memcmp(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(socket_events_mode)
+{
+    // every supported mode parses back to itself, and the default is one of them
+    const std::string strModes = GetSupportedSocketEventsModes();
+    bool fDefaultSupported = false;
+    for (SocketEventsMode mode : {SOCKETEVENTS_SELECT, SOCKETEVENTS_POLL, SOCKETEVENTS_EPOLL}) {
+        const std::string strName = GetSocketEventsModeName(mode);
+        SocketEventsMode parsed;
+        bool fSupported = ParseSocketEventsMode(strName, parsed);
+        BOOST_CHECK_EQUAL(fSupported, strModes.find(strName) != std::string::npos);
+        if (fSupported) {
+            BOOST_CHECK_EQUAL(parsed, mode);
+            fDefaultSupported |= mode == DEFAULT_SOCKETEVENTS;
+        }
+    }
+    BOOST_CHECK(fDefaultSupported);
+
+    SocketEventsMode parsed;
+    BOOST_CHECK(ParseSocketEventsMode("select", parsed));
+    BOOST_CHECK(!ParseSocketEventsMode("", parsed));
+    BOOST_CHECK(!ParseSocketEventsMode("Select", parsed));
+    BOOST_CHECK(!ParseSocketEventsMode("kqueue", parsed));
+}
 
 BOOST_AUTO_TEST_SUITE_END()
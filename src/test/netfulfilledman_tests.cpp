@@ -0,0 +1,163 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <netbase.h>
+#include <netfulfilledman.h>
+#include <test/setup_common.h>
+#include <tinyformat.h>
+#include <util/time.h>
+
+#include <iterator>
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(netfulfilledman_tests, BasicTestingSetup)
+
+// Tick counts of the wheel levels, see CNetFulfilledRequestManager
+static const int64_t LEVEL1_TICKS = 64;
+static const int64_t LEVEL2_TICKS = 64 * 64;
+static const int64_t WHEEL_TICKS = 64 * 64 * 64;
+
+static CService GetAddr(int n)
+{
+    return LookupNumeric(strprintf("1.2.3.%d", n).c_str(), 1234);
+}
+
+BOOST_AUTO_TEST_CASE(netfulfilledman_expiry_at_slot_boundaries)
+{
+    const int64_t nExpireTime = Params().FulfilledRequestExpireTime();
+    const CService addr = GetAddr(1);
+
+    // Expire right before, on and right after the boundaries of the slots of every level
+    for (int64_t nBoundary : {LEVEL1_TICKS * 1000, LEVEL2_TICKS * 1000, WHEEL_TICKS * 10}) {
+        for (int64_t nOffset : {-1, 0, 1}) {
+            const int64_t nExpire = nBoundary + nOffset;
+            for (bool fStepwise : {true, false}) {
+                CNetFulfilledRequestManager man;
+                // Run the wheel for a while first, so that the entry is not added right after the wheel was rebuilt
+                SetMockTime(nExpire - nExpireTime - 5000);
+                man.AddFulfilledRequest(GetAddr(2), "other");
+                SetMockTime(nExpire - nExpireTime);
+                man.AddFulfilledRequest(addr, "request");
+
+                int64_t nTime = nExpire - nExpireTime;
+                while (nTime < nExpire - 2) {
+                    nTime = fStepwise ? nTime + 1 : nExpire - 2;
+                    SetMockTime(nTime);
+                    man.CheckAndRemove();
+                }
+                SetMockTime(nExpire - 1);
+                man.CheckAndRemove();
+                BOOST_CHECK(man.HasFulfilledRequest(addr, "request"));
+                BOOST_CHECK_EQUAL(man.GetFulfilledRequestCount(), 1U);
+
+                SetMockTime(nExpire);
+                BOOST_CHECK(!man.HasFulfilledRequest(addr, "request"));
+                man.CheckAndRemove();
+                BOOST_CHECK_EQUAL(man.GetFulfilledRequestCount(), 0U);
+            }
+        }
+    }
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(netfulfilledman_wrap_around)
+{
+    const int64_t nExpireTime = Params().FulfilledRequestExpireTime();
+    const std::vector<std::string> vecRequests = {"a", "b", "c"};
+    CNetFulfilledRequestManager man;
+    // expiry time of every fulfilled request, as it should be seen by the manager
+    std::map<std::pair<int, std::string>, int64_t> mapExpected;
+
+    // Cover the whole wheel several times, with steps shorter and longer than a slot of each level
+    int64_t nTime = 1000000;
+    const int64_t nEndTime = nTime + WHEEL_TICKS * 3;
+    bool fJumped = false;
+    while (nTime < nEndTime) {
+        int64_t nStep = InsecureRandRange(4) == 0 ? InsecureRandRange(LEVEL2_TICKS) : InsecureRandRange(LEVEL1_TICKS);
+        if (!fJumped && nTime > nEndTime - WHEEL_TICKS) {
+            // a time jump past the range of the wheel rebuilds it
+            nStep = WHEEL_TICKS + 10;
+            fJumped = true;
+        }
+        nTime += nStep;
+        SetMockTime(nTime);
+
+        for (int i = 0; i < 3; i++) {
+            int n = InsecureRandRange(8);
+            const std::string& strRequest = vecRequests[InsecureRandRange(vecRequests.size())];
+            if (InsecureRandRange(8) == 0) {
+                man.RemoveAllFulfilledRequests(GetAddr(n));
+                for (const auto& strRemoved : vecRequests) {
+                    mapExpected.erase(std::make_pair(n, strRemoved));
+                }
+            } else {
+                man.AddFulfilledRequest(GetAddr(n), strRequest);
+                mapExpected[std::make_pair(n, strRequest)] = nTime + nExpireTime;
+            }
+        }
+
+        man.CheckAndRemove();
+        for (auto it = mapExpected.begin(); it != mapExpected.end();) {
+            it = it->second <= nTime ? mapExpected.erase(it) : std::next(it);
+        }
+        BOOST_CHECK_EQUAL(man.GetFulfilledRequestCount(), mapExpected.size());
+        for (int n = 0; n < 8; n++) {
+            for (const auto& strRequest : vecRequests) {
+                BOOST_CHECK_EQUAL(man.HasFulfilledRequest(GetAddr(n), strRequest), mapExpected.count(std::make_pair(n, strRequest)) != 0);
+            }
+        }
+    }
+    BOOST_CHECK(fJumped);
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(netfulfilledman_readd_expired)
+{
+    const int64_t nExpireTime = Params().FulfilledRequestExpireTime();
+    const CService addr = GetAddr(1);
+    const int64_t nStart = 1000000;
+    CNetFulfilledRequestManager man;
+
+    SetMockTime(nStart);
+    man.AddFulfilledRequest(addr, "request");
+
+    // Re-add the expired request before it was removed. The wheel entry of the first one expires it right away, the
+    // new one must survive that.
+    SetMockTime(nStart + nExpireTime);
+    BOOST_CHECK(!man.HasFulfilledRequest(addr, "request"));
+    man.AddFulfilledRequest(addr, "request");
+    BOOST_CHECK(man.HasFulfilledRequest(addr, "request"));
+    BOOST_CHECK_EQUAL(man.GetFulfilledRequestCount(), 1U);
+
+    SetMockTime(nStart + 2 * nExpireTime - 1);
+    man.CheckAndRemove();
+    BOOST_CHECK(man.HasFulfilledRequest(addr, "request"));
+    BOOST_CHECK_EQUAL(man.GetFulfilledRequestCount(), 1U);
+
+    // Re-add it after it was removed
+    SetMockTime(nStart + 2 * nExpireTime);
+    man.CheckAndRemove();
+    BOOST_CHECK_EQUAL(man.GetFulfilledRequestCount(), 0U);
+    man.AddFulfilledRequest(addr, "request");
+    BOOST_CHECK(man.HasFulfilledRequest(addr, "request"));
+
+    // Fulfilling it again before it expires postpones the expiry
+    SetMockTime(nStart + 3 * nExpireTime - 10);
+    man.AddFulfilledRequest(addr, "request");
+    SetMockTime(nStart + 3 * nExpireTime);
+    man.CheckAndRemove();
+    BOOST_CHECK(man.HasFulfilledRequest(addr, "request"));
+    BOOST_CHECK_EQUAL(man.GetFulfilledRequestCount(), 1U);
+    SetMockTime(nStart + 4 * nExpireTime - 10);
+    man.CheckAndRemove();
+    BOOST_CHECK(!man.HasFulfilledRequest(addr, "request"));
+    BOOST_CHECK_EQUAL(man.GetFulfilledRequestCount(), 0U);
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
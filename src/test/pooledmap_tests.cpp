@@ -0,0 +1,253 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <memusage.h>
+#include <pooledmap.h>
+
+#include <test/setup_common.h>
+
+#include <map>
+#include <set>
+#include <unordered_map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pooledmap_tests, BasicTestingSetup)
+
+namespace {
+
+struct IdentityHasher {
+    size_t operator()(uint64_t key) const { return key; }
+};
+
+// Puts every key into one of four probe chains, so that lookups have to walk over erased slots
+struct CollidingHasher {
+    size_t operator()(uint64_t key) const { return key % 4; }
+};
+
+// Value type which counts its live instances, to check that entries are destroyed exactly once
+struct Tracked {
+    static int live;
+    uint64_t value;
+
+    Tracked() : value(0) { ++live; }
+    explicit Tracked(uint64_t v) : value(v) { ++live; }
+    Tracked(const Tracked& other) : value(other.value) { ++live; }
+    Tracked& operator=(const Tracked& other) = default;
+    ~Tracked() { --live; }
+};
+int Tracked::live = 0;
+
+template <typename Map, typename Ref>
+void CheckEqual(const Map& map, const Ref& ref)
+{
+    BOOST_CHECK_EQUAL(map.size(), ref.size());
+    BOOST_CHECK_EQUAL(map.empty(), ref.empty());
+    size_t count = 0;
+    for (const auto& entry : map) {
+        auto it = ref.find(entry.first);
+        BOOST_CHECK(it != ref.end() && it->second == entry.second.value);
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, ref.size());
+    for (const auto& entry : ref) {
+        auto it = map.find(entry.first);
+        BOOST_CHECK(it != map.end() && it->second.value == entry.second);
+    }
+}
+
+template <typename Hasher>
+void TestAgainstReference(uint64_t key_range)
+{
+    pooledmap<uint64_t, Tracked, Hasher> map;
+    std::unordered_map<uint64_t, uint64_t> ref;
+
+    for (int i = 0; i < 20000; i++) {
+        uint64_t key = InsecureRandRange(key_range);
+        uint64_t value = InsecureRand32();
+        switch (InsecureRandRange(4)) {
+        case 0: {
+            auto ret = map.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(value));
+            auto ref_ret = ref.emplace(key, value);
+            BOOST_CHECK_EQUAL(ret.second, ref_ret.second);
+            BOOST_CHECK_EQUAL(ret.first->first, key);
+            BOOST_CHECK_EQUAL(ret.first->second.value, ref_ret.first->second);
+            break;
+        }
+        case 1:
+            map[key].value = value;
+            ref[key] = value;
+            break;
+        case 2:
+            BOOST_CHECK_EQUAL(map.erase(key), ref.erase(key));
+            break;
+        case 3:
+            BOOST_CHECK_EQUAL(map.count(key), ref.count(key));
+            break;
+        }
+        BOOST_CHECK_EQUAL(map.size(), ref.size());
+        BOOST_CHECK_EQUAL(Tracked::live, (int)map.size());
+        if (i % 1000 == 0) CheckEqual(map, ref);
+    }
+    CheckEqual(map, ref);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(pooledmap_reference)
+{
+    TestAgainstReference<IdentityHasher>(1000);
+    TestAgainstReference<IdentityHasher>(1ULL << 40);
+    TestAgainstReference<CollidingHasher>(200);
+    BOOST_CHECK_EQUAL(Tracked::live, 0);
+}
+
+BOOST_AUTO_TEST_CASE(pooledmap_erase_while_iterating)
+{
+    pooledmap<uint64_t, Tracked, CollidingHasher> map;
+    for (uint64_t i = 0; i < 1000; i++) {
+        map.emplace(std::piecewise_construct, std::forward_as_tuple(i), std::forward_as_tuple(i));
+    }
+
+    // Every entry is visited exactly once, whether the entries before it were erased or not
+    std::set<uint64_t> visited;
+    for (auto it = map.begin(); it != map.end();) {
+        BOOST_CHECK(visited.insert(it->first).second);
+        if (it->first % 2 == 0) {
+            it = map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    BOOST_CHECK_EQUAL(visited.size(), 1000U);
+    BOOST_CHECK_EQUAL(map.size(), 500U);
+    BOOST_CHECK_EQUAL(Tracked::live, 500);
+    for (uint64_t i = 0; i < 1000; i++) {
+        BOOST_CHECK_EQUAL(map.count(i), i % 2);
+    }
+
+    // Erase the rest the way CCoinsViewDB::BatchWrite does
+    for (auto it = map.begin(); it != map.end(); it = map.erase(it)) {}
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+    BOOST_CHECK_EQUAL(Tracked::live, 0);
+}
+
+BOOST_AUTO_TEST_CASE(pooledmap_rehash_tombstones)
+{
+    pooledmap<uint64_t, Tracked, CollidingHasher> map;
+    std::vector<uint64_t> keys;
+    for (uint64_t i = 0; i < 100; i++) {
+        map.emplace(std::piecewise_construct, std::forward_as_tuple(i), std::forward_as_tuple(i));
+        keys.push_back(i);
+    }
+    // Entry 0 is never erased, its address has to survive all the rehashes below
+    const Tracked* pinned = &map.find(0)->second;
+    const size_t bucket_count = map.bucket_count();
+
+    // Keep the size constant while every erase leaves a marker behind. The markers are dropped by rehashing
+    // into a table of the same size rather than by growing it.
+    uint64_t next_key = 100;
+    for (int i = 0; i < 10000; i++) {
+        size_t pos = 1 + InsecureRandRange(keys.size() - 1);
+        BOOST_CHECK_EQUAL(map.erase(keys[pos]), 1U);
+        keys[pos] = next_key;
+        map.emplace(std::piecewise_construct, std::forward_as_tuple(next_key), std::forward_as_tuple(next_key));
+        next_key++;
+        BOOST_CHECK_EQUAL(map.size(), 100U);
+    }
+    BOOST_CHECK_EQUAL(map.bucket_count(), bucket_count);
+    BOOST_CHECK_EQUAL(&map.find(0)->second, pinned);
+    for (uint64_t key : keys) {
+        auto it = map.find(key);
+        BOOST_CHECK(it != map.end() && it->second.value == key);
+    }
+    BOOST_CHECK(map.find(next_key) == map.end());
+    BOOST_CHECK_EQUAL(Tracked::live, 100);
+}
+
+BOOST_AUTO_TEST_CASE(pooledmap_clear_swap)
+{
+    pooledmap<uint64_t, Tracked, IdentityHasher> map1;
+    pooledmap<uint64_t, Tracked, IdentityHasher> map2;
+    for (uint64_t i = 0; i < 100; i++) {
+        map1.emplace(std::piecewise_construct, std::forward_as_tuple(i), std::forward_as_tuple(i));
+    }
+    map2.emplace(std::piecewise_construct, std::forward_as_tuple(1000), std::forward_as_tuple(1000));
+    const Tracked* entry1 = &map1.find(50)->second;
+    const Tracked* entry2 = &map2.find(1000)->second;
+    const size_t usage1 = map1.DynamicMemoryUsage();
+    const size_t usage2 = map2.DynamicMemoryUsage();
+
+    // Swapping moves the entries, their memory and their addresses along
+    map1.swap(map2);
+    BOOST_CHECK_EQUAL(map1.size(), 1U);
+    BOOST_CHECK_EQUAL(map2.size(), 100U);
+    BOOST_CHECK_EQUAL(&map1.find(1000)->second, entry2);
+    BOOST_CHECK_EQUAL(&map2.find(50)->second, entry1);
+    BOOST_CHECK(map1.find(50) == map1.end());
+    BOOST_CHECK(map2.find(1000) == map2.end());
+    BOOST_CHECK_EQUAL(map1.DynamicMemoryUsage(), usage2);
+    BOOST_CHECK_EQUAL(map2.DynamicMemoryUsage(), usage1);
+    BOOST_CHECK_EQUAL(Tracked::live, 101);
+
+    // Clearing destroys the entries and releases all memory
+    map2.clear();
+    BOOST_CHECK(map2.empty());
+    BOOST_CHECK(map2.begin() == map2.end());
+    BOOST_CHECK_EQUAL(map2.bucket_count(), 0U);
+    BOOST_CHECK_EQUAL(map2.DynamicMemoryUsage(), 0U);
+    BOOST_CHECK(map2.find(50) == map2.end());
+    BOOST_CHECK_EQUAL(Tracked::live, 1);
+
+    // A cleared map can be used again
+    map2[7].value = 7;
+    BOOST_CHECK_EQUAL(map2.size(), 1U);
+    BOOST_CHECK_EQUAL(map2.find(7)->second.value, 7U);
+    BOOST_CHECK_EQUAL(Tracked::live, 2);
+
+    map1.clear();
+    map2.clear();
+    BOOST_CHECK_EQUAL(Tracked::live, 0);
+}
+
+BOOST_AUTO_TEST_CASE(pooledmap_memory_usage)
+{
+    typedef std::pair<const uint64_t, Tracked> value_type;
+    pooledmap<uint64_t, Tracked, IdentityHasher> map;
+    std::unordered_map<uint64_t, Tracked, IdentityHasher> ref;
+    BOOST_CHECK_EQUAL(map.DynamicMemoryUsage(), 0U);
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), 0U);
+
+    size_t usage = 0;
+    for (uint64_t i = 0; i < 100000; i++) {
+        map[i].value = i;
+        ref[i].value = i;
+
+        // Memory is only ever added, when the table grows or a new chunk is allocated
+        const size_t new_usage = memusage::DynamicUsage(map);
+        BOOST_CHECK(new_usage >= usage);
+        usage = new_usage;
+        // The entries and the table are accounted for
+        BOOST_CHECK(usage >= map.size() * sizeof(value_type) + map.bucket_count() * 2 * sizeof(void*));
+    }
+    // Storing the entries in a pool takes no more memory than one allocation per entry
+    BOOST_CHECK(usage <= memusage::DynamicUsage(ref));
+
+    // Erased entries are reused, and erasing alone does not release memory
+    for (uint64_t i = 0; i < 50000; i++) {
+        BOOST_CHECK_EQUAL(map.erase(i), 1U);
+    }
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), usage);
+    for (uint64_t i = 100000; i < 150000; i++) {
+        map[i].value = i;
+    }
+    BOOST_CHECK_EQUAL(map.size(), 100000U);
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), usage);
+
+    map.clear();
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
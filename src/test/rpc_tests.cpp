@@ -340,6 +340,16 @@ BOOST_AUTO_TEST_CASE(rpc_convert_values_generatetoaddress)
     BOOST_CHECK_EQUAL(result[2].get_int(), 9);
 }
 
+BOOST_AUTO_TEST_CASE(rpc_quorum_commitmentcache)
+{
+    UniValue r;
+    BOOST_CHECK_NO_THROW(r = CallRPC("quorum commitmentcache"));
+    BOOST_CHECK_EQUAL(find_value(r.get_obj(), "hits").get_int(), 0);
+    BOOST_CHECK_EQUAL(find_value(r.get_obj(), "misses").get_int(), 0);
+    BOOST_CHECK_EQUAL(find_value(r.get_obj(), "hitrate").get_real(), 0.0);
+    BOOST_CHECK_THROW(CallRPC("quorum commitmentcache extra"), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_CASE(rpc_getblockstats_calculate_percentiles_by_weight)
 {
     int64_t total_weight = 200;
@@ -12,6 +12,7 @@
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
 #include <init.h>
+#include <llmq/quorums_init.h>
 #include <miner.h>
 #include <net.h>
 #include <noui.h>
@@ -19,7 +20,9 @@
 #include <rpc/register.h>
 #include <rpc/server.h>
 #include <script/sigcache.h>
+#include <special/deterministicmns.h>
 #include <special/specialdb.h>
+#include <special/specialtx.h>
 #include <streams.h>
 #include <txdb.h>
 #include <util/memory.h>
@@ -89,6 +92,9 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
     pblocktree.reset(new CBlockTreeDB(1 << 20, true));
     pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
     pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+    pspecialdb.reset(new CSpecialDB(1 << 20, true, true));
+    deterministicMNManager.reset(new CDeterministicMNManager(*pspecialdb));
+    llmq::InitLLMQSystem(*pspecialdb, &scheduler, true, true);
     if (!LoadGenesisBlock(chainparams)) {
         throw std::runtime_error("LoadGenesisBlock failed.");
     }
@@ -99,13 +105,14 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
     }
 
     nScriptCheckThreads = 3;
-    for (int i = 0; i < nScriptCheckThreads - 1; i++)
+    for (int i = 0; i < nScriptCheckThreads - 1; i++) {
         threadGroup.create_thread([i]() { return ThreadScriptCheck(i); });
+        threadGroup.create_thread([i]() { return ThreadSpecialTxCheck(i); });
+        threadGroup.create_thread([i]() { return ThreadHeaderCheck(i); });
+    }
 
     g_banman = MakeUnique<BanMan>(GetDataDir() / "banlist.dat", nullptr, DEFAULT_MISBEHAVING_BANTIME);
     g_connman = MakeUnique<CConnman>(0x1337, 0x1337); // Deterministic randomness for tests.
-
-    pspecialdb.reset(new CSpecialDB(1 << 20, true, true));
 }
 
 TestingSetup::~TestingSetup()
@@ -120,6 +127,8 @@ TestingSetup::~TestingSetup()
     pcoinsTip.reset();
     pcoinsdbview.reset();
     pblocktree.reset();
+    llmq::DestroyLLMQSystem();
+    deterministicMNManager.reset();
     pspecialdb.reset();
 }
 
@@ -147,13 +156,33 @@ TestChain100Setup::TestChain100Setup() : TestingSetup(CBaseChainParams::REGTEST)
 //
 CBlock
 TestChain100Setup::CreateAndProcessBlock(const std::vector<CMutableTransaction>& txns, const CScript& scriptPubKey)
+{
+    const CChainParams& chainparams = Params();
+    CBlock block = CreateBlock(txns, scriptPubKey);
+
+    std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(block);
+    ProcessNewBlock(chainparams, shared_pblock, true, nullptr);
+
+    return block;
+}
+
+CBlock
+TestChain100Setup::CreateBlock(const std::vector<CMutableTransaction>& txns, const CScript& scriptPubKey)
 {
     const CChainParams& chainparams = Params();
     std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey);
     CBlock& block = pblocktemplate->block;
 
-    // Replace mempool-selected txns with just coinbase plus passed-in txns:
+    // Replace mempool-selected txns with just coinbase plus passed-in txns, but keep the quorum commitments which
+    // are required in the mining phase of each DKG interval:
+    std::vector<CTransactionRef> llmqCommitments;
+    for (const auto& tx : block.vtx) {
+        if (tx->nType == TRANSACTION_QUORUM_COMMITMENT) {
+            llmqCommitments.push_back(tx);
+        }
+    }
     block.vtx.resize(1);
+    block.vtx.insert(block.vtx.end(), llmqCommitments.begin(), llmqCommitments.end());
     for (const CMutableTransaction& tx : txns)
         block.vtx.push_back(MakeTransactionRef(tx));
     // IncrementExtraNonce creates a valid coinbase and merkleRoot
@@ -165,11 +194,7 @@ TestChain100Setup::CreateAndProcessBlock(const std::vector<CMutableTransaction>&
 
     while (!CheckProofOfWork(block.GetHash(), block.nBits, chainparams.GetConsensus())) ++block.nNonce;
 
-    std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(block);
-    ProcessNewBlock(chainparams, shared_pblock, true, nullptr);
-
-    CBlock result = block;
-    return result;
+    return block;
 }
 
 TestChain100Setup::~TestChain100Setup()
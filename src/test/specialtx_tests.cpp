@@ -0,0 +1,510 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bls/bls.h>
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <consensus/validation.h>
+#include <key.h>
+#include <llmq/quorums_blockprocessor.h>
+#include <llmq/quorums_commitment.h>
+#include <llmq/quorums_utils.h>
+#include <netbase.h>
+#include <pow.h>
+#include <random.h>
+#include <script/standard.h>
+#include <special/deterministicmns.h>
+#include <special/providertx.h>
+#include <special/specialdb.h>
+#include <special/specialtx.h>
+#include <test/setup_common.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <univalue.h>
+
+extern UniValue CallRPC(std::string args);
+
+BOOST_AUTO_TEST_SUITE(specialtx_tests)
+
+struct TestMasternode {
+    CKey ownerKey;
+    CKey payoutKey;
+    CBLSSecretKey operatorKey;
+    uint256 proTxHash;
+};
+
+static void SignCoinbaseSpends(CMutableTransaction& tx, const CKey& coinbaseKey)
+{
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    for (size_t i = 0; i < tx.vin.size(); i++) {
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, tx, i, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        tx.vin[i].scriptSig = CScript() << vchSig;
+    }
+}
+
+// Builds an MN with unique keys and collateral, which can be added to a list without further setup
+static CDeterministicMNCPtr MakeTestMN(uint64_t internalId, int nRegisteredHeight, int nLastPaidHeight)
+{
+    CKey ownerKey;
+    ownerKey.MakeNewKey(true);
+    auto dmnState = std::make_shared<CDeterministicMNState>();
+    dmnState->keyIDOwner = ownerKey.GetPubKey().GetID();
+    dmnState->nRegisteredHeight = nRegisteredHeight;
+    dmnState->nLastPaidHeight = nLastPaidHeight;
+    auto dmn = std::make_shared<CDeterministicMN>();
+    dmn->proTxHash = InsecureRand256();
+    dmn->internalId = internalId;
+    dmn->collateralOutpoint = COutPoint(InsecureRand256(), 0);
+    dmn->nOperatorReward = 0;
+    dmn->pdmnState = dmnState;
+    return dmn;
+}
+
+// The payment order as it was computed before the payee queue, by sorting all valid MNs
+static std::vector<uint256> GetPayeeOrder(const CDeterministicMNList& mnList)
+{
+    std::vector<std::pair<int, uint256> > order;
+    mnList.ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
+        int height = dmn->pdmnState->nLastPaidHeight;
+        if (dmn->pdmnState->nPoSeRevivedHeight != -1 && dmn->pdmnState->nPoSeRevivedHeight > height) {
+            height = dmn->pdmnState->nPoSeRevivedHeight;
+        } else if (height == 0) {
+            height = dmn->pdmnState->nRegisteredHeight;
+        }
+        order.emplace_back(height, dmn->proTxHash);
+    });
+    std::sort(order.begin(), order.end());
+    std::vector<uint256> result;
+    for (const auto& p : order) {
+        result.emplace_back(p.second);
+    }
+    return result;
+}
+
+static void CheckPayeeQueue(const CDeterministicMNList& mnList)
+{
+    const std::vector<uint256> expected = GetPayeeOrder(mnList);
+    BOOST_CHECK_EQUAL(mnList.GetValidMNsCount(), expected.size());
+    auto payee = mnList.GetMNPayee();
+    BOOST_CHECK(expected.empty() ? !payee : payee && payee->proTxHash == expected.front());
+    std::vector<uint256> projected;
+    for (const auto& dmn : mnList.GetProjectedMNPayees(expected.size() + 1)) {
+        projected.emplace_back(dmn->proTxHash);
+    }
+    BOOST_CHECK(projected == expected);
+    BOOST_CHECK_EQUAL(mnList.GetProjectedMNPayees(2).size(), std::min<size_t>(2, expected.size()));
+}
+
+static CMutableTransaction CreateProRegTx(TestMasternode& mn, const std::vector<CTransactionRef>& coinbases, const CKey& coinbaseKey, int nAddr)
+{
+    mn.ownerKey.MakeNewKey(true);
+    mn.payoutKey.MakeNewKey(true);
+    mn.operatorKey.MakeNewKey();
+
+    CMutableTransaction tx;
+    tx.nVersion = 2;
+    tx.nType = TRANSACTION_PROVIDER_REGISTER;
+    CAmount nValueIn = 0;
+    for (const auto& coinbase : coinbases) {
+        tx.vin.emplace_back(COutPoint(coinbase->GetHash(), 0));
+        nValueIn += coinbase->vout[0].nValue;
+    }
+    CScript scriptPayout = GetScriptForDestination(PKHash(mn.payoutKey.GetPubKey()));
+    tx.vout.emplace_back(1337 * COIN, scriptPayout);
+    tx.vout.emplace_back(nValueIn - 1337 * COIN, scriptPayout);
+
+    CProRegTx proTx;
+    proTx.collateralOutpoint = COutPoint(uint256(), 0);
+    proTx.addr = LookupNumeric(strprintf("1.1.1.%d", nAddr).c_str(), 10000);
+    proTx.keyIDOwner = mn.ownerKey.GetPubKey().GetID();
+    proTx.pubKeyOperator = mn.operatorKey.GetPublicKey();
+    proTx.keyIDVoting = proTx.keyIDOwner;
+    proTx.scriptPayout = scriptPayout;
+    proTx.inputsHash = CalcTxInputsHash(CTransaction(tx));
+    SetTxPayload(tx, proTx);
+
+    SignCoinbaseSpends(tx, coinbaseKey);
+    mn.proTxHash = tx.GetHash();
+    return tx;
+}
+
+static CMutableTransaction CreateProUpServTx(const TestMasternode& mn, const CBLSSecretKey& signKey, const CTransactionRef& coinbase, const CKey& coinbaseKey)
+{
+    CMutableTransaction tx;
+    tx.nVersion = 2;
+    tx.nType = TRANSACTION_PROVIDER_UPDATE_SERVICE;
+    tx.vin.emplace_back(COutPoint(coinbase->GetHash(), 0));
+    tx.vout.emplace_back(coinbase->vout[0].nValue, coinbase->vout[0].scriptPubKey);
+
+    CProUpServTx proTx;
+    proTx.proTxHash = mn.proTxHash;
+    proTx.addr = LookupNumeric("1.1.2.1", 10000);
+    proTx.inputsHash = CalcTxInputsHash(CTransaction(tx));
+    proTx.sig = signKey.Sign(::SerializeHash(proTx));
+    SetTxPayload(tx, proTx);
+
+    SignCoinbaseSpends(tx, coinbaseKey);
+    return tx;
+}
+
+static CMutableTransaction CreateCommitmentTx(const std::vector<TestMasternode>& mns, const CBlockIndex* pindexQuorum, int nHeight, bool fValidQuorumSig)
+{
+    const auto& params = Params().GetConsensus().llmqs.at(Consensus::LLMQ_5_60);
+    auto members = llmq::CLLMQUtils::GetAllQuorumMembers(params.type, pindexQuorum);
+
+    CBLSSecretKey quorumKey;
+    quorumKey.MakeNewKey();
+
+    llmq::CFinalCommitmentTxPayload qcTx;
+    qcTx.nHeight = nHeight;
+    llmq::CFinalCommitment& qc = qcTx.commitment;
+    qc = llmq::CFinalCommitment(params, pindexQuorum->GetBlockHash());
+    qc.quorumPublicKey = quorumKey.GetPublicKey();
+    qc.quorumVvecHash = GetRandHash();
+    for (size_t i = 0; i < members.size(); i++) {
+        qc.validMembers[i] = true;
+        qc.signers[i] = true;
+    }
+
+    uint256 commitmentHash = llmq::CLLMQUtils::BuildCommitmentHash(params.type, qc.quorumHash, qc.validMembers, qc.quorumPublicKey, qc.quorumVvecHash);
+    std::vector<CBLSSignature> memberSigs;
+    std::vector<CBLSPublicKey> memberPubKeys;
+    for (const auto& member : members) {
+        for (const auto& mn : mns) {
+            if (mn.proTxHash == member->proTxHash) {
+                memberSigs.emplace_back(mn.operatorKey.Sign(commitmentHash));
+                memberPubKeys.emplace_back(mn.operatorKey.GetPublicKey());
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(memberSigs.size(), members.size());
+    qc.membersSig = CBLSSignature::AggregateSecure(memberSigs, memberPubKeys, commitmentHash);
+    qc.quorumSig = fValidQuorumSig ? quorumKey.Sign(commitmentHash) : quorumKey.Sign(GetRandHash());
+
+    CMutableTransaction tx;
+    tx.nVersion = 2;
+    tx.nType = TRANSACTION_QUORUM_COMMITMENT;
+    SetTxPayload(tx, qcTx);
+    return tx;
+}
+
+static CMutableTransaction CreateCollateralSpendTx(const TestMasternode& mn)
+{
+    CScript scriptPayout = GetScriptForDestination(PKHash(mn.payoutKey.GetPubKey()));
+    CMutableTransaction tx;
+    tx.vin.emplace_back(COutPoint(mn.proTxHash, 0));
+    tx.vout.emplace_back(1336 * COIN, scriptPayout);
+
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPayout, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(mn.payoutKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig = CScript() << vchSig << ToByteVector(mn.payoutKey.GetPubKey());
+    return tx;
+}
+
+// Replace the null commitment the miner included for qcTx's quorum type
+static void ReplaceCommitment(CBlock& block, const CMutableTransaction& qcTx)
+{
+    llmq::CFinalCommitmentTxPayload qc;
+    BOOST_CHECK(GetTxPayload(qcTx, qc));
+    for (auto& tx : block.vtx) {
+        llmq::CFinalCommitmentTxPayload other;
+        if (tx->nType == TRANSACTION_QUORUM_COMMITMENT && GetTxPayload(*tx, other) && other.commitment.llmqType == qc.commitment.llmqType) {
+            tx = MakeTransactionRef(qcTx);
+        }
+    }
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    while (!CheckProofOfWork(block.GetHash(), block.nBits, Params().GetConsensus())) ++block.nNonce;
+}
+
+static std::pair<uint64_t, uint64_t> GetCommitmentCacheStats()
+{
+    uint64_t nHits, nMisses;
+    llmq::quorumBlockProcessor->GetVerifiedCommitmentsStats(nHits, nMisses);
+    return std::make_pair(nHits, nMisses);
+}
+
+static std::string GetRejectReason(const CBlock& block)
+{
+    LOCK(cs_main);
+    CValidationState state;
+    if (TestBlockValidity(state, Params(), block, ::ChainActive().Tip(), false, true)) {
+        return "";
+    }
+    return state.GetRejectReason();
+}
+
+BOOST_AUTO_TEST_CASE(specialtxcheck_empty)
+{
+    // Checks left behind by CCheckQueue::Add must not abort the node if they are queued again
+    CSpecialTxCheck check;
+    BOOST_CHECK(!check());
+
+    CSpecialTxCheck check2([] { return true; });
+    BOOST_CHECK(check2());
+    check.swap(check2);
+    BOOST_CHECK(check());
+    BOOST_CHECK(!check2());
+}
+
+BOOST_FIXTURE_TEST_CASE(verified_commitments_cache, TestingSetup)
+{
+    llmq::CQuorumBlockProcessor processor(*pspecialdb);
+    uint256 commitmentHash = GetRandHash();
+    uint256 otherHash = GetRandHash();
+
+    BOOST_CHECK(!processor.IsCommitmentVerified(commitmentHash));
+    processor.AddVerifiedCommitment(commitmentHash);
+    // Lookups keep the entry
+    BOOST_CHECK(processor.IsCommitmentVerified(commitmentHash));
+    BOOST_CHECK(processor.IsCommitmentVerified(commitmentHash));
+    BOOST_CHECK(!processor.IsCommitmentVerified(otherHash));
+
+    // Entries are salted per instance
+    llmq::CQuorumBlockProcessor processor2(*pspecialdb);
+    BOOST_CHECK(!processor2.IsCommitmentVerified(commitmentHash));
+
+    // Only blocks count as hits and misses
+    uint64_t nHits, nMisses;
+    processor.GetVerifiedCommitmentsStats(nHits, nMisses);
+    BOOST_CHECK_EQUAL(nHits, 0U);
+    BOOST_CHECK_EQUAL(nMisses, 0U);
+}
+
+BOOST_FIXTURE_TEST_CASE(specialtxs_in_block_checkqueue, TestChain100Setup)
+{
+    const auto& consensus = Params().GetConsensus();
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    BOOST_CHECK(nScriptCheckThreads > 0);
+
+    auto mineTo = [&](int nHeight) {
+        while (WITH_LOCK(cs_main, return ::ChainActive().Height()) < nHeight) {
+            m_coinbase_txns.push_back(CreateAndProcessBlock({}, scriptPubKey).vtx[0]);
+        }
+    };
+
+    // Register three masternodes, enough for the minimum size of a LLMQ_5_60 quorum
+    mineTo(consensus.nLLMQActivationHeight - 10);
+    std::vector<TestMasternode> mns(3);
+    std::vector<CMutableTransaction> proRegTxs;
+    for (size_t i = 0; i < mns.size(); i++) {
+        std::vector<CTransactionRef> coinbases(m_coinbase_txns.begin() + i * 27, m_coinbase_txns.begin() + (i + 1) * 27);
+        proRegTxs.emplace_back(CreateProRegTx(mns[i], coinbases, coinbaseKey, i + 1));
+    }
+    CreateAndProcessBlock(proRegTxs, scriptPubKey);
+    BOOST_CHECK_EQUAL(deterministicMNManager->GetListAtChainTip().GetValidMNsCount(), mns.size());
+
+    // Move to the first block of the mining window of the first LLMQ_5_60 quorum after activation
+    const auto& params = consensus.llmqs.at(Consensus::LLMQ_5_60);
+    int nQuorumHeight = consensus.nLLMQActivationHeight - consensus.nLLMQActivationHeight % params.dkgInterval + params.dkgInterval;
+    int nHeight = nQuorumHeight + params.dkgMiningWindowStart;
+    mineTo(nHeight - 1);
+    const CBlockIndex* pindexQuorum = WITH_LOCK(cs_main, return ::ChainActive()[nQuorumHeight]);
+    BOOST_CHECK_EQUAL(llmq::CLLMQUtils::GetAllQuorumMembers(params.type, pindexQuorum).size(), mns.size());
+
+    CTransactionRef coinbase = m_coinbase_txns[mns.size() * 27];
+    auto qcTx = CreateCommitmentTx(mns, pindexQuorum, nHeight, true);
+    auto badQcTx = CreateCommitmentTx(mns, pindexQuorum, nHeight, false);
+    auto proUpServTx = CreateProUpServTx(mns[0], mns[0].operatorKey, coinbase, coinbaseKey);
+    auto badProUpServTx = CreateProUpServTx(mns[0], mns[1].operatorKey, coinbase, coinbaseKey);
+
+    CBlock badQcBlock = CreateBlock({proUpServTx}, scriptPubKey);
+    ReplaceCommitment(badQcBlock, badQcTx);
+    CBlock badProTxBlock = CreateBlock({badProUpServTx}, scriptPubKey);
+    CBlock block = CreateBlock({proUpServTx}, scriptPubKey);
+    ReplaceCommitment(block, qcTx);
+
+    // An invalid signature is rejected for the same reason with and without the check queue
+    int nScriptCheckThreadsOld = nScriptCheckThreads;
+    for (int nThreads : {nScriptCheckThreadsOld, 0}) {
+        nScriptCheckThreads = nThreads;
+        BOOST_CHECK_EQUAL(GetRejectReason(badQcBlock), "bad-qc-invalid");
+        BOOST_CHECK_EQUAL(GetRejectReason(badProTxBlock), "bad-protx-sig");
+    }
+    nScriptCheckThreads = nScriptCheckThreadsOld;
+    // Neither rejected commitments nor TestBlockValidity count towards the cache statistics
+    BOOST_CHECK(GetCommitmentCacheStats() == std::make_pair(uint64_t(0), uint64_t(0)));
+
+    // The commitment signatures are queued before the ProTx signatures
+    ProcessNewBlock(Params(), std::make_shared<const CBlock>(block), true, nullptr);
+    CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        pindex = ::ChainActive().Tip();
+        BOOST_CHECK(pindex->GetBlockHash() == block.GetHash());
+        BOOST_CHECK(llmq::quorumBlockProcessor->HasMinedCommitment(params.type, pindexQuorum->GetBlockHash()));
+    }
+    auto dmn = deterministicMNManager->GetListAtChainTip().GetMN(mns[0].proTxHash);
+    BOOST_CHECK(dmn && dmn->pdmnState->addr == LookupNumeric("1.1.2.1", 10000));
+    BOOST_CHECK(GetCommitmentCacheStats() == std::make_pair(uint64_t(0), uint64_t(1)));
+
+    // The commitment is found in the cache when the block is connected again
+    CValidationState state;
+    BOOST_CHECK(InvalidateBlock(state, Params(), pindex));
+    BOOST_CHECK(!WITH_LOCK(cs_main, return llmq::quorumBlockProcessor->HasMinedCommitment(params.type, pindexQuorum->GetBlockHash())));
+    WITH_LOCK(cs_main, ResetBlockFailureFlags(pindex));
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    BOOST_CHECK(WITH_LOCK(cs_main, return ::ChainActive().Tip()) == pindex);
+    BOOST_CHECK(GetCommitmentCacheStats() == std::make_pair(uint64_t(1), uint64_t(1)));
+
+    UniValue stats = CallRPC("quorum commitmentcache");
+    BOOST_CHECK_EQUAL(find_value(stats.get_obj(), "hits").get_int(), 1);
+    BOOST_CHECK_EQUAL(find_value(stats.get_obj(), "misses").get_int(), 1);
+    BOOST_CHECK_EQUAL(find_value(stats.get_obj(), "hitrate").get_real(), 0.5);
+}
+
+BOOST_FIXTURE_TEST_CASE(payee_queue_order, BasicTestingSetup)
+{
+    CDeterministicMNList mnList(uint256(), 100, 0);
+    CheckPayeeQueue(mnList);
+
+    // Registered and paid heights interleave, and two MNs share a height so the proTxHash decides
+    std::vector<CDeterministicMNCPtr> dmns;
+    const std::vector<std::pair<int, int> > heights = {{10, 0}, {5, 20}, {12, 0}, {3, 12}, {8, 0}, {7, 30}};
+    for (const auto& h : heights) {
+        dmns.emplace_back(MakeTestMN(dmns.size(), h.first, h.second));
+        mnList.AddMN(dmns.back());
+        mnList.SetTotalRegisteredCount(dmns.size());
+        CheckPayeeQueue(mnList);
+    }
+    BOOST_CHECK_EQUAL(mnList.GetMNPayee()->proTxHash, dmns[4]->proTxHash);
+
+    // A copy shares the queue until one of them is modified, the original is not affected
+    const CDeterministicMNList oldList = mnList;
+    const std::vector<uint256> oldOrder = GetPayeeOrder(oldList);
+
+    // Paying the first MN moves it to the back
+    auto payee = mnList.GetMNPayee();
+    auto newState = std::make_shared<CDeterministicMNState>(*payee->pdmnState);
+    newState->nLastPaidHeight = 101;
+    mnList.UpdateMN(payee, newState);
+    CheckPayeeQueue(mnList);
+    BOOST_CHECK_EQUAL(mnList.GetProjectedMNPayees(dmns.size()).back()->proTxHash, payee->proTxHash);
+
+    // Banned MNs leave the queue, revived ones are queued by their revive height
+    newState = std::make_shared<CDeterministicMNState>(*dmns[0]->pdmnState);
+    newState->nPoSeBanHeight = 101;
+    mnList.UpdateMN(dmns[0]->proTxHash, newState);
+    CheckPayeeQueue(mnList);
+    BOOST_CHECK_EQUAL(mnList.GetValidMNsCount(), dmns.size() - 1);
+    newState = std::make_shared<CDeterministicMNState>(*newState);
+    newState->nPoSeBanHeight = -1;
+    newState->nPoSeRevivedHeight = 11;
+    mnList.UpdateMN(dmns[0]->proTxHash, newState);
+    CheckPayeeQueue(mnList);
+    BOOST_CHECK_EQUAL(mnList.GetValidMNsCount(), dmns.size());
+
+    mnList.RemoveMN(dmns[3]->proTxHash);
+    CheckPayeeQueue(mnList);
+    dmns.emplace_back(MakeTestMN(dmns.size(), 1, 0));
+    mnList.AddMN(dmns.back());
+    mnList.SetTotalRegisteredCount(dmns.size());
+    CheckPayeeQueue(mnList);
+    BOOST_CHECK_EQUAL(mnList.GetMNPayee()->proTxHash, dmns.back()->proTxHash);
+
+    BOOST_CHECK(GetPayeeOrder(oldList) == oldOrder);
+    CheckPayeeQueue(oldList);
+
+    // Applying a diff and unserializing rebuild the same queue
+    CBlockIndex index;
+    const uint256 blockHash = InsecureRand256();
+    index.phashBlock = &blockHash;
+    index.nHeight = 101;
+    const CDeterministicMNList diffList = oldList.ApplyDiff(&index, oldList.BuildDiff(mnList));
+    CheckPayeeQueue(diffList);
+    BOOST_CHECK(GetPayeeOrder(diffList) == GetPayeeOrder(mnList));
+
+    CDataStream ds(SER_DISK, CLIENT_VERSION);
+    ds << mnList;
+    CDeterministicMNList readList;
+    ds >> readList;
+    CheckPayeeQueue(readList);
+    BOOST_CHECK(GetPayeeOrder(readList) == GetPayeeOrder(mnList));
+}
+
+BOOST_FIXTURE_TEST_CASE(masternode_list_changes, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    auto getIndex = [](int nHeight) { return WITH_LOCK(cs_main, return ::ChainActive()[nHeight]); };
+    auto getChanges = [&](int nSinceHeight, std::set<uint256>& changed, std::set<uint256>& removed) {
+        std::vector<CDeterministicMNCPtr> vecChanged, vecRemoved;
+        bool ret = deterministicMNManager->GetListChangesSince(getIndex(nSinceHeight), WITH_LOCK(cs_main, return ::ChainActive().Tip()), vecChanged, vecRemoved);
+        changed.clear();
+        removed.clear();
+        for (const auto& dmn : vecChanged) changed.emplace(dmn->proTxHash);
+        for (const auto& dmn : vecRemoved) removed.emplace(dmn->proTxHash);
+        return ret;
+    };
+    std::set<uint256> changed, removed;
+
+    const int nHeight = WITH_LOCK(cs_main, return ::ChainActive().Height());
+    std::vector<TestMasternode> mns(2);
+    std::vector<CMutableTransaction> proRegTxs;
+    for (size_t i = 0; i < mns.size(); i++) {
+        std::vector<CTransactionRef> coinbases(m_coinbase_txns.begin() + i * 27, m_coinbase_txns.begin() + (i + 1) * 27);
+        proRegTxs.emplace_back(CreateProRegTx(mns[i], coinbases, coinbaseKey, i + 1));
+    }
+    CreateAndProcessBlock(proRegTxs, scriptPubKey);
+    BOOST_CHECK_EQUAL(deterministicMNManager->GetListAtChainTip().GetAllMNsCount(), 2U);
+    BOOST_CHECK(getChanges(nHeight, changed, removed));
+    BOOST_CHECK(changed == std::set<uint256>({mns[0].proTxHash, mns[1].proTxHash}));
+    BOOST_CHECK(removed.empty());
+
+    // Only the updated MN is reported
+    CreateAndProcessBlock({CreateProUpServTx(mns[0], mns[0].operatorKey, m_coinbase_txns[mns.size() * 27], coinbaseKey)}, scriptPubKey);
+    BOOST_CHECK(getChanges(nHeight + 1, changed, removed));
+    BOOST_CHECK(changed == std::set<uint256>({mns[0].proTxHash}));
+    BOOST_CHECK(removed.empty());
+
+    // Spending the collateral removes the MN
+    const COutPoint collateral(mns[1].proTxHash, 0);
+    CreateAndProcessBlock({CreateCollateralSpendTx(mns[1])}, scriptPubKey);
+    BOOST_CHECK_EQUAL(deterministicMNManager->GetListAtChainTip().GetAllMNsCount(), 1U);
+    BOOST_CHECK(getChanges(nHeight + 2, changed, removed));
+    BOOST_CHECK(changed.empty());
+    BOOST_CHECK(removed == std::set<uint256>({mns[1].proTxHash}));
+
+    // An MN added and removed again in between is neither changed nor removed
+    BOOST_CHECK(getChanges(nHeight, changed, removed));
+    BOOST_CHECK(changed == std::set<uint256>({mns[0].proTxHash}));
+    BOOST_CHECK(removed.empty());
+
+    // Nothing changed since the tip, and a cursor which is not an ancestor of the tip can't be served
+    BOOST_CHECK(getChanges(nHeight + 3, changed, removed));
+    BOOST_CHECK(changed.empty() && removed.empty());
+    std::vector<CDeterministicMNCPtr> vecChanged, vecRemoved;
+    BOOST_CHECK(!deterministicMNManager->GetListChangesSince(getIndex(nHeight + 3), getIndex(nHeight), vecChanged, vecRemoved));
+
+    // The RPC returns the same changes, with the height to continue from
+    const std::string strCollateral0 = COutPoint(mns[0].proTxHash, 0).ToStringShort();
+    UniValue r = CallRPC(strprintf("masternodelist json - %d", nHeight));
+    BOOST_CHECK_EQUAL(find_value(r.get_obj(), "height").get_int(), nHeight + 3);
+    BOOST_CHECK(!find_value(r.get_obj(), "full").get_bool());
+    BOOST_CHECK_EQUAL(find_value(r.get_obj(), "masternodes").size(), 1U);
+    BOOST_CHECK(find_value(r.get_obj(), "masternodes").exists(strCollateral0));
+    BOOST_CHECK(find_value(r.get_obj(), "removed").empty());
+
+    r = CallRPC(strprintf("masternodelist status - %d", nHeight + 2));
+    BOOST_CHECK(find_value(r.get_obj(), "masternodes").empty());
+    BOOST_CHECK_EQUAL(find_value(r.get_obj(), "removed").size(), 1U);
+    BOOST_CHECK_EQUAL(find_value(r.get_obj(), "removed")[0].get_str(), collateral.ToStringShort());
+
+    // -1 returns the full list, start and count page through it
+    r = CallRPC("masternodelist status - -1");
+    BOOST_CHECK(find_value(r.get_obj(), "full").get_bool());
+    BOOST_CHECK_EQUAL(find_value(r.get_obj(), "masternodes").size(), 1U);
+    r = CallRPC("masternodelist status - -1 1");
+    BOOST_CHECK(find_value(r.get_obj(), "masternodes").empty());
+    r = CallRPC("masternodelist status - -1 0 0");
+    BOOST_CHECK(find_value(r.get_obj(), "masternodes").empty());
+    BOOST_CHECK_THROW(CallRPC("masternodelist status - -1 -1"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,136 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <clientversion.h>
+#include <key.h>
+#include <key_io.h>
+#include <spork.h>
+#include <streams.h>
+#include <test/setup_common.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+// UpdateSpork relays the new spork, which needs g_connman
+BOOST_FIXTURE_TEST_SUITE(spork_tests, TestingSetup)
+
+static std::vector<CKey> SetupSporkKeys(CSporkManager& manager, size_t nKeys, int nMinKeys)
+{
+    std::vector<CKey> keys(nKeys);
+    for (auto& key : keys) {
+        key.MakeNewKey(true);
+        BOOST_CHECK(manager.SetSporkAddress(EncodeDestination(PKHash(key.GetPubKey()))));
+    }
+    BOOST_CHECK(manager.SetMinSporkKeys(nMinKeys));
+    return keys;
+}
+
+static void CheckDefaults(CSporkManager& manager)
+{
+    for (int nSporkID = SPORK_START; nSporkID <= SPORK_END; nSporkID++) {
+        BOOST_CHECK_EQUAL(manager.GetSporkValue(nSporkID), mapSporkDefaults.at(nSporkID));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(spork_defaults)
+{
+    CSporkManager manager;
+    CheckDefaults(manager);
+    BOOST_CHECK(!manager.IsSporkActive(SPORK_4_CHAINLOCKS_ENABLED));
+
+    // Unknown sporks have no value and are never active
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_START - 1), -1);
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_END + 1), -1);
+    BOOST_CHECK(!manager.IsSporkActive(SPORK_START - 1));
+    BOOST_CHECK(!manager.IsSporkActive(SPORK_END + 1));
+}
+
+BOOST_AUTO_TEST_CASE(spork_values_follow_signers)
+{
+    CSporkManager manager;
+    std::vector<CKey> keys = SetupSporkKeys(manager, 3, 2);
+
+    // A single signer is below the threshold, the default stays in effect
+    BOOST_CHECK(manager.SetPrivKey(EncodeSecret(keys[0])));
+    BOOST_CHECK(manager.UpdateSpork(SPORK_4_CHAINLOCKS_ENABLED, 0));
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_4_CHAINLOCKS_ENABLED), mapSporkDefaults.at(SPORK_4_CHAINLOCKS_ENABLED));
+    BOOST_CHECK(!manager.IsSporkActive(SPORK_4_CHAINLOCKS_ENABLED));
+
+    // The second signer makes the value effective, other sporks are not affected
+    BOOST_CHECK(manager.SetPrivKey(EncodeSecret(keys[1])));
+    BOOST_CHECK(manager.UpdateSpork(SPORK_4_CHAINLOCKS_ENABLED, 0));
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_4_CHAINLOCKS_ENABLED), 0);
+    BOOST_CHECK(manager.IsSporkActive(SPORK_4_CHAINLOCKS_ENABLED));
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_5_INSTANTSEND_ENABLED), mapSporkDefaults.at(SPORK_5_INSTANTSEND_ENABLED));
+
+    // Changing the threshold recalculates the values
+    BOOST_CHECK(manager.SetMinSporkKeys(3));
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_4_CHAINLOCKS_ENABLED), mapSporkDefaults.at(SPORK_4_CHAINLOCKS_ENABLED));
+    BOOST_CHECK(manager.SetMinSporkKeys(2));
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_4_CHAINLOCKS_ENABLED), 0);
+
+    // One signer changing its vote breaks the majority
+    BOOST_CHECK(manager.UpdateSpork(SPORK_4_CHAINLOCKS_ENABLED, 1));
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_4_CHAINLOCKS_ENABLED), mapSporkDefaults.at(SPORK_4_CHAINLOCKS_ENABLED));
+    BOOST_CHECK(manager.SetPrivKey(EncodeSecret(keys[0])));
+    BOOST_CHECK(manager.UpdateSpork(SPORK_4_CHAINLOCKS_ENABLED, 1));
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_4_CHAINLOCKS_ENABLED), 1);
+
+    // Loading sporks.dat restores the effective values
+    CDataStream ds(SER_DISK, CLIENT_VERSION);
+    ds << manager;
+    CSporkManager manager2;
+    for (const auto& key : keys) {
+        BOOST_CHECK(manager2.SetSporkAddress(EncodeDestination(PKHash(key.GetPubKey()))));
+    }
+    BOOST_CHECK(manager2.SetMinSporkKeys(2));
+    CheckDefaults(manager2);
+    ds >> manager2;
+    BOOST_CHECK_EQUAL(manager2.GetSporkValue(SPORK_4_CHAINLOCKS_ENABLED), 1);
+
+    manager.Clear();
+    CheckDefaults(manager);
+}
+
+BOOST_AUTO_TEST_CASE(spork_concurrent_reads)
+{
+    CSporkManager manager;
+    std::vector<CKey> keys = SetupSporkKeys(manager, 1, 1);
+    BOOST_CHECK(manager.SetPrivKey(EncodeSecret(keys[0])));
+
+    // Readers must only ever see the default or one of the values written so far, in the order they were written
+    const int64_t nDefault = mapSporkDefaults.at(SPORK_5_INSTANTSEND_ENABLED);
+    const int64_t nUpdates = 200;
+    std::atomic<bool> fDone{false};
+    std::atomic<int> nErrors{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&] {
+            int64_t nLast = 0;
+            while (!fDone) {
+                int64_t nValue = manager.GetSporkValue(SPORK_5_INSTANTSEND_ENABLED);
+                if (nValue == nDefault) {
+                    if (nLast != 0) nErrors++;
+                    continue;
+                }
+                if (nValue < nLast || nValue < 1 || nValue > nUpdates) nErrors++;
+                nLast = nValue;
+            }
+        });
+    }
+    for (int64_t nValue = 1; nValue <= nUpdates; nValue++) {
+        BOOST_CHECK(manager.UpdateSpork(SPORK_5_INSTANTSEND_ENABLED, nValue));
+    }
+    fDone = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    BOOST_CHECK_EQUAL(nErrors, 0);
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_5_INSTANTSEND_ENABLED), nUpdates);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
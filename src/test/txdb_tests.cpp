@@ -0,0 +1,184 @@
+// Copyright (c) 2018-2021 The EMRALS Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <pow.h>
+#include <txdb.h>
+#include <util/memory.h>
+#include <validation.h>
+
+#include <test/setup_common.h>
+
+#include <memory>
+#include <unordered_map>
+
+#include <boost/test/unit_test.hpp>
+
+struct RegtestBasicTestingSetup : public BasicTestingSetup {
+    RegtestBasicTestingSetup() : BasicTestingSetup(CBaseChainParams::REGTEST) {}
+};
+
+BOOST_FIXTURE_TEST_SUITE(txdb_tests, RegtestBasicTestingSetup)
+
+namespace {
+
+/** The result of one LoadBlockIndexGuts call, keyed by block hash like BlockManager::m_block_index */
+struct LoadedIndex
+{
+    std::unordered_map<uint256, std::unique_ptr<CBlockIndex>, BlockHasher> mapIndex;
+    std::unordered_map<const CBlockIndex*, uint256> mapProofOfStakeHashes;
+
+    CBlockIndex* Insert(const uint256& hash)
+    {
+        if (hash.IsNull()) return nullptr;
+        auto it = mapIndex.find(hash);
+        if (it == mapIndex.end()) {
+            it = mapIndex.emplace(hash, MakeUnique<CBlockIndex>()).first;
+            it->second->phashBlock = &it->first;
+        }
+        return it->second.get();
+    }
+};
+
+} // namespace
+
+static bool LoadIndex(CBlockTreeDB& db, int nThreads, LoadedIndex& loaded)
+{
+    return db.LoadBlockIndexGuts(Params().GetConsensus(), [&](const uint256& hash) { return loaded.Insert(hash); }, loaded.mapProofOfStakeHashes, nThreads);
+}
+
+static void CheckEqual(const LoadedIndex& a, const LoadedIndex& b)
+{
+    BOOST_CHECK_EQUAL(a.mapIndex.size(), b.mapIndex.size());
+    BOOST_CHECK_EQUAL(a.mapProofOfStakeHashes.size(), b.mapProofOfStakeHashes.size());
+    for (const auto& p : a.mapIndex) {
+        auto it = b.mapIndex.find(p.first);
+        BOOST_REQUIRE(it != b.mapIndex.end());
+        const CBlockIndex& x = *p.second;
+        const CBlockIndex& y = *it->second;
+        BOOST_CHECK_EQUAL(x.pprev ? x.pprev->GetBlockHash() : uint256(), y.pprev ? y.pprev->GetBlockHash() : uint256());
+        BOOST_CHECK_EQUAL(x.nHeight, y.nHeight);
+        BOOST_CHECK_EQUAL(x.nFile, y.nFile);
+        BOOST_CHECK_EQUAL(x.nDataPos, y.nDataPos);
+        BOOST_CHECK_EQUAL(x.nUndoPos, y.nUndoPos);
+        BOOST_CHECK_EQUAL(x.nVersion, y.nVersion);
+        BOOST_CHECK_EQUAL(x.hashMerkleRoot, y.hashMerkleRoot);
+        BOOST_CHECK_EQUAL(x.nTime, y.nTime);
+        BOOST_CHECK_EQUAL(x.nBits, y.nBits);
+        BOOST_CHECK_EQUAL(x.nNonce, y.nNonce);
+        BOOST_CHECK_EQUAL(x.nStatus, y.nStatus);
+        BOOST_CHECK_EQUAL(x.nTx, y.nTx);
+        BOOST_CHECK_EQUAL(x.nFlags, y.nFlags);
+        BOOST_CHECK_EQUAL(x.nStakeModifier, y.nStakeModifier);
+        auto itPoS = a.mapProofOfStakeHashes.find(&x);
+        if (itPoS != a.mapProofOfStakeHashes.end()) {
+            auto itPoS2 = b.mapProofOfStakeHashes.find(&y);
+            BOOST_CHECK(itPoS2 != b.mapProofOfStakeHashes.end() && itPoS2->second == itPoS->second);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(load_block_index_guts_parallel)
+{
+    CBlockTreeDB db(1 << 20, true);
+
+    // A chain of entries with random looking hashes, so that every key range of the workers gets entries. Every
+    // third block is proof-of-stake, the others carry valid (regtest) proof-of-work.
+    const int nBlocks = 3000;
+    std::vector<std::unique_ptr<CBlockIndex>> vIndex;
+    std::vector<uint256> vHashes(nBlocks);
+    {
+        LOCK(cs_main);
+        for (int i = 0; i < nBlocks; i++) {
+            CBlockHeader header;
+            header.nVersion = 4;
+            header.hashPrevBlock = i ? vHashes[i - 1] : uint256();
+            header.hashMerkleRoot = InsecureRand256();
+            header.nTime = 1000000 + i;
+            header.nBits = UintToArith256(Params().GetConsensus().powLimit).GetCompact();
+            const bool fProofOfStake = i % 3 == 2;
+            while (!fProofOfStake && !CheckProofOfWork(header.GetHash(), header.nBits, Params().GetConsensus())) {
+                header.nNonce++;
+            }
+            vHashes[i] = header.GetHash();
+
+            vIndex.emplace_back(MakeUnique<CBlockIndex>(header));
+            CBlockIndex* pindex = vIndex.back().get();
+            pindex->phashBlock = &vHashes[i];
+            pindex->pprev = i ? vIndex[i - 1].get() : nullptr;
+            pindex->nHeight = i;
+            pindex->nStatus = BLOCK_VALID_SCRIPTS | BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO;
+            pindex->nFile = i / 1000;
+            pindex->nDataPos = 8 + i * 300;
+            pindex->nUndoPos = 8 + i * 100;
+            pindex->nTx = 1 + i % 7;
+            pindex->nStakeModifier = InsecureRandBits(64);
+            CBlockIndexPoSData posData;
+            posData.nMint = i;
+            posData.nMoneySupply = 50 * i;
+            if (fProofOfStake) {
+                pindex->SetProofOfStake();
+                posData.prevoutStake = COutPoint(InsecureRand256(), 1);
+                posData.nStakeTime = header.nTime;
+                posData.hashProofOfStake = InsecureRand256();
+            }
+            pindex->SetPoSData(posData);
+        }
+
+        std::vector<const CBlockIndex*> blockinfo;
+        for (const auto& pindex : vIndex) {
+            blockinfo.emplace_back(pindex.get());
+        }
+        BOOST_CHECK(db.WriteBatchSync({}, 0, blockinfo));
+    }
+
+    // The serial load is the reference
+    LoadedIndex serial;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(LoadIndex(db, 1, serial));
+    }
+    BOOST_CHECK_EQUAL(serial.mapIndex.size(), (size_t)nBlocks);
+    BOOST_CHECK_EQUAL(serial.mapProofOfStakeHashes.size(), (size_t)(nBlocks / 3));
+    for (int i = 0; i < nBlocks; i++) {
+        auto it = serial.mapIndex.find(vHashes[i]);
+        BOOST_REQUIRE(it != serial.mapIndex.end());
+        BOOST_CHECK_EQUAL(it->second->nHeight, i);
+        BOOST_CHECK(it->second->pprev == (i ? serial.mapIndex.at(vHashes[i - 1]).get() : nullptr));
+        BOOST_CHECK_EQUAL(it->second->IsProofOfStake(), vIndex[i]->IsProofOfStake());
+        if (it->second->IsProofOfStake()) {
+            LOCK(cs_main);
+            BOOST_CHECK_EQUAL(serial.mapProofOfStakeHashes.at(it->second.get()), vIndex[i]->GetPoSData().hashProofOfStake);
+        }
+    }
+
+    // Worker counts which split the key space evenly, unevenly and beyond the number of ranges
+    for (int nThreads : {2, 3, 7, 16, 300}) {
+        LoadedIndex parallel;
+        LOCK(cs_main);
+        BOOST_CHECK(LoadIndex(db, nThreads, parallel));
+        CheckEqual(serial, parallel);
+    }
+
+    // A single entry with invalid proof-of-work fails the load, whichever worker reads it
+    CBlockHeader header = vIndex[0]->GetBlockHeader();
+    header.nBits = UintToArith256(uint256S("0x01")).GetCompact();
+    uint256 hashInvalid = header.GetHash();
+    CBlockIndex invalid(header);
+    invalid.phashBlock = &hashInvalid;
+    {
+        LOCK(cs_main);
+        invalid.SetPoSData(CBlockIndexPoSData());
+        BOOST_CHECK(db.WriteBatchSync({}, 0, {&invalid}));
+    }
+    for (int nThreads : {1, 4}) {
+        LoadedIndex failed;
+        LOCK(cs_main);
+        BOOST_CHECK(!LoadIndex(db, nThreads, failed));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
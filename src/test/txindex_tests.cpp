@@ -69,6 +69,28 @@ BOOST_FIXTURE_TEST_CASE(txindex_initial_sync, TestChain100Setup)
         }
     }
 
+    // Check that transaction views agree with the deserialized transactions.
+    for (const auto& txn : m_coinbase_txns) {
+        CTransactionView view;
+        uint256 view_block_hash;
+        if (!txindex.FindTx(txn->GetHash(), block_hash, tx_disk) ||
+            !txindex.FindTxView(txn->GetHash(), view_block_hash, view)) {
+            BOOST_ERROR("FindTxView failed");
+            continue;
+        }
+        BOOST_CHECK(view_block_hash == block_hash);
+        BOOST_CHECK_EQUAL(view.GetOutputCount(), txn->vout.size());
+        for (uint32_t n = 0; n < txn->vout.size(); n++) {
+            CTxOut out;
+            BOOST_CHECK(view.GetOutput(n, out));
+            BOOST_CHECK(out == txn->vout[n]);
+        }
+        CTxOut out;
+        BOOST_CHECK(!view.GetOutput(txn->vout.size(), out));
+        CTransactionRef tx_view = view.GetTransaction();
+        BOOST_CHECK(tx_view && tx_view->GetHash() == txn->GetHash());
+    }
+
     // shutdown sequence (c.f. Shutdown() in init.cpp)
     txindex.Stop();
 
@@ -75,4 +75,35 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+BOOST_AUTO_TEST_CASE(block_header_hashes)
+{
+    // Batch sizes around the threshold take the serial and the parallel path
+    for (size_t nCount : {(size_t)0, (size_t)1, MIN_PARALLEL_HEADER_HASHES - 1, MIN_PARALLEL_HEADER_HASHES, MIN_PARALLEL_HEADER_HASHES + 1, (size_t)2000}) {
+        std::vector<CBlockHeader> headers(nCount);
+        uint256 hashPrev = InsecureRand256();
+        for (CBlockHeader& header : headers) {
+            header.nVersion = InsecureRand32();
+            header.hashPrevBlock = hashPrev;
+            header.hashMerkleRoot = InsecureRand256();
+            header.nTime = InsecureRand32();
+            header.nBits = InsecureRand32();
+            header.nNonce = InsecureRand32();
+            hashPrev = header.GetHash();
+        }
+
+        std::vector<uint256> hashes = GetBlockHeaderHashes(headers);
+        BOOST_CHECK_EQUAL(hashes.size(), nCount);
+        for (size_t i = 0; i < nCount; i++) {
+            BOOST_CHECK(hashes[i] == headers[i].GetHash());
+        }
+
+        // Without script check threads everything is hashed in the calling thread
+        const int nScriptCheckThreadsPrev = nScriptCheckThreads;
+        nScriptCheckThreads = 0;
+        BOOST_CHECK(GetBlockHeaderHashes(headers) == hashes);
+        nScriptCheckThreads = nScriptCheckThreadsPrev;
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
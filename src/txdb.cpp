@@ -15,8 +15,14 @@
 #include <util/system.h>
 #include <util/translation.h>
 
+#include <util/threadnames.h>
+
 #include <stdint.h>
 
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
 #include <boost/thread.hpp>
 
 static const char DB_COIN = 'C';
@@ -30,6 +36,11 @@ static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 
+//! Number of block index entries a LoadBlockIndexGuts worker hands over at once
+static const size_t BLOCK_INDEX_LOAD_BATCH_SIZE = 1024;
+//! Rough size of a block index entry in the database, used to presize the in-memory block index
+static const size_t BLOCK_INDEX_ENTRY_SIZE_ESTIMATE = 150;
+
 namespace {
 
 struct CoinEntry {
@@ -58,15 +69,44 @@ CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(Get
 {
 }
 
+CCoinsViewDB::~CCoinsViewDB()
+{
+    if (m_async_thread.joinable()) m_async_thread.join();
+}
+
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    if (m_async_pending) {
+        LOCK(m_async_mutex);
+        if (m_async_coins) {
+            CCoinsMap::const_iterator it = m_async_coins->find(outpoint);
+            if (it != m_async_coins->end() && (it->second.flags & CCoinsCacheEntry::DIRTY)) {
+                if (it->second.coin.IsSpent()) return false;
+                coin = it->second.coin;
+                return true;
+            }
+        }
+    }
     return db.Read(CoinEntry(&outpoint), coin);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    if (m_async_pending) {
+        LOCK(m_async_mutex);
+        if (m_async_coins) {
+            CCoinsMap::const_iterator it = m_async_coins->find(outpoint);
+            if (it != m_async_coins->end() && (it->second.flags & CCoinsCacheEntry::DIRTY)) {
+                return !it->second.coin.IsSpent();
+            }
+        }
+    }
     return db.Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    if (m_async_pending) {
+        LOCK(m_async_mutex);
+        if (m_async_coins) return m_async_block;
+    }
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -81,12 +121,7 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
     return vhashHeadBlocks;
 }
 
-bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
-    CDBBatch batch(db);
-    size_t count = 0;
-    size_t changed = 0;
-    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
-    int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
+void CCoinsViewDB::StartBatchWrite(CDBBatch& batch, const uint256& hashBlock) const {
     assert(!hashBlock.IsNull());
 
     uint256 old_tip = GetBestBlock();
@@ -105,6 +140,13 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     // interrupting after partial writes from multiple independent reorgs.
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
+}
+
+bool CCoinsViewDB::WriteCoins(CDBBatch& batch, CCoinsMap& mapCoins, const uint256& hashBlock, bool erase) {
+    size_t count = 0;
+    size_t changed = 0;
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
 
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
@@ -116,8 +158,11 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        if (erase) {
+            it = mapCoins.erase(it);
+        } else {
+            ++it;
+        }
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -142,6 +187,89 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     return ret;
 }
 
+bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    // Writes have to be applied in order
+    if (!WaitForAsyncWrite()) return false;
+
+    CDBBatch batch(db);
+    StartBatchWrite(batch, hashBlock);
+    return WriteCoins(batch, mapCoins, hashBlock, true);
+}
+
+bool CCoinsViewDB::BatchWriteAsync(std::unique_ptr<CCoinsMap> mapCoins, const uint256& hashBlock, size_t usage) {
+    if (!WaitForAsyncWrite()) return false;
+    if (m_async_thread.joinable()) m_async_thread.join();
+
+    // Mark the transition before returning, so that if the node stops before
+    // the write is committed, the chain state is rolled forward on startup.
+    CDBBatch batch(db);
+    StartBatchWrite(batch, hashBlock);
+    if (!db.WriteBatch(batch)) return false;
+
+    {
+        LOCK(m_async_mutex);
+        m_async_pending = true;
+        m_async_coins = std::move(mapCoins);
+        m_async_block = hashBlock;
+        m_async_usage = usage;
+        m_async_running = true;
+    }
+    m_async_thread = std::thread(&TraceThread<std::function<void()>>, "coinswrite", std::bind(&CCoinsViewDB::ThreadAsyncWrite, this));
+    return true;
+}
+
+void CCoinsViewDB::ThreadAsyncWrite() {
+    CCoinsMap* coins;
+    uint256 hashBlock;
+    {
+        LOCK(m_async_mutex);
+        coins = m_async_coins.get();
+        hashBlock = m_async_block;
+    }
+
+    // Readers may look up coins concurrently, so the map is left untouched
+    // until the write is committed.
+    bool ret = false;
+    try {
+        CDBBatch batch(db);
+        ret = WriteCoins(batch, *coins, hashBlock, false);
+    } catch (const std::exception& e) {
+        LogPrintf("%s: %s\n", __func__, e.what());
+    }
+
+    std::unique_ptr<CCoinsMap> release;
+    {
+        LOCK(m_async_mutex);
+        if (ret) {
+            release = std::move(m_async_coins);
+            m_async_usage = 0;
+            m_async_pending = false;
+        } else {
+            // Keep serving the coins until the node is shut down
+            m_async_failed = true;
+        }
+        m_async_running = false;
+    }
+    m_async_cv.notify_all();
+
+    if (!ret) {
+        LogPrintf("*** Failed to write to coin database\n");
+        uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details").translated, "", CClientUIInterface::MSG_ERROR | CClientUIInterface::MSG_NOPREFIX);
+        StartShutdown();
+    }
+}
+
+bool CCoinsViewDB::WaitForAsyncWrite() const {
+    WAIT_LOCK(m_async_mutex, lock);
+    m_async_cv.wait(lock, [&] { return !m_async_running; });
+    return !m_async_failed;
+}
+
+size_t CCoinsViewDB::AsyncWriteMemoryUsage() const {
+    LOCK(m_async_mutex);
+    return m_async_usage;
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
@@ -171,6 +299,9 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
 {
+    // Iterate over a consistent state
+    WaitForAsyncWrite();
+
     CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
@@ -266,21 +397,143 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+bool CBlockTreeDB::ReadBlockIndexPoSData(const uint256& hash, CBlockIndexPoSData& data)
+{
+    CDiskBlockIndex diskindex;
+    if (!Read(std::make_pair(DB_BLOCK_INDEX, hash), diskindex)) {
+        return false;
+    }
+    data = diskindex.diskPoSData;
+    return true;
+}
+
+size_t CBlockTreeDB::EstimateBlockIndexEntries() const
+{
+    uint256 hashEnd;
+    memset(hashEnd.begin(), 0xff, hashEnd.size());
+    return EstimateSize(std::make_pair(DB_BLOCK_INDEX, uint256()), std::make_pair(DB_BLOCK_INDEX, hashEnd)) / BLOCK_INDEX_ENTRY_SIZE_ESTIMATE;
+}
+
+namespace {
+
+/** A block index entry read by one of the LoadBlockIndexGuts workers, with its hash already computed and checked */
+struct LoadedBlockIndex
+{
+    uint256 hash;
+    CDiskBlockIndex diskindex;
+};
+
+} // namespace
+
+bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex,
+                                      std::unordered_map<const CBlockIndex*, uint256>& mapProofOfStakeHashes, int nThreads)
 {
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    // The key space is split into ranges by the first byte of the block hash. Every range is read, deserialized,
+    // hashed and checked by its own worker, only linking the entries into the block index happens on this thread.
+    const int nWorkers = std::max(1, std::min(nThreads, 256));
+    // bounds the number of entries which are waiting to be linked
+    const size_t nMaxQueuedBatches = 4 * nWorkers;
+
+    Mutex cs;
+    std::condition_variable cond;
+    std::deque<std::vector<LoadedBlockIndex>> queue;
+    int nRunning = nWorkers;
+    std::atomic<bool> fAbort{false};
+    std::string strError;
+
+    auto worker = [&](int nWorker) {
+        util::ThreadRename(strprintf("loadblkidx.%d", nWorker));
+        const int nBegin = nWorker * 256 / nWorkers;
+        const int nEnd = (nWorker + 1) * 256 / nWorkers;
+
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        uint256 hashStart;
+        *hashStart.begin() = (unsigned char)nBegin;
+        pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, hashStart));
+
+        std::string strWorkerError;
+        std::vector<LoadedBlockIndex> batch;
+        batch.reserve(BLOCK_INDEX_LOAD_BATCH_SIZE);
+        auto pushBatch = [&]() {
+            WAIT_LOCK(cs, lock);
+            cond.wait(lock, [&] { return queue.size() < nMaxQueuedBatches || fAbort; });
+            queue.emplace_back(std::move(batch));
+            cond.notify_all();
+            batch.clear();
+            batch.reserve(BLOCK_INDEX_LOAD_BATCH_SIZE);
+        };
+
+        while (pcursor->Valid() && !fAbort) {
+            std::pair<char, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() >= nEnd) {
+                break;
+            }
+            batch.emplace_back();
+            LoadedBlockIndex& entry = batch.back();
+            if (!pcursor->GetValue(entry.diskindex)) {
+                strWorkerError = "failed to read value";
+                break;
+            }
+            entry.hash = entry.diskindex.GetBlockHash();
+            if (entry.diskindex.IsProofOfWork() && !CheckProofOfWork(entry.hash, entry.diskindex.nBits, consensusParams)) {
+                // ToString needs phashBlock, which is only set once the entry is linked into the block index
+                entry.diskindex.phashBlock = &entry.hash;
+                strWorkerError = "CheckProofOfWork failed: " + entry.diskindex.ToString();
+                break;
+            }
+            if (batch.size() == BLOCK_INDEX_LOAD_BATCH_SIZE) {
+                pushBatch();
+            }
+            pcursor->Next();
+        }
+        if (strWorkerError.empty() && !batch.empty()) {
+            pushBatch();
+        }
+
+        LOCK(cs);
+        if (!strWorkerError.empty() && strError.empty()) {
+            strError = strWorkerError;
+            fAbort = true;
+        }
+        nRunning--;
+        cond.notify_all();
+    };
 
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+    std::vector<std::thread> vWorkers;
+    for (int i = 0; i < nWorkers; i++) {
+        vWorkers.emplace_back(worker, i);
+    }
+    auto joinWorkers = [&]() {
+        {
+            LOCK(cs);
+            fAbort = true;
+            cond.notify_all();
+        }
+        for (auto& t : vWorkers) {
+            t.join();
+        }
+    };
 
     // Load m_block_index
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
+    try {
+        while (true) {
+            boost::this_thread::interruption_point();
+            std::vector<LoadedBlockIndex> batch;
+            {
+                WAIT_LOCK(cs, lock);
+                cond.wait(lock, [&] { return !queue.empty() || nRunning == 0 || fAbort; });
+                if (fAbort || queue.empty()) {
+                    break;
+                }
+                batch = std::move(queue.front());
+                queue.pop_front();
+                cond.notify_all();
+            }
+
+            for (const LoadedBlockIndex& entry : batch) {
+                const CDiskBlockIndex& diskindex = entry.diskindex;
                 // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
+                CBlockIndex* pindexNew = insertBlockIndex(entry.hash);
                 pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
                 pindexNew->nHeight        = diskindex.nHeight;
                 pindexNew->nFile          = diskindex.nFile;
@@ -294,27 +547,23 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
 
-                // proof-of-stake related block index fields
-                pindexNew->nMint          = diskindex.nMint;
-                pindexNew->nMoneySupply   = diskindex.nMoneySupply;
+                // proof-of-stake related block index fields, the cold ones are loaded on demand
                 pindexNew->nFlags         = diskindex.nFlags;
                 pindexNew->nStakeModifier = diskindex.nStakeModifier;
-                pindexNew->prevoutStake   = diskindex.prevoutStake;
-                pindexNew->nStakeTime     = diskindex.nStakeTime;
-                pindexNew->hashProofOfStake = diskindex.hashProofOfStake;
-
-                if (pindexNew->IsProofOfWork() && !CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams))
-                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
-
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
+                if (pindexNew->IsProofOfStake()) {
+                    mapProofOfStakeHashes.emplace(pindexNew, diskindex.diskPoSData.hashProofOfStake);
+                }
             }
-        } else {
-            break;
         }
+    } catch (...) {
+        joinWorkers();
+        throw;
     }
+    joinWorkers();
 
+    if (!strError.empty()) {
+        return error("%s: %s", __func__, strError);
+    }
     return true;
 }
 
@@ -12,10 +12,15 @@
 #include <limitedmap.h>
 #include <index/txindex.h>
 #include <primitives/block.h>
+#include <sync.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -42,6 +47,12 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxTxIndexCache = 1024;
 //! Max memory allocated to all block filter index caches combined in MiB.
 static const int64_t max_filter_index_cache = 1024;
+//! Max memory allocated to the address index cache, if -addressindex (MiB)
+static const int64_t nMaxAddressIndexCache = 1024;
+//! Max memory allocated to the spent index cache, if -spentindex (MiB)
+static const int64_t nMaxSpentIndexCache = 512;
+//! Max memory allocated to the timestamp index cache, if -timestampindex (MiB)
+static const int64_t nMaxTimestampIndexCache = 8;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
@@ -50,8 +61,28 @@ class CCoinsViewDB final : public CCoinsView
 {
 protected:
     CDBWrapper db;
+
+    //! Set while m_async_coins may be non-null, so that readers skip m_async_mutex when nothing is being written
+    std::atomic<bool> m_async_pending{false};
+    mutable Mutex m_async_mutex;
+    mutable std::condition_variable m_async_cv;
+    //! Coins written by the background writer. They are served from here until the write is committed.
+    std::unique_ptr<CCoinsMap> m_async_coins GUARDED_BY(m_async_mutex);
+    //! The best block of the coins being written
+    uint256 m_async_block GUARDED_BY(m_async_mutex);
+    //! Memory used by m_async_coins
+    size_t m_async_usage GUARDED_BY(m_async_mutex){0};
+    bool m_async_running GUARDED_BY(m_async_mutex){false};
+    bool m_async_failed GUARDED_BY(m_async_mutex){false};
+    std::thread m_async_thread;
+
+    void StartBatchWrite(CDBBatch& batch, const uint256& hashBlock) const;
+    bool WriteCoins(CDBBatch& batch, CCoinsMap& mapCoins, const uint256& hashBlock, bool erase);
+    void ThreadAsyncWrite();
+
 public:
     explicit CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -60,6 +91,20 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    /**
+     * Write the coins in a background thread. The database is marked as being in
+     * transition to hashBlock before returning, like BatchWrite does in its first
+     * batch, and reads are served from mapCoins until the write is committed.
+     * A write which is still in progress is waited for first.
+     */
+    bool BatchWriteAsync(std::unique_ptr<CCoinsMap> mapCoins, const uint256& hashBlock, size_t usage);
+
+    //! Wait for a background write to be committed. Returns false if it failed.
+    bool WaitForAsyncWrite() const;
+
+    //! Memory used by the coins of a background write which is not committed yet.
+    size_t AsyncWriteMemoryUsage() const;
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
@@ -110,7 +155,16 @@ public:
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &vect);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    /** Loads all block index entries without their cold proof-of-stake fields. The proof-of-stake hashes are only
+        needed for the stake modifier checksums, which are computed afterwards, so they are returned separately.
+        Reading, deserializing and checking the entries is spread over nThreads workers, insertBlockIndex is only
+        called from the calling thread. */
+    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex,
+                            std::unordered_map<const CBlockIndex*, uint256>& mapProofOfStakeHashes, int nThreads = 1);
+    /** Rough number of block index entries in the database, only meant for presizing containers */
+    size_t EstimateBlockIndexEntries() const;
+    /** Reads the cold proof-of-stake fields of a block index entry, see CBlockIndex::GetPoSData */
+    bool ReadBlockIndexPoSData(const uint256& hash, CBlockIndexPoSData& data);
 };
 
 #endif // EMRALS_TXDB_H
@@ -68,6 +68,17 @@ int64_t GetTimeMicros()
     return now;
 }
 
+int64_t GetThreadCpuTimeMicros()
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+#endif
+    return -1;
+}
+
 int64_t GetSystemTimeInSeconds()
 {
     return GetTimeMicros()/1000000;
@@ -22,6 +22,9 @@ int64_t GetTimeMillis();
 int64_t GetTimeMicros();
 /** Returns the system time (not mockable) */
 int64_t GetSystemTimeInSeconds(); // Like GetTime(), but not mockable
+/** Returns the CPU time consumed by the calling thread in microseconds, or -1 where per-thread CPU clocks are
+    not available */
+int64_t GetThreadCpuTimeMicros();
 
 /** For testing. Set e.g. with the setmocktime rpc, or -mocktime argument */
 void SetMockTime(int64_t nMockTimeIn);
@@ -16,6 +16,7 @@
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
 #include <cuckoocache.h>
+#include <crypto/common.h>
 #include <flatfile.h>
 #include <hash.h>
 #include <index/txindex.h>
@@ -55,6 +56,7 @@
 #include <validationinterface.h>
 #include <warnings.h>
 
+#include <deque>
 #include <future>
 #include <sstream>
 #include <string>
@@ -124,6 +126,7 @@ bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
 size_t nCoinCacheUsage = 5000 * 300;
+bool fAsyncFlush = DEFAULT_ASYNC_FLUSH;
 uint64_t nPruneTarget = 0;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 
@@ -154,6 +157,9 @@ namespace {
     /** Dirty block index entries. */
     std::set<CBlockIndex*> setDirtyBlockIndex;
 
+    /** Entries whose cold proof-of-stake fields were read from the block tree database, oldest first. */
+    std::deque<const CBlockIndex*> g_loaded_pos_data;
+
     /** Dirty block file entries. */
     std::set<int> setDirtyFileInfo;
 } // anon namespace
@@ -195,6 +201,14 @@ static FILE* OpenUndoFile(const FlatFilePos &pos, bool fReadOnly = false);
 static FlatFileSeq BlockFileSeq();
 static FlatFileSeq UndoFileSeq();
 
+//! Number of block index entries whose cold proof-of-stake fields are kept in memory after reading them from disk
+static const size_t MAX_LOADED_POS_DATA = 10000;
+
+//! Number of block files and of undo files which are kept memory mapped for reading
+static const size_t MAX_MAPPED_BLOCK_FILES = 8;
+static FlatFileMapCache g_block_file_maps(MAX_MAPPED_BLOCK_FILES);
+static FlatFileMapCache g_undo_file_maps(MAX_MAPPED_BLOCK_FILES);
+
 bool CheckFinalTx(const CTransaction &tx, int flags)
 {
     AssertLockHeld(cs_main);
@@ -950,6 +964,25 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, const Consensus
     return false;
 }
 
+bool GetTransactionOutput(const COutPoint& outpoint, CTxOut& txOut, uint256& hashBlock)
+{
+    LOCK(cs_main);
+
+    CTransactionRef ptx = mempool.get(outpoint.hash);
+    if (ptx) {
+        if (outpoint.n >= ptx->vout.size()) return false;
+        txOut = ptx->vout[outpoint.n];
+        return true;
+    }
+
+    if (g_txindex) {
+        CTransactionView view;
+        return g_txindex->FindTxView(outpoint.hash, hashBlock, view) && view.GetOutput(outpoint.n, txOut);
+    }
+
+    return false;
+}
+
 
 
 
@@ -981,21 +1014,61 @@ static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessa
     return true;
 }
 
+/**
+ * Find a record written by WriteBlockToDisk or UndoWriteToDisk in a memory mapped file. On success
+ * data spans the record, followed by trailing_size more bytes, and mapping keeps it valid. Fails if
+ * the file cannot be mapped or the record header does not match, in which case the caller should
+ * read the file the regular way, which reports the actual error.
+ */
+static bool GetMappedRecord(FlatFileMapCache& cache, const fs::path& path, unsigned int nPos, size_t trailing_size,
+                            const CMessageHeader::MessageStartChars& message_start,
+                            std::shared_ptr<const FlatFileMapCache::Mapping>& mapping, Span<const unsigned char>& data)
+{
+    const size_t header_size = CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t);
+    if (nPos < header_size) return false;
+
+    mapping = cache.Get(path, nPos);
+    if (!mapping) return false;
+    Span<const unsigned char> file = mapping->GetData();
+    if (memcmp(file.data() + nPos - header_size, message_start, CMessageHeader::MESSAGE_START_SIZE)) return false;
+    const uint32_t size = ReadLE32(file.data() + nPos - sizeof(uint32_t));
+    if (size > MAX_SIZE) return false;
+
+    // Also checks that the file still holds the whole record, a corrupt size must not point past its end.
+    const size_t end = (size_t)nPos + size + trailing_size;
+    mapping = cache.Get(path, end);
+    if (!mapping) return false;
+    data = mapping->GetData().subspan(nPos, size + trailing_size);
+    return true;
+}
+
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    std::shared_ptr<const FlatFileMapCache::Mapping> mapping;
+    Span<const unsigned char> data;
+    if (!pos.IsNull() && GetMappedRecord(g_block_file_maps, BlockFileSeq().FileName(pos), pos.nPos, 0, Params().MessageStart(), mapping, data)) {
+        // Deserialize straight from the mapped file
+        try {
+            SpanReader(SER_DISK, CLIENT_VERSION, data) >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+    } else {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
 
-    // Read block
-    try {
-        filein >> block;
-    }
-    catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        // Read block
+        try {
+            filein >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
 
     // Check the header
@@ -1023,6 +1096,13 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
 
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
 {
+    std::shared_ptr<const FlatFileMapCache::Mapping> mapping;
+    Span<const unsigned char> data;
+    if (!pos.IsNull() && GetMappedRecord(g_block_file_maps, BlockFileSeq().FileName(pos), pos.nPos, 0, message_start, mapping, data)) {
+        block.assign(data.begin(), data.end());
+        return true;
+    }
+
     FlatFilePos hpos = pos;
     hpos.nPos -= 8; // Seek back 8 bytes for meta header
     CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
@@ -1056,6 +1136,11 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
     return true;
 }
 
+bool MapBlockFromDisk(const FlatFilePos& pos, std::shared_ptr<const FlatFileMapCache::Mapping>& mapping, Span<const unsigned char>& data)
+{
+    return !pos.IsNull() && GetMappedRecord(g_block_file_maps, BlockFileSeq().FileName(pos), pos.nPos, 0, Params().MessageStart(), mapping, data);
+}
+
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start)
 {
     FlatFilePos block_pos;
@@ -1111,7 +1196,7 @@ CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams, b
         nSubsidy = 1.5 * COIN;
 
     // Check if we reached the coin max supply.
-    CAmount nMoneySupply = ChainActive().Tip()->nMoneySupply;
+    CAmount nMoneySupply = WITH_LOCK(cs_main, return ChainActive().Tip()->GetPoSData().nMoneySupply);
 
     if (nMoneySupply + nSubsidy >= MAX_MONEY)
         nSubsidy = MAX_MONEY - nMoneySupply;
@@ -1484,6 +1569,26 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
         return error("%s: no undo data available", __func__);
     }
 
+    std::shared_ptr<const FlatFileMapCache::Mapping> mapping;
+    Span<const unsigned char> data;
+    if (GetMappedRecord(g_undo_file_maps, UndoFileSeq().FileName(pos), pos.nPos, sizeof(uint256), Params().MessageStart(), mapping, data)) {
+        // Verify the checksum over the serialized undo data and deserialize it straight from the mapped file
+        Span<const unsigned char> undo_data = data.first(data.size() - sizeof(uint256));
+        CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+        hasher << pindex->pprev->GetBlockHash();
+        hasher.write((const char*)undo_data.data(), undo_data.size());
+        if (hasher.GetHash() != uint256(std::vector<unsigned char>(data.end() - sizeof(uint256), data.end())))
+            return error("%s: Checksum mismatch", __func__);
+
+        try {
+            SpanReader(SER_DISK, CLIENT_VERSION, undo_data) >> blockundo;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+        return true;
+    }
+
     // Open history file to read
     CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
@@ -1643,6 +1748,11 @@ void static FlushBlockFile(bool fFinalize = false)
     bool status = true;
     status &= BlockFileSeq().Flush(block_pos_old, fFinalize);
     status &= UndoFileSeq().Flush(undo_pos_old, fFinalize);
+    if (fFinalize) {
+        // Finalizing truncates the pre-allocated space, mappings of it must not be used anymore.
+        g_block_file_maps.Invalidate(BlockFileSeq().FileName(block_pos_old));
+        g_undo_file_maps.Invalidate(UndoFileSeq().FileName(undo_pos_old));
+    }
     if (!status) {
         AbortNode("Flushing block file to disk failed. This is likely the result of an I/O error.");
     }
@@ -1694,6 +1804,41 @@ void ThreadScriptCheck(int worker_num) {
     scriptcheckqueue.Thread();
 }
 
+/**
+ * Closure representing the stateless part of header validation, which is calculating the header's hash. PoW is not
+ * checked for headers (PoS headers can't be told apart reliably before the block arrives) and block signatures are
+ * not part of headers, so everything else depends on the block index and happens when committing under cs_main.
+ */
+class CHeaderCheck
+{
+private:
+    const CBlockHeader* header{nullptr};
+    uint256* hash{nullptr};
+
+public:
+    CHeaderCheck() {}
+    CHeaderCheck(const CBlockHeader& headerIn, uint256& hashIn) : header(&headerIn), hash(&hashIn) {}
+
+    bool operator()()
+    {
+        *hash = header->GetHash();
+        return true;
+    }
+
+    void swap(CHeaderCheck& check)
+    {
+        std::swap(header, check.header);
+        std::swap(hash, check.hash);
+    }
+};
+
+static CCheckQueue<CHeaderCheck> headercheckqueue(64);
+
+void ThreadHeaderCheck(int worker_num) {
+    util::ThreadRename(strprintf("headerch.%i", worker_num));
+    headercheckqueue.Thread();
+}
+
 VersionBitsCache versionbitscache GUARDED_BY(cs_main);
 
 int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Params& params)
@@ -1828,20 +1973,17 @@ bool CChainState::PoSContextualBlockChecks(const CBlock& block, CValidationState
     // compute nStakeModifierChecksum begin
     unsigned int nFlagsBackup      = pindex->nFlags;
     uint64_t nStakeModifierBackup  = pindex->nStakeModifier;
-    uint256 hashProofOfStakeBackup = pindex->hashProofOfStake;
 
     // set necessary pindex fields
     if (!pindex->SetStakeEntropyBit(nEntropyBit))
         return error("%s: failed SetStakeEntropyBit()", __func__);
     pindex->SetStakeModifier(nStakeModifier, fGeneratedStakeModifier);
-    pindex->hashProofOfStake = hashProofOfStake;
 
-    unsigned int nStakeModifierChecksum = GetStakeModifierChecksum(pindex);
+    unsigned int nStakeModifierChecksum = GetStakeModifierChecksum(pindex, hashProofOfStake);
 
     // undo pindex fields
     pindex->nFlags           = nFlagsBackup;
     pindex->nStakeModifier   = nStakeModifierBackup;
-    pindex->hashProofOfStake = hashProofOfStakeBackup;
     // compute nStakeModifierChecksum end
 
     if (!CheckStakeModifierCheckpoints(pindex->nHeight, nStakeModifierChecksum))
@@ -1855,9 +1997,10 @@ bool CChainState::PoSContextualBlockChecks(const CBlock& block, CValidationState
     if (block.IsProofOfStake())
     {
         pindex->SetProofOfStake();
-        pindex->prevoutStake = block.vtx[1]->vin[0].prevout;
-        pindex->nStakeTime = block.nTime;
-        pindex->hashProofOfStake = hashProofOfStake;
+        CBlockIndexPoSData& posData = pindex->GetMutablePoSData();
+        posData.prevoutStake = block.vtx[1]->vin[0].prevout;
+        posData.nStakeTime = block.nTime;
+        posData.hashProofOfStake = hashProofOfStake;
     }
     if (!pindex->SetStakeEntropyBit(nEntropyBit))
         return error("%s: failed SetStakeEntropyBit()", __func__);
@@ -2210,9 +2353,10 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     // EMRALS: Check Proof-of-Stake, masternode payments and superblocks
 
     // proof-of-stake: keep track of money supply and mint amount.
-    CAmount nMoneySupplyPrev = pindex->pprev ? pindex->pprev->nMoneySupply : 0;
-    pindex->nMoneySupply = nMoneySupplyPrev + (nValueOut - nValueIn) - nFees;
-    pindex->nMint = nValueOut - nValueIn;
+    CAmount nMoneySupplyPrev = pindex->pprev ? pindex->pprev->GetPoSData().nMoneySupply : 0;
+    CBlockIndexPoSData& posData = pindex->GetMutablePoSData();
+    posData.nMoneySupply = nMoneySupplyPrev + (nValueOut - nValueIn) - nFees;
+    posData.nMint = nValueOut - nValueIn;
 
     // // Check PoS expected mint
     // if (block.IsProofOfStake() && pindex->nMint > blockReward)
@@ -2281,6 +2425,23 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     return true;
 }
 
+/**
+ * Frees the cold proof-of-stake fields of the least recently loaded entries, eg. read by RPC or the stake modifier
+ * selection, once more than MAX_LOADED_POS_DATA were loaded. Dirty entries are freed after they have been written,
+ * the tip keeps them as they are needed to connect the next block. Only called while flushing, so that no reference
+ * returned by CBlockIndex::GetPoSData is held anymore.
+ */
+static void ReleaseLoadedPoSData() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    while (g_loaded_pos_data.size() > MAX_LOADED_POS_DATA) {
+        const CBlockIndex* pindex = g_loaded_pos_data.front();
+        g_loaded_pos_data.pop_front();
+        if (pindex != ::ChainActive().Tip() && !setDirtyBlockIndex.count(const_cast<CBlockIndex*>(pindex))) {
+            pindex->ReleasePoSData();
+        }
+    }
+}
+
 bool CChainState::FlushStateToDisk(
     const CChainParams& chainparams,
     CValidationState &state,
@@ -2322,7 +2483,8 @@ bool CChainState::FlushStateToDisk(
             nLastFlush = nNow;
         }
         int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
-        int64_t cacheSize = pcoinsTip->DynamicMemoryUsage();
+        // Coins which are still being written in the background are held in memory as well
+        int64_t cacheSize = pcoinsTip->DynamicMemoryUsage() + pcoinsdbview->AsyncWriteMemoryUsage();
         int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
         bool fCacheLarge = mode == FlushStateMode::PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
@@ -2359,6 +2521,13 @@ bool CChainState::FlushStateToDisk(
                 if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                     return AbortNode(state, "Failed to write to block index database");
                 }
+                // The cold proof-of-stake fields are on disk now. Keep them for the tip only, which is needed to
+                // connect the next block.
+                for (const CBlockIndex* pindex : vBlocks) {
+                    if (pindex != ::ChainActive().Tip()) {
+                        pindex->ReleasePoSData();
+                    }
+                }
             }
             // Finally remove any pruned files
             if (fFlushForPrune)
@@ -2376,14 +2545,23 @@ bool CChainState::FlushStateToDisk(
                 return AbortNode(state, "Disk space is too low!", _("Error: Disk space is too low!").translated, CClientUIInterface::MSG_NOPREFIX);
             }
             // Flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            if (fAsyncFlush && (mode == FlushStateMode::PERIODIC || mode == FlushStateMode::IF_NEEDED) && !fFlushForPrune) {
+                // Hand the changes to the background writer. Keep the cache warm,
+                // unless the flush is meant to free memory.
+                size_t nAsyncUsage = 0;
+                std::unique_ptr<CCoinsMap> coins = pcoinsTip->DetachDirty(fCacheLarge || fCacheCritical, nAsyncUsage);
+                if (!pcoinsdbview->BatchWriteAsync(std::move(coins), pcoinsTip->GetBestBlock(), nAsyncUsage))
+                    return AbortNode(state, "Failed to write to coin database");
+            } else if (!pcoinsTip->Flush()) {
                 return AbortNode(state, "Failed to write to coin database");
+            }
             if (!pspecialdb->CommitRootTransaction())
                 return AbortNode(state, "Failed to commit specialDB");
             nLastFlush = nNow;
             full_flush_completed = true;
         }
     }
+    ReleaseLoadedPoSData();
     if (full_flush_completed) {
         // Update best block in wallet (so we can detect restored wallets).
         GetMainSignals().ChainStateFlushed(m_chain.GetLocator());
@@ -3234,18 +3412,19 @@ void ResetBlockFailureFlags(CBlockIndex *pindex) {
     return ::ChainstateActive().ResetBlockFailureFlags(pindex);
 }
 
-CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block, bool fProofOfStake, enum BlockStatus nStatus)
+CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block, const uint256& hash, bool fProofOfStake, enum BlockStatus nStatus)
 {
     AssertLockHeld(cs_main);
 
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator it = m_block_index.find(hash);
     if (it != m_block_index.end())
         return it->second;
 
-    // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
+    // Construct new block index object, there is nothing in the database yet to lazily load the cold fields from
+    CBlockIndex* pindexNew = AllocateBlockIndex();
+    *pindexNew = CBlockIndex(block);
+    pindexNew->SetPoSData(CBlockIndexPoSData());
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -3736,11 +3915,10 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fProofOfStake)
+bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, const uint256& hash, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fProofOfStake)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = m_block_index.find(hash);
     CBlockIndex *pindex = nullptr;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
@@ -3778,7 +3956,7 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState
 
         if (llmq::chainLocksHandler->HasConflictingChainLock(pindexPrev->nHeight + 1, hash)) {
             if (pindex == nullptr)
-                AddToBlockIndex(block, block.nNonce == 0, BLOCK_CONFLICT_CHAINLOCK);
+                AddToBlockIndex(block, hash, block.nNonce == 0, BLOCK_CONFLICT_CHAINLOCK);
             return state.Invalid(ValidationInvalidReason::CONSENSUS, error("%s: header %s conflicts with chainlock", __func__, hash.ToString()), REJECT_INVALID, "bad-chainlock");
         }
 
@@ -3821,7 +3999,7 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState
         }
     }
     if (pindex == nullptr)
-        pindex = AddToBlockIndex(block, fProofOfStake);
+        pindex = AddToBlockIndex(block, hash, fProofOfStake);
 
     if (ppindex)
         *ppindex = pindex;
@@ -3832,25 +4010,58 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState
     return true;
 }
 
+std::vector<uint256> GetBlockHeaderHashes(const std::vector<CBlockHeader>& headers)
+{
+    std::vector<uint256> hashes(headers.size());
+    if (!nScriptCheckThreads || headers.size() < MIN_PARALLEL_HEADER_HASHES) {
+        for (size_t i = 0; i < headers.size(); i++) {
+            hashes[i] = headers[i].GetHash();
+        }
+        return hashes;
+    }
+
+    CCheckQueueControl<CHeaderCheck> control(&headercheckqueue);
+    std::vector<CHeaderCheck> vChecks;
+    vChecks.reserve(headers.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+        vChecks.emplace_back(headers[i], hashes[i]);
+    }
+    control.Add(vChecks);
+    control.Wait();
+    return hashes;
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
+    return ProcessNewBlockHeaders(headers, GetBlockHeaderHashes(headers), state, chainparams, ppindex, first_invalid);
+}
+
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, const std::vector<uint256>& hashes, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
+{
+    assert(hashes.size() == headers.size());
     if (first_invalid != nullptr) first_invalid->SetNull();
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        // The whole batch is committed to the block index in one go, so it's enough to check the index consistency
+        // once at the end
+        bool accepted = true;
+        for (size_t i = 0; i < headers.size(); i++) {
+            const CBlockHeader& header = headers[i];
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            bool accepted = g_blockman.AcceptBlockHeader(header, state, chainparams, &pindex, header.nFlags & CBlockIndex::BLOCK_PROOF_OF_STAKE);
-            ::ChainstateActive().CheckBlockIndex(chainparams.GetConsensus());
-
+            accepted = g_blockman.AcceptBlockHeader(header, hashes[i], state, chainparams, &pindex, header.nFlags & CBlockIndex::BLOCK_PROOF_OF_STAKE);
             if (!accepted) {
                 if (first_invalid) *first_invalid = header;
-                return false;
+                break;
             }
             if (ppindex) {
                 *ppindex = pindex;
             }
         }
+        ::ChainstateActive().CheckBlockIndex(chainparams.GetConsensus());
+        if (!accepted) {
+            return false;
+        }
     }
     NotifyHeaderTip();
     return true;
@@ -3886,7 +4097,7 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
     CBlockIndex *pindexDummy = nullptr;
     CBlockIndex *&pindex = ppindex ? *ppindex : pindexDummy;
 
-    if (!m_blockman.AcceptBlockHeader(block, state, chainparams, &pindex, (block.nNonce == 0)))
+    if (!m_blockman.AcceptBlockHeader(block, block.GetHash(), state, chainparams, &pindex, (block.nNonce == 0)))
          return false;
 
     //! no need, we wont even get here unless checkblock/checkblockheader succeeds
@@ -4097,6 +4308,8 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         FlatFilePos pos(*it, 0);
+        g_block_file_maps.Invalidate(BlockFileSeq().FileName(pos));
+        g_undo_file_maps.Invalidate(UndoFileSeq().FileName(pos));
         fs::remove(BlockFileSeq().FileName(pos));
         fs::remove(UndoFileSeq().FileName(pos));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -4242,19 +4455,50 @@ CBlockIndex * BlockManager::InsertBlockIndex(const uint256& hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
+    CBlockIndex* pindexNew = AllocateBlockIndex();
     mi = m_block_index.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
     return pindexNew;
 }
 
+CBlockIndex* BlockManager::AllocateBlockIndex()
+{
+    AssertLockHeld(cs_main);
+
+    if (m_block_index_chunks.empty() || m_block_index_chunk_used == BLOCK_INDEX_CHUNK_SIZE) {
+        m_block_index_chunks.emplace_back(new CBlockIndex[BLOCK_INDEX_CHUNK_SIZE]);
+        m_block_index_chunk_used = 0;
+    }
+    return &m_block_index_chunks.back()[m_block_index_chunk_used++];
+}
+
+// Defined here rather than in chain.cpp as it needs pblocktree
+CBlockIndexPoSData& CBlockIndex::LoadPoSData() const
+{
+    AssertLockHeld(cs_main);
+    CBlockIndexPoSData* data = new CBlockIndexPoSData();
+    posData.reset(data);
+    // Entries which were never written keep the defaults, whatever is set on them is written with the next flush
+    if (phashBlock && pblocktree) {
+        pblocktree->ReadBlockIndexPoSData(*phashBlock, *data);
+        g_loaded_pos_data.push_back(this);
+    }
+    return *data;
+}
+
 bool BlockManager::LoadBlockIndex(
     const Consensus::Params& consensus_params,
     CBlockTreeDB& blocktree,
     std::set<CBlockIndex*, CBlockIndexWorkComparator>& block_index_candidates)
 {
-    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }))
+    // Avoid rehashing the block index over and over while it is loaded
+    const size_t nEstimatedEntries = blocktree.EstimateBlockIndexEntries();
+    m_block_index.reserve(nEstimatedEntries);
+
+    std::unordered_map<const CBlockIndex*, uint256> mapProofOfStakeHashes;
+    mapProofOfStakeHashes.reserve(nEstimatedEntries);
+    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }, mapProofOfStakeHashes, std::max(nScriptCheckThreads, 1)))
         return false;
 
     boost::this_thread::interruption_point();
@@ -4302,7 +4546,8 @@ bool BlockManager::LoadBlockIndex(
             pindexBestHeader = pindex;
 
         // proof-of-stake: calculate stake modifier checksum
-        pindex->nStakeModifierChecksum = GetStakeModifierChecksum(pindex);
+        auto itProof = mapProofOfStakeHashes.find(pindex);
+        pindex->nStakeModifierChecksum = GetStakeModifierChecksum(pindex, itProof != mapProofOfStakeHashes.end() ? itProof->second : uint256());
         if (ChainActive().Contains(pindex))
             if (!CheckStakeModifierCheckpoints(pindex->nHeight, pindex->nStakeModifierChecksum))
                 return error("%s: failed stake modifier checkpoint height=%d, modifier=0x%016llx", __func__, pindex->nHeight, pindex->nStakeModifier);
@@ -4315,11 +4560,9 @@ void BlockManager::Unload() {
     m_failed_blocks.clear();
     m_blocks_unlinked.clear();
 
-    for (const BlockMap::value_type& entry : m_block_index) {
-        delete entry.second;
-    }
-
     m_block_index.clear();
+    m_block_index_chunks.clear();
+    m_block_index_chunk_used = 0;
 }
 
 bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
@@ -4774,6 +5017,7 @@ void UnloadBlockIndex()
     vinfoBlockFile.clear();
     nLastBlockFile = 0;
     setDirtyBlockIndex.clear();
+    g_loaded_pos_data.clear();
     setDirtyFileInfo.clear();
     versionbitscache.Clear();
     for (int b = 0; b < VERSIONBITS_NUM_BITS; b++) {
@@ -13,6 +13,7 @@
 #include <amount.h>
 #include <coins.h>
 #include <crypto/common.h> // for ReadLE64
+#include <flatfile.h>
 #include <fs.h>
 #include <policy/feerate.h>
 #include <protocol.h> // For CMessageHeader::MessageStartChars
@@ -85,6 +86,8 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Header batches smaller than this are hashed in the calling thread, handing them off costs more than it saves */
+static const size_t MIN_PARALLEL_HEADER_HASHES = 64;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 128;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -118,8 +121,13 @@ static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
+/** Default for -asyncflush */
+static const bool DEFAULT_ASYNC_FLUSH = false;
 static const bool DEFAULT_TXINDEX = true;
 static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
+static const bool DEFAULT_ADDRESSINDEX = false;
+static const bool DEFAULT_SPENTINDEX = false;
+static const bool DEFAULT_TIMESTAMPINDEX = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
@@ -159,6 +167,8 @@ extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
 extern size_t nCoinCacheUsage;
+/** Whether periodic and memory driven flushes write the coins database in the background */
+extern bool fAsyncFlush;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
 /** If the tip is older than this (in seconds), the node is considered to be in initial block download. */
@@ -233,6 +243,13 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
  * @param[out] first_invalid First header that fails validation, if one exists
  */
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex = nullptr, CBlockHeader* first_invalid = nullptr) LOCKS_EXCLUDED(cs_main);
+/** Same as above, but with the hashes of the headers already calculated by GetBlockHeaderHashes */
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, const std::vector<uint256>& hashes, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex = nullptr, CBlockHeader* first_invalid = nullptr) LOCKS_EXCLUDED(cs_main);
+/**
+ * Calculate the hashes of a batch of headers. Big batches (e.g. during headers-first sync) are hashed in parallel
+ * by the header check threads, so that only the contextual checks remain for the (serial) commit under cs_main.
+ */
+std::vector<uint256> GetBlockHeaderHashes(const std::vector<CBlockHeader>& headers);
 
 /** Open a block file (blk?????.dat) */
 FILE* OpenBlockFile(const FlatFilePos &pos, bool fReadOnly = false);
@@ -251,8 +268,12 @@ bool LoadChainTip(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_m
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck(int worker_num);
+/** Run an instance of the header hashing thread */
+void ThreadHeaderCheck(int worker_num);
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(const uint256& hash, CTransactionRef& tx, const Consensus::Params& params, uint256& hashBlock, const CBlockIndex* const blockIndex = nullptr);
+/** Retrieve a single transaction output like GetTransaction, without deserializing the rest of a transaction found on disk */
+bool GetTransactionOutput(const COutPoint& outpoint, CTxOut& txOut, uint256& hashBlock);
 /**
  * Find the best known block, and make it the tip of the block chain
  *
@@ -374,6 +395,9 @@ bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::P
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
+/** Map the block at pos. On success data spans the serialized block and mapping keeps it valid. Fails
+ *  if the block file cannot be mapped, in which case the block has to be read the regular way. */
+bool MapBlockFromDisk(const FlatFilePos& pos, std::shared_ptr<const FlatFileMapCache::Mapping>& mapping, Span<const unsigned char>& data);
 
 /** Reprocess a number of blocks to try and get on the correct chain again **/
 bool DisconnectBlocks(int blocks);
@@ -450,6 +474,12 @@ struct CBlockIndexWorkComparator
  * candidate tips is not maintained here.
  */
 class BlockManager {
+private:
+    /** Block index entries are allocated in chunks of this many entries, see AllocateBlockIndex */
+    static constexpr size_t BLOCK_INDEX_CHUNK_SIZE = 4096;
+    std::vector<std::unique_ptr<CBlockIndex[]>> m_block_index_chunks GUARDED_BY(cs_main);
+    size_t m_block_index_chunk_used GUARDED_BY(cs_main){0};
+
 public:
     BlockMap m_block_index GUARDED_BY(cs_main);
     PrevBlockMap m_prev_block_index GUARDED_BY(cs_main);
@@ -497,16 +527,25 @@ public:
     /** Clear all data members. */
     void Unload() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-    CBlockIndex* AddToBlockIndex(const CBlockHeader& block, bool fProofOfStake, enum BlockStatus nStatus = BLOCK_VALID_TREE) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    CBlockIndex* AddToBlockIndex(const CBlockHeader& block, bool fProofOfStake, enum BlockStatus nStatus = BLOCK_VALID_TREE) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        return AddToBlockIndex(block, block.GetHash(), fProofOfStake, nStatus);
+    }
+    /** Same as above, but with the hash of the header already known */
+    CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const uint256& hash, bool fProofOfStake, enum BlockStatus nStatus = BLOCK_VALID_TREE) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Create a new block index entry for a given block hash */
     CBlockIndex* InsertBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** Returns a new null entry, entries are stored densely and only released all at once by Unload */
+    CBlockIndex* AllocateBlockIndex() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     /**
      * If a block header hasn't already been seen, call CheckBlockHeader on it, ensure
      * that it doesn't descend from an invalid block, and then add it to m_block_index.
+     * hash must be the hash of block, which callers usually computed ahead of time outside of cs_main.
      */
     bool AcceptBlockHeader(
         const CBlockHeader& block,
+        const uint256& hash,
         CValidationState& state,
         const CChainParams& chainparams,
         CBlockIndex** ppindex,
@@ -289,8 +289,15 @@ static int64_t AddTx(CWallet& wallet, uint32_t lockTime, int64_t mockTime, int64
         LOCK(cs_main);
         wallet.AddToWallet(wtx);
     }
-    LOCK(wallet.cs_wallet);
-    return wallet.mapWallet.at(wtx.GetHash()).nTimeSmart;
+    int64_t nTimeSmart = WITH_LOCK(wallet.cs_wallet, return wallet.mapWallet.at(wtx.GetHash()).nTimeSmart);
+    if (block) {
+        // Only the entries allocated by the block manager are freed when the block index is unloaded
+        LOCK(cs_main);
+        uint256 hash = block->GetBlockHash();
+        ::BlockIndex().erase(hash);
+        delete block;
+    }
+    return nTimeSmart;
 }
 
 // Simple test to verify assignment of CWalletTx::nSmartTime value. Could be
@@ -5494,7 +5494,7 @@ bool CWallet::CreateCoinStake(unsigned int nBits,
             COutPoint prevoutStake = COutPoint(out.tx->GetHash(), out.i);
             nTryTime = nTxNewTime + 45 - n; // TODO: change 45 to nHashDrift
 
-            if (CheckStakeKernelHash(nBits, ChainActive().Tip(), block, out.tx->tx, prevoutStake, nTryTime, hashProofOfStake))
+            if (CheckStakeKernelHash(nBits, ChainActive().Tip(), block, out.tx->tx->vout[out.i].nValue, prevoutStake, nTryTime, hashProofOfStake))
             {
                 // Found a kernel
                 LogPrint(BCLog::KERNEL, "%s: kernel found\n", __func__);
@@ -9,6 +9,8 @@
   * node0, node1, and node2 will have different dbcrash ratios, and different
     dbcache sizes
   * node3 will be a regular node, with no crashing.
+  * with --asyncflush, node0, node1 and node2 write their coins database in
+    the background.
   * The nodes will not connect to each other.
 
 - use default test framework starting chain. initialize starting_tip_height to
@@ -37,6 +39,10 @@ from test_framework.util import assert_equal, create_confirmed_utxos, hex_str_to
 
 
 class ChainstateWriteCrashTest(EMRALSTestFramework):
+    def add_options(self, parser):
+        parser.add_argument("--asyncflush", dest="asyncflush", default=False, action="store_true",
+                            help="Write the coins database of the crashing nodes in the background (-asyncflush=1)")
+
     def set_test_params(self):
         self.num_nodes = 4
         self.setup_clean_chain = False
@@ -62,6 +68,10 @@ class ChainstateWriteCrashTest(EMRALSTestFramework):
         self.skip_if_no_wallet()
 
     def setup_network(self):
+        if self.options.asyncflush:
+            # Crashes may now also hit the background writer, after the head blocks have been marked
+            for args in self.extra_args[:3]:
+                args.append("-asyncflush=1")
         self.add_nodes(self.num_nodes, extra_args=self.extra_args)
         self.start_nodes()
         self.import_deterministic_coinbase_privkeys()
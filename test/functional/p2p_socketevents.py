@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+# Copyright (c) 2018-2021 The EMRALS Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the -socketevents modes.
+
+For every mode which is supported on this platform:
+
+- Restart both nodes with the mode and connect them
+- Mine blocks on one node and sync them to the other, which keeps the send queues busy
+- Flood a P2P connection so that receiving is paused and resumed, then check that it is still served
+- Disconnect and reconnect the nodes
+
+Also check that an unknown mode is rejected on startup.
+"""
+
+import random
+import sys
+
+from test_framework.messages import CInv, msg_inv
+from test_framework.mininode import P2PInterface
+from test_framework.test_framework import EMRALSTestFramework
+from test_framework.test_node import ErrorMatch
+from test_framework.util import (
+    assert_equal,
+    connect_nodes,
+    disconnect_nodes,
+    wait_until,
+)
+
+
+class SocketEventsTest(EMRALSTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+
+    def get_supported_modes(self):
+        # poll and epoll are only used on Linux, see compat.h
+        if sys.platform.startswith('linux'):
+            return ["select", "poll", "epoll"]
+        return ["select"]
+
+    def test_mode(self, mode):
+        self.log.info("Test -socketevents=%s" % mode)
+        for i in range(self.num_nodes):
+            self.restart_node(i, ["-socketevents=%s" % mode, "-maxreceivebuffer=1"])
+        connect_nodes(self.nodes[0], 1)
+        wait_until(lambda: all(len(node.getpeerinfo()) == 1 for node in self.nodes), timeout=30)
+
+        self.nodes[0].generate(100)
+        self.sync_blocks()
+
+        self.log.info("Pause and resume receiving from a flooding peer")
+        peer = self.nodes[1].add_p2p_connection(P2PInterface())
+        # Every message is much bigger than the 1000 bytes receive buffer, so receiving is paused after each of them
+        for _ in range(20):
+            peer.send_message(msg_inv([CInv(1, random.getrandbits(256)) for _ in range(1000)]))
+        peer.sync_with_ping(timeout=60)
+        assert_equal(len(self.nodes[1].getpeerinfo()), 2)
+        self.nodes[1].disconnect_p2ps()
+
+        self.log.info("Reconnect the nodes")
+        disconnect_nodes(self.nodes[0], 1)
+        wait_until(lambda: all(len(node.getpeerinfo()) == 0 for node in self.nodes), timeout=30)
+        connect_nodes(self.nodes[0], 1)
+        self.nodes[1].generate(10)
+        self.sync_blocks()
+
+    def run_test(self):
+        self.log.info("Test that an unknown mode is rejected")
+        self.stop_node(0)
+        self.nodes[0].assert_start_raises_init_error(
+            ["-socketevents=unknown"],
+            r"Error: Invalid -socketevents \('unknown'\) specified\. Only these modes are supported: select.*",
+            match=ErrorMatch.FULL_REGEX)
+        self.start_node(0)
+
+        for mode in self.get_supported_modes():
+            self.test_mode(mode)
+
+
+if __name__ == '__main__':
+    SocketEventsTest().main()
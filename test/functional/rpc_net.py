@@ -36,6 +36,7 @@ class NetTest(EMRALSTestFramework):
         self._test_getaddednodeinfo()
         self._test_getpeerinfo()
         self._test_getnodeaddresses()
+        self._test_getpeermessagecosts()
 
     def _test_connection_count(self):
         # connect_nodes_bi connects each node to the other
@@ -85,6 +86,11 @@ class NetTest(EMRALSTestFramework):
         assert_equal(self.nodes[0].getnetworkinfo()['networkactive'], True)
         assert_equal(self.nodes[0].getnetworkinfo()['connections'], 2)
 
+        # the handshake messages went through the default lane
+        lanes = self.nodes[0].getnetworkinfo()['messagelanes']
+        assert_equal([lane['name'] for lane in lanes], ['priority', 'default', 'bulk'])
+        assert_greater_than_or_equal(lanes[1]['processed'], 1)
+
     def _test_getaddednodeinfo(self):
         assert_equal(self.nodes[0].getaddednodeinfo(), [])
         # add a node (node2) to node0
@@ -106,6 +112,23 @@ class NetTest(EMRALSTestFramework):
         assert_equal(peer_info[0][0]['minfeefilter'], Decimal("0.00000500"))
         assert_equal(peer_info[1][0]['minfeefilter'], Decimal("0.00001000"))
 
+    def _test_getpeermessagecosts(self):
+        self.nodes[0].ping()
+        wait_until(lambda: all('pong' in peer['costs_per_msg'] for peer in self.nodes[0].getpeermessagecosts()), timeout=1)
+        peer_costs = self.nodes[0].getpeermessagecosts()
+        assert_equal(len(peer_costs), 2)
+        for peer in peer_costs:
+            pong = peer['costs_per_msg']['pong']
+            assert_greater_than_or_equal(pong['count'], 1)
+            assert_greater_than_or_equal(pong['bytes'], 32)
+            assert_greater_than_or_equal(peer['cputime'], pong['cputime'])
+        # peers are sorted by the CPU time they cost
+        assert_greater_than_or_equal(peer_costs[0]['cputime'], peer_costs[1]['cputime'])
+
+        peer_id = peer_costs[1]['id']
+        assert_equal([peer['id'] for peer in self.nodes[0].getpeermessagecosts(peer_id)], [peer_id])
+        assert_raises_rpc_error(-29, "Node not found in connected nodes", self.nodes[0].getpeermessagecosts, 1000)
+
     def _test_getnodeaddresses(self):
         self.nodes[0].add_p2p_connection(P2PInterface())
 